@@ -13,13 +13,55 @@ SOURCES += \
         main.cc \
         mainwindow.cc \
         glwidget.cc \
-        my_getline.c
+        my_getline.c \
+        stage_timer.c \
+        trace.c \
+        memory_stats.c \
+        parallel.c \
+        weld.c \
+        reorder.c \
+        compact.c \
+        arena.c \
+        out_of_core.c \
+        model_cache.c \
+        obj_reload.c \
+        mesh_loader.c \
+        obj_export.c \
+        camera.c \
+        quality.c \
+        point_cloud.c \
+        obj_stream.c \
+        obj_index.c \
+        cpu_dispatch.c \
+        half_edge.c \
+        bvh.c
 
 HEADERS += \
         backend.h \
         mainwindow.h \
         glwidget.h \
-        my_getline.h
+        my_getline.h \
+        stage_timer.h \
+        trace.h \
+        memory_stats.h \
+        parallel.h \
+        weld.h \
+        reorder.h \
+        compact.h \
+        arena.h \
+        out_of_core.h \
+        model_cache.h \
+        obj_reload.h \
+        mesh_loader.h \
+        obj_export.h \
+        camera.h \
+        quality.h \
+        point_cloud.h \
+        obj_stream.h \
+        obj_index.h \
+        cpu_dispatch.h \
+        half_edge.h \
+        bvh.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,395 @@
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include "arena.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_FIRST_BLOCK (1u << 20)
+#define ARENA_HUGE_PAGE (2u << 20)
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*!
+ * \brief ArenaBlock_t
+ *
+ * Block of a temporary region, the data follows the header. Each new block
+ * of a region is twice as large as the previous one, so a region has a
+ * logarithmic number of blocks however much it holds.
+ */
+typedef struct ArenaBlock_t {
+  struct ArenaBlock_t* next;
+  size_t size;
+  size_t used;
+} ArenaBlock_t;
+
+typedef struct ArenaRegion_t {
+  struct ArenaRegion_t* next;
+  ArenaBlock_t* blocks;
+  size_t next_block_size;
+} ArenaRegion_t;
+
+typedef struct ArenaMapping_t {
+  struct ArenaMapping_t* next;
+  void* pointer;
+  size_t mapped_bytes;
+  MemCategory_t category;
+  size_t bytes;
+  int huge;
+  int thp;
+} ArenaMapping_t;
+
+struct Arena_t {
+  unsigned long long id;
+  pthread_mutex_t lock;
+  ArenaRegion_t* regions;
+  ArenaMapping_t* mappings;
+  atomic_llong temp_used;
+  atomic_llong temp_high_water;
+  atomic_llong temp_reserved;
+  long long mesh_live;
+  long long mesh_high_water;
+  long long huge_page_bytes;
+  long long thp_bytes;
+};
+
+// Identifies arenas in the per-thread cache, addresses can be reused.
+static atomic_ullong arena_next_id = 1;
+static Arena_t* arena_current = NULL;
+
+typedef struct ArenaThreadCache_t {
+  unsigned long long arena_id;
+  ArenaRegion_t* region;
+} ArenaThreadCache_t;
+
+static _Thread_local ArenaThreadCache_t arena_thread_cache;
+
+static size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void raisePeak(atomic_llong* peak, long long value) {
+  long long current = atomic_load_explicit(peak, memory_order_relaxed);
+  while (value > current &&
+         !atomic_compare_exchange_weak_explicit(peak, &current, value,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+Arena_t* arenaCreate(void) {
+  Arena_t* arena = calloc(1, sizeof(Arena_t));
+  if (arena == NULL) return NULL;
+  arena->id = atomic_fetch_add(&arena_next_id, 1);
+  pthread_mutex_init(&arena->lock, NULL);
+  return arena;
+}
+
+static void unmapMesh(ArenaMapping_t* mapping) {
+  if (mapping->mapped_bytes > 0) {
+    munmap(mapping->pointer, mapping->mapped_bytes);
+  } else {
+    free(mapping->pointer);
+  }
+  memAccountRelease(mapping->category, (long long)mapping->bytes);
+}
+
+static void freeRegionBlocks(ArenaRegion_t* region, int keep_first) {
+  ArenaBlock_t* block = region->blocks;
+  while (block != NULL) {
+    ArenaBlock_t* next = block->next;
+    if (keep_first && next == NULL) {
+      // The oldest block is the smallest, keep it for the next temporaries
+      block->used = 0;
+      region->blocks = block;
+      return;
+    }
+    memAccountRelease(MEM_LOADER_TEMP, (long long)block->size);
+    free(block);
+    block = next;
+  }
+  region->blocks = NULL;
+}
+
+/*!
+ * \brief arenaDestroy
+ *
+ * Releases every temporary block and mesh mapping of the arena. Pointers
+ * obtained from it become invalid. The arena must not be current.
+ */
+void arenaDestroy(Arena_t* arena) {
+  if (arena == NULL) return;
+  ArenaRegion_t* region = arena->regions;
+  while (region != NULL) {
+    ArenaRegion_t* next = region->next;
+    freeRegionBlocks(region, 0);
+    free(region);
+    region = next;
+  }
+  ArenaMapping_t* mapping = arena->mappings;
+  while (mapping != NULL) {
+    ArenaMapping_t* next = mapping->next;
+    unmapMesh(mapping);
+    free(mapping);
+    mapping = next;
+  }
+  pthread_mutex_destroy(&arena->lock);
+  free(arena);
+}
+
+/*!
+ * \brief arenaResetTemp
+ *
+ * Releases all temporaries at once, keeping one block per region for reuse.
+ * No other thread may allocate from the arena meanwhile.
+ */
+void arenaResetTemp(Arena_t* arena) {
+  if (arena == NULL) return;
+  long long reserved = 0;
+  for (ArenaRegion_t* region = arena->regions; region != NULL;
+       region = region->next) {
+    freeRegionBlocks(region, 1);
+    if (region->blocks != NULL) reserved += (long long)region->blocks->size;
+    region->next_block_size = ARENA_FIRST_BLOCK * 2;
+  }
+  atomic_store(&arena->temp_used, 0);
+  atomic_store(&arena->temp_reserved, reserved);
+}
+
+static ArenaRegion_t* threadRegion(Arena_t* arena) {
+  if (arena_thread_cache.arena_id == arena->id) {
+    return arena_thread_cache.region;
+  }
+  ArenaRegion_t* region = calloc(1, sizeof(ArenaRegion_t));
+  if (region == NULL) return NULL;
+  region->next_block_size = ARENA_FIRST_BLOCK;
+  pthread_mutex_lock(&arena->lock);
+  region->next = arena->regions;
+  arena->regions = region;
+  pthread_mutex_unlock(&arena->lock);
+  arena_thread_cache.arena_id = arena->id;
+  arena_thread_cache.region = region;
+  return region;
+}
+
+/*!
+ * \brief arenaAllocTemp
+ *
+ * Bump-allocates bytes from the calling thread's region, 16-byte aligned.
+ * Needs no locking once the thread has its region. The memory is released
+ * by arenaResetTemp() or arenaDestroy(), never individually.
+ *
+ * \return NULL if bytes is 0 or memory is exhausted.
+ */
+void* arenaAllocTemp(Arena_t* arena, size_t bytes) {
+  if (arena == NULL || bytes == 0) return NULL;
+  ArenaRegion_t* region = threadRegion(arena);
+  if (region == NULL) return NULL;
+  bytes = alignUp(bytes, ARENA_ALIGNMENT);
+  const size_t header = alignUp(sizeof(ArenaBlock_t), ARENA_ALIGNMENT);
+  ArenaBlock_t* block = region->blocks;
+  if (block == NULL || block->size - block->used < bytes) {
+    size_t size = region->next_block_size;
+    while (size < bytes) size *= 2;
+    block = malloc(header + size);
+    if (block == NULL) return NULL;
+    block->size = size;
+    block->used = 0;
+    block->next = region->blocks;
+    region->blocks = block;
+    region->next_block_size = size * 2;
+    atomic_fetch_add(&arena->temp_reserved, (long long)size);
+    memAccountAdd(MEM_LOADER_TEMP, (long long)size);
+  }
+  void* pointer = (char*)block + header + block->used;
+  block->used += bytes;
+  const long long used =
+      atomic_fetch_add(&arena->temp_used, (long long)bytes) + (long long)bytes;
+  raisePeak(&arena->temp_high_water, used);
+  return pointer;
+}
+
+// Maps bytes of zeroed memory, preferring huge pages for large arrays.
+static int mapMesh(ArenaMapping_t* mapping) {
+  const size_t bytes = mapping->bytes;
+#if defined(MAP_HUGETLB)
+  if (bytes >= ARENA_HUGE_PAGE) {
+    const size_t size = alignUp(bytes, ARENA_HUGE_PAGE);
+    void* pointer = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (pointer != MAP_FAILED) {
+      mapping->pointer = pointer;
+      mapping->mapped_bytes = size;
+      mapping->huge = 1;
+      return 0;
+    }
+  }
+#endif
+#if defined(MAP_ANONYMOUS)
+  const size_t size = alignUp(bytes, 4096);
+  void* pointer = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pointer != MAP_FAILED) {
+    mapping->pointer = pointer;
+    mapping->mapped_bytes = size;
+#if defined(MADV_HUGEPAGE)
+    // Explicit huge pages are often not reserved, let the kernel use
+    // transparent ones instead
+    mapping->thp = bytes >= ARENA_HUGE_PAGE &&
+                   madvise(pointer, size, MADV_HUGEPAGE) == 0;
+#endif
+    return 0;
+  }
+#endif
+  mapping->pointer = malloc(bytes);
+  return mapping->pointer != NULL ? 0 : -1;
+}
+
+/*!
+ * \brief arenaAllocMesh
+ *
+ * Allocates a mesh array as its own page mapping, backed by huge pages when
+ * it is at least 2 MiB and the system provides them. Thread-safe.
+ *
+ * \return NULL if bytes is 0 or memory is exhausted.
+ */
+void* arenaAllocMesh(Arena_t* arena, MemCategory_t category, size_t bytes) {
+  if (arena == NULL || bytes == 0) return NULL;
+  ArenaMapping_t* mapping = calloc(1, sizeof(ArenaMapping_t));
+  if (mapping == NULL) return NULL;
+  mapping->category = category;
+  mapping->bytes = bytes;
+  if (mapMesh(mapping) != 0) {
+    free(mapping);
+    return NULL;
+  }
+  memAccountAdd(category, (long long)bytes);
+  pthread_mutex_lock(&arena->lock);
+  mapping->next = arena->mappings;
+  arena->mappings = mapping;
+  arena->mesh_live += (long long)bytes;
+  if (arena->mesh_live > arena->mesh_high_water) {
+    arena->mesh_high_water = arena->mesh_live;
+  }
+  if (mapping->huge) arena->huge_page_bytes += (long long)bytes;
+  if (mapping->thp) arena->thp_bytes += (long long)bytes;
+  pthread_mutex_unlock(&arena->lock);
+  return mapping->pointer;
+}
+
+/*!
+ * \brief arenaFreeMesh
+ *
+ * Unmaps one mesh array before the arena is destroyed, e.g. the old vertex
+ * array after a pass built a new one. Pointers not from arenaAllocMesh are
+ * ignored.
+ */
+void arenaFreeMesh(Arena_t* arena, MemCategory_t category, void* pointer,
+                   size_t bytes) {
+  (void)category;
+  (void)bytes;
+  if (arena == NULL || pointer == NULL) return;
+  pthread_mutex_lock(&arena->lock);
+  ArenaMapping_t** link = &arena->mappings;
+  while (*link != NULL && (*link)->pointer != pointer) link = &(*link)->next;
+  ArenaMapping_t* mapping = *link;
+  if (mapping != NULL) {
+    *link = mapping->next;
+    arena->mesh_live -= (long long)mapping->bytes;
+    if (mapping->huge) arena->huge_page_bytes -= (long long)mapping->bytes;
+    if (mapping->thp) arena->thp_bytes -= (long long)mapping->bytes;
+  }
+  pthread_mutex_unlock(&arena->lock);
+  if (mapping != NULL) {
+    unmapMesh(mapping);
+    free(mapping);
+  }
+}
+
+void arenaGetStats(Arena_t* arena, ArenaStats_t* stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (arena == NULL) return;
+  stats->temp_used = atomic_load(&arena->temp_used);
+  stats->temp_high_water = atomic_load(&arena->temp_high_water);
+  stats->temp_reserved = atomic_load(&arena->temp_reserved);
+  pthread_mutex_lock(&arena->lock);
+  stats->mesh_live = arena->mesh_live;
+  stats->mesh_high_water = arena->mesh_high_water;
+  stats->huge_page_bytes = arena->huge_page_bytes;
+  stats->thp_bytes = arena->thp_bytes;
+  for (ArenaRegion_t* region = arena->regions; region != NULL;
+       region = region->next) {
+    stats->regions++;
+  }
+  pthread_mutex_unlock(&arena->lock);
+}
+
+/*!
+ * \brief arenaSetCurrent
+ *
+ * Makes the loader functions allocate from arena, NULL switches back to
+ * malloc. Set it while no load is running, it is read by worker threads.
+ */
+void arenaSetCurrent(Arena_t* arena) { arena_current = arena; }
+
+Arena_t* arenaCurrent(void) { return arena_current; }
+
+/*!
+ * \brief loaderAlloc
+ *
+ * Allocation used by the loader and the post-load passes. With a current
+ * arena, MEM_LOADER_TEMP memory comes from the thread's temporary region
+ * and everything else is a mesh mapping; otherwise it is memAccountMalloc.
+ */
+void* loaderAlloc(MemCategory_t category, size_t bytes) {
+  Arena_t* arena = arena_current;
+  if (arena == NULL) return memAccountMalloc(category, bytes);
+  if (category == MEM_LOADER_TEMP) return arenaAllocTemp(arena, bytes);
+  return arenaAllocMesh(arena, category, bytes);
+}
+
+/*!
+ * \brief loaderFree
+ *
+ * Counterpart of loaderAlloc. Temporaries of a current arena are left for
+ * arenaResetTemp(), mesh arrays are unmapped at once.
+ */
+void loaderFree(MemCategory_t category, void* pointer, size_t bytes) {
+  Arena_t* arena = arena_current;
+  if (arena == NULL) {
+    memAccountFree(category, pointer, bytes);
+  } else if (category != MEM_LOADER_TEMP) {
+    arenaFreeMesh(arena, category, pointer, bytes);
+  }
+}
+
+/*!
+ * \brief loaderShrink
+ *
+ * Shrinks an array from loaderAlloc to new_bytes, keeping its start.
+ *
+ * \return The possibly moved array; the old one if it could not be moved.
+ */
+void* loaderShrink(MemCategory_t category, void* pointer, size_t bytes,
+                   size_t new_bytes) {
+  if (pointer == NULL || new_bytes >= bytes) return pointer;
+  if (arena_current == NULL) {
+    void* shrunk = realloc(pointer, new_bytes);
+    if (shrunk == NULL) return pointer;
+    memAccountRelease(category, (long long)(bytes - new_bytes));
+    return shrunk;
+  }
+  void* shrunk = loaderAlloc(category, new_bytes);
+  if (shrunk == NULL) return pointer;
+  memcpy(shrunk, pointer, new_bytes);
+  loaderFree(category, pointer, bytes);
+  return shrunk;
+}
@@ -0,0 +1,62 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "memory_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Arena_t
+ *
+ * Memory of one loaded model. Temporaries are bump-allocated from a region
+ * per thread and are only released together; mesh arrays are separate page
+ * mappings (huge pages where available) that can also be freed one by one.
+ * Destroying the arena releases everything with a handful of calls,
+ * independent of the number of allocations.
+ */
+typedef struct Arena_t Arena_t;
+
+/*!
+ * \brief ArenaStats_t
+ *
+ * Byte counts of an arena. temp_used is what has been handed out since the
+ * last arenaResetTemp(); huge_page_bytes is the part of the mesh mappings
+ * backed by explicit huge pages, thp_bytes the part advised for transparent
+ * huge pages.
+ */
+typedef struct ArenaStats_t {
+  long long temp_used;
+  long long temp_high_water;
+  long long temp_reserved;
+  long long mesh_live;
+  long long mesh_high_water;
+  long long huge_page_bytes;
+  long long thp_bytes;
+  int regions;
+} ArenaStats_t;
+
+Arena_t* arenaCreate(void);
+void arenaDestroy(Arena_t* arena);
+void arenaResetTemp(Arena_t* arena);
+void* arenaAllocTemp(Arena_t* arena, size_t bytes);
+void* arenaAllocMesh(Arena_t* arena, MemCategory_t category, size_t bytes);
+void arenaFreeMesh(Arena_t* arena, MemCategory_t category, void* pointer,
+                   size_t bytes);
+void arenaGetStats(Arena_t* arena, ArenaStats_t* stats);
+
+void arenaSetCurrent(Arena_t* arena);
+Arena_t* arenaCurrent(void);
+void* loaderAlloc(MemCategory_t category, size_t bytes);
+void loaderFree(MemCategory_t category, void* pointer, size_t bytes);
+void* loaderShrink(MemCategory_t category, void* pointer, size_t bytes,
+                   size_t new_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ARENA_H
@@ -1,10 +1,18 @@
 #include <math.h>
 #include <float.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
 #include "backend.h"
+#include "cpu_dispatch.h"
+#include "memory_stats.h"
 #include "my_getline.h"
+#include "obj_index.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
 
 /*!
 * \brief Matrix4x4_t
@@ -133,47 +141,273 @@ void rotateZ(float angle, float x, float y, float z, float* x_rezult, float* y_r
     *z_rezult = out._z;
 }
 
-void scaleModelC(float* vertices, int vertices_count, float scaleFactor) {
-    for (int i = 0; i < vertices_count * 3; ++i)
-        vertices[i] *= scaleFactor;
+// Vertices a thread of a transform or of the parse stages gets at least
+#define VERTEX_GRAIN (1L << 16)
+
+// Arguments of the vertex loops handed to parallelFor
+typedef struct VertexLoop_t {
+    float* vertices;
+    float factor;
+    const float* offset;
+    const float* matrix;
+} VertexLoop_t;
+
+static void __scaleRange(void* context, long begin, long end) {
+    const VertexLoop_t* loop = context;
+    cpuKernels()->scale(loop->vertices + begin * 3, end - begin, loop->factor);
+}
+
+static void __moveRange(void* context, long begin, long end) {
+    const VertexLoop_t* loop = context;
+    cpuKernels()->move(loop->vertices + begin * 3, end - begin, loop->offset);
+}
+
+static void __transformRange(void* context, long begin, long end) {
+    const VertexLoop_t* loop = context;
+    cpuKernels()->transform(loop->vertices + begin * 3, end - begin,
+                            loop->matrix);
 }
 
-void moveModelC(float* vertices, int vertices_count, float dx, float dy, float dz)
+void scaleModelC(float* vertices, long long vertices_count, float scaleFactor) {
+    TRACE_BEGIN(span);
+    const double start = stageTimerNow();
+    VertexLoop_t loop = {vertices, scaleFactor, NULL, NULL};
+    parallelFor((long)vertices_count, VERTEX_GRAIN, __scaleRange, &loop);
+    stageTimerRecord(STAGE_SCALE, start, vertices_count);
+    TRACE_END(span, "scaleModelC");
+}
+
+void moveModelC(float* vertices, long long vertices_count, float dx, float dy, float dz)
 {
-    for (int i = 0; i < vertices_count * 3; i += 3) {
-        vertices[i] += dx;
-        vertices[i + 1] += dy;
-        vertices[i + 2] += dz;
+    TRACE_BEGIN(span);
+    const double start = stageTimerNow();
+    const float offset[3] = {dx, dy, dz};
+    VertexLoop_t loop = {vertices, 0.0f, offset, NULL};
+    parallelFor((long)vertices_count, VERTEX_GRAIN, __moveRange, &loop);
+    stageTimerRecord(STAGE_MOVE, start, vertices_count);
+    TRACE_END(span, "moveModelC");
+}
+
+/*!
+* \brief transformModelC
+*
+* Applies an affine transform to every vertex in one pass, so that several
+* moves, scales and rotations cost one walk over the model.
+*
+* \param matrix Column-major 4x4 matrix like QMatrix4x4::constData(); the
+* bottom row is ignored.
+*
+* The loops of scaleModelC, moveModelC and this function run on the
+* cpuKernels() of the processor, which give the results of the scalar loops,
+* over ranges of vertices spread on the parallelFor() pool. Each vertex is
+* transformed on its own, so the result does not depend on the threads.
+*/
+void transformModelC(float* vertices, long long vertices_count, const float matrix[16])
+{
+    TRACE_BEGIN(span);
+    const double start = stageTimerNow();
+    VertexLoop_t loop = {vertices, 0.0f, NULL, matrix};
+    parallelFor((long)vertices_count, VERTEX_GRAIN, __transformRange, &loop);
+    stageTimerRecord(STAGE_TRANSFORM, start, vertices_count);
+    TRACE_END(span, "transformModelC");
+}
+
+// Bounding box corner and size the last model loaded on this thread was
+// normalized with
+static _Thread_local float normalization_origin[3] = {0.0f, 0.0f, 0.0f};
+static _Thread_local float normalization_scale = 1.0f;
+
+/*!
+* \brief setNormalization
+*
+* Records how a loader normalized a model: original = normalized * scale +
+* origin, per axis. Called by every loader after normalizing.
+*/
+void setNormalization(const float origin[3], float scale) {
+    memcpy(normalization_origin, origin, sizeof(normalization_origin));
+    normalization_scale = scale;
+}
+
+/*!
+* \brief getNormalization
+*
+* Returns what setNormalization recorded last on this thread, so the
+* coordinates of the loaded model can be mapped back to the file's.
+*/
+void getNormalization(float origin[3], float* scale) {
+    memcpy(origin, normalization_origin, sizeof(normalization_origin));
+    *scale = normalization_scale;
+}
+
+// Why the last load on this thread failed
+static _Thread_local LoadError_t load_error = {LOAD_OK, 0, -1, ""};
+
+/*!
+* \brief setLoadError
+*
+* Records why a load failed, with a printf-style message. Called by every
+* loader that fails; LOAD_OK clears the record.
+*/
+void setLoadError(LoadErrorCode_t code, long long line, long long offset, const char* format, ...) {
+    load_error.code = code;
+    load_error.line = line;
+    load_error.offset = offset;
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(load_error.message, sizeof(load_error.message), format, arguments);
+    va_end(arguments);
+}
+
+/*!
+* \brief getLoadError
+*
+* Returns what setLoadError recorded last on this thread.
+*/
+void getLoadError(LoadError_t* error) {
+    *error = load_error;
+}
+
+/*!
+* \brief __readLine
+*
+* my_getline_allocate that adds the time spent reading to *read_ns when timed
+* is set, so the trace can show how much of a pass is file reading. With a
+* current arena the line buffer is one of its temporaries.
+*/
+static ssize_t __getLine(char** line, size_t* len, FILE* file) {
+    Arena_t* arena = arenaCurrent();
+    return arena ? my_getline_arena(line, len, file, arena) : my_getline_allocate(line, len, file);
+}
+
+static ssize_t __readLine(char** line, size_t* len, FILE* file, int timed, double* read_ns) {
+    if (!timed) {
+        return __getLine(line, len, file);
     }
+    const double start = traceNow();
+    const ssize_t length = __getLine(line, len, file);
+    *read_ns += traceNow() - start;
+    return length;
 }
 
-void parseObjFile(const char *filename, float** cubeVertices, int* n_vertices, unsigned int** cubeIndices, int* n_indices) {
-    int vertexIndex = 0;
-    int faceIndex = 0;
+/*!
+* \brief __locateBadIndex
+*
+* Reads the file again up to the line that wrote the index at position, and
+* records which of its vertex references is wrong. Only runs once a load
+* has failed, so the fill pass needs no line bookkeeping.
+*/
+static void __locateBadIndex(FILE* file, long long position, long long n_vertices) {
+    static const int face_corners[6] = {0, 1, 1, 2, 2, 0};
+    static const int line_corners[2] = {0, 1};
+    char* line = NULL;
+    size_t len = 0;
+    ssize_t length;
+    long long number = 0;
+    long long offset = 0;
+    long long n_before = 0;
+    long long index = 0;
+    rewind(file);
+    setLoadError(LOAD_ERROR_INDEX, 0, -1, "vertex index %lld of the model is out of range", position);
+    while ((length = __getLine(&line, &len, file)) != -1) {
+        ++number;
+        const int is_face = line[0] == 'f' && line[1] == ' ';
+        if (line[0] == 'v' && line[1] == ' ') {
+            ++n_before;
+        } else if (is_face || (line[0] == 'l' && line[1] == ' ')) {
+            const int count = is_face ? 3 : 2;
+            const int width = is_face ? 6 : 2;
+            if (position < index + width) {
+                unsigned int corners[3];
+                const int parsed = objParseIndices(line, n_before, corners, count);
+                const int corner = (is_face ? face_corners : line_corners)[position - index];
+                if (parsed < count) {
+                    setLoadError(LOAD_ERROR_SYNTAX, number, offset, "line %lld: %s needs %d vertex indices, found %d", number, is_face ? "face" : "line", count, parsed);
+                } else if (corners[corner] == OBJ_INDEX_INVALID) {
+                    setLoadError(LOAD_ERROR_INDEX, number, offset, "line %lld: vertex reference %d does not name a vertex", number, corner + 1);
+                } else {
+                    setLoadError(LOAD_ERROR_INDEX, number, offset, "line %lld: vertex %u is out of range, the file has %lld vertices", number, corners[corner] + 1, n_vertices);
+                }
+                break;
+            }
+            index += width;
+        }
+        offset += length;
+    }
+    if (line && !arenaCurrent()) free(line);
+}
+
+// Folds the bounding box of vertices [begin, end) into a min-max partial.
+static void __boundsRange(void* context, long begin, long end, void* partial) {
+    const float* vertices = context;
+    float* box = partial;
+    float min[3], max[3];
+    cpuKernels()->bounds(vertices + begin * 3, end - begin, min, max);
+    for (int axis = 0; axis < 3; ++axis) {
+        box[axis] = min[axis] < box[axis] ? min[axis] : box[axis];
+        box[axis + 3] = max[axis] > box[axis + 3] ? max[axis] : box[axis + 3];
+    }
+}
+
+static void __mergeBounds(void* context, void* result, const void* partial) {
+    (void)context;
+    float* box = result;
+    const float* part = partial;
+    for (int axis = 0; axis < 3; ++axis) {
+        box[axis] = part[axis] < box[axis] ? part[axis] : box[axis];
+        box[axis + 3] = part[axis + 3] > box[axis + 3] ? part[axis + 3] : box[axis + 3];
+    }
+}
+
+// Corner and size of the box normalized into [0, 1]
+typedef struct Normalization_t {
+    float* vertices;
+    float min[3];
+    float range;
+} Normalization_t;
+
+static void __normalizeRange(void* context, long begin, long end) {
+    const Normalization_t* normalization = context;
+    for (long i = begin * 3; i < end * 3; i += 3) {
+        float* v = normalization->vertices + i;
+        v[0] = (v[0] - normalization->min[0]) / normalization->range;
+        v[1] = (v[1] - normalization->min[1]) / normalization->range;
+        v[2] = (v[2] - normalization->min[2]) / normalization->range;
+    }
+}
+
+/*!
+* \brief parseObjFile
+*
+* Reads the vertices, faces and lines of an OBJ file in two passes, a count
+* and a fill, and normalizes the vertices into [0, 1]. Faces become three
+* edges and relative (negative) vertex references are resolved. Every index
+* is checked against the vertex count before the model is handed out.
+*
+* \return 0 on success, -1 if the file cannot be read, memory ran out or a
+* face or line is malformed; the reason is kept for getLoadError() and the
+* arrays are NULL with zero counts then.
+*/
+int parseObjFile(const char *filename, float** cubeVertices, long long* n_vertices, unsigned int** cubeIndices, long long* n_indices) {
+    long long vertexIndex = 0;
+    long long faceIndex = 0;
 
+    const double parse_start = stageTimerNow();
     FILE* file = fopen(filename, "r");
     if (file == NULL) {
-        printf("Error opening file\n");
-        return;
+        setLoadError(LOAD_ERROR_OPEN, 0, -1, "cannot open %s", filename);
+        fprintf(stderr, "%s: cannot open\n", filename);
+        return -1;
     }
 
     char* line = NULL;
     size_t len = 0;
+    const int timed = trace_enabled;
+    double read_ns = 0.0;
+    TRACE_BEGIN(count_span);
 
-    float min_x = FLT_MAX, min_y = FLT_MAX, min_z = FLT_MAX;
-    float max_x = FLT_MIN, max_y = FLT_MIN, max_z = FLT_MIN;
-
-    while (my_getline_allocate(&line, &len, file) != -1) {
+    while (__readLine(&line, &len, file, timed, &read_ns) != -1) {
         if (line[0] == 'v' && line[1] == ' ') {
             (*n_vertices)++;
-            float x, y, z;
-            sscanf(line, "v %f %f %f", &x, &y, &z);
-            min_x = fmin(min_x, x);
-            min_y = fmin(min_y, y);
-            min_z = fmin(min_z, z);
-            max_x = fmax(max_x, x);
-            max_y = fmax(max_y, y);
-            max_z = fmax(max_z, z);
         } else if (line[0] == 'l' && line[1] == ' ') {
             (*n_indices) += 2;
         } else if (line[0] == 'f' && line[1] == ' ') {
@@ -181,40 +415,50 @@ void parseObjFile(const char *filename, float** cubeVertices, int* n_vertices, u
         }
     }
 
+    stageTimerRecord(STAGE_PARSE_COUNT, parse_start, *n_vertices);
+    if (count_span >= 0.0) {
+        traceRecordSpanArg("parse.count", count_span, "read_ms", read_ns / 1e6);
+    }
+    const double fill_start = stageTimerNow();
+    read_ns = 0.0;
+    TRACE_BEGIN(index_span);
     rewind(file);
 
-    float max_range = fmax(fmax(max_x - min_x, max_y - min_y), max_z - min_z);
-
-    *cubeVertices = (float*)malloc((*n_vertices) * 3 * sizeof(float));
-    *cubeIndices = (unsigned int*)malloc((*n_indices) * sizeof(unsigned int));
+    *cubeVertices = (float*)loaderAlloc(MEM_VERTICES, (size_t)*n_vertices * 3 * sizeof(float));
+    *cubeIndices = (unsigned int*)loaderAlloc(MEM_INDICES, (size_t)*n_indices * sizeof(unsigned int));
+    if ((*n_vertices > 0 && *cubeVertices == NULL) || (*n_indices > 0 && *cubeIndices == NULL)) {
+        setLoadError(LOAD_ERROR_MEMORY, 0, -1, "not enough memory for %lld vertices and %lld indices", *n_vertices, *n_indices);
+        fprintf(stderr, "%s: %s\n", filename, load_error.message);
+        freeModelC(*cubeVertices, *n_vertices, *cubeIndices, *n_indices);
+        *cubeVertices = NULL;
+        *cubeIndices = NULL;
+        *n_vertices = 0;
+        *n_indices = 0;
+        fclose(file);
+        if (line && !arenaCurrent()) free(line);
+        return -1;
+    }
 
-    while (my_getline_allocate(&line, &len, file) != -1) {
-        if (line[0] == 'v' && line[1] == ' ') {
+    // Writes stay within the counts of the first pass, in case the file
+    // changes in between
+    const long long vertex_end = *n_vertices * 3;
+    while (__readLine(&line, &len, file, timed, &read_ns) != -1) {
+        if (line[0] == 'v' && line[1] == ' ' && vertexIndex < vertex_end) {
             float x, y, z;
             sscanf(line, "v %f %f %f", &x, &y, &z);
-            (*cubeVertices)[vertexIndex++] = (x - min_x) / max_range;
-            (*cubeVertices)[vertexIndex++] = (y - min_y) / max_range;
-            (*cubeVertices)[vertexIndex++] = (z - min_z) / max_range;
+            (*cubeVertices)[vertexIndex++] = x;
+            (*cubeVertices)[vertexIndex++] = y;
+            (*cubeVertices)[vertexIndex++] = z;
         }
         // Parse the line-style obj file
-          else if (line[0] == 'l' && line[1] == ' ') {
-            int indices[2];
-            sscanf(line, "l %d %d", &indices[0], &indices[1]);
-            (*cubeIndices)[faceIndex++] = indices[0] - 1;
-            (*cubeIndices)[faceIndex++] = indices[1] - 1;
+          else if (line[0] == 'l' && line[1] == ' ' && faceIndex + 2 <= *n_indices) {
+            objParseIndices(line, vertexIndex / 3, *cubeIndices + faceIndex, 2);
+            faceIndex += 2;
         }
         // Parse the perfect face-style obj file
-          else if (line[0] == 'f' && line[1] == ' ') {
-            int indices[3];
-            if (strchr(line, '/') == NULL) {
-                sscanf(line, "f %d %d %d", &indices[0], &indices[1], &indices[2]);
-            } else {
-                sscanf(line, "f %d/%*d/%*d %d/%*d/%*d %d/%*d/%*d", &indices[0], &indices[1], &indices[2]);
-            }
-            for (int i = 0; i < 3; i++) {
-                // Convert to zero-based index
-                --indices[i];
-            }
+          else if (line[0] == 'f' && line[1] == ' ' && faceIndex + 6 <= *n_indices) {
+            unsigned int indices[3];
+            objParseIndices(line, vertexIndex / 3, indices, 3);
             // Triangulate and convert to line segments
             (*cubeIndices)[faceIndex++] = indices[0];
             (*cubeIndices)[faceIndex++] = indices[1];
@@ -224,8 +468,73 @@ void parseObjFile(const char *filename, float** cubeVertices, int* n_vertices, u
             (*cubeIndices)[faceIndex++] = indices[0];
         }
     }
+    while (vertexIndex < vertex_end) (*cubeVertices)[vertexIndex++] = 0.0f;
+    while (faceIndex < *n_indices) (*cubeIndices)[faceIndex++] = OBJ_INDEX_INVALID;
+    if (index_span >= 0.0) {
+        traceRecordSpanArg("parse.index", index_span, "read_ms", read_ns / 1e6);
+    }
+
+    TRACE_BEGIN(validate_span);
+    const long long bad = objFindBadIndex(*cubeIndices, *n_indices, *n_vertices);
+    TRACE_END(validate_span, "parse.validate");
+    if (bad >= 0) {
+        __locateBadIndex(file, bad, *n_vertices);
+        fprintf(stderr, "%s: %s\n", filename, load_error.message);
+        freeModelC(*cubeVertices, *n_vertices, *cubeIndices, *n_indices);
+        *cubeVertices = NULL;
+        *cubeIndices = NULL;
+        *n_vertices = 0;
+        *n_indices = 0;
+    }
     fclose(file);
-    if (line) {
+    if (line && !arenaCurrent()) {
+        // The line buffer only grows, so its final size is its peak size
+        memAccountAdd(MEM_LOADER_TEMP, (long long)len);
+        memAccountRelease(MEM_LOADER_TEMP, (long long)len);
         free(line);
     }
+    if (bad >= 0) return -1;
+
+    // The bounding box comes from the filled array rather than the count
+    // pass, so it runs on the vector kernels of cpuKernels(), and on the
+    // parallelFor() pool like the normalization. Minimum and maximum do not
+    // depend on the order, so neither does the box.
+    TRACE_BEGIN(bounds_span);
+    float box[6] = {FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+    if (parallelReduce((long)*n_vertices, VERTEX_GRAIN, __boundsRange, __mergeBounds,
+                       *cubeVertices, box, sizeof(box)) != 0) {
+        cpuKernels()->bounds(*cubeVertices, *n_vertices, box, box + 3);
+    }
+    float* max = box + 3;
+    for (int axis = 0; axis < 3; ++axis) max[axis] = fmax(FLT_MIN, max[axis]);
+    const float min_x = box[0], min_y = box[1], min_z = box[2];
+    float max_range = fmax(fmax(max[0] - min_x, max[1] - min_y), max[2] - min_z);
+    TRACE_END(bounds_span, "parse.bounds");
+
+    // Normalize into [0, 1] in a separate pass so it shows up as its own stage
+    TRACE_BEGIN(normalize_span);
+    Normalization_t normalization = {*cubeVertices, {min_x, min_y, min_z}, max_range};
+    parallelFor((long)(vertexIndex / 3), VERTEX_GRAIN, __normalizeRange, &normalization);
+    TRACE_END(normalize_span, "parse.normalize");
+    const float origin[3] = {min_x, min_y, min_z};
+    setNormalization(origin, max_range);
+    stageTimerRecord(STAGE_PARSE_FILL, fill_start, *n_vertices);
+    stageTimerRecord(STAGE_PARSE_TOTAL, parse_start, *n_vertices);
+    if (trace_enabled) {
+        traceRecordSpanArg("parseObjFile", parse_start, "vertices", *n_vertices);
+    }
+    setLoadError(LOAD_OK, 0, -1, "");
+    return 0;
+}
+
+/*!
+* \brief freeModelC
+*
+* Frees the arrays returned by parseObjFile and removes them from the memory
+* accounting. NULL arrays are ignored. The arena that was current while
+* loading must still be current.
+*/
+void freeModelC(float* vertices, long long n_vertices, unsigned int* indices, long long n_indices) {
+    loaderFree(MEM_VERTICES, vertices, (size_t)n_vertices * 3 * sizeof(float));
+    loaderFree(MEM_INDICES, indices, (size_t)n_indices * sizeof(unsigned int));
 }
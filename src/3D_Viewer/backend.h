@@ -5,6 +5,32 @@
 extern "C" {
 #endif
 
+// Bytes of LoadError_t::message, including the terminating zero
+#define LOAD_ERROR_MESSAGE_BYTES 256
+
+typedef enum LoadErrorCode_t {
+  LOAD_OK,
+  LOAD_ERROR_OPEN,     // the file cannot be opened
+  LOAD_ERROR_FORMAT,   // unknown or malformed file format
+  LOAD_ERROR_MEMORY,   // not enough memory for the model
+  LOAD_ERROR_SYNTAX,   // a face or line with too few vertex references
+  LOAD_ERROR_INDEX     // a vertex reference outside the vertices of the file
+} LoadErrorCode_t;
+
+/*!
+ * \brief LoadError_t
+ *
+ * Why the last load failed. line is 1-based and offset the byte offset of
+ * the start of that line; they are 0 and -1 when no line is to blame or it
+ * is not known.
+ */
+typedef struct LoadError_t {
+  LoadErrorCode_t code;
+  long long line;
+  long long offset;
+  char message[LOAD_ERROR_MESSAGE_BYTES];
+} LoadError_t;
+
 void rotateX(float angle, float x, float y, float z, float* x_rezult,
              float* y_rezult, float* z_rezult);
 void rotateY(float angle, float x, float y, float z, float* x_rezult,
@@ -12,11 +38,22 @@ void rotateY(float angle, float x, float y, float z, float* x_rezult,
 void rotateZ(float angle, float x, float y, float z, float* x_rezult,
              float* y_rezult, float* z_rezult);
 
-void scaleModelC(float* vertices, int vertices_count, float scaleFactor);
-void moveModelC(float* vertices, int vertices_count, float x, float y, float z);
+void scaleModelC(float* vertices, long long vertices_count, float scaleFactor);
+void moveModelC(float* vertices, long long vertices_count, float x, float y,
+                float z);
+void transformModelC(float* vertices, long long vertices_count,
+                     const float matrix[16]);
 
-void parseObjFile(const char* filename, float** cubeVertices, int* n_vertices,
-                  unsigned int** cubeIndices, int* n_indices);
+int parseObjFile(const char* filename, float** cubeVertices,
+                 long long* n_vertices, unsigned int** cubeIndices,
+                 long long* n_indices);
+void setNormalization(const float origin[3], float scale);
+void getNormalization(float origin[3], float* scale);
+void setLoadError(LoadErrorCode_t code, long long line, long long offset,
+                  const char* format, ...);
+void getLoadError(LoadError_t* error);
+void freeModelC(float* vertices, long long n_vertices, unsigned int* indices,
+                long long n_indices);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_main.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../cpu_dispatch.h"
+
+static const long kModelSizes[] = {1000L, 10000L, 100000L, 1000000L,
+                                   10000000L};
+
+double benchNowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double nearestRank(const double *sorted, int n, double percentile) {
+  int rank = (int)(percentile / 100.0 * n + 0.999999);
+  if (rank < 1) rank = 1;
+  if (rank > n) rank = n;
+  return sorted[rank - 1];
+}
+
+/*!
+ * \brief benchComputeStats
+ *
+ * Sorts the samples in place and fills min, median, p99 and mean.
+ */
+void benchComputeStats(double *samples, int n_samples, BenchStats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (n_samples <= 0) return;
+  qsort(samples, n_samples, sizeof(double), compareDoubles);
+  double sum = 0.0;
+  for (int i = 0; i < n_samples; ++i) sum += samples[i];
+  stats->reps = n_samples;
+  stats->min_ns = samples[0];
+  stats->median_ns = nearestRank(samples, n_samples, 50.0);
+  stats->p99_ns = nearestRank(samples, n_samples, 99.0);
+  stats->mean_ns = sum / n_samples;
+}
+
+/*!
+ * \brief benchRepsFor
+ *
+ * Number of repetitions for a kernel on a model of the given size. It depends
+ * only on the size (never on measured time), so two runs on different commits
+ * always take the same number of samples.
+ *
+ * \param budget Vertex work per size, e.g. 3e6 gives 3 reps for 1M vertices.
+ */
+int benchRepsFor(const BenchConfig_t *config, long vertices, double budget) {
+  if (config->reps_override > 0) return config->reps_override;
+  long reps = (long)(budget / (double)vertices);
+  if (reps < 3) reps = 3;
+  if (reps > 31) reps = 31;
+  return (int)reps;
+}
+
+void benchAddResult(BenchReport_t *report, const char *name, long vertices,
+                    long bytes, const BenchStats_t *stats) {
+  if (report->n_results >= BENCH_MAX_RESULTS) return;
+  BenchResult_t *result = &report->results[report->n_results++];
+  snprintf(result->name, sizeof(result->name), "%s", name);
+  result->vertices = vertices;
+  result->bytes = bytes;
+  result->stats = *stats;
+  result->memory_bytes = memAccountTotalPeak();
+  memAccountResetPeaks();
+
+  const double seconds = stats->median_ns / 1e9;
+  printf("%-22s %10ld %6d %14.0f %14.0f %14.3e", name, vertices, stats->reps,
+         stats->median_ns, stats->p99_ns, vertices / seconds);
+  if (bytes > 0) printf(" %14.3e", bytes / seconds);
+  printf("\n");
+  fflush(stdout);
+}
+
+/*!
+ * \brief benchWriteJson
+ *
+ * Writes the report as JSON. The layout is flat, one object per result, so
+ * reports of two commits can be compared key by key.
+ *
+ * \return 0 on success, -1 if the file could not be written.
+ */
+int benchWriteJson(const BenchReport_t *report, const BenchConfig_t *config,
+                   const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  fprintf(file, "{\n");
+  fprintf(file, "  \"schema\": 1,\n");
+  fprintf(file, "  \"label\": \"%s\",\n", config->label ? config->label : "");
+  fprintf(file, "  \"max_vertices\": %ld,\n", config->max_vertices);
+  fprintf(file, "  \"peak_rss_bytes\": %lld,\n", memProcessPeakRss());
+  fprintf(file, "  \"results\": [\n");
+  for (int i = 0; i < report->n_results; ++i) {
+    const BenchResult_t *r = &report->results[i];
+    const double seconds = r->stats.median_ns / 1e9;
+    fprintf(file,
+            "    {\"name\": \"%s\", \"vertices\": %ld, \"bytes\": %ld, "
+            "\"reps\": %d, \"min_ns\": %.0f, \"median_ns\": %.0f, "
+            "\"p99_ns\": %.0f, \"mean_ns\": %.0f, "
+            "\"vertices_per_sec\": %.6e, \"bytes_per_sec\": %.6e, "
+            "\"memory_bytes\": %lld}%s\n",
+            r->name, r->vertices, r->bytes, r->stats.reps, r->stats.min_ns,
+            r->stats.median_ns, r->stats.p99_ns, r->stats.mean_ns,
+            r->vertices / seconds, r->bytes / seconds, r->memory_bytes,
+            i + 1 < report->n_results ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+static void printUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [--max-vertices N] [--reps N]\n"
+          "          [--only parse|transform|weld|halfedge|reorder|pick]\n"
+          "          [--output FILE.json] [--work-dir DIR] [--label TEXT]\n",
+          program);
+}
+
+static int parseArguments(int argc, char *argv[], BenchConfig_t *config) {
+  for (int i = 1; i < argc; ++i) {
+    const int has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--max-vertices") == 0 && has_value) {
+      config->max_vertices = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+      config->reps_override = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--only") == 0 && has_value) {
+      ++i;
+      config->run_parse = strcmp(argv[i], "parse") == 0;
+      config->run_transform = strcmp(argv[i], "transform") == 0;
+      config->run_weld = strcmp(argv[i], "weld") == 0;
+      config->run_half_edge = strcmp(argv[i], "halfedge") == 0;
+      config->run_reorder = strcmp(argv[i], "reorder") == 0;
+      config->run_pick = strcmp(argv[i], "pick") == 0;
+    } else if (strcmp(argv[i], "--output") == 0 && has_value) {
+      config->output_path = argv[++i];
+    } else if (strcmp(argv[i], "--work-dir") == 0 && has_value) {
+      config->work_dir = argv[++i];
+    } else if (strcmp(argv[i], "--label") == 0 && has_value) {
+      config->label = argv[++i];
+    } else {
+      printUsage(argv[0]);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  BenchConfig_t config = {10000000L, 0, 1, 1, 1, 1, 1, 1,
+                           "bench_results.json", NULL, ""};
+  config.work_dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+  if (parseArguments(argc, argv, &config) != 0) return 1;
+  cpuSetLevel(-1);
+
+  static BenchReport_t report;
+  printf("%-22s %10s %6s %14s %14s %14s %14s\n", "kernel", "vertices", "reps",
+         "median_ns", "p99_ns", "vertices/s", "bytes/s");
+
+  const int n_sizes = sizeof(kModelSizes) / sizeof(kModelSizes[0]);
+  for (int i = 0; i < n_sizes && kModelSizes[i] <= config.max_vertices; ++i) {
+    if (config.run_parse) benchParsing(&config, &report, kModelSizes[i]);
+    if (config.run_transform) benchTransforms(&config, &report, kModelSizes[i]);
+    if (config.run_weld) benchWeld(&config, &report, kModelSizes[i]);
+    if (config.run_half_edge) benchHalfEdge(&config, &report, kModelSizes[i]);
+    if (config.run_reorder) benchReorder(&config, &report, kModelSizes[i]);
+    if (config.run_pick) benchPicking(&config, &report, kModelSizes[i]);
+  }
+
+  if (benchWriteJson(&report, &config, config.output_path) != 0) return 1;
+  printf("Results written to %s\n", config.output_path);
+  return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef SRC_BENCHMARKS_BENCH_MAIN_H_
+#define SRC_BENCHMARKS_BENCH_MAIN_H_
+
+#include <stdio.h>
+
+#include "../backend.h"
+#include "../memory_stats.h"
+#include "../tools/obj_generator.h"
+
+#define BENCH_MAX_RESULTS 256
+#define BENCH_NAME_LENGTH 64
+
+/*!
+ * \brief BenchConfig_t
+ *
+ * Options of a benchmark run, filled from the command line.
+ */
+typedef struct BenchConfig_t {
+  long max_vertices;
+  int reps_override;
+  int run_parse;
+  int run_transform;
+  int run_weld;
+  int run_half_edge;
+  int run_reorder;
+  int run_pick;
+  const char *output_path;
+  const char *work_dir;
+  const char *label;
+} BenchConfig_t;
+
+/*!
+ * \brief BenchStats_t
+ *
+ * Statistics over the repetitions of one measured kernel, in nanoseconds.
+ * Percentiles use the nearest-rank method, so p99 of less than 100 samples
+ * is the slowest repetition.
+ */
+typedef struct BenchStats_t {
+  int reps;
+  double min_ns;
+  double median_ns;
+  double p99_ns;
+  double mean_ns;
+} BenchStats_t;
+
+/*!
+ * \brief BenchResult_t
+ *
+ * One row of the report: a kernel measured on a model of a given size.
+ * bytes is zero for kernels that do not read a file. memory_bytes is the
+ * peak of the memory accounting (memory_stats.h) since the previous row.
+ */
+typedef struct BenchResult_t {
+  char name[BENCH_NAME_LENGTH];
+  long vertices;
+  long bytes;
+  long long memory_bytes;
+  BenchStats_t stats;
+} BenchResult_t;
+
+typedef struct BenchReport_t {
+  BenchResult_t results[BENCH_MAX_RESULTS];
+  int n_results;
+} BenchReport_t;
+
+double benchNowNs(void);
+void benchComputeStats(double *samples, int n_samples, BenchStats_t *stats);
+int benchRepsFor(const BenchConfig_t *config, long vertices, double budget);
+void benchAddResult(BenchReport_t *report, const char *name, long vertices,
+                    long bytes, const BenchStats_t *stats);
+int benchWriteJson(const BenchReport_t *report, const BenchConfig_t *config,
+                   const char *path);
+
+void benchParsing(const BenchConfig_t *config, BenchReport_t *report,
+                  long vertices);
+void benchTransforms(const BenchConfig_t *config, BenchReport_t *report,
+                     long vertices);
+void benchWeld(const BenchConfig_t *config, BenchReport_t *report,
+               long vertices);
+void benchHalfEdge(const BenchConfig_t *config, BenchReport_t *report,
+                   long faces);
+void benchReorder(const BenchConfig_t *config, BenchReport_t *report,
+                  long vertices);
+void benchPicking(const BenchConfig_t *config, BenchReport_t *report,
+                  long vertices);
+
+#endif  // SRC_BENCHMARKS_BENCH_MAIN_H_
@@ -0,0 +1,243 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../arena.h"
+#include "../mesh_loader.h"
+#include "../model_cache.h"
+#include "../obj_export.h"
+#include "../stage_timer.h"
+#include "bench_main.h"
+
+/*!
+ * \brief writeBinaryCopies
+ *
+ * Writes the vertices and triangles of a generated OBJ model as binary PLY
+ * and binary STL, so the loaders read the same model as parseObjFile.
+ *
+ * \return 0 on success, -1 otherwise; the sizes of the files are returned.
+ */
+static int writeBinaryCopies(const char *obj_path, const char *ply_path,
+                             const char *stl_path, long *ply_bytes,
+                             long *stl_bytes) {
+  FILE *obj = fopen(obj_path, "r");
+  if (obj == NULL) return -1;
+  long n_vertices = 0;
+  long n_faces = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), obj) != NULL) {
+    n_vertices += line[0] == 'v' && line[1] == ' ';
+    n_faces += line[0] == 'f' && line[1] == ' ';
+  }
+  float *positions = malloc((size_t)n_vertices * 3 * sizeof(float) + 1);
+  int *faces = malloc((size_t)n_faces * 3 * sizeof(int) + 1);
+  FILE *ply = fopen(ply_path, "wb");
+  FILE *stl = fopen(stl_path, "wb");
+  int result = positions && faces && ply && stl ? 0 : -1;
+  rewind(obj);
+  long v = 0;
+  long f = 0;
+  while (result == 0 && fgets(line, sizeof(line), obj) != NULL) {
+    if (line[0] == 'v' && line[1] == ' ') {
+      sscanf(line, "v %f %f %f", &positions[v * 3], &positions[v * 3 + 1],
+             &positions[v * 3 + 2]);
+      ++v;
+    } else if (line[0] == 'f' && line[1] == ' ') {
+      int *face = &faces[f * 3];
+      if (strchr(line, '/') == NULL) {
+        sscanf(line, "f %d %d %d", &face[0], &face[1], &face[2]);
+      } else {
+        sscanf(line, "f %d/%*d/%*d %d/%*d/%*d %d/%*d/%*d", &face[0],
+               &face[1], &face[2]);
+      }
+      for (int k = 0; k < 3; ++k) --face[k];
+      ++f;
+    }
+  }
+  if (result == 0) {
+    fprintf(ply,
+            "ply\nformat binary_little_endian 1.0\nelement vertex %ld\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "element face %ld\nproperty list uchar int vertex_indices\n"
+            "end_header\n",
+            n_vertices, n_faces);
+    fwrite(positions, sizeof(float), (size_t)n_vertices * 3, ply);
+    const char header[80] = "s21 benchmark";
+    const uint32_t n_triangles = (uint32_t)n_faces;
+    fwrite(header, 1, sizeof(header), stl);
+    fwrite(&n_triangles, sizeof(n_triangles), 1, stl);
+    for (long i = 0; i < n_faces; ++i) {
+      const unsigned char corners = 3;
+      const float normal[3] = {0.0f, 0.0f, 0.0f};
+      const uint16_t attributes = 0;
+      fwrite(&corners, 1, 1, ply);
+      fwrite(&faces[i * 3], sizeof(int), 3, ply);
+      fwrite(normal, sizeof(float), 3, stl);
+      for (int k = 0; k < 3; ++k) {
+        fwrite(&positions[faces[i * 3 + k] * 3], sizeof(float), 3, stl);
+      }
+      fwrite(&attributes, sizeof(attributes), 1, stl);
+    }
+    *ply_bytes = ftell(ply);
+    *stl_bytes = ftell(stl);
+  }
+  fclose(obj);
+  if (ply) fclose(ply);
+  if (stl) fclose(stl);
+  free(positions);
+  free(faces);
+  return result;
+}
+
+/*!
+ * \brief benchParsing
+ *
+ * Measures parseObjFile on a generated grid model (default generator options)
+ * with the given vertex count. Reports vertices/s and bytes/s of the source
+ * file, plus the count and fill passes as recorded by the parser's own stage
+ * timers. parseObjFile.arena is the same parse into a load arena, including
+ * the release of the whole arena. modelCache.hit is a load of the same model
+ * from the model cache, the copy out and its release. meshLoadPly and
+ * meshLoadStl load the same model from binary PLY and STL files; objExport
+ * writes it back out as OBJ.
+ */
+void benchParsing(const BenchConfig_t *config, BenchReport_t *report,
+                  long vertices) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/s21_bench_grid_%ld.obj", config->work_dir,
+           vertices);
+  ObjGeneratorOptions_t options;
+  objGeneratorDefaults(&options);
+  options.n_vertices = vertices;
+  ObjGeneratorStats_t model;
+  if (objGenerateFile(path, &options, &model) != 0) return;
+
+  const int reps = benchRepsFor(config, vertices, 3e6);
+  double *samples = malloc(8 * reps * sizeof(double));
+  double *count_samples = samples + reps;
+  double *fill_samples = samples + 2 * reps;
+  double *arena_samples = samples + 3 * reps;
+  double *cache_samples = samples + 4 * reps;
+  double *ply_samples = samples + 5 * reps;
+  double *stl_samples = samples + 6 * reps;
+  double *export_samples = samples + 7 * reps;
+  for (int rep = 0; rep < reps; ++rep) {
+    float *model_vertices = NULL;
+    unsigned int *model_indices = NULL;
+    long long n_vertices = 0;
+    long long n_indices = 0;
+
+    const double start = benchNowNs();
+    parseObjFile(path, &model_vertices, &n_vertices, &model_indices,
+                 &n_indices);
+    samples[rep] = benchNowNs() - start;
+    count_samples[rep] = stageTimerGet(STAGE_PARSE_COUNT)->last_ns;
+    fill_samples[rep] = stageTimerGet(STAGE_PARSE_FILL)->last_ns;
+
+    freeModelC(model_vertices, n_vertices, model_indices, n_indices);
+  }
+  for (int rep = 0; rep < reps; ++rep) {
+    float *model_vertices = NULL;
+    unsigned int *model_indices = NULL;
+    long long n_vertices = 0;
+    long long n_indices = 0;
+
+    const double start = benchNowNs();
+    Arena_t *arena = arenaCreate();
+    arenaSetCurrent(arena);
+    parseObjFile(path, &model_vertices, &n_vertices, &model_indices,
+                 &n_indices);
+    arenaSetCurrent(NULL);
+    arenaDestroy(arena);
+    arena_samples[rep] = benchNowNs() - start;
+  }
+  float *cached_vertices = NULL;
+  unsigned int *cached_indices = NULL;
+  long long n_cached_vertices = 0;
+  long long n_cached_indices = 0;
+  parseObjFile(path, &cached_vertices, &n_cached_vertices, &cached_indices,
+               &n_cached_indices);
+  ModelCache_t *cache = modelCacheCreate(1, 1LL << 40);
+  modelCachePut(cache, path, 0, cached_vertices, n_cached_vertices,
+                cached_indices, n_cached_indices);
+  char export_path[1040];
+  snprintf(export_path, sizeof(export_path), "%s.export.obj", path);
+  ObjExportOptions_t export_options;
+  objExportDefaults(&export_options);
+  getNormalization(export_options.origin, &export_options.scale);
+  ObjExportStats_t exported;
+  for (int rep = 0; rep < reps; ++rep) {
+    const double start = benchNowNs();
+    objExport(export_path, cached_vertices, n_cached_vertices, cached_indices,
+              n_cached_indices, &export_options, &exported);
+    export_samples[rep] = benchNowNs() - start;
+  }
+  remove(export_path);
+  freeModelC(cached_vertices, n_cached_vertices, cached_indices,
+             n_cached_indices);
+  for (int rep = 0; rep < reps; ++rep) {
+    float *model_vertices = NULL;
+    unsigned int *model_indices = NULL;
+    long long n_vertices = 0;
+    long long n_indices = 0;
+
+    const double start = benchNowNs();
+    modelCacheGet(cache, path, 0, &model_vertices, &n_vertices, &model_indices,
+                  &n_indices);
+    freeModelC(model_vertices, n_vertices, model_indices, n_indices);
+    cache_samples[rep] = benchNowNs() - start;
+  }
+  modelCacheDestroy(cache);
+
+  char ply_path[1040];
+  char stl_path[1040];
+  snprintf(ply_path, sizeof(ply_path), "%s.ply", path);
+  snprintf(stl_path, sizeof(stl_path), "%s.stl", path);
+  long ply_bytes = 0;
+  long stl_bytes = 0;
+  const int binary = writeBinaryCopies(path, ply_path, stl_path, &ply_bytes,
+                                       &stl_bytes) == 0;
+  for (int rep = 0; binary && rep < reps; ++rep) {
+    float *model_vertices = NULL;
+    unsigned int *model_indices = NULL;
+    long long n_vertices = 0;
+    long long n_indices = 0;
+
+    double start = benchNowNs();
+    meshLoadPly(ply_path, &model_vertices, &n_vertices, &model_indices,
+                &n_indices);
+    ply_samples[rep] = benchNowNs() - start;
+    freeModelC(model_vertices, n_vertices, model_indices, n_indices);
+
+    start = benchNowNs();
+    meshLoadStl(stl_path, &model_vertices, &n_vertices, &model_indices,
+                &n_indices);
+    stl_samples[rep] = benchNowNs() - start;
+    freeModelC(model_vertices, n_vertices, model_indices, n_indices);
+  }
+
+  BenchStats_t stats;
+  benchComputeStats(samples, reps, &stats);
+  benchAddResult(report, "parseObjFile", vertices, model.n_bytes, &stats);
+  benchComputeStats(count_samples, reps, &stats);
+  benchAddResult(report, "parseObjFile.count", vertices, model.n_bytes, &stats);
+  benchComputeStats(fill_samples, reps, &stats);
+  benchAddResult(report, "parseObjFile.fill", vertices, model.n_bytes, &stats);
+  benchComputeStats(arena_samples, reps, &stats);
+  benchAddResult(report, "parseObjFile.arena", vertices, model.n_bytes, &stats);
+  benchComputeStats(cache_samples, reps, &stats);
+  benchAddResult(report, "modelCache.hit", vertices, model.n_bytes, &stats);
+  benchComputeStats(export_samples, reps, &stats);
+  benchAddResult(report, "objExport", vertices, exported.bytes, &stats);
+  if (binary) {
+    benchComputeStats(ply_samples, reps, &stats);
+    benchAddResult(report, "meshLoadPly", vertices, ply_bytes, &stats);
+    benchComputeStats(stl_samples, reps, &stats);
+    benchAddResult(report, "meshLoadStl", vertices, stl_bytes, &stats);
+  }
+
+  free(samples);
+  remove(path);
+  remove(ply_path);
+  remove(stl_path);
+}
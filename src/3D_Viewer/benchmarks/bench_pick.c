@@ -0,0 +1,243 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "../bvh.h"
+#include "bench_main.h"
+
+// Cursor positions timed one by one for the query latency
+#define BENCH_PICK_QUERIES 1000
+#define BENCH_PICK_WIDTH 1000
+#define BENCH_PICK_HEIGHT 800
+
+static const double kPi = 3.14159265358979323846;
+
+// Keeps the scans from being optimized away
+static volatile long long bench_pick_sink;
+
+typedef struct PickModel_t {
+  float *vertices;
+  unsigned int *indices;
+  long long n_vertices;
+  long long n_indices;
+} PickModel_t;
+
+/*!
+ * \brief createSphereModel
+ *
+ * A latitude-longitude sphere of about the given vertex count, two
+ * triangles per cell written as three segments each, as the loaders do.
+ * Returns 0 on success.
+ */
+static int createSphereModel(PickModel_t *model, long vertices) {
+  long side = 2;
+  while ((side + 1) * (side + 1) <= vertices) ++side;
+  const long cells = (side - 1) * (side - 1);
+  model->n_vertices = side * side;
+  model->n_indices = cells * 12;
+  model->vertices = malloc((size_t)model->n_vertices * 3 * sizeof(float));
+  model->indices = malloc((size_t)model->n_indices * sizeof(unsigned int));
+  if (model->vertices == NULL || model->indices == NULL) {
+    free(model->vertices);
+    free(model->indices);
+    return -1;
+  }
+  for (long row = 0; row < side; ++row) {
+    const double latitude = kPi * ((double)row / (side - 1) - 0.5);
+    for (long column = 0; column < side; ++column) {
+      const double longitude = 2.0 * kPi * column / (side - 1);
+      float *v = &model->vertices[(row * side + column) * 3];
+      v[0] = (float)(0.8 * cos(latitude) * cos(longitude));
+      v[1] = (float)(0.8 * sin(latitude));
+      v[2] = (float)(0.8 * cos(latitude) * sin(longitude));
+    }
+  }
+  unsigned int *p = model->indices;
+  for (long row = 0; row + 1 < side; ++row) {
+    for (long column = 0; column + 1 < side; ++column) {
+      const unsigned int a = (unsigned int)(row * side + column);
+      const unsigned int corners[2][3] = {
+          {a, a + 1, a + (unsigned int)side + 1},
+          {a, a + (unsigned int)side + 1, a + (unsigned int)side}};
+      for (int t = 0; t < 2; ++t) {
+        for (int k = 0; k < 3; ++k) {
+          *p++ = corners[t][k];
+          *p++ = corners[t][(k + 1) % 3];
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/*!
+ * \brief viewMatrix
+ *
+ * Column-major projection times view of the viewer's starting camera: a
+ * 50 degree perspective looking at the origin from (2, 2, 4).
+ */
+static void viewMatrix(float mvp[16]) {
+  const double eye[3] = {2.0, 2.0, 4.0};
+  const double distance = sqrt(24.0);
+  double forward[3] = {-eye[0] / distance, -eye[1] / distance,
+                       -eye[2] / distance};
+  // right = forward x up, up' = right x forward
+  double right[3] = {-forward[2], 0.0, forward[0]};
+  const double length = hypot(right[0], right[2]);
+  right[0] /= length;
+  right[2] /= length;
+  const double up[3] = {right[1] * forward[2] - right[2] * forward[1],
+                        right[2] * forward[0] - right[0] * forward[2],
+                        right[0] * forward[1] - right[1] * forward[0]};
+  double view[16] = {0};
+  for (int i = 0; i < 3; ++i) {
+    view[i * 4] = right[i];
+    view[i * 4 + 1] = up[i];
+    view[i * 4 + 2] = -forward[i];
+  }
+  for (int r = 0; r < 3; ++r) {
+    const double *axis = r == 0 ? right : r == 1 ? up : forward;
+    const double dot = axis[0] * eye[0] + axis[1] * eye[1] + axis[2] * eye[2];
+    view[12 + r] = r == 2 ? dot : -dot;
+  }
+  view[15] = 1.0;
+  const double aspect = (double)BENCH_PICK_WIDTH / BENCH_PICK_HEIGHT;
+  const double f = 1.0 / tan(25.0 * kPi / 180.0);
+  const double near = 0.1;
+  const double far = 100.0;
+  double projection[16] = {0};
+  projection[0] = f / aspect;
+  projection[5] = f;
+  projection[10] = (far + near) / (near - far);
+  projection[11] = -1.0;
+  projection[14] = 2.0 * far * near / (near - far);
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 4; ++row) {
+      double sum = 0.0;
+      for (int k = 0; k < 4; ++k) {
+        sum += projection[k * 4 + row] * view[column * 4 + k];
+      }
+      mvp[column * 4 + row] = (float)sum;
+    }
+  }
+}
+
+// Window position of a vertex, which the sphere keeps in front of the camera.
+static void windowOf(const float mvp[16], const float *p, float *x, float *y) {
+  float clip[4];
+  for (int row = 0; row < 4; ++row) {
+    clip[row] = mvp[row] * p[0] + mvp[4 + row] * p[1] + mvp[8 + row] * p[2] +
+                mvp[12 + row];
+  }
+  *x = (clip[0] / clip[3] + 1.0f) * 0.5f * BENCH_PICK_WIDTH;
+  *y = (1.0f - clip[1] / clip[3]) * 0.5f * BENCH_PICK_HEIGHT;
+}
+
+// The closest vertex within BVH_PICK_PIXELS by projecting all of them.
+static long long scanVertices(const PickModel_t *model, const float mvp[16],
+                              float x, float y) {
+  float closest = BVH_PICK_PIXELS;
+  long long found = -1;
+  for (long long v = 0; v < model->n_vertices; ++v) {
+    float vx, vy;
+    windowOf(mvp, &model->vertices[v * 3], &vx, &vy);
+    const float pixels = hypotf(vx - x, vy - y);
+    if (pixels < closest) {
+      closest = pixels;
+      found = v;
+    }
+  }
+  return found;
+}
+
+static void addRow(BenchReport_t *report, const char *name, long vertices,
+                   double *samples, int n_samples) {
+  if (n_samples <= 0) return;
+  BenchStats_t stats;
+  benchComputeStats(samples, n_samples, &stats);
+  benchAddResult(report, name, vertices, 0, &stats);
+}
+
+/*!
+ * \brief benchPicking
+ *
+ * Measures the picking hierarchy on a sphere of the given vertex count:
+ * bvhBuild, a bvhRefit of every vertex as after a transform, and bvhPick
+ * latency over BENCH_PICK_QUERIES cursors near vertices and in between,
+ * each timed on its own. pickScan projects every vertex per query, the
+ * cost of picking without the hierarchy.
+ */
+void benchPicking(const BenchConfig_t *config, BenchReport_t *report,
+                  long vertices) {
+  PickModel_t model;
+  if (createSphereModel(&model, vertices) != 0) return;
+  const int reps = benchRepsFor(config, vertices, 3e7);
+  const int n_samples =
+      reps > BENCH_PICK_QUERIES ? reps : BENCH_PICK_QUERIES;
+  double *samples = malloc(n_samples * sizeof(double));
+  Bvh_t bvh = {0};
+  if (samples == NULL) {
+    free(model.vertices);
+    free(model.indices);
+    return;
+  }
+
+  int done = 0;
+  for (; done < reps; ++done) {
+    bvhFree(&bvh);
+    const double start = benchNowNs();
+    const int status = bvhBuild(model.vertices, model.n_vertices,
+                                model.indices, model.n_indices, &bvh);
+    samples[done] = benchNowNs() - start;
+    if (status != 0) break;
+  }
+  addRow(report, "bvhBuild", vertices, samples, done);
+  if (done < reps) {
+    bvhFree(&bvh);
+    free(samples);
+    free(model.vertices);
+    free(model.indices);
+    return;
+  }
+
+  for (int i = 0; i < reps; ++i) {
+    const double start = benchNowNs();
+    bvhRefit(&bvh, model.vertices, model.indices, 0, model.n_vertices);
+    samples[i] = benchNowNs() - start;
+  }
+  addRow(report, "bvhRefit", vertices, samples, reps);
+
+  float mvp[16];
+  viewMatrix(mvp);
+  float cursors[BENCH_PICK_QUERIES][2];
+  int hits = 0;
+  for (int q = 0; q < BENCH_PICK_QUERIES; ++q) {
+    const long long v = ((long long)q * 7919) % model.n_vertices;
+    windowOf(mvp, &model.vertices[v * 3], &cursors[q][0], &cursors[q][1]);
+    // Every other cursor lies between vertices and edges
+    cursors[q][0] += (float)(q % 2) * 3.5f;
+    cursors[q][1] += (float)(q % 3) * 1.5f;
+  }
+  for (int q = 0; q < BENCH_PICK_QUERIES; ++q) {
+    BvhPick_t pick;
+    const double start = benchNowNs();
+    bvhPick(&bvh, model.vertices, model.indices, mvp, NULL,
+            BENCH_PICK_WIDTH, BENCH_PICK_HEIGHT, cursors[q][0], cursors[q][1],
+            BVH_PICK_PIXELS, &pick);
+    samples[q] = benchNowNs() - start;
+    hits += pick.kind != BVH_PICK_NONE;
+  }
+  addRow(report, "bvhPick", vertices, samples, BENCH_PICK_QUERIES);
+
+  for (int q = 0; q < reps; ++q) {
+    const double start = benchNowNs();
+    bench_pick_sink = scanVertices(&model, mvp, cursors[q][0], cursors[q][1]);
+    samples[q] = benchNowNs() - start;
+  }
+  addRow(report, "pickScan", vertices, samples, reps);
+  bench_pick_sink = hits;
+
+  bvhFree(&bvh);
+  free(samples);
+  free(model.vertices);
+  free(model.indices);
+}
@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../point_cloud.h"
+#include "../reorder.h"
+#include "bench_main.h"
+
+typedef struct ScrambledModel_t {
+  float *vertices;
+  unsigned int *indices;
+  long n_vertices;
+  long n_indices;
+} ScrambledModel_t;
+
+static uint64_t nextRandom(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+/*!
+ * \brief createScrambledModel
+ *
+ * A square grid of about the given vertex count with edges to the right and
+ * lower neighbours, vertices stored in a random order as in unsorted scan
+ * data. Returns 0 on success.
+ */
+static int createScrambledModel(ScrambledModel_t *model, long vertices) {
+  long side = 1;
+  while ((side + 1) * (side + 1) <= vertices) ++side;
+  model->n_vertices = side * side;
+  model->n_indices = 4 * side * (side - 1);
+  model->vertices = malloc(model->n_vertices * 3 * sizeof(float));
+  model->indices = malloc(model->n_indices * sizeof(unsigned int));
+  unsigned int *slot = malloc(model->n_vertices * sizeof(unsigned int));
+  if (model->vertices == NULL || model->indices == NULL || slot == NULL) {
+    free(model->vertices);
+    free(model->indices);
+    free(slot);
+    return -1;
+  }
+  uint64_t state = 21;
+  for (long i = 0; i < model->n_vertices; ++i) slot[i] = (unsigned int)i;
+  for (long i = model->n_vertices - 1; i > 0; --i) {
+    const long j = (long)(nextRandom(&state) % (uint64_t)(i + 1));
+    const unsigned int swap = slot[i];
+    slot[i] = slot[j];
+    slot[j] = swap;
+  }
+  for (long i = 0; i < model->n_vertices; ++i) {
+    float *v = &model->vertices[slot[i] * 3L];
+    v[0] = (float)(i % side) / side;
+    v[1] = (float)(i / side) / side;
+    v[2] = 0.0f;
+  }
+  long k = 0;
+  for (long row = 0; row < side; ++row) {
+    for (long column = 0; column < side; ++column) {
+      const long i = row * side + column;
+      if (column + 1 < side) {
+        model->indices[k++] = slot[i];
+        model->indices[k++] = slot[i + 1];
+      }
+      if (row + 1 < side) {
+        model->indices[k++] = slot[i];
+        model->indices[k++] = slot[i + side];
+      }
+    }
+  }
+  free(slot);
+  return 0;
+}
+
+// Walks the segments the way glDrawElements fetches vertices.
+static float fetchSegments(const float *vertices, const unsigned int *indices,
+                           long n_indices) {
+  float sum = 0.0f;
+  for (long k = 0; k < n_indices; ++k) {
+    const float *v = &vertices[indices[k] * 3L];
+    sum += v[0] + v[1] + v[2];
+  }
+  return sum;
+}
+
+static void measureModel(const BenchConfig_t *config, BenchReport_t *report,
+                         const ScrambledModel_t *model, const char *suffix,
+                         double *samples) {
+  const int reps = benchRepsFor(config, model->n_vertices, 3e7);
+  char name[BENCH_NAME_LENGTH];
+  volatile float sink = 0.0f;
+  BenchStats_t stats;
+  for (int rep = 0; rep < reps; ++rep) {
+    const double start = benchNowNs();
+    sink += fetchSegments(model->vertices, model->indices, model->n_indices);
+    samples[rep] = benchNowNs() - start;
+  }
+  benchComputeStats(samples, reps, &stats);
+  snprintf(name, sizeof(name), "drawFetch.%s", suffix);
+  benchAddResult(report, name, model->n_vertices, 0, &stats);
+
+  for (int rep = 0; rep < reps; ++rep) {
+    const float step = rep % 2 == 0 ? 0.1f : -0.1f;
+    const double start = benchNowNs();
+    moveModelC(model->vertices, (int)model->n_vertices, step, step, step);
+    samples[rep] = benchNowNs() - start;
+  }
+  benchComputeStats(samples, reps, &stats);
+  snprintf(name, sizeof(name), "moveModelC.%s", suffix);
+  benchAddResult(report, name, model->n_vertices, 0, &stats);
+}
+
+/*!
+ * \brief benchReorder
+ *
+ * Measures reorderModel on a grid stored in random order, and the segment
+ * fetch (the CPU side of drawing the edges) and moveModelC before and after
+ * reordering. Transforms walk the vertex array linearly, so they are
+ * expected to be unaffected; the fetch shows the locality gain. The same
+ * vertices without edges are also built into a point cloud octree.
+ */
+void benchReorder(const BenchConfig_t *config, BenchReport_t *report,
+                  long vertices) {
+  ScrambledModel_t model;
+  if (createScrambledModel(&model, vertices) != 0) return;
+  const size_t vertex_bytes = model.n_vertices * 3 * sizeof(float);
+  const size_t index_bytes = model.n_indices * sizeof(unsigned int);
+  const int reps = benchRepsFor(config, model.n_vertices, 3e7);
+  double *samples = malloc(reps * sizeof(double));
+  unsigned int *indices = malloc(index_bytes);
+  if (samples == NULL || indices == NULL) {
+    free(samples);
+    free(indices);
+    free(model.vertices);
+    free(model.indices);
+    return;
+  }
+  measureModel(config, report, &model, "scrambled", samples);
+
+  int rep = 0;
+  for (; rep < reps; ++rep) {
+    float *copy = memAccountMalloc(MEM_VERTICES, vertex_bytes);
+    if (copy == NULL) break;
+    memcpy(copy, model.vertices, vertex_bytes);
+    memcpy(indices, model.indices, index_bytes);
+    const double start = benchNowNs();
+    reorderModel(&copy, (int)model.n_vertices, indices, (int)model.n_indices,
+                 NULL);
+    samples[rep] = benchNowNs() - start;
+    if (rep + 1 == reps) {
+      // Keep the last result for the after measurements
+      memcpy(model.vertices, copy, vertex_bytes);
+      memcpy(model.indices, indices, index_bytes);
+    }
+    freeModelC(copy, (int)model.n_vertices, NULL, 0);
+  }
+  BenchStats_t stats;
+  benchComputeStats(samples, rep, &stats);
+  benchAddResult(report, "reorderModel", model.n_vertices, 0, &stats);
+  if (rep == reps) measureModel(config, report, &model, "reordered", samples);
+
+  for (rep = 0; rep < reps; ++rep) {
+    PointCloud_t cloud;
+    const double start = benchNowNs();
+    if (pointCloudBuild(model.vertices, (int)model.n_vertices, &cloud) != 0) {
+      break;
+    }
+    samples[rep] = benchNowNs() - start;
+    pointCloudFree(&cloud);
+  }
+  benchComputeStats(samples, rep, &stats);
+  benchAddResult(report, "pointCloudBuild", model.n_vertices, 0, &stats);
+
+  free(samples);
+  free(indices);
+  free(model.vertices);
+  free(model.indices);
+}
@@ -0,0 +1,162 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../cpu_dispatch.h"
+#include "../obj_index.h"
+#include "bench_main.h"
+
+static const float kTenDegrees = 0.17453292f;
+
+typedef void (*RotateFunction_t)(float, float, float, float, float *, float *,
+                                 float *);
+
+static float *createVertices(long vertices) {
+  float *data = malloc(vertices * 3 * sizeof(float));
+  if (data == NULL) return NULL;
+  for (long i = 0; i < vertices * 3; ++i) data[i] = (float)(i % 1000) / 1000.0f;
+  return data;
+}
+
+// Six edge indices per vertex, about what parseObjFile gives for a grid.
+static unsigned int *createIndices(long vertices) {
+  unsigned int *indices = malloc(vertices * 6 * sizeof(unsigned int));
+  if (indices == NULL) return NULL;
+  for (long i = 0; i < vertices * 6; ++i) {
+    indices[i] = (unsigned int)((i * 7919) % vertices);
+  }
+  return indices;
+}
+
+// Same per-vertex loop as GLWidget::rotateModel runs for each axis.
+static void rotateAll(RotateFunction_t rotate, float angle, float *data,
+                      long vertices) {
+  for (long i = 0; i < vertices * 3; i += 3) {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    rotate(angle, data[i], data[i + 1], data[i + 2], &x, &y, &z);
+    data[i] = x;
+    data[i + 1] = y;
+    data[i + 2] = z;
+  }
+}
+
+static void measureRotation(const BenchConfig_t *config, BenchReport_t *report,
+                            const char *name, RotateFunction_t rotate,
+                            float *data, long vertices, double *samples) {
+  const int reps = benchRepsFor(config, vertices, 1e8);
+  for (int rep = 0; rep < reps; ++rep) {
+    // Alternate the direction so the model does not drift between reps.
+    const float angle = (rep % 2 == 0 ? 1.0f : -1.0f) * kTenDegrees;
+    const double start = benchNowNs();
+    rotateAll(rotate, angle, data, vertices);
+    samples[rep] = benchNowNs() - start;
+  }
+  BenchStats_t stats;
+  benchComputeStats(samples, reps, &stats);
+  benchAddResult(report, name, vertices, 0, &stats);
+}
+
+// Names a result after its kernel and, for a forced level, the level.
+static void addResult(BenchReport_t *report, const char *kernel,
+                      const char *level, long vertices,
+                      const BenchStats_t *stats) {
+  char name[BENCH_NAME_LENGTH];
+  if (level == NULL) {
+    snprintf(name, sizeof(name), "%s", kernel);
+  } else {
+    snprintf(name, sizeof(name), "%s/%s", kernel, level);
+  }
+  benchAddResult(report, name, vertices, 0, stats);
+}
+
+// scaleModelC, moveModelC, transformModelC and objFindBadIndex on the
+// kernels cpuKernels() has bound; level names the results, NULL for the
+// default kernels.
+static void measureVertexKernels(const BenchConfig_t *config,
+                                 BenchReport_t *report, const char *level,
+                                 float *data, const unsigned int *indices,
+                                 long vertices, double *samples) {
+  const int reps = benchRepsFor(config, vertices, 1e8);
+  for (int rep = 0; rep < reps; ++rep) {
+    const float factor = rep % 2 == 0 ? 1.1f : 1.0f / 1.1f;
+    const double start = benchNowNs();
+    scaleModelC(data, vertices, factor);
+    samples[rep] = benchNowNs() - start;
+  }
+  BenchStats_t stats;
+  benchComputeStats(samples, reps, &stats);
+  addResult(report, "scaleModelC", level, vertices, &stats);
+
+  for (int rep = 0; rep < reps; ++rep) {
+    const float offset = rep % 2 == 0 ? 0.1f : -0.1f;
+    const double start = benchNowNs();
+    moveModelC(data, vertices, offset, offset, offset);
+    samples[rep] = benchNowNs() - start;
+  }
+  benchComputeStats(samples, reps, &stats);
+  addResult(report, "moveModelC", level, vertices, &stats);
+
+  // A rotation and a move merged into one column-major matrix, as GLWidget
+  // applies the transforms queued between two frames
+  for (int rep = 0; rep < reps; ++rep) {
+    const float sign = rep % 2 == 0 ? 1.0f : -1.0f;
+    const float c = cosf(kTenDegrees);
+    const float s = sign * sinf(kTenDegrees);
+    const float offset = sign * 0.1f;
+    const float matrix[16] = {1.0f, 0.0f,   0.0f, 0.0f, 0.0f, c,
+                              s,    0.0f,   0.0f, -s,   c,    0.0f,
+                              0.0f, offset, 0.0f, 1.0f};
+    const double start = benchNowNs();
+    transformModelC(data, vertices, matrix);
+    samples[rep] = benchNowNs() - start;
+  }
+  benchComputeStats(samples, reps, &stats);
+  addResult(report, "transformModelC", level, vertices, &stats);
+
+  for (int rep = 0; rep < reps; ++rep) {
+    const double start = benchNowNs();
+    objFindBadIndex(indices, vertices * 6LL, vertices);
+    samples[rep] = benchNowNs() - start;
+  }
+  benchComputeStats(samples, reps, &stats);
+  addResult(report, "objFindBadIndex", level, vertices, &stats);
+}
+
+/*!
+ * \brief benchTransforms
+ *
+ * Measures rotateX/Y/Z applied to every vertex, scaleModelC, moveModelC and
+ * transformModelC on an array of the given vertex count, and
+ * objFindBadIndex on six indices per vertex. Reports vertices/s. All but
+ * the rotations run once on the default kernels and once per level the
+ * processor supports, named e.g. "scaleModelC/avx2".
+ */
+void benchTransforms(const BenchConfig_t *config, BenchReport_t *report,
+                     long vertices) {
+  float *data = createVertices(vertices);
+  unsigned int *indices = createIndices(vertices);
+  const int reps = benchRepsFor(config, vertices, 1e8);
+  double *samples = malloc(reps * sizeof(double));
+  if (data == NULL || indices == NULL || samples == NULL) {
+    free(data);
+    free(indices);
+    free(samples);
+    return;
+  }
+
+  measureRotation(config, report, "rotateX", rotateX, data, vertices, samples);
+  measureRotation(config, report, "rotateY", rotateY, data, vertices, samples);
+  measureRotation(config, report, "rotateZ", rotateZ, data, vertices, samples);
+
+  measureVertexKernels(config, report, NULL, data, indices, vertices, samples);
+  for (int level = CPU_LEVEL_SCALAR; level <= (int)cpuDetectLevel(); ++level) {
+    cpuSetLevel(level);
+    measureVertexKernels(config, report, cpuLevelName(cpuLevel()), data,
+                         indices, vertices, samples);
+  }
+  cpuSetLevel(-1);
+
+  free(samples);
+  free(indices);
+  free(data);
+}
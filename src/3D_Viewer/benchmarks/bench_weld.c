@@ -0,0 +1,151 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../half_edge.h"
+#include "../weld.h"
+#include "bench_main.h"
+
+/*!
+ * \brief createDuplicatedModel
+ *
+ * Vertices of a grid in [0, 1]^3 where every position appears twice, the
+ * second copy displaced by less than the merge distance, as in exports that
+ * repeat positions per face group. Edges join consecutive vertices.
+ */
+static void createDuplicatedModel(float *vertices, unsigned int *indices,
+                                  long n_vertices) {
+  const long side = 256;
+  for (long i = 0; i < n_vertices; ++i) {
+    const long position = i / 2;
+    const float offset = (float)(i % 2) * WELD_DEFAULT_EPSILON * 0.25f;
+    vertices[i * 3] = (float)(position % side) / side + offset;
+    vertices[i * 3 + 1] = (float)(position / side % side) / side;
+    vertices[i * 3 + 2] = (float)(position / (side * side)) / side;
+    indices[i] = (unsigned int)((i + 1) % n_vertices);
+  }
+}
+
+/*!
+ * \brief benchWeld
+ *
+ * Measures weldVertices on a model where half of the vertices are
+ * duplicates. The model is restored before each repetition, outside the
+ * timed region. Reports vertices/s.
+ */
+void benchWeld(const BenchConfig_t *config, BenchReport_t *report,
+               long vertices) {
+  const size_t vertex_bytes = vertices * 3 * sizeof(float);
+  const size_t index_bytes = vertices * sizeof(unsigned int);
+  float *pristine_vertices = malloc(vertex_bytes);
+  unsigned int *pristine_indices = malloc(index_bytes);
+  unsigned int *indices = malloc(index_bytes);
+  const int reps = benchRepsFor(config, vertices, 3e7);
+  double *samples = malloc(reps * sizeof(double));
+  if (pristine_vertices == NULL || pristine_indices == NULL ||
+      indices == NULL || samples == NULL) {
+    free(pristine_vertices);
+    free(pristine_indices);
+    free(indices);
+    free(samples);
+    return;
+  }
+  createDuplicatedModel(pristine_vertices, pristine_indices, vertices);
+
+  for (int rep = 0; rep < reps; ++rep) {
+    float *model = memAccountMalloc(MEM_VERTICES, vertex_bytes);
+    if (model == NULL) break;
+    memcpy(model, pristine_vertices, vertex_bytes);
+    memcpy(indices, pristine_indices, index_bytes);
+    long long n_vertices = vertices;
+
+    const double start = benchNowNs();
+    weldVertices(&model, &n_vertices, indices, vertices,
+                 WELD_DEFAULT_EPSILON, NULL);
+    samples[rep] = benchNowNs() - start;
+    freeModelC(model, n_vertices, NULL, 0);
+  }
+  BenchStats_t stats;
+  benchComputeStats(samples, reps, &stats);
+  benchAddResult(report, "weldVertices", vertices, 0, &stats);
+
+  free(pristine_vertices);
+  free(pristine_indices);
+  free(indices);
+  free(samples);
+}
+
+/*!
+ * \brief createTriangleGrid
+ *
+ * Segments of a square grid cut into about n_faces triangles, three per
+ * face as the loaders write them.
+ *
+ * \return The indices, NULL if out of memory.
+ */
+static unsigned int *createTriangleGrid(long n_faces, long long *n_indices,
+                                        long long *n_vertices) {
+  const long side = (long)sqrt((double)n_faces / 2.0) + 1;
+  const long cells = (side - 1) * (side - 1);
+  unsigned int *indices = malloc((size_t)cells * 12 * sizeof(unsigned int));
+  if (indices == NULL) return NULL;
+  unsigned int *p = indices;
+  for (long row = 0; row + 1 < side; ++row) {
+    for (long column = 0; column + 1 < side; ++column) {
+      const unsigned int a = (unsigned int)(row * side + column);
+      const unsigned int corners[2][3] = {
+          {a, a + 1, a + (unsigned int)side + 1},
+          {a, a + (unsigned int)side + 1, a + (unsigned int)side}};
+      for (int t = 0; t < 2; ++t) {
+        for (int k = 0; k < 3; ++k) {
+          *p++ = corners[t][k];
+          *p++ = corners[t][(k + 1) % 3];
+        }
+      }
+    }
+  }
+  *n_indices = cells * 12;
+  *n_vertices = side * side;
+  return indices;
+}
+
+/*!
+ * \brief benchHalfEdge
+ *
+ * Measures halfEdgeBuild on a grid of about as many triangles as the size
+ * says, so the 10M row is a 10M-face model. Reports faces/s; the memory
+ * column holds the peak of the build, the mesh itself takes 24 bytes per
+ * face and 4 per vertex.
+ */
+void benchHalfEdge(const BenchConfig_t *config, BenchReport_t *report,
+                   long faces) {
+  long long n_indices = 0;
+  long long n_vertices = 0;
+  unsigned int *indices = createTriangleGrid(faces, &n_indices, &n_vertices);
+  const int reps = benchRepsFor(config, faces, 3e7);
+  double *samples = malloc(reps * sizeof(double));
+  if (indices == NULL || samples == NULL) {
+    free(indices);
+    free(samples);
+    return;
+  }
+
+  int done = 0;
+  for (; done < reps; ++done) {
+    HalfEdgeMesh_t mesh;
+    const double start = benchNowNs();
+    const int status =
+        halfEdgeBuild(indices, n_indices, n_vertices, &mesh, NULL);
+    samples[done] = benchNowNs() - start;
+    halfEdgeFree(&mesh);
+    if (status != 0) break;
+  }
+  if (done > 0) {
+    BenchStats_t stats;
+    benchComputeStats(samples, done, &stats);
+    benchAddResult(report, "halfEdgeBuild", faces, 0, &stats);
+  }
+
+  free(indices);
+  free(samples);
+}
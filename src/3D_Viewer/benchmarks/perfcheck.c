@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERF_MAX_ENTRIES 256
+#define PERF_NAME_LENGTH 64
+
+/*!
+ * \brief PerfMetric_t
+ *
+ * A compared metric of a benchmark result, the tolerated relative slowdown
+ * and the smallest model it is gated at. Both metrics are times, so larger
+ * values are worse. With 31 reps the p99 is close to the slowest rep, which
+ * on small models is mostly scheduler noise, so it only gates large models.
+ */
+typedef struct PerfMetric_t {
+  const char *key;
+  double tolerance;
+  long min_vertices;
+} PerfMetric_t;
+
+typedef struct PerfEntry_t {
+  char name[PERF_NAME_LENGTH];
+  long vertices;
+  double values[2];
+} PerfEntry_t;
+
+typedef struct PerfReport_t {
+  char *text;
+  PerfEntry_t entries[PERF_MAX_ENTRIES];
+  int n_entries;
+} PerfReport_t;
+
+static PerfMetric_t perf_metrics[] = {{"median_ns", 0.25, 0},
+                                      {"p99_ns", 1.00, 100000}};
+static const int kMetricCount = 2;
+
+static char *readFile(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    perror(path);
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  rewind(file);
+  char *text = malloc(size + 1);
+  if (text != NULL) {
+    text[fread(text, 1, size, file)] = '\0';
+  }
+  fclose(file);
+  return text;
+}
+
+// Finds "key": inside [begin, end) and returns a pointer to its value.
+static const char *findValue(const char *begin, const char *end,
+                             const char *key) {
+  char pattern[PERF_NAME_LENGTH + 4];
+  snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+  const size_t length = strlen(pattern);
+  for (const char *p = begin; p + length < end; ++p) {
+    if (strncmp(p, pattern, length) == 0) {
+      p += length;
+      while (p < end && (*p == ' ' || *p == ':')) ++p;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+static double numberValue(const char *begin, const char *end, const char *key,
+                          double fallback) {
+  const char *value = findValue(begin, end, key);
+  return value ? strtod(value, NULL) : fallback;
+}
+
+/*!
+ * \brief loadReport
+ *
+ * Reads a report written by benchmarks.out. Only the flat layout written by
+ * benchWriteJson is understood: one object per result inside "results".
+ */
+static int loadReport(const char *path, PerfReport_t *report) {
+  memset(report, 0, sizeof(*report));
+  report->text = readFile(path);
+  if (report->text == NULL) return -1;
+  const char *end = report->text + strlen(report->text);
+  const char *p = findValue(report->text, end, "results");
+  if (p == NULL) {
+    fprintf(stderr, "%s: no \"results\" array\n", path);
+    return -1;
+  }
+  while ((p = strchr(p, '{')) != NULL &&
+         report->n_entries < PERF_MAX_ENTRIES) {
+    const char *close = strchr(p, '}');
+    if (close == NULL) break;
+    PerfEntry_t *entry = &report->entries[report->n_entries++];
+    const char *name = findValue(p, close, "name");
+    if (name != NULL && *name == '"') {
+      sscanf(name + 1, "%63[^\"]", entry->name);
+    }
+    entry->vertices = (long)numberValue(p, close, "vertices", 0);
+    for (int m = 0; m < kMetricCount; ++m) {
+      entry->values[m] = numberValue(p, close, perf_metrics[m].key, 0);
+    }
+    p = close + 1;
+  }
+  return 0;
+}
+
+// Tolerances and minimum sizes stored in the baseline override the
+// defaults, command line options override both.
+static void loadTolerances(const PerfReport_t *baseline) {
+  if (baseline->text == NULL) return;
+  const char *end = baseline->text + strlen(baseline->text);
+  const char *tolerances = findValue(baseline->text, end, "tolerances");
+  const char *close = tolerances ? strchr(tolerances, '}') : NULL;
+  for (int m = 0; m < kMetricCount && close != NULL; ++m) {
+    PerfMetric_t *metric = &perf_metrics[m];
+    metric->tolerance =
+        numberValue(tolerances, close, metric->key, metric->tolerance);
+  }
+  const char *sizes = findValue(baseline->text, end, "min_vertices");
+  close = sizes ? strchr(sizes, '}') : NULL;
+  for (int m = 0; m < kMetricCount && close != NULL; ++m) {
+    PerfMetric_t *metric = &perf_metrics[m];
+    metric->min_vertices = (long)numberValue(sizes, close, metric->key,
+                                             (double)metric->min_vertices);
+  }
+}
+
+static const PerfEntry_t *findEntry(const PerfReport_t *report,
+                                    const PerfEntry_t *wanted) {
+  for (int i = 0; i < report->n_entries; ++i) {
+    const PerfEntry_t *entry = &report->entries[i];
+    if (entry->vertices == wanted->vertices &&
+        strcmp(entry->name, wanted->name) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * \brief compareReports
+ *
+ * Prints one row per result and gated metric. A result the baseline does not
+ * have is reported as missing and fails the check, so a new kernel cannot go
+ * ungated; refresh the baseline with --rebase.
+ *
+ * \return Number of metrics slower than the baseline beyond tolerance plus
+ * the number of results missing from the baseline.
+ */
+static int compareReports(const PerfReport_t *baseline,
+                          const PerfReport_t *current) {
+  int regressions = 0;
+  printf("%-22s %10s %-10s %14s %14s %9s %9s  %s\n", "kernel", "vertices",
+         "metric", "baseline", "current", "delta", "limit", "status");
+  for (int i = 0; i < current->n_entries; ++i) {
+    const PerfEntry_t *now = &current->entries[i];
+    const PerfEntry_t *before = findEntry(baseline, now);
+    if (before == NULL) {
+      printf("%-22s %10ld %-10s %14s %14s %9s %9s  MISSING\n", now->name,
+             now->vertices, "-", "-", "-", "-", "-");
+      ++regressions;
+      continue;
+    }
+    for (int m = 0; m < kMetricCount; ++m) {
+      if (now->vertices < perf_metrics[m].min_vertices) continue;
+      if (before->values[m] <= 0.0) continue;
+      const double delta = now->values[m] / before->values[m] - 1.0;
+      const int regressed = delta > perf_metrics[m].tolerance;
+      regressions += regressed;
+      printf("%-22s %10ld %-10s %14.0f %14.0f %+8.1f%% %+8.1f%%  %s\n",
+             now->name, now->vertices, perf_metrics[m].key, before->values[m],
+             now->values[m], delta * 100.0, perf_metrics[m].tolerance * 100.0,
+             regressed ? "REGRESSION" : (delta < -0.1 ? "faster" : "ok"));
+    }
+  }
+  return regressions;
+}
+
+// Writes the current report as the new baseline, keeping the tolerances
+// and minimum sizes.
+static int writeBaseline(const PerfReport_t *current, const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  const char *body = strchr(current->text, '{');
+  fprintf(file, "{\n  \"tolerances\": {\"%s\": %.2f, \"%s\": %.2f},",
+          perf_metrics[0].key, perf_metrics[0].tolerance, perf_metrics[1].key,
+          perf_metrics[1].tolerance);
+  fprintf(file, "\n  \"min_vertices\": {\"%s\": %ld, \"%s\": %ld},",
+          perf_metrics[0].key, perf_metrics[0].min_vertices,
+          perf_metrics[1].key, perf_metrics[1].min_vertices);
+  fputs(body ? body + 1 : "\n}\n", file);
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+static void printUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s BASELINE.json CURRENT.json [--median-tolerance X]\n"
+          "          [--p99-tolerance X] [--p99-min-vertices N] [--rebase]\n"
+          "Tolerances are relative slowdowns, 0.25 allows 25%% slower.\n"
+          "p99 is only gated on models of at least N vertices.\n"
+          "Results missing from BASELINE.json fail the check.\n"
+          "--rebase replaces BASELINE.json with CURRENT.json.\n",
+          program);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  int rebase = 0;
+  double tolerances[2] = {-1.0, -1.0};
+  long p99_min_vertices = -1;
+  for (int i = 3; i < argc; ++i) {
+    if (strcmp(argv[i], "--median-tolerance") == 0 && i + 1 < argc) {
+      tolerances[0] = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--p99-tolerance") == 0 && i + 1 < argc) {
+      tolerances[1] = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--p99-min-vertices") == 0 && i + 1 < argc) {
+      p99_min_vertices = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--rebase") == 0) {
+      rebase = 1;
+    } else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+
+  static PerfReport_t baseline;
+  static PerfReport_t current;
+  // A missing baseline is only an error when comparing against it.
+  if (loadReport(argv[1], &baseline) == 0) {
+    loadTolerances(&baseline);
+  } else if (!rebase) {
+    return 2;
+  }
+  if (loadReport(argv[2], &current) != 0) return 2;
+  for (int m = 0; m < kMetricCount; ++m) {
+    if (tolerances[m] >= 0.0) perf_metrics[m].tolerance = tolerances[m];
+  }
+  if (p99_min_vertices >= 0) perf_metrics[1].min_vertices = p99_min_vertices;
+
+  if (rebase) {
+    const int status = writeBaseline(&current, argv[1]);
+    if (status == 0) printf("Baseline %s updated from %s\n", argv[1], argv[2]);
+    return status == 0 ? 0 : 2;
+  }
+
+  const int regressions = compareReports(&baseline, &current);
+  if (regressions > 0) {
+    printf("perfcheck: %d metric(s) regressed or missing from the baseline\n",
+           regressions);
+    return 1;
+  }
+  printf("perfcheck: no regressions\n");
+  return 0;
+}
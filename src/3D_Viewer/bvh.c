@@ -0,0 +1,780 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "bvh.h"
+
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_dispatch.h"
+#include "memory_stats.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define BVH_GRAIN 16384
+// Three passes of 10 bits sort the 30-bit codes, 1024 counters stay in cache
+#define BVH_RADIX_BITS 10
+#define BVH_RADIX_PASSES 3
+// Bits per axis of the Morton code
+#define BVH_MORTON_BITS 10
+// Splits on the 30 key bits, then halvings of up to 2^31 equal keys
+#define BVH_MAX_DEPTH 64
+// Positions closer to the camera than this are behind it
+#define BVH_MIN_W 1e-6f
+
+/*!
+ * \brief BvhBuild_t
+ *
+ * State of one build. Everything is allocated with memAccountMalloc rather
+ * than from the model's arena, as a build on a worker thread runs while the
+ * arena's temporaries are reset.
+ */
+typedef struct BvhBuild_t {
+  const float* vertices;
+  const unsigned int* indices;
+  float minimum[3];
+  float scale[3];
+  // Morton code in the high half, primitive in the low half
+  uint64_t* keys;
+  uint32_t* primitives;
+  const ParallelToken_t* token;
+  Bvh_t* bvh;
+  long long next_node;
+} BvhBuild_t;
+
+struct BvhBuilder_t {
+  pthread_t thread;
+  const float* vertices;
+  long long n_vertices;
+  const unsigned int* indices;
+  long long n_indices;
+  ParallelToken_t* token;
+  atomic_int done;
+  int result;
+  double elapsed_ns;
+  Bvh_t bvh;
+};
+
+// Spreads the low 10 bits of v so that two zero bits follow each bit.
+static uint32_t spreadBits(uint32_t v) {
+  v &= 0x3FF;
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+static uint32_t quantize(float value, float minimum, float scale) {
+  const float q = (value - minimum) * scale;
+  const float limit = (float)((1 << BVH_MORTON_BITS) - 1);
+  // Written so that NaN ends up at 0
+  return q > 0.0f ? (uint32_t)(q < limit ? q : limit) : 0;
+}
+
+static int isCancelled(const BvhBuild_t* build) {
+  return parallelTokenCancelled(build->token);
+}
+
+// The key of a segment is that of its center.
+static void computeKeys(void* argument, long begin, long end) {
+  BvhBuild_t* build = argument;
+  for (long i = begin; i < end; ++i) {
+    const uint32_t primitive = build->primitives[i];
+    float center[3];
+    if (primitive & BVH_VERTEX_FLAG) {
+      memcpy(center,
+             &build->vertices[(size_t)(primitive & ~BVH_VERTEX_FLAG) * 3],
+             sizeof(center));
+    } else {
+      const unsigned int* ends = &build->indices[(size_t)primitive * 2];
+      const float* a = &build->vertices[(size_t)ends[0] * 3];
+      const float* b = &build->vertices[(size_t)ends[1] * 3];
+      for (int axis = 0; axis < 3; ++axis) {
+        center[axis] = 0.5f * (a[axis] + b[axis]);
+      }
+    }
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      code |= spreadBits(quantize(center[axis], build->minimum[axis],
+                                  build->scale[axis]))
+              << axis;
+    }
+    build->keys[i] = (uint64_t)code << 32 | primitive;
+  }
+}
+
+/*!
+ * \brief sortByKey
+ *
+ * LSD radix sort of the keys on their code half, with the counts of all
+ * passes taken in one read. Stable, so primitives in the same cell keep
+ * their order. The sorted primitives are copied back to build->primitives.
+ *
+ * \return 0 on success, -1 if out of memory.
+ */
+static int sortByKey(BvhBuild_t* build, uint32_t n) {
+  const size_t bytes = n * sizeof(uint64_t);
+  uint64_t* other = memAccountMalloc(MEM_LOADER_TEMP, bytes);
+  if (other == NULL) return -1;
+  const uint32_t mask = (1u << BVH_RADIX_BITS) - 1;
+  uint32_t counts[BVH_RADIX_PASSES][1 << BVH_RADIX_BITS] = {{0}};
+  uint64_t* keys = build->keys;
+  for (uint32_t i = 0; i < n; ++i) {
+    const uint32_t code = (uint32_t)(keys[i] >> 32);
+    for (int pass = 0; pass < BVH_RADIX_PASSES; ++pass) {
+      counts[pass][(code >> (pass * BVH_RADIX_BITS)) & mask]++;
+    }
+  }
+  for (int pass = 0; pass < BVH_RADIX_PASSES; ++pass) {
+    const int shift = 32 + pass * BVH_RADIX_BITS;
+    uint32_t total = 0;
+    for (int digit = 0; digit < (1 << BVH_RADIX_BITS); ++digit) {
+      const uint32_t count = counts[pass][digit];
+      counts[pass][digit] = total;
+      total += count;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+      other[counts[pass][(keys[i] >> shift) & mask]++] = keys[i];
+    }
+    uint64_t* swap = keys;
+    keys = other;
+    other = swap;
+  }
+  for (uint32_t i = 0; i < n; ++i) build->primitives[i] = (uint32_t)keys[i];
+  // After an odd number of passes the sorted keys are in the other array
+  build->keys = keys;
+  memAccountFree(MEM_LOADER_TEMP, other, bytes);
+  return 0;
+}
+
+// First position in [begin, end) where the key prefix changes: at the
+// highest differing bit, or the middle if all keys are equal.
+static uint32_t findSplit(const uint64_t* keys, uint32_t begin, uint32_t end) {
+  const uint32_t difference = (uint32_t)((keys[begin] ^ keys[end - 1]) >> 32);
+  if (difference == 0) return begin + (end - begin) / 2;
+  uint32_t bit = 1u << 31;
+  while (!(difference & bit)) bit >>= 1;
+  uint32_t low = begin + 1;
+  uint32_t high = end - 1;
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+    if ((uint32_t)(keys[middle] >> 32) & bit) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return low;
+}
+
+static long long countNodes(const uint64_t* keys, uint32_t begin,
+                            uint32_t end) {
+  if (end - begin <= BVH_LEAF_SIZE) return 1;
+  const uint32_t split = findSplit(keys, begin, end);
+  return 1 + countNodes(keys, begin, split) + countNodes(keys, split, end);
+}
+
+// Lays the subtree out depth first, so children follow their parent.
+static void placeNode(BvhBuild_t* build, long long index, uint32_t begin,
+                      uint32_t end, int depth) {
+  BvhNode_t* node = &build->bvh->nodes[index];
+  if (depth > build->bvh->depth) build->bvh->depth = depth;
+  if (end - begin <= BVH_LEAF_SIZE) {
+    node->first = begin;
+    node->count = end - begin;
+    return;
+  }
+  const uint32_t split = findSplit(build->keys, begin, end);
+  node->count = 0;
+  placeNode(build, build->next_node++, begin, split, depth + 1);
+  const long long second = build->next_node++;
+  node->first = (unsigned int)second;
+  placeNode(build, second, split, end, depth + 1);
+}
+
+// Selects rather than fminf, which is a library call, or branches, which
+// mispredict; NaN coordinates compare false and leave the box as it is. The
+// box is grown in locals, as stores to the node's floats could alias the
+// vertices.
+static void growBox(float box[6], uint32_t range[2], const float* vertices,
+                    uint32_t vertex) {
+  const float* p = &vertices[(size_t)vertex * 3];
+  for (int axis = 0; axis < 3; ++axis) {
+    box[axis] = p[axis] < box[axis] ? p[axis] : box[axis];
+    box[3 + axis] = p[axis] > box[3 + axis] ? p[axis] : box[3 + axis];
+  }
+  range[0] = vertex < range[0] ? vertex : range[0];
+  range[1] = vertex > range[1] ? vertex : range[1];
+}
+
+static void fitLeaf(const Bvh_t* bvh, const float* vertices,
+                    const unsigned int* indices, BvhNode_t* node) {
+  float box[6] = {FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+  uint32_t range[2] = {UINT32_MAX, 0};
+  for (uint32_t i = node->first; i < node->first + node->count; ++i) {
+    const uint32_t primitive = bvh->primitives[i];
+    uint32_t ends[2] = {primitive & ~BVH_VERTEX_FLAG,
+                        primitive & ~BVH_VERTEX_FLAG};
+    if (!(primitive & BVH_VERTEX_FLAG)) {
+      ends[0] = indices[(size_t)primitive * 2];
+      ends[1] = indices[(size_t)primitive * 2 + 1];
+    }
+    for (int e = 0; e < 2; ++e) growBox(box, range, vertices, ends[e]);
+  }
+  memcpy(node->min, box, sizeof(node->min));
+  memcpy(node->max, box + 3, sizeof(node->max));
+  node->low = range[0];
+  node->high = range[1];
+}
+
+static void fitInner(Bvh_t* bvh, long long index) {
+  BvhNode_t* node = &bvh->nodes[index];
+  const BvhNode_t* a = &bvh->nodes[index + 1];
+  const BvhNode_t* b = &bvh->nodes[node->first];
+  for (int axis = 0; axis < 3; ++axis) {
+    node->min[axis] = a->min[axis] < b->min[axis] ? a->min[axis] : b->min[axis];
+    node->max[axis] = a->max[axis] > b->max[axis] ? a->max[axis] : b->max[axis];
+  }
+  node->low = a->low < b->low ? a->low : b->low;
+  node->high = a->high > b->high ? a->high : b->high;
+}
+
+typedef struct BvhRefit_t {
+  Bvh_t* bvh;
+  const float* vertices;
+  const unsigned int* indices;
+} BvhRefit_t;
+
+static void fitLeaves(void* argument, long begin, long end) {
+  BvhRefit_t* refit = argument;
+  for (long i = begin; i < end; ++i) {
+    BvhNode_t* node = &refit->bvh->nodes[i];
+    if (node->count > 0) {
+      fitLeaf(refit->bvh, refit->vertices, refit->indices, node);
+    }
+  }
+}
+
+// Leaves in parallel, then the inner nodes from the last one up.
+static void fitAll(Bvh_t* bvh, const float* vertices,
+                   const unsigned int* indices, const ParallelToken_t* token) {
+  BvhRefit_t refit = {bvh, vertices, indices};
+  if (parallelForCancellable((long)bvh->n_nodes, BVH_GRAIN, fitLeaves, &refit,
+                             token) != 0) {
+    return;
+  }
+  for (long long i = bvh->n_nodes - 1; i >= 0; --i) {
+    if (bvh->nodes[i].count == 0) fitInner(bvh, i);
+  }
+}
+
+static void fitRange(Bvh_t* bvh, const float* vertices,
+                     const unsigned int* indices, long long index,
+                     uint32_t first, uint32_t last) {
+  BvhNode_t* node = &bvh->nodes[index];
+  if (node->high < first || node->low > last) return;
+  if (node->count > 0) {
+    fitLeaf(bvh, vertices, indices, node);
+    return;
+  }
+  fitRange(bvh, vertices, indices, index + 1, first, last);
+  fitRange(bvh, vertices, indices, node->first, first, last);
+  fitInner(bvh, index);
+}
+
+// Segments with a vertex out of range are left out.
+static uint32_t gatherPrimitives(const unsigned int* indices,
+                                 long long n_indices, long long n_vertices,
+                                 unsigned char* used, uint32_t* primitives) {
+  uint32_t n = 0;
+  for (long long s = 0; s < n_indices / 2; ++s) {
+    const unsigned int a = indices[s * 2];
+    const unsigned int b = indices[s * 2 + 1];
+    if (a >= n_vertices || b >= n_vertices) continue;
+    used[a] = 1;
+    used[b] = 1;
+    primitives[n++] = (uint32_t)s;
+  }
+  for (long long v = 0; v < n_vertices; ++v) {
+    if (!used[v]) primitives[n++] = (uint32_t)v | BVH_VERTEX_FLAG;
+  }
+  return n;
+}
+
+static void computeScale(BvhBuild_t* build, long long n_vertices) {
+  float maximum[3];
+  cpuKernels()->bounds(build->vertices, n_vertices, build->minimum, maximum);
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = maximum[axis] - build->minimum[axis];
+    build->scale[axis] =
+        extent > 0.0f ? (float)(1 << BVH_MORTON_BITS) / extent : 0.0f;
+  }
+}
+
+/*!
+ * \brief buildBvh
+ *
+ * Builds the hierarchy in Morton order: primitives are sorted by the
+ * Morton code of their centers, and every node is split where the code's
+ * highest differing bit changes, which puts the primitives of each octree
+ * cell in a subtree of their own. Keys and boxes are computed on
+ * parallelThreadCount() threads. Once token, if not NULL, is cancelled
+ * the rest of the current pass is skipped and no other pass is started.
+ */
+static int buildBvh(const float* vertices, long long n_vertices,
+                    const unsigned int* indices, long long n_indices,
+                    Bvh_t* bvh, const ParallelToken_t* token) {
+  memset(bvh, 0, sizeof(*bvh));
+  if (n_vertices < 0 || n_indices < 0 || n_vertices >= BVH_VERTEX_FLAG ||
+      n_indices / 2 >= BVH_VERTEX_FLAG) {
+    return -1;
+  }
+  bvh->n_vertices = n_vertices;
+  bvh->n_indices = n_indices;
+  const size_t most = (size_t)(n_indices / 2 + n_vertices);
+  if (most == 0) return 0;
+  BvhBuild_t build = {0};
+  build.vertices = vertices;
+  build.indices = indices;
+  build.token = token;
+  build.bvh = bvh;
+  unsigned char* used = memAccountMalloc(MEM_LOADER_TEMP, (size_t)n_vertices);
+  build.primitives = memAccountMalloc(MEM_INDICES, most * sizeof(uint32_t));
+  if ((used == NULL && n_vertices > 0) || build.primitives == NULL) {
+    memAccountFree(MEM_LOADER_TEMP, used, (size_t)n_vertices);
+    memAccountFree(MEM_INDICES, build.primitives, most * sizeof(uint32_t));
+    return -1;
+  }
+  if (n_vertices > 0) memset(used, 0, (size_t)n_vertices);
+  const uint32_t n =
+      gatherPrimitives(indices, n_indices, n_vertices, used, build.primitives);
+  memAccountFree(MEM_LOADER_TEMP, used, (size_t)n_vertices);
+  bvh->primitives = build.primitives;
+  bvh->n_primitives = n;
+  // The primitives keep their allocated size, see bvhFree()
+  if (n == 0) return 0;
+  build.keys = memAccountMalloc(MEM_LOADER_TEMP, n * sizeof(uint64_t));
+  int result = -1;
+  if (build.keys != NULL && !isCancelled(&build)) {
+    computeScale(&build, n_vertices);
+    parallelForCancellable((long)n, BVH_GRAIN, computeKeys, &build,
+                           build.token);
+    if (!isCancelled(&build) && sortByKey(&build, n) == 0 &&
+        !isCancelled(&build)) {
+      bvh->n_nodes = countNodes(build.keys, 0, n);
+      bvh->nodes =
+          memAccountMalloc(MEM_INDICES, bvh->n_nodes * sizeof(BvhNode_t));
+      if (bvh->nodes != NULL) {
+        build.next_node = 1;
+        placeNode(&build, 0, 0, n, 1);
+        fitAll(bvh, vertices, indices, build.token);
+        result = 0;
+      }
+    }
+  }
+  memAccountFree(MEM_LOADER_TEMP, build.keys, n * sizeof(uint64_t));
+  if (result != 0 || isCancelled(&build)) {
+    bvhFree(bvh);
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * \brief bvhBuild
+ *
+ * Builds the hierarchy over the segments of a model and its vertices
+ * without segments, see buildBvh(). bvhBuildStart() does the same on a
+ * worker thread.
+ *
+ * \return 0 on success, -1 if out of memory or there are 2^31 vertices or
+ * segments or more, with an empty hierarchy then.
+ */
+int bvhBuild(const float* vertices, long long n_vertices,
+             const unsigned int* indices, long long n_indices, Bvh_t* bvh) {
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+  const int result =
+      buildBvh(vertices, n_vertices, indices, n_indices, bvh, NULL);
+  stageTimerRecord(STAGE_BVH, start, bvh->n_primitives);
+  TRACE_END(span, "bvhBuild");
+  return result;
+}
+
+void bvhFree(Bvh_t* bvh) {
+  const long long n_primitives = bvh->n_indices / 2 + bvh->n_vertices;
+  memAccountFree(MEM_INDICES, bvh->nodes,
+                 (size_t)bvh->n_nodes * sizeof(BvhNode_t));
+  memAccountFree(MEM_INDICES, bvh->primitives,
+                 (size_t)n_primitives * sizeof(uint32_t));
+  memset(bvh, 0, sizeof(*bvh));
+}
+
+// Bytes held by the hierarchy.
+long long bvhBytes(const Bvh_t* bvh) {
+  if (bvh->primitives == NULL) return 0;
+  return bvh->n_nodes * (long long)sizeof(BvhNode_t) +
+         (bvh->n_indices / 2 + bvh->n_vertices) * (long long)sizeof(uint32_t);
+}
+
+/*!
+ * \brief bvhRefit
+ *
+ * Recomputes the boxes after vertices moved, keeping the tree: the result
+ * is as tight as a new build's for the same order, though the order may
+ * have got worse. A change to all vertices, such as a transform, refits
+ * the leaves in parallel; a smaller range refits the nodes whose vertex
+ * range overlaps it. The indices must be those of the build.
+ *
+ * \param first_vertex First changed vertex.
+ * \param n_changed Number of changed vertices, n_vertices for all of them.
+ */
+void bvhRefit(Bvh_t* bvh, const float* vertices, const unsigned int* indices,
+              long long first_vertex, long long n_changed) {
+  if (bvh->n_nodes == 0 || n_changed <= 0) return;
+  TRACE_BEGIN(span);
+  if (first_vertex <= 0 && n_changed >= bvh->n_vertices) {
+    fitAll(bvh, vertices, indices, NULL);
+  } else if (first_vertex < bvh->n_vertices) {
+    long long last = first_vertex + n_changed - 1;
+    if (last >= bvh->n_vertices) last = bvh->n_vertices - 1;
+    fitRange(bvh, vertices, indices, 0,
+             (uint32_t)(first_vertex < 0 ? 0 : first_vertex), (uint32_t)last);
+  }
+  TRACE_END(span, "bvhRefit");
+}
+
+/*!
+ * \brief BvhView_t
+ *
+ * Window of a query: the column-major mvp matrix, the viewport in pixels
+ * and the cursor, with y growing downwards as in Qt.
+ */
+typedef struct BvhView_t {
+  const float* mvp;
+  // mvp times the transform of the vertices since the boxes were fit
+  float box_mvp[16];
+  float width;
+  float height;
+  float x;
+  float y;
+} BvhView_t;
+
+static void toClip(const float mvp[16], const float p[3], float clip[4]) {
+  for (int row = 0; row < 4; ++row) {
+    clip[row] = mvp[row] * p[0] + mvp[4 + row] * p[1] + mvp[8 + row] * p[2] +
+                mvp[12 + row];
+  }
+}
+
+// Window position of a clip position in front of the camera.
+static void toWindow(const BvhView_t* view, const float clip[4],
+                     float window[3]) {
+  window[0] = (clip[0] / clip[3] + 1.0f) * 0.5f * view->width;
+  window[1] = (1.0f - clip[1] / clip[3]) * 0.5f * view->height;
+  window[2] = (clip[2] / clip[3] + 1.0f) * 0.5f;
+}
+
+/*!
+ * \brief boxPixels
+ *
+ * \return Distance in pixels from the cursor to the window rectangle of a
+ * box, 0 if the box reaches behind the near plane, or -1 if it is empty or
+ * all in front of the near or beyond the far plane.
+ */
+static float boxPixels(const BvhView_t* view, const BvhNode_t* node) {
+  if (node->min[0] > node->max[0]) return -1.0f;
+  // Corners are the clip position of min plus the clip offsets of the
+  // box's extent along each axis
+  float base[4];
+  toClip(view->box_mvp, node->min, base);
+  float step[3][4];
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = node->max[axis] - node->min[axis];
+    for (int row = 0; row < 4; ++row) {
+      step[axis][row] = view->box_mvp[axis * 4 + row] * extent;
+    }
+  }
+  float low[2] = {FLT_MAX, FLT_MAX};
+  float high[2] = {-FLT_MAX, -FLT_MAX};
+  int near = 0;
+  int far = 0;
+  int clipped = 0;
+  for (int corner = 0; corner < 8; ++corner) {
+    float clip[4];
+    for (int row = 0; row < 4; ++row) {
+      clip[row] = base[row] + (corner & 1 ? step[0][row] : 0.0f) +
+                  (corner & 2 ? step[1][row] : 0.0f) +
+                  (corner & 4 ? step[2][row] : 0.0f);
+    }
+    near += clip[2] < -clip[3];
+    far += clip[2] > clip[3];
+    if (clip[2] < -clip[3] || clip[3] <= BVH_MIN_W) {
+      clipped = 1;
+      continue;
+    }
+    float window[3];
+    toWindow(view, clip, window);
+    for (int axis = 0; axis < 2; ++axis) {
+      if (window[axis] < low[axis]) low[axis] = window[axis];
+      if (window[axis] > high[axis]) high[axis] = window[axis];
+    }
+  }
+  if (near == 8 || far == 8) return -1.0f;
+  if (clipped) return 0.0f;
+  const float dx = low[0] > view->x ? low[0] - view->x
+                   : view->x > high[0] ? view->x - high[0]
+                                       : 0.0f;
+  const float dy = low[1] > view->y ? low[1] - view->y
+                   : view->y > high[1] ? view->y - high[1]
+                                       : 0.0f;
+  return sqrtf(dx * dx + dy * dy);
+}
+
+// Keeps the vertex if it is closer to the cursor, or as close and nearer.
+static void testVertex(const BvhView_t* view, const float* vertices,
+                       uint32_t vertex, BvhPick_t* best) {
+  float clip[4];
+  toClip(view->mvp, &vertices[(size_t)vertex * 3], clip);
+  if (clip[3] <= BVH_MIN_W || clip[2] < -clip[3] || clip[2] > clip[3]) return;
+  float window[3];
+  toWindow(view, clip, window);
+  const float dx = window[0] - view->x;
+  const float dy = window[1] - view->y;
+  const float pixels = sqrtf(dx * dx + dy * dy);
+  if (pixels < best->pixels ||
+      (pixels == best->pixels && window[2] < best->depth)) {
+    best->kind = BVH_PICK_VERTEX;
+    best->index = vertex;
+    best->pixels = pixels;
+    best->depth = window[2];
+  }
+}
+
+// Same for a segment, cut at the near plane.
+static void testSegment(const BvhView_t* view, const float* vertices,
+                        const unsigned int* indices, uint32_t segment,
+                        BvhPick_t* best) {
+  float a[4], b[4];
+  toClip(view->mvp, &vertices[(size_t)indices[segment * 2] * 3], a);
+  toClip(view->mvp, &vertices[(size_t)indices[segment * 2 + 1] * 3], b);
+  const float da = a[2] + a[3];
+  const float db = b[2] + b[3];
+  if (da < 0.0f && db < 0.0f) return;
+  if (da < 0.0f || db < 0.0f) {
+    float* behind = da < 0.0f ? a : b;
+    const float* front = da < 0.0f ? b : a;
+    const float d_behind = da < 0.0f ? da : db;
+    const float d_front = da < 0.0f ? db : da;
+    const float t = d_behind / (d_behind - d_front);
+    for (int i = 0; i < 4; ++i) behind[i] += (front[i] - behind[i]) * t;
+  }
+  if (a[3] <= BVH_MIN_W || b[3] <= BVH_MIN_W) return;
+  float wa[3], wb[3];
+  toWindow(view, a, wa);
+  toWindow(view, b, wb);
+  const float ex = wb[0] - wa[0];
+  const float ey = wb[1] - wa[1];
+  const float length = ex * ex + ey * ey;
+  float t = 0.0f;
+  if (length > 0.0f) {
+    t = ((view->x - wa[0]) * ex + (view->y - wa[1]) * ey) / length;
+    t = fminf(fmaxf(t, 0.0f), 1.0f);
+  }
+  const float dx = wa[0] + ex * t - view->x;
+  const float dy = wa[1] + ey * t - view->y;
+  const float pixels = sqrtf(dx * dx + dy * dy);
+  const float depth = wa[2] + (wb[2] - wa[2]) * t;
+  if (depth < 0.0f || depth > 1.0f) return;
+  if (pixels < best->pixels ||
+      (pixels == best->pixels && depth < best->depth)) {
+    best->kind = BVH_PICK_EDGE;
+    best->index = segment;
+    best->pixels = pixels;
+    best->depth = depth;
+  }
+}
+
+/*!
+ * \brief bvhPick
+ *
+ * Finds the vertex or edge under the cursor in screen space. A vertex
+ * within max_pixels wins over any edge, so the corners of small faces can
+ * be picked; otherwise the closest edge within max_pixels is taken, and
+ * of equally close ones the nearest to the camera. Nodes are visited
+ * nearest rectangle first, and those farther from the cursor than the
+ * best vertex so far, or max_pixels, are skipped with their subtrees.
+ *
+ * \param mvp Column-major projection times model-view matrix.
+ * \param moved Affine transform applied to the vertices since the boxes
+ * were last fit, NULL for none. The boxes are projected through it, so
+ * moving, scaling or rotating the model needs no refit.
+ * \param x, y Cursor in pixels from the top left corner.
+ */
+void bvhPick(const Bvh_t* bvh, const float* vertices,
+             const unsigned int* indices, const float mvp[16],
+             const float moved[16], int width, int height, float x, float y,
+             float max_pixels, BvhPick_t* pick) {
+  memset(pick, 0, sizeof(*pick));
+  pick->index = -1;
+  if (bvh->n_nodes == 0) return;
+  BvhView_t view = {mvp, {0}, (float)width, (float)height, x, y};
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 4; ++row) {
+      float sum = 0.0f;
+      for (int k = 0; k < 4; ++k) {
+        const float m = moved == NULL ? (float)(k == column)
+                                      : moved[column * 4 + k];
+        sum += mvp[k * 4 + row] * m;
+      }
+      view.box_mvp[column * 4 + row] = sum;
+    }
+  }
+  BvhPick_t vertex = {BVH_PICK_NONE, -1, FLT_MAX, FLT_MAX, 0};
+  BvhPick_t edge = vertex;
+  vertex.pixels = max_pixels;
+  edge.pixels = max_pixels;
+  uint32_t stack[BVH_MAX_DEPTH * 2];
+  float stack_pixels[BVH_MAX_DEPTH * 2];
+  int size = 0;
+  const float root = boxPixels(&view, &bvh->nodes[0]);
+  if (root >= 0.0f && root <= max_pixels) {
+    stack[size] = 0;
+    stack_pixels[size++] = root;
+  }
+  while (size > 0) {
+    --size;
+    const uint32_t index = stack[size];
+    // A vertex beats every edge, so only a closer vertex matters once found
+    if (stack_pixels[size] > vertex.pixels) continue;
+    const BvhNode_t* node = &bvh->nodes[index];
+    pick->nodes_visited++;
+    if (node->count > 0) {
+      for (uint32_t i = node->first; i < node->first + node->count; ++i) {
+        const uint32_t primitive = bvh->primitives[i];
+        if (primitive & BVH_VERTEX_FLAG) {
+          testVertex(&view, vertices, primitive & ~BVH_VERTEX_FLAG, &vertex);
+          continue;
+        }
+        testVertex(&view, vertices, indices[primitive * 2], &vertex);
+        testVertex(&view, vertices, indices[primitive * 2 + 1], &vertex);
+        if (vertex.kind == BVH_PICK_NONE) {
+          testSegment(&view, vertices, indices, primitive, &edge);
+        }
+      }
+      continue;
+    }
+    const uint32_t children[2] = {index + 1, node->first};
+    float pixels[2];
+    for (int c = 0; c < 2; ++c) {
+      pixels[c] = boxPixels(&view, &bvh->nodes[children[c]]);
+    }
+    // The nearer child is pushed last and visited first
+    const int nearer = pixels[1] >= 0.0f && pixels[1] < pixels[0];
+    for (int c = 0; c < 2; ++c) {
+      const int child = c == 0 ? !nearer : nearer;
+      if (pixels[child] < 0.0f || pixels[child] > vertex.pixels) continue;
+      stack[size] = children[child];
+      stack_pixels[size++] = pixels[child];
+    }
+  }
+  const long long visited = pick->nodes_visited;
+  if (vertex.kind != BVH_PICK_NONE) {
+    *pick = vertex;
+  } else if (edge.kind != BVH_PICK_NONE) {
+    *pick = edge;
+  }
+  pick->nodes_visited = visited;
+}
+
+static void* runBuilder(void* argument) {
+  BvhBuilder_t* builder = argument;
+  traceSetThreadName("bvh builder");
+  // Transforms on the GUI thread go first on the shared pool
+  parallelSetPriority(PARALLEL_BACKGROUND);
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+  builder->result =
+      buildBvh(builder->vertices, builder->n_vertices, builder->indices,
+               builder->n_indices, &builder->bvh, builder->token);
+  TRACE_END(span, "bvhBuild");
+  builder->elapsed_ns = stageTimerNow() - start;
+  atomic_store(&builder->done, 1);
+  return NULL;
+}
+
+/*!
+ * \brief bvhBuildStart
+ *
+ * Starts bvhBuild() on a worker thread, whose loops run on the shared
+ * pool at background priority. The vertices and indices must not change or
+ * be freed until bvhBuildFinish() or bvhBuildCancel(); they may be read
+ * meanwhile.
+ *
+ * \return The builder, or NULL if its memory or thread could not be had.
+ */
+BvhBuilder_t* bvhBuildStart(const float* vertices, long long n_vertices,
+                            const unsigned int* indices, long long n_indices) {
+  BvhBuilder_t* builder = calloc(1, sizeof(BvhBuilder_t));
+  if (builder == NULL) return NULL;
+  builder->vertices = vertices;
+  builder->n_vertices = n_vertices;
+  builder->indices = indices;
+  builder->n_indices = n_indices;
+  builder->token = parallelTokenCreate();
+  atomic_init(&builder->done, 0);
+  if (builder->token == NULL ||
+      pthread_create(&builder->thread, NULL, runBuilder, builder) != 0) {
+    parallelTokenDestroy(builder->token);
+    free(builder);
+    return NULL;
+  }
+  return builder;
+}
+
+// Whether bvhBuildFinish() would return without waiting.
+int bvhBuildDone(BvhBuilder_t* builder) {
+  return builder == NULL || atomic_load(&builder->done);
+}
+
+/*!
+ * \brief bvhBuildFinish
+ *
+ * Waits for the build, frees the builder and hands over the hierarchy.
+ *
+ * \return 0 on success, otherwise -1 with an empty hierarchy.
+ */
+int bvhBuildFinish(BvhBuilder_t* builder, Bvh_t* bvh) {
+  memset(bvh, 0, sizeof(*bvh));
+  if (builder == NULL) return -1;
+  pthread_join(builder->thread, NULL);
+  const int result = builder->result;
+  if (result == 0) {
+    *bvh = builder->bvh;
+    stageTimerRecord(STAGE_BVH, stageTimerNow() - builder->elapsed_ns,
+                     bvh->n_primitives);
+  }
+  parallelTokenDestroy(builder->token);
+  free(builder);
+  return result;
+}
+
+/*!
+ * \brief bvhBuildCancel
+ *
+ * Cancels the token of the build, so that the chunks of its current pass
+ * not started yet are skipped, waits for it and frees everything. Does
+ * nothing for NULL.
+ */
+void bvhBuildCancel(BvhBuilder_t* builder) {
+  if (builder == NULL) return;
+  parallelTokenCancel(builder->token);
+  Bvh_t bvh;
+  if (bvhBuildFinish(builder, &bvh) == 0) bvhFree(&bvh);
+}
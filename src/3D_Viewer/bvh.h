@@ -0,0 +1,94 @@
+#ifndef BVH_H
+#define BVH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most primitives in a leaf
+#define BVH_LEAF_SIZE 8
+// Cursor distance in pixels within which a vertex or an edge is picked
+#define BVH_PICK_PIXELS 6.0f
+// Primitives with this bit are vertices without edges, the others segments
+#define BVH_VERTEX_FLAG 0x80000000u
+
+/*!
+ * \brief BvhNode_t
+ *
+ * Node of a bounding volume hierarchy. A leaf holds count primitives from
+ * first on; an inner node has count 0, its first child right after it and
+ * its second child at first. low and high are the smallest and largest
+ * vertex the primitives below it use, so a change to a range of vertices
+ * only refits the nodes whose range overlaps it.
+ */
+typedef struct BvhNode_t {
+  float min[3];
+  float max[3];
+  unsigned int first;
+  unsigned int count;
+  unsigned int low;
+  unsigned int high;
+} BvhNode_t;
+
+/*!
+ * \brief Bvh_t
+ *
+ * Hierarchy over the segments of a model and its vertices that no segment
+ * uses, in Morton order of their centers, with node 0 as the root. It keeps
+ * no pointer to the vertices and indices, which are passed to every call.
+ */
+typedef struct Bvh_t {
+  BvhNode_t* nodes;
+  unsigned int* primitives;
+  long long n_nodes;
+  long long n_primitives;
+  long long n_vertices;
+  long long n_indices;
+  int depth;
+} Bvh_t;
+
+typedef enum BvhPickKind_t {
+  BVH_PICK_NONE,
+  BVH_PICK_VERTEX,
+  BVH_PICK_EDGE
+} BvhPickKind_t;
+
+/*!
+ * \brief BvhPick_t
+ *
+ * Result of bvhPick. index is a vertex or a segment, whose vertices are
+ * indices[2 * index] and indices[2 * index + 1]. pixels is the distance
+ * from the cursor, depth the window depth in [0, 1] of the picked point.
+ */
+typedef struct BvhPick_t {
+  BvhPickKind_t kind;
+  long long index;
+  float pixels;
+  float depth;
+  long long nodes_visited;
+} BvhPick_t;
+
+typedef struct BvhBuilder_t BvhBuilder_t;
+
+int bvhBuild(const float* vertices, long long n_vertices,
+             const unsigned int* indices, long long n_indices, Bvh_t* bvh);
+void bvhFree(Bvh_t* bvh);
+long long bvhBytes(const Bvh_t* bvh);
+void bvhRefit(Bvh_t* bvh, const float* vertices, const unsigned int* indices,
+              long long first_vertex, long long n_changed);
+void bvhPick(const Bvh_t* bvh, const float* vertices,
+             const unsigned int* indices, const float mvp[16],
+             const float moved[16], int width, int height, float x, float y,
+             float max_pixels, BvhPick_t* pick);
+
+BvhBuilder_t* bvhBuildStart(const float* vertices, long long n_vertices,
+                            const unsigned int* indices, long long n_indices);
+int bvhBuildDone(BvhBuilder_t* builder);
+int bvhBuildFinish(BvhBuilder_t* builder, Bvh_t* bvh);
+void bvhBuildCancel(BvhBuilder_t* builder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // BVH_H
@@ -0,0 +1,226 @@
+#include "camera.h"
+
+#include <math.h>
+#include <string.h>
+
+#define CAMERA_PI 3.14159265358979f
+
+// Where GLWidget used to place the camera with lookAt, up is +y
+static const float kHomeEye[3] = {2.0f, 2.0f, 4.0f};
+
+static void normalize3(float v[3]) {
+  const float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (length > 0.0f) {
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+  }
+}
+
+static void cross3(const float a[3], const float b[3], float out[3]) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void normalizeQuaternion(float q[4]) {
+  const float length =
+      sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int i = 0; i < 4; ++i) q[i] /= length;
+}
+
+// out = a * b, so that rotating by out rotates by b first
+static void multiplyQuaternions(const float a[4], const float b[4],
+                                float out[4]) {
+  out[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  out[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  out[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  out[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+static void quaternionToMatrix(const float q[4], float r[3][3]) {
+  const float w = q[0], x = q[1], y = q[2], z = q[3];
+  r[0][0] = 1.0f - 2.0f * (y * y + z * z);
+  r[0][1] = 2.0f * (x * y - w * z);
+  r[0][2] = 2.0f * (x * z + w * y);
+  r[1][0] = 2.0f * (x * y + w * z);
+  r[1][1] = 1.0f - 2.0f * (x * x + z * z);
+  r[1][2] = 2.0f * (y * z - w * x);
+  r[2][0] = 2.0f * (x * z - w * y);
+  r[2][1] = 2.0f * (y * z + w * x);
+  r[2][2] = 1.0f - 2.0f * (x * x + y * y);
+}
+
+static void matrixToQuaternion(float r[3][3], float q[4]) {
+  const float trace = r[0][0] + r[1][1] + r[2][2];
+  if (trace > 0.0f) {
+    const float s = 2.0f * sqrtf(trace + 1.0f);
+    q[0] = 0.25f * s;
+    q[1] = (r[2][1] - r[1][2]) / s;
+    q[2] = (r[0][2] - r[2][0]) / s;
+    q[3] = (r[1][0] - r[0][1]) / s;
+  } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+    const float s = 2.0f * sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]);
+    q[0] = (r[2][1] - r[1][2]) / s;
+    q[1] = 0.25f * s;
+    q[2] = (r[0][1] + r[1][0]) / s;
+    q[3] = (r[0][2] + r[2][0]) / s;
+  } else if (r[1][1] > r[2][2]) {
+    const float s = 2.0f * sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]);
+    q[0] = (r[0][2] - r[2][0]) / s;
+    q[1] = (r[0][1] + r[1][0]) / s;
+    q[2] = 0.25f * s;
+    q[3] = (r[1][2] + r[2][1]) / s;
+  } else {
+    const float s = 2.0f * sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]);
+    q[0] = (r[1][0] - r[0][1]) / s;
+    q[1] = (r[0][2] + r[2][0]) / s;
+    q[2] = (r[1][2] + r[2][1]) / s;
+    q[3] = 0.25f * s;
+  }
+  normalizeQuaternion(q);
+}
+
+// Point of the unit sphere under a pixel, the sphere filling the shorter
+// side of the widget. Outside it the closest point of its rim is taken.
+static void arcballPoint(float x, float y, int width, int height,
+                         float point[3]) {
+  const float size = (float)(width < height ? width : height);
+  point[0] = (2.0f * x - width) / size;
+  point[1] = (height - 2.0f * y) / size;
+  const float squared = point[0] * point[0] + point[1] * point[1];
+  if (squared <= 1.0f) {
+    point[2] = sqrtf(1.0f - squared);
+  } else {
+    point[2] = 0.0f;
+    normalize3(point);
+  }
+}
+
+/*!
+ * \brief cameraReset
+ *
+ * Looks at the origin from (2, 2, 4) with +y up, the view the viewer starts
+ * with.
+ */
+void cameraReset(Camera_t* camera) {
+  float forward[3] = {-kHomeEye[0], -kHomeEye[1], -kHomeEye[2]};
+  const float up[3] = {0.0f, 1.0f, 0.0f};
+  normalize3(forward);
+  float side[3];
+  cross3(forward, up, side);
+  normalize3(side);
+  float camera_up[3];
+  cross3(side, forward, camera_up);
+  float rotation[3][3];
+  for (int axis = 0; axis < 3; ++axis) {
+    rotation[0][axis] = side[axis];
+    rotation[1][axis] = camera_up[axis];
+    rotation[2][axis] = -forward[axis];
+  }
+  matrixToQuaternion(rotation, camera->orientation);
+  memset(camera->target, 0, sizeof(camera->target));
+  camera->distance = sqrtf(kHomeEye[0] * kHomeEye[0] +
+                           kHomeEye[1] * kHomeEye[1] +
+                           kHomeEye[2] * kHomeEye[2]);
+  camera->home_distance = camera->distance;
+}
+
+/*!
+ * \brief cameraOrbit
+ *
+ * Turns the view about the target for a mouse drag from (x0, y0) to
+ * (x1, y1), in widget pixels. The point of the arcball under the cursor
+ * stays under it, so the model follows the mouse.
+ */
+void cameraOrbit(Camera_t* camera, float x0, float y0, float x1, float y1,
+                 int width, int height) {
+  if (width <= 0 || height <= 0) return;
+  float from[3];
+  float to[3];
+  arcballPoint(x0, y0, width, height, from);
+  arcballPoint(x1, y1, width, height, to);
+  const float dot = from[0] * to[0] + from[1] * to[1] + from[2] * to[2];
+  // Opposite points of the rim have no single rotation between them
+  if (dot <= -0.999999f) return;
+  float drag[4] = {1.0f + dot, 0.0f, 0.0f, 0.0f};
+  cross3(from, to, drag + 1);
+  normalizeQuaternion(drag);
+
+  float orientation[4];
+  multiplyQuaternions(drag, camera->orientation, orientation);
+  normalizeQuaternion(orientation);
+  memcpy(camera->orientation, orientation, sizeof(orientation));
+}
+
+/*!
+ * \brief cameraPan
+ *
+ * Moves the target in the view plane so that the model follows a mouse
+ * drag of (dx, dy) pixels.
+ *
+ * \param parallel Whether the parallel projection, spanning -1 to 1 across
+ * the widget, is shown instead of the perspective one.
+ */
+void cameraPan(Camera_t* camera, float dx, float dy, int width, int height,
+               int parallel) {
+  if (width <= 0 || height <= 0) return;
+  float per_pixel_x;
+  float per_pixel_y;
+  if (parallel) {
+    const float scale = camera->home_distance / camera->distance;
+    per_pixel_x = 2.0f / (width * scale);
+    per_pixel_y = 2.0f / (height * scale);
+  } else {
+    const float half_fov = CAMERA_FOV_DEGREES * CAMERA_PI / 360.0f;
+    per_pixel_x = 2.0f * camera->distance * tanf(half_fov) / height;
+    per_pixel_y = per_pixel_x;
+  }
+  float rotation[3][3];
+  quaternionToMatrix(camera->orientation, rotation);
+  for (int axis = 0; axis < 3; ++axis) {
+    camera->target[axis] -= dx * per_pixel_x * rotation[0][axis] -
+                            dy * per_pixel_y * rotation[1][axis];
+  }
+}
+
+/*!
+ * \brief cameraZoom
+ *
+ * Moves the camera towards the target by CAMERA_ZOOM_STEP per step, away
+ * from it for negative steps, within CAMERA_MIN_DISTANCE and
+ * CAMERA_MAX_DISTANCE.
+ */
+void cameraZoom(Camera_t* camera, float steps) {
+  float distance = camera->distance / powf(CAMERA_ZOOM_STEP, steps);
+  if (distance < CAMERA_MIN_DISTANCE) distance = CAMERA_MIN_DISTANCE;
+  if (distance > CAMERA_MAX_DISTANCE) distance = CAMERA_MAX_DISTANCE;
+  camera->distance = distance;
+}
+
+/*!
+ * \brief cameraViewMatrix
+ *
+ * Fills the column-major model-view matrix, like QMatrix4x4::data(). In
+ * parallel projection the camera stays at home_distance and the distance
+ * scales the view across the screen instead.
+ */
+void cameraViewMatrix(const Camera_t* camera, int parallel, float view[16]) {
+  float rotation[3][3];
+  quaternionToMatrix(camera->orientation, rotation);
+  const float scale =
+      parallel ? camera->home_distance / camera->distance : 1.0f;
+  const float distance = parallel ? camera->home_distance : camera->distance;
+  memset(view, 0, 16 * sizeof(float));
+  for (int row = 0; row < 3; ++row) {
+    const float row_scale = row < 2 ? scale : 1.0f;
+    float translation = 0.0f;
+    for (int column = 0; column < 3; ++column) {
+      view[column * 4 + row] = row_scale * rotation[row][column];
+      translation -= view[column * 4 + row] * camera->target[column];
+    }
+    view[12 + row] = translation;
+  }
+  view[14] -= distance;
+  view[15] = 1.0f;
+}
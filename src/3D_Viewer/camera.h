@@ -0,0 +1,44 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Same field of view as the perspective projection of GLWidget
+#define CAMERA_FOV_DEGREES 50.0f
+// Distance change per wheel step
+#define CAMERA_ZOOM_STEP 1.1f
+// Keeps the target between the near and far planes, 0.1 and 100
+#define CAMERA_MIN_DISTANCE 0.25f
+#define CAMERA_MAX_DISTANCE 50.0f
+
+/*!
+ * \brief Camera_t
+ *
+ * Arcball camera looking at target from distance. orientation is the unit
+ * quaternion (w, x, y, z) rotating world directions into the camera's. The
+ * model itself is never changed; cameraViewMatrix() gives the model-view
+ * matrix. In parallel projection the distance scales the view instead,
+ * relative to home_distance, the distance after cameraReset().
+ */
+typedef struct Camera_t {
+  float orientation[4];
+  float target[3];
+  float distance;
+  float home_distance;
+} Camera_t;
+
+void cameraReset(Camera_t* camera);
+void cameraOrbit(Camera_t* camera, float x0, float y0, float x1, float y1,
+                 int width, int height);
+void cameraPan(Camera_t* camera, float dx, float dy, int width, int height,
+               int parallel);
+void cameraZoom(Camera_t* camera, float steps);
+void cameraViewMatrix(const Camera_t* camera, int parallel, float view[16]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CAMERA_H
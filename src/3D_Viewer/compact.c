@@ -0,0 +1,204 @@
+#include "compact.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define COMPACT_UNORM_MAX 65535.0f
+#define COMPACT_BIAS 32768
+#define COMPACT_WINDOW 65535u
+// Below this many segments per chunk on average the draw calls cost more
+// than the halved index size saves, and all indices stay 32-bit.
+#define COMPACT_MIN_SEGMENTS_PER_CHUNK 1024
+
+static void quantizePositions(const float* vertices, long long n_vertices,
+                              CompactMesh_t* mesh) {
+  float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (long long i = 0; i < n_vertices; ++i) {
+    for (int axis = 0; axis < 3; ++axis) {
+      const float value = vertices[i * 3 + axis];
+      if (value < minimum[axis]) minimum[axis] = value;
+      if (value > maximum[axis]) maximum[axis] = value;
+    }
+  }
+  float encode[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = maximum[axis] - minimum[axis];
+    encode[axis] = extent > 0.0f ? COMPACT_UNORM_MAX / extent : 0.0f;
+    mesh->decode_scale[axis] = extent / COMPACT_UNORM_MAX;
+    mesh->decode_offset[axis] =
+        minimum[axis] + COMPACT_BIAS * mesh->decode_scale[axis];
+  }
+
+  double squared_sum = 0.0;
+  for (long long i = 0; i < n_vertices; ++i) {
+    double squared = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float value = vertices[i * 3 + axis];
+      const long q = lroundf((value - minimum[axis]) * encode[axis]);
+      const int16_t stored = (int16_t)(q - COMPACT_BIAS);
+      mesh->positions[i * 3 + axis] = stored;
+      const double decoded =
+          stored * (double)mesh->decode_scale[axis] + mesh->decode_offset[axis];
+      squared += (decoded - value) * (decoded - value);
+    }
+    squared_sum += squared;
+    if (sqrt(squared) > mesh->max_error) mesh->max_error = sqrt(squared);
+  }
+  mesh->rms_error = n_vertices > 0 ? sqrt(squared_sum / n_vertices) : 0.0;
+}
+
+typedef enum ChunkPass_t {
+  CHUNK_PASS_COUNT,
+  CHUNK_PASS_BASES,
+  CHUNK_PASS_INDICES
+} ChunkPass_t;
+
+/*!
+ * \brief splitIntoChunks
+ *
+ * Greedily groups consecutive segments into chunks whose vertices span at
+ * most 65536 indices; segments longer than that go to the 32-bit list. The
+ * grouping is replayed in three passes: counting, recording the final base
+ * of each chunk, and writing the indices relative to those bases.
+ */
+static void splitIntoChunks(const unsigned int* indices, long long n_indices,
+                            CompactMesh_t* mesh, ChunkPass_t pass) {
+  int n_chunks = 0;
+  long long n16 = 0;
+  long long n32 = 0;
+  unsigned int low = 0;
+  unsigned int high = 0;
+  for (long long k = 0; k + 1 < n_indices; k += 2) {
+    const unsigned int a = indices[k];
+    const unsigned int b = indices[k + 1];
+    const unsigned int segment_low = a < b ? a : b;
+    const unsigned int segment_high = a < b ? b : a;
+    if (segment_high - segment_low > COMPACT_WINDOW) {
+      if (pass == CHUNK_PASS_INDICES) {
+        mesh->indices32[n32] = a;
+        mesh->indices32[n32 + 1] = b;
+      }
+      n32 += 2;
+      continue;
+    }
+    const unsigned int new_low = segment_low < low ? segment_low : low;
+    const unsigned int new_high = segment_high > high ? segment_high : high;
+    if (n_chunks == 0 || new_high - new_low > COMPACT_WINDOW) {
+      ++n_chunks;
+      low = segment_low;
+      high = segment_high;
+      if (pass == CHUNK_PASS_BASES) {
+        mesh->chunks[n_chunks - 1].first = (uint32_t)n16;
+        mesh->chunks[n_chunks - 1].count = 0;
+      }
+    } else {
+      low = new_low;
+      high = new_high;
+    }
+    CompactChunk_t* chunk = pass == CHUNK_PASS_COUNT
+                                ? NULL
+                                : &mesh->chunks[n_chunks - 1];
+    if (pass == CHUNK_PASS_BASES) {
+      chunk->base = low;
+      chunk->count += 2;
+    } else if (pass == CHUNK_PASS_INDICES) {
+      mesh->indices16[n16] = (uint16_t)(a - chunk->base);
+      mesh->indices16[n16 + 1] = (uint16_t)(b - chunk->base);
+    }
+    n16 += 2;
+  }
+  mesh->n_chunks = n_chunks;
+  mesh->n_indices16 = n16;
+  mesh->n_indices32 = n32;
+}
+
+/*!
+ * \brief compactMeshBuild
+ *
+ * Builds the compact form of a parsed model. Meshes under 65536 vertices get
+ * one chunk of 16-bit indices. Larger meshes are split into chunks of nearby
+ * vertices, which works well after reorderModel; when the segments are too
+ * scattered for that, or too many for the 32-bit chunk offsets, all indices
+ * stay 32-bit.
+ *
+ * \return 0 on success, -1 if out of memory (mesh is left empty).
+ */
+int compactMeshBuild(const float* vertices, long long n_vertices,
+                     const unsigned int* indices, long long n_indices,
+                     CompactMesh_t* mesh) {
+  memset(mesh, 0, sizeof(*mesh));
+  if (n_vertices <= 0) return 0;
+  mesh->n_vertices = n_vertices;
+  mesh->positions = loaderAlloc(
+      MEM_VERTICES, (size_t)n_vertices * 3 * sizeof(int16_t));
+  if (mesh->positions == NULL) return -1;
+  quantizePositions(vertices, n_vertices, mesh);
+
+  splitIntoChunks(indices, n_indices, mesh, CHUNK_PASS_COUNT);
+  const long long n_segments = n_indices / 2;
+  if ((mesh->n_chunks > 1 &&
+       mesh->n_chunks > n_segments / COMPACT_MIN_SEGMENTS_PER_CHUNK) ||
+      mesh->n_indices16 > UINT32_MAX) {
+    mesh->n_chunks = 0;
+    mesh->n_indices16 = 0;
+    mesh->n_indices32 = n_segments * 2;
+  }
+  mesh->chunks = loaderAlloc(
+      MEM_INDICES, (size_t)mesh->n_chunks * sizeof(CompactChunk_t));
+  mesh->indices16 = loaderAlloc(
+      MEM_INDICES, (size_t)mesh->n_indices16 * sizeof(uint16_t));
+  mesh->indices32 = loaderAlloc(
+      MEM_INDICES, (size_t)mesh->n_indices32 * sizeof(unsigned int));
+  if ((mesh->n_chunks > 0 && mesh->chunks == NULL) ||
+      (mesh->n_indices16 > 0 && mesh->indices16 == NULL) ||
+      (mesh->n_indices32 > 0 && mesh->indices32 == NULL)) {
+    compactMeshFree(mesh);
+    return -1;
+  }
+  if (mesh->n_chunks > 0) {
+    splitIntoChunks(indices, n_indices, mesh, CHUNK_PASS_BASES);
+    splitIntoChunks(indices, n_indices, mesh, CHUNK_PASS_INDICES);
+  } else if (mesh->n_indices32 > 0) {
+    memcpy(mesh->indices32, indices,
+           (size_t)mesh->n_indices32 * sizeof(unsigned int));
+  }
+  return 0;
+}
+
+void compactMeshFree(CompactMesh_t* mesh) {
+  loaderFree(MEM_VERTICES, mesh->positions,
+             (size_t)mesh->n_vertices * 3 * sizeof(int16_t));
+  loaderFree(MEM_INDICES, mesh->chunks,
+             (size_t)mesh->n_chunks * sizeof(CompactChunk_t));
+  loaderFree(MEM_INDICES, mesh->indices16,
+             (size_t)mesh->n_indices16 * sizeof(uint16_t));
+  loaderFree(MEM_INDICES, mesh->indices32,
+             (size_t)mesh->n_indices32 * sizeof(unsigned int));
+  memset(mesh, 0, sizeof(*mesh));
+}
+
+/*!
+ * \brief compactMeshDecode
+ *
+ * Writes the decoded x, y, z of a vertex to out, as the vertex stage
+ * computes it from decode_scale and decode_offset.
+ */
+void compactMeshDecode(const CompactMesh_t* mesh, long long vertex,
+                       float* out) {
+  for (int axis = 0; axis < 3; ++axis) {
+    out[axis] = mesh->positions[vertex * 3 + axis] * mesh->decode_scale[axis] +
+                mesh->decode_offset[axis];
+  }
+}
+
+// Bytes of geometry drawn per frame, positions and indices.
+long long compactMeshBytes(const CompactMesh_t* mesh) {
+  return (long long)mesh->n_vertices * 3 * sizeof(int16_t) +
+         (long long)mesh->n_indices16 * sizeof(uint16_t) +
+         (long long)mesh->n_indices32 * sizeof(unsigned int);
+}
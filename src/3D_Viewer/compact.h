@@ -0,0 +1,60 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief CompactChunk_t
+ *
+ * A run of 16-bit indices that are relative to base, so a chunk can address
+ * any 65536 consecutive vertices. Drawn with the vertex pointer offset by
+ * base vertices.
+ */
+typedef struct CompactChunk_t {
+  uint32_t base;
+  uint32_t first;
+  uint32_t count;
+} CompactChunk_t;
+
+/*!
+ * \brief CompactMesh_t
+ *
+ * Model stored with 16-bit positions and, where possible, 16-bit indices.
+ * Positions are unorm16 over the bounding box, stored biased by -32768 so
+ * they fit the signed GL_SHORT vertex format; a position decodes as
+ * q * decode_scale + decode_offset per axis. Segments that fit no chunk are
+ * kept with 32-bit indices in indices32. The errors are distances between
+ * the decoded and original positions, in model units.
+ */
+typedef struct CompactMesh_t {
+  int16_t* positions;
+  long long n_vertices;
+  float decode_scale[3];
+  float decode_offset[3];
+  uint16_t* indices16;
+  long long n_indices16;
+  CompactChunk_t* chunks;
+  int n_chunks;
+  unsigned int* indices32;
+  long long n_indices32;
+  double max_error;
+  double rms_error;
+} CompactMesh_t;
+
+int compactMeshBuild(const float* vertices, long long n_vertices,
+                     const unsigned int* indices, long long n_indices,
+                     CompactMesh_t* mesh);
+void compactMeshFree(CompactMesh_t* mesh);
+void compactMeshDecode(const CompactMesh_t* mesh, long long vertex,
+                       float* out);
+long long compactMeshBytes(const CompactMesh_t* mesh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPACT_H
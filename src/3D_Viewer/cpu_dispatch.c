@@ -0,0 +1,650 @@
+#include "cpu_dispatch.h"
+
+#include <float.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Multiplies and adds stay separate in every level, or a fused
+// multiply-add would round differently from the scalar loops
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CPU_DISPATCH_X86 1
+#include <immintrin.h>
+#else
+#define CPU_DISPATCH_X86 0
+#endif
+
+static const char* const kLevelNames[CPU_LEVEL_COUNT] = {"scalar", "sse4.2",
+                                                         "avx2", "avx512"};
+
+// The scalar loops, also used for the vertices left over by the vector ones.
+// They are built for SSE, so the AVX kernels clear the upper halves of the
+// vector registers before calling them: with the halves dirty, every SSE
+// instruction of the process, libm's included, runs several times slower.
+
+static void boundsRange(const float* vertices, long long first,
+                        long long end, float min[3], float max[3]) {
+  for (long long i = first * 3; i < end * 3; i += 3) {
+    for (int axis = 0; axis < 3; ++axis) {
+      const float value = vertices[i + axis];
+      min[axis] = value < min[axis] ? value : min[axis];
+      max[axis] = value > max[axis] ? value : max[axis];
+    }
+  }
+}
+
+static void moveRange(float* vertices, long long first, long long end,
+                      const float offset[3]) {
+  for (long long i = first * 3; i < end * 3; i += 3) {
+    vertices[i] += offset[0];
+    vertices[i + 1] += offset[1];
+    vertices[i + 2] += offset[2];
+  }
+}
+
+static void transformRange(float* vertices, long long first, long long end,
+                           const float m[16]) {
+  for (long long i = first * 3; i < end * 3; i += 3) {
+    const float x = vertices[i];
+    const float y = vertices[i + 1];
+    const float z = vertices[i + 2];
+    vertices[i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+    vertices[i + 1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+    vertices[i + 2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+  }
+}
+
+static void emptyBounds(float min[3], float max[3]) {
+  for (int axis = 0; axis < 3; ++axis) {
+    min[axis] = FLT_MAX;
+    max[axis] = -FLT_MAX;
+  }
+}
+
+static void boundsScalar(const float* vertices, long long count, float min[3],
+                         float max[3]) {
+  emptyBounds(min, max);
+  boundsRange(vertices, 0, count, min, max);
+}
+
+static void scaleScalar(float* vertices, long long count, float factor) {
+  for (long long i = 0; i < count * 3; ++i) vertices[i] *= factor;
+}
+
+static void moveScalar(float* vertices, long long count,
+                       const float offset[3]) {
+  moveRange(vertices, 0, count, offset);
+}
+
+static void transformScalar(float* vertices, long long count,
+                            const float matrix[16]) {
+  transformRange(vertices, 0, count, matrix);
+}
+
+static unsigned int indexMaxScalar(const unsigned int* indices,
+                                   long long count) {
+  unsigned int result = 0;
+  for (long long i = 0; i < count; ++i) {
+    result = indices[i] > result ? indices[i] : result;
+  }
+  return result;
+}
+
+#if CPU_DISPATCH_X86
+
+// Folds the per-lane bounds of a block into per-axis ones.
+static void reduceLanes(const float* lows, const float* highs, int width,
+                        float min[3], float max[3]) {
+  emptyBounds(min, max);
+  for (int lane = 0; lane < 3 * width; ++lane) {
+    const int axis = lane % 3;
+    min[axis] = lows[lane] < min[axis] ? lows[lane] : min[axis];
+    max[axis] = highs[lane] > max[axis] ? highs[lane] : max[axis];
+  }
+}
+
+static void repeatXyz(const float values[3], int width, float* block) {
+  for (int lane = 0; lane < 3 * width; ++lane) block[lane] = values[lane % 3];
+}
+
+/*
+ * Four vertices in 128 bits are (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3).
+ * Blending the three vectors puts the x, y or z of every vertex in one of
+ * them, swapped within pairs of lanes; the swaps below put them in vertex
+ * order. Each swap is its own inverse, so the same swaps and the blends in
+ * turn lay the components back out. Wider vectors do the same in every
+ * 128 bits once their blocks are regrouped.
+ */
+#define CPU_SWAP_X _MM_SHUFFLE(1, 2, 3, 0)
+#define CPU_SWAP_Y _MM_SHUFFLE(2, 3, 0, 1)
+#define CPU_SWAP_Z _MM_SHUFFLE(3, 0, 1, 2)
+
+// The matrix as one broadcast per element, row by row, for the rows of x,
+// y and z. Every level sums a row in the order of the scalar loop.
+static void matrixRows(const float matrix[16], float rows[12]) {
+  for (int row = 0; row < 3; ++row) {
+    for (int column = 0; column < 4; ++column) {
+      rows[4 * row + column] = matrix[4 * column + row];
+    }
+  }
+}
+
+__attribute__((target("sse4.2"))) static void boundsSse42(
+    const float* vertices, long long count, float min[3], float max[3]) {
+  __m128 lows[3];
+  __m128 highs[3];
+  for (int k = 0; k < 3; ++k) {
+    lows[k] = _mm_set1_ps(FLT_MAX);
+    highs[k] = _mm_set1_ps(-FLT_MAX);
+  }
+  long long v = 0;
+  for (; v + 4 <= count; v += 4) {
+    const float* block = vertices + v * 3;
+    for (int k = 0; k < 3; ++k) {
+      // The new value first, so a NaN keeps the running bound
+      const __m128 value = _mm_loadu_ps(block + 4 * k);
+      lows[k] = _mm_min_ps(value, lows[k]);
+      highs[k] = _mm_max_ps(value, highs[k]);
+    }
+  }
+  float low_lanes[12];
+  float high_lanes[12];
+  for (int k = 0; k < 3; ++k) {
+    _mm_storeu_ps(low_lanes + 4 * k, lows[k]);
+    _mm_storeu_ps(high_lanes + 4 * k, highs[k]);
+  }
+  reduceLanes(low_lanes, high_lanes, 4, min, max);
+  boundsRange(vertices, v, count, min, max);
+}
+
+__attribute__((target("sse4.2"))) static void scaleSse42(float* vertices,
+                                                         long long count,
+                                                         float factor) {
+  const __m128 scale = _mm_set1_ps(factor);
+  const long long n = count * 3;
+  long long i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(vertices + i, _mm_mul_ps(_mm_loadu_ps(vertices + i), scale));
+  }
+  for (; i < n; ++i) vertices[i] *= factor;
+}
+
+__attribute__((target("sse4.2"))) static void moveSse42(
+    float* vertices, long long count, const float offset[3]) {
+  float pattern[12];
+  repeatXyz(offset, 4, pattern);
+  __m128 offsets[3];
+  for (int k = 0; k < 3; ++k) offsets[k] = _mm_loadu_ps(pattern + 4 * k);
+  long long v = 0;
+  for (; v + 4 <= count; v += 4) {
+    float* block = vertices + v * 3;
+    for (int k = 0; k < 3; ++k) {
+      _mm_storeu_ps(block + 4 * k,
+                    _mm_add_ps(_mm_loadu_ps(block + 4 * k), offsets[k]));
+    }
+  }
+  moveRange(vertices, v, count, offset);
+}
+
+__attribute__((target("sse4.2"))) static __m128 rowSse42(const __m128* row,
+                                                        __m128 x, __m128 y,
+                                                        __m128 z) {
+  return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[0], x),
+                                          _mm_mul_ps(row[1], y)),
+                               _mm_mul_ps(row[2], z)),
+                    row[3]);
+}
+
+__attribute__((target("sse4.2"))) static void transformSse42(
+    float* vertices, long long count, const float matrix[16]) {
+  float rows[12];
+  matrixRows(matrix, rows);
+  __m128 m[12];
+  for (int i = 0; i < 12; ++i) m[i] = _mm_set1_ps(rows[i]);
+  long long v = 0;
+  for (; v + 4 <= count; v += 4) {
+    float* block = vertices + v * 3;
+    const __m128 a = _mm_loadu_ps(block);
+    const __m128 b = _mm_loadu_ps(block + 4);
+    const __m128 c = _mm_loadu_ps(block + 8);
+    __m128 x = _mm_blend_ps(_mm_blend_ps(a, b, 0x4), c, 0x2);
+    __m128 y = _mm_blend_ps(_mm_blend_ps(a, b, 0x9), c, 0x4);
+    __m128 z = _mm_blend_ps(_mm_blend_ps(a, b, 0x2), c, 0x9);
+    x = _mm_shuffle_ps(x, x, CPU_SWAP_X);
+    y = _mm_shuffle_ps(y, y, CPU_SWAP_Y);
+    z = _mm_shuffle_ps(z, z, CPU_SWAP_Z);
+    __m128 out_x = rowSse42(m, x, y, z);
+    __m128 out_y = rowSse42(m + 4, x, y, z);
+    __m128 out_z = rowSse42(m + 8, x, y, z);
+    out_x = _mm_shuffle_ps(out_x, out_x, CPU_SWAP_X);
+    out_y = _mm_shuffle_ps(out_y, out_y, CPU_SWAP_Y);
+    out_z = _mm_shuffle_ps(out_z, out_z, CPU_SWAP_Z);
+    _mm_storeu_ps(block,
+                  _mm_blend_ps(_mm_blend_ps(out_x, out_y, 0x2), out_z, 0x4));
+    _mm_storeu_ps(block + 4,
+                  _mm_blend_ps(_mm_blend_ps(out_y, out_z, 0x2), out_x, 0x4));
+    _mm_storeu_ps(block + 8,
+                  _mm_blend_ps(_mm_blend_ps(out_z, out_x, 0x2), out_y, 0x4));
+  }
+  transformRange(vertices, v, count, matrix);
+}
+
+__attribute__((target("avx2"))) static void boundsAvx2(const float* vertices,
+                                                       long long count,
+                                                       float min[3],
+                                                       float max[3]) {
+  __m256 lows[3];
+  __m256 highs[3];
+  for (int k = 0; k < 3; ++k) {
+    lows[k] = _mm256_set1_ps(FLT_MAX);
+    highs[k] = _mm256_set1_ps(-FLT_MAX);
+  }
+  long long v = 0;
+  for (; v + 8 <= count; v += 8) {
+    const float* block = vertices + v * 3;
+    for (int k = 0; k < 3; ++k) {
+      const __m256 value = _mm256_loadu_ps(block + 8 * k);
+      lows[k] = _mm256_min_ps(value, lows[k]);
+      highs[k] = _mm256_max_ps(value, highs[k]);
+    }
+  }
+  float low_lanes[24];
+  float high_lanes[24];
+  for (int k = 0; k < 3; ++k) {
+    _mm256_storeu_ps(low_lanes + 8 * k, lows[k]);
+    _mm256_storeu_ps(high_lanes + 8 * k, highs[k]);
+  }
+  reduceLanes(low_lanes, high_lanes, 8, min, max);
+  _mm256_zeroupper();
+  boundsRange(vertices, v, count, min, max);
+}
+
+__attribute__((target("avx2"))) static void scaleAvx2(float* vertices,
+                                                      long long count,
+                                                      float factor) {
+  const __m256 scale = _mm256_set1_ps(factor);
+  const long long n = count * 3;
+  long long i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(vertices + i,
+                     _mm256_mul_ps(_mm256_loadu_ps(vertices + i), scale));
+  }
+  for (; i < n; ++i) vertices[i] *= factor;
+}
+
+__attribute__((target("avx2"))) static void moveAvx2(float* vertices,
+                                                     long long count,
+                                                     const float offset[3]) {
+  float pattern[24];
+  repeatXyz(offset, 8, pattern);
+  __m256 offsets[3];
+  for (int k = 0; k < 3; ++k) offsets[k] = _mm256_loadu_ps(pattern + 8 * k);
+  long long v = 0;
+  for (; v + 8 <= count; v += 8) {
+    float* block = vertices + v * 3;
+    for (int k = 0; k < 3; ++k) {
+      _mm256_storeu_ps(block + 8 * k,
+                       _mm256_add_ps(_mm256_loadu_ps(block + 8 * k),
+                                     offsets[k]));
+    }
+  }
+  _mm256_zeroupper();
+  moveRange(vertices, v, count, offset);
+}
+
+__attribute__((target("avx2"))) static __m256 rowAvx2(const __m256* row,
+                                                     __m256 x, __m256 y,
+                                                     __m256 z) {
+  return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[0], x),
+                                                   _mm256_mul_ps(row[1], y)),
+                                     _mm256_mul_ps(row[2], z)),
+                       row[3]);
+}
+
+__attribute__((target("avx2"))) static void transformAvx2(
+    float* vertices, long long count, const float matrix[16]) {
+  float rows[12];
+  matrixRows(matrix, rows);
+  __m256 m[12];
+  for (int i = 0; i < 12; ++i) m[i] = _mm256_set1_ps(rows[i]);
+  long long v = 0;
+  for (; v + 8 <= count; v += 8) {
+    float* block = vertices + v * 3;
+    const __m256 v0 = _mm256_loadu_ps(block);
+    const __m256 v1 = _mm256_loadu_ps(block + 8);
+    const __m256 v2 = _mm256_loadu_ps(block + 16);
+    // Vertices 0-3 in the low 128 bits and 4-7 in the high ones
+    const __m256 a = _mm256_permute2f128_ps(v0, v1, 0x30);
+    const __m256 b = _mm256_permute2f128_ps(v0, v2, 0x21);
+    const __m256 c = _mm256_permute2f128_ps(v1, v2, 0x30);
+    __m256 x = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x44), c, 0x22);
+    __m256 y = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x99), c, 0x44);
+    __m256 z = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x22), c, 0x99);
+    x = _mm256_shuffle_ps(x, x, CPU_SWAP_X);
+    y = _mm256_shuffle_ps(y, y, CPU_SWAP_Y);
+    z = _mm256_shuffle_ps(z, z, CPU_SWAP_Z);
+    __m256 out_x = rowAvx2(m, x, y, z);
+    __m256 out_y = rowAvx2(m + 4, x, y, z);
+    __m256 out_z = rowAvx2(m + 8, x, y, z);
+    out_x = _mm256_shuffle_ps(out_x, out_x, CPU_SWAP_X);
+    out_y = _mm256_shuffle_ps(out_y, out_y, CPU_SWAP_Y);
+    out_z = _mm256_shuffle_ps(out_z, out_z, CPU_SWAP_Z);
+    const __m256 out_a =
+        _mm256_blend_ps(_mm256_blend_ps(out_x, out_y, 0x22), out_z, 0x44);
+    const __m256 out_b =
+        _mm256_blend_ps(_mm256_blend_ps(out_y, out_z, 0x22), out_x, 0x44);
+    const __m256 out_c =
+        _mm256_blend_ps(_mm256_blend_ps(out_z, out_x, 0x22), out_y, 0x44);
+    _mm256_storeu_ps(block, _mm256_permute2f128_ps(out_a, out_b, 0x20));
+    _mm256_storeu_ps(block + 8, _mm256_permute2f128_ps(out_c, out_a, 0x30));
+    _mm256_storeu_ps(block + 16, _mm256_permute2f128_ps(out_b, out_c, 0x31));
+  }
+  _mm256_zeroupper();
+  transformRange(vertices, v, count, matrix);
+}
+
+__attribute__((target("avx512f"))) static void boundsAvx512(
+    const float* vertices, long long count, float min[3], float max[3]) {
+  __m512 lows[3];
+  __m512 highs[3];
+  for (int k = 0; k < 3; ++k) {
+    lows[k] = _mm512_set1_ps(FLT_MAX);
+    highs[k] = _mm512_set1_ps(-FLT_MAX);
+  }
+  long long v = 0;
+  for (; v + 16 <= count; v += 16) {
+    const float* block = vertices + v * 3;
+    for (int k = 0; k < 3; ++k) {
+      const __m512 value = _mm512_loadu_ps(block + 16 * k);
+      lows[k] = _mm512_min_ps(value, lows[k]);
+      highs[k] = _mm512_max_ps(value, highs[k]);
+    }
+  }
+  float low_lanes[48];
+  float high_lanes[48];
+  for (int k = 0; k < 3; ++k) {
+    _mm512_storeu_ps(low_lanes + 16 * k, lows[k]);
+    _mm512_storeu_ps(high_lanes + 16 * k, highs[k]);
+  }
+  reduceLanes(low_lanes, high_lanes, 16, min, max);
+  _mm256_zeroupper();
+  boundsRange(vertices, v, count, min, max);
+}
+
+__attribute__((target("avx512f"))) static void scaleAvx512(float* vertices,
+                                                           long long count,
+                                                           float factor) {
+  const __m512 scale = _mm512_set1_ps(factor);
+  const long long n = count * 3;
+  long long i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_ps(vertices + i,
+                     _mm512_mul_ps(_mm512_loadu_ps(vertices + i), scale));
+  }
+  for (; i < n; ++i) vertices[i] *= factor;
+}
+
+__attribute__((target("avx512f"))) static void moveAvx512(
+    float* vertices, long long count, const float offset[3]) {
+  float pattern[48];
+  repeatXyz(offset, 16, pattern);
+  __m512 offsets[3];
+  for (int k = 0; k < 3; ++k) offsets[k] = _mm512_loadu_ps(pattern + 16 * k);
+  long long v = 0;
+  for (; v + 16 <= count; v += 16) {
+    float* block = vertices + v * 3;
+    for (int k = 0; k < 3; ++k) {
+      _mm512_storeu_ps(block + 16 * k,
+                       _mm512_add_ps(_mm512_loadu_ps(block + 16 * k),
+                                     offsets[k]));
+    }
+  }
+  _mm256_zeroupper();
+  moveRange(vertices, v, count, offset);
+}
+
+/*!
+ * \brief regroupIndices
+ *
+ * Indices for two _mm512_permutex2var_ps() that move 128-bit parts between
+ * three vectors, the first taking the parts of vectors 0 and 1 and the
+ * second those of vector 2. Splitting gathers parts 0, 3, 6, 9 of a block,
+ * then 1, 4, 7, 10 and 2, 5, 8, 11, so every 128 bits hold four whole
+ * vertices laid out as above. Joining puts the parts back.
+ */
+static void regroupIndices(int split, int first[3][16], int second[3][16]) {
+  for (int out = 0; out < 3; ++out) {
+    for (int part = 0; part < 4; ++part) {
+      const int chunk = split ? 3 * part + out : 4 * out + part;
+      // Part of the 12 in the three input vectors
+      const int source = split ? chunk : 4 * (chunk % 3) + chunk / 3;
+      for (int lane = 4 * part; lane < 4 * part + 4; ++lane) {
+        const int element = lane % 4;
+        first[out][lane] = source < 8 ? 4 * source + element : 0;
+        second[out][lane] = source < 8 ? lane : 4 * (source - 8) + element + 16;
+      }
+    }
+  }
+}
+
+__attribute__((target("avx512f"))) static __m512 rowAvx512(const __m512* row,
+                                                          __m512 x, __m512 y,
+                                                          __m512 z) {
+  return _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(row[0], x),
+                                                   _mm512_mul_ps(row[1], y)),
+                                     _mm512_mul_ps(row[2], z)),
+                       row[3]);
+}
+
+__attribute__((target("avx512f"))) static void regroupAvx512(
+    const __m512i first[3], const __m512i second[3], const __m512 in[3],
+    __m512 out[3]) {
+  for (int k = 0; k < 3; ++k) {
+    const __m512 low = _mm512_permutex2var_ps(in[0], first[k], in[1]);
+    out[k] = _mm512_permutex2var_ps(low, second[k], in[2]);
+  }
+}
+
+__attribute__((target("avx512f"))) static void transformAvx512(
+    float* vertices, long long count, const float matrix[16]) {
+  float rows[12];
+  matrixRows(matrix, rows);
+  __m512 m[12];
+  for (int i = 0; i < 12; ++i) m[i] = _mm512_set1_ps(rows[i]);
+  int indices[4][3][16];
+  regroupIndices(1, indices[0], indices[1]);
+  regroupIndices(0, indices[2], indices[3]);
+  __m512i split[2][3];
+  __m512i join[2][3];
+  for (int k = 0; k < 3; ++k) {
+    split[0][k] = _mm512_loadu_si512(indices[0][k]);
+    split[1][k] = _mm512_loadu_si512(indices[1][k]);
+    join[0][k] = _mm512_loadu_si512(indices[2][k]);
+    join[1][k] = _mm512_loadu_si512(indices[3][k]);
+  }
+  long long v = 0;
+  for (; v + 16 <= count; v += 16) {
+    float* block = vertices + v * 3;
+    const __m512 in[3] = {_mm512_loadu_ps(block), _mm512_loadu_ps(block + 16),
+                          _mm512_loadu_ps(block + 32)};
+    __m512 parts[3];
+    regroupAvx512(split[0], split[1], in, parts);
+    __m512 x = _mm512_mask_blend_ps(
+        0x2222, _mm512_mask_blend_ps(0x4444, parts[0], parts[1]), parts[2]);
+    __m512 y = _mm512_mask_blend_ps(
+        0x4444, _mm512_mask_blend_ps(0x9999, parts[0], parts[1]), parts[2]);
+    __m512 z = _mm512_mask_blend_ps(
+        0x9999, _mm512_mask_blend_ps(0x2222, parts[0], parts[1]), parts[2]);
+    x = _mm512_shuffle_ps(x, x, CPU_SWAP_X);
+    y = _mm512_shuffle_ps(y, y, CPU_SWAP_Y);
+    z = _mm512_shuffle_ps(z, z, CPU_SWAP_Z);
+    __m512 out_x = rowAvx512(m, x, y, z);
+    __m512 out_y = rowAvx512(m + 4, x, y, z);
+    __m512 out_z = rowAvx512(m + 8, x, y, z);
+    out_x = _mm512_shuffle_ps(out_x, out_x, CPU_SWAP_X);
+    out_y = _mm512_shuffle_ps(out_y, out_y, CPU_SWAP_Y);
+    out_z = _mm512_shuffle_ps(out_z, out_z, CPU_SWAP_Z);
+    const __m512 joined[3] = {
+        _mm512_mask_blend_ps(
+            0x4444, _mm512_mask_blend_ps(0x2222, out_x, out_y), out_z),
+        _mm512_mask_blend_ps(
+            0x4444, _mm512_mask_blend_ps(0x2222, out_y, out_z), out_x),
+        _mm512_mask_blend_ps(
+            0x4444, _mm512_mask_blend_ps(0x2222, out_z, out_x), out_y)};
+    __m512 out[3];
+    regroupAvx512(join[0], join[1], joined, out);
+    for (int k = 0; k < 3; ++k) _mm512_storeu_ps(block + 16 * k, out[k]);
+  }
+  _mm256_zeroupper();
+  transformRange(vertices, v, count, matrix);
+}
+
+// The index maxima keep two vectors apart, so consecutive maxima do not wait
+// for each other.
+__attribute__((target("sse4.2"))) static unsigned int indexMaxSse42(
+    const unsigned int* indices, long long count) {
+  __m128i high[2] = {_mm_setzero_si128(), _mm_setzero_si128()};
+  long long i = 0;
+  for (; i + 8 <= count; i += 8) {
+    for (int k = 0; k < 2; ++k) {
+      const __m128i block =
+          _mm_loadu_si128((const __m128i*)(indices + i + 4 * k));
+      high[k] = _mm_max_epu32(high[k], block);
+    }
+  }
+  unsigned int lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, _mm_max_epu32(high[0], high[1]));
+  unsigned int result = indexMaxScalar(indices + i, count - i);
+  for (int lane = 0; lane < 4; ++lane) {
+    result = lanes[lane] > result ? lanes[lane] : result;
+  }
+  return result;
+}
+
+__attribute__((target("avx2"))) static unsigned int indexMaxAvx2(
+    const unsigned int* indices, long long count) {
+  __m256i high[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+  long long i = 0;
+  for (; i + 16 <= count; i += 16) {
+    for (int k = 0; k < 2; ++k) {
+      const __m256i block =
+          _mm256_loadu_si256((const __m256i*)(indices + i + 8 * k));
+      high[k] = _mm256_max_epu32(high[k], block);
+    }
+  }
+  unsigned int lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_max_epu32(high[0], high[1]));
+  _mm256_zeroupper();
+  unsigned int result = indexMaxScalar(indices + i, count - i);
+  for (int lane = 0; lane < 8; ++lane) {
+    result = lanes[lane] > result ? lanes[lane] : result;
+  }
+  return result;
+}
+
+__attribute__((target("avx512f"))) static unsigned int indexMaxAvx512(
+    const unsigned int* indices, long long count) {
+  __m512i high[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+  long long i = 0;
+  for (; i + 32 <= count; i += 32) {
+    for (int k = 0; k < 2; ++k) {
+      const __m512i block = _mm512_loadu_si512(indices + i + 16 * k);
+      high[k] = _mm512_max_epu32(high[k], block);
+    }
+  }
+  const unsigned int lanes =
+      _mm512_reduce_max_epu32(_mm512_max_epu32(high[0], high[1]));
+  _mm256_zeroupper();
+  const unsigned int rest = indexMaxScalar(indices + i, count - i);
+  return lanes > rest ? lanes : rest;
+}
+
+#endif  // CPU_DISPATCH_X86
+
+static const CpuKernels_t kKernels[CPU_LEVEL_COUNT] = {
+    {CPU_LEVEL_SCALAR, boundsScalar, scaleScalar, moveScalar,
+     transformScalar, indexMaxScalar},
+#if CPU_DISPATCH_X86
+    {CPU_LEVEL_SSE42, boundsSse42, scaleSse42, moveSse42, transformSse42,
+     indexMaxSse42},
+    {CPU_LEVEL_AVX2, boundsAvx2, scaleAvx2, moveAvx2, transformAvx2,
+     indexMaxAvx2},
+    {CPU_LEVEL_AVX512, boundsAvx512, scaleAvx512, moveAvx512,
+     transformAvx512, indexMaxAvx512},
+#endif
+};
+
+// NULL until cpuSetLevel() or the first cpuKernels() call picks the level.
+// Atomic, as the kernels are looked up from parallelFor() workers.
+static _Atomic(const CpuKernels_t*) cpu_kernels = NULL;
+
+/*!
+ * \brief cpuDetectLevel
+ *
+ * The widest instruction set the processor and the operating system
+ * support. Always CPU_LEVEL_SCALAR on processors other than x86.
+ */
+CpuLevel_t cpuDetectLevel(void) {
+#if CPU_DISPATCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return CPU_LEVEL_AVX512;
+  if (__builtin_cpu_supports("avx2")) return CPU_LEVEL_AVX2;
+  if (__builtin_cpu_supports("sse4.2")) return CPU_LEVEL_SSE42;
+#endif
+  return CPU_LEVEL_SCALAR;
+}
+
+// The level cpuSetLevel() binds for level, see there.
+static const CpuKernels_t* kernelsFor(int level) {
+  const CpuLevel_t detected = cpuDetectLevel();
+  if (level < 0) {
+    const char* env = getenv("S21_VIEWER_CPU");
+    level = detected;
+    for (int i = 0; env != NULL && i < CPU_LEVEL_COUNT; ++i) {
+      if (strcmp(env, kLevelNames[i]) == 0) level = i;
+    }
+  }
+  if (level > (int)detected) level = detected;
+  return &kKernels[level];
+}
+
+/*!
+ * \brief cpuSetLevel
+ *
+ * Binds the kernels of a level, lowered to what cpuDetectLevel() allows.
+ * -1 restores the default: the level named by the S21_VIEWER_CPU
+ * environment variable ("scalar", "sse4.2", "avx2" or "avx512") if set,
+ * otherwise the detected one. The programs call cpuSetLevel(-1) once at
+ * startup. Kernels running meanwhile finish on the level they started on.
+ */
+void cpuSetLevel(int level) { atomic_store(&cpu_kernels, kernelsFor(level)); }
+
+/*!
+ * \brief cpuKernels
+ *
+ * The kernels in use. A program that did not call cpuSetLevel() gets the
+ * default level, bound by the first call on any thread.
+ */
+const CpuKernels_t* cpuKernels(void) {
+  const CpuKernels_t* kernels = atomic_load(&cpu_kernels);
+  if (kernels == NULL) {
+    const CpuKernels_t* expected = NULL;
+    kernels = kernelsFor(-1);
+    if (!atomic_compare_exchange_strong(&cpu_kernels, &expected, kernels)) {
+      kernels = expected;
+    }
+  }
+  return kernels;
+}
+
+CpuLevel_t cpuLevel(void) { return cpuKernels()->level; }
+
+const char* cpuLevelName(CpuLevel_t level) {
+  return level >= 0 && level < CPU_LEVEL_COUNT ? kLevelNames[level] : "";
+}
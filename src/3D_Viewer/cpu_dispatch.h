@@ -0,0 +1,49 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum CpuLevel_t {
+  CPU_LEVEL_SCALAR,
+  CPU_LEVEL_SSE42,
+  CPU_LEVEL_AVX2,
+  CPU_LEVEL_AVX512,
+  CPU_LEVEL_COUNT
+} CpuLevel_t;
+
+/*!
+ * \brief CpuKernels_t
+ *
+ * The vertex loops of backend.c built for one instruction set, over count
+ * vertices of three interleaved floats. Every level computes the same
+ * operations in the same order, without fused multiply-adds, so they all
+ * give the results of the scalar loops.
+ *
+ * bounds gives FLT_MAX and -FLT_MAX for no vertices and skips NaNs. move
+ * adds offset and transform applies a column-major matrix whose bottom row
+ * is ignored, like transformModelC. index_max is the largest of count
+ * indices, 0 for none, for objFindBadIndex().
+ */
+typedef struct CpuKernels_t {
+  CpuLevel_t level;
+  void (*bounds)(const float* vertices, long long count, float min[3],
+                 float max[3]);
+  void (*scale)(float* vertices, long long count, float factor);
+  void (*move)(float* vertices, long long count, const float offset[3]);
+  void (*transform)(float* vertices, long long count, const float matrix[16]);
+  unsigned int (*index_max)(const unsigned int* indices, long long count);
+} CpuKernels_t;
+
+CpuLevel_t cpuDetectLevel(void);
+CpuLevel_t cpuLevel(void);
+void cpuSetLevel(int level);
+const CpuKernels_t* cpuKernels(void);
+const char* cpuLevelName(CpuLevel_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CPU_DISPATCH_H
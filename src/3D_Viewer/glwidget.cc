@@ -1,91 +1,96 @@
 #include "glwidget.h"
 
+#include <QApplication>
+#include <QDebug>
+#include <QDir>
+#include <QTimer>
+#include <climits>
+
 #include "backend.h"
+#include "memory_stats.h"
+#include "obj_index.h"
+#include "obj_stream.h"
+#include "reorder.h"
+#include "stage_timer.h"
+#include "trace.h"
+#include "weld.h"
 
 void GLWidget::scaleModel(float scaleFactor) {
-  scaleModelC(_cubeVertices, _n_vertices, scaleFactor);
-  update();
+  TraceScope trace("GLWidget::scaleModel");
+  QMatrix4x4 scale;
+  scale.scale(scaleFactor);
+  queueTransform(scale);
 }
 /*!
  * \brief GLWidget::moveModel
  *
  * Translates the model by the given x, y, and z offsets. \n
- * This function updates the vertex positions in _cubeVertices and calls
- * update() to trigger a repaint of the widget. \n
+ * The offsets are queued, see queueTransform(). \n
  *
  * \param x The x-axis offset.
  * \param y The y-axis offset.
  * \param z The z-axis offset.
  */
 void GLWidget::moveModel(float x, float y, float z) {
-  moveModelC(_cubeVertices, _n_vertices, x, y, z);
-  update();
+  TraceScope trace("GLWidget::moveModel");
+  QMatrix4x4 move;
+  move.translate(x, y, z);
+  queueTransform(move);
 }
 /*!
  * \brief GLWidget::rotateModel
  *
- * Rotates the model by the given x, y, and z angles in degrees. This function
- * updates the vertex positions in _cubeVertices using a rotation matrix and
- * calls update() to trigger a repaint of the widget.
+ * Rotates the model by the given x, y, and z angles in degrees. The rotation
+ * is queued, see queueTransform().
  *
  * \param xAngle The rotation angle in degrees around the x-axis.
  * \param yAngle The rotation angle in degrees around the y-axis.
  * \param zAngle The rotation angle in degrees around the z-axis.
  */
 void GLWidget::rotateModel(float xAngle, float yAngle, float zAngle) {
-  const float xAngleRadian = xAngle / 360.0f * 2.0f * M_PI;
-  const float yAngleRadian = yAngle / 360.0f * 2.0f * M_PI;
-  const float zAngleRadian = zAngle / 360.0f * 2.0f * M_PI;
-
-  for (int i = 0; i < _n_vertices * 3; i += 3) {
-    const float x = _cubeVertices[i];
-    const float y = _cubeVertices[i + 1];
-    const float z = _cubeVertices[i + 2];
-
-    float x_rezult = 0.0f;
-    float y_rezult = 0.0f;
-    float z_rezult = 0.0f;
-
-    rotateX(xAngleRadian, x, y, z, &x_rezult, &y_rezult, &z_rezult);
-
-    _cubeVertices[i] = x_rezult;
-    _cubeVertices[i + 1] = y_rezult;
-    _cubeVertices[i + 2] = z_rezult;
-  }
-
-  for (int i = 0; i < _n_vertices * 3; i += 3) {
-    const float x = _cubeVertices[i];
-    const float y = _cubeVertices[i + 1];
-    const float z = _cubeVertices[i + 2];
-
-    float x_rezult = 0.0f;
-    float y_rezult = 0.0f;
-    float z_rezult = 0.0f;
-
-    rotateY(yAngleRadian, x, y, z, &x_rezult, &y_rezult, &z_rezult);
-
-    _cubeVertices[i] = x_rezult;
-    _cubeVertices[i + 1] = y_rezult;
-    _cubeVertices[i + 2] = z_rezult;
-  }
-
-  for (int i = 0; i < _n_vertices * 3; i += 3) {
-    const float x = _cubeVertices[i];
-    const float y = _cubeVertices[i + 1];
-    const float z = _cubeVertices[i + 2];
-
-    float x_rezult = 0.0f;
-    float y_rezult = 0.0f;
-    float z_rezult = 0.0f;
-
-    rotateZ(zAngleRadian, x, y, z, &x_rezult, &y_rezult, &z_rezult);
-
-    _cubeVertices[i] = x_rezult;
-    _cubeVertices[i + 1] = y_rezult;
-    _cubeVertices[i + 2] = z_rezult;
+  TraceScope trace("GLWidget::rotateModel");
+  // Same order and directions as rotateX, rotateY and rotateZ, the latter
+  // turns clockwise
+  QMatrix4x4 rotation;
+  rotation.rotate(-zAngle, 0.0f, 0.0f, 1.0f);
+  rotation.rotate(yAngle, 0.0f, 1.0f, 0.0f);
+  rotation.rotate(xAngle, 1.0f, 0.0f, 0.0f);
+  queueTransform(rotation);
+}
+/*!
+ * \brief GLWidget::queueTransform
+ *
+ * Compact, point-cloud and out-of-core models take the transform into
+ * modelTransform.
+ * For float models it is merged into pendingTransform and applied to the
+ * vertices once, before the next frame is drawn, however many transforms
+ * arrive in between.
+ */
+void GLWidget::queueTransform(const QMatrix4x4& transform) {
+  if (compactActive || pointCloudActive || oocStore != nullptr) {
+    modelTransform = transform * modelTransform;
+  } else {
+    pendingTransform = transform * pendingTransform;
+    transformPending = true;
   }
-
-  update();
+  markInput();
+}
+/*!
+ * \brief GLWidget::applyPendingTransform
+ *
+ * Applies the queued transforms to _cubeVertices in one pass. Called before
+ * drawing and before anything else reads the vertices. A picking hierarchy
+ * still being built from the vertices is cancelled first.
+ */
+void GLWidget::applyPendingTransform() {
+  if (!transformPending) return;
+  TraceScope trace("GLWidget::applyPendingTransform");
+  cancelPickBuild();
+  transformModelC(_cubeVertices, _n_vertices, pendingTransform.constData());
+  bakedTransform = pendingTransform * bakedTransform;
+  pickTransform = pendingTransform * pickTransform;
+  pendingTransform.setToIdentity();
+  transformPending = false;
 }
 /*!
  * \brief GLWidget::GLWidget
@@ -102,13 +107,39 @@ GLWidget::GLWidget(QWidget* parent)
       _n_vertices(0),
       _n_indices(0),
       _cubeVertices(nullptr),
-      _cubeIndices(nullptr) {
+      _cubeIndices(nullptr),
+      halfEdges(),
+      compactActive(false),
+      compactMesh(),
+      oocStore(nullptr),
+      pointCloudActive(false),
+      pointCloud(),
+      modelArena(nullptr),
+      modelCache(nullptr),
+      fileWatcher(nullptr),
+      reloadTimer(nullptr),
+      modelReload(nullptr),
+      transformPending(false),
+      inputStart(-1.0),
+      pickBuilder(nullptr),
+      pickBvh(),
+      pickRebuild(false),
+      hoverPick(),
+      interacting(false),
+      idleTimer(nullptr),
+      coarseIndices(NULL),
+      n_coarseIndices(0),
+      coarseCapacity(0),
+      reducedTarget(nullptr),
+      reducedTargetBytes(0),
+      drawBatch(INT_MAX - 1) {
   // Make sure the widget has a valid OpenGL context
   setFormat(QSurfaceFormat::defaultFormat());
   parseObjFile(
       "/home/finchren/school/s21_3DViewer/s21_3DViewer/src/3D_Viewer/models/"
       "cube_first.obj",
       &_cubeVertices, &_n_vertices, &_cubeIndices, &_n_indices);
+  getNormalization(modelOrigin, &modelScale);
 
   emit modelLoaded(_n_vertices, _n_indices / 2);
   // The initial color to black
@@ -120,6 +151,48 @@ GLWidget::GLWidget(QWidget* parent)
   // Set the initial edge color to white
   edgeColor = QColor(255, 255, 255);
   loadSettings();
+
+  QSettings settings("finchren", "3D_Viewer");
+  long long cacheMB = qgetenv("S21_VIEWER_MODEL_CACHE_MB").toLongLong();
+  if (cacheMB <= 0) {
+    cacheMB = settings.value("modelCacheMB", MODEL_CACHE_DEFAULT_BUDGET_MB)
+                  .toLongLong();
+  }
+  const int cacheEntries =
+      settings.value("modelCacheEntries", MODEL_CACHE_DEFAULT_ENTRIES).toInt();
+  modelCache = modelCacheCreate(cacheEntries, cacheMB << 20);
+
+  fileWatcher = new QFileSystemWatcher(this);
+  connect(fileWatcher, &QFileSystemWatcher::fileChanged, this,
+          &GLWidget::onWatchedFileChanged);
+  connect(fileWatcher, &QFileSystemWatcher::directoryChanged, this,
+          &GLWidget::onWatchedFileChanged);
+  // Writers often save in several steps, reload once they are done
+  reloadTimer = new QTimer(this);
+  reloadTimer->setSingleShot(true);
+  reloadTimer->setInterval(200);
+  connect(reloadTimer, &QTimer::timeout, this, &GLWidget::reloadWatchedModel);
+
+  cameraReset(&camera);
+  connect(this, &QOpenGLWidget::frameSwapped, this, &GLWidget::onFrameSwapped);
+
+  targetFrameMs = qgetenv("S21_VIEWER_TARGET_FRAME_MS").toDouble();
+  if (targetFrameMs <= 0.0) {
+    targetFrameMs =
+        settings.value("targetFrameMs", QUALITY_DEFAULT_TARGET_MS).toDouble();
+  }
+  qualityInit(&quality, targetFrameMs * 1e6);
+  pointBudget = qgetenv("S21_VIEWER_POINT_BUDGET").toLongLong();
+  if (pointBudget <= 0) {
+    pointBudget =
+        settings.value("pointBudget", POINT_CLOUD_DEFAULT_BUDGET).toLongLong();
+  }
+  idleTimer = new QTimer(this);
+  idleTimer->setSingleShot(true);
+  idleTimer->setInterval(QUALITY_IDLE_MS);
+  connect(idleTimer, &QTimer::timeout, this, &GLWidget::onInteractionIdle);
+  // Hover picking needs moves without a button held
+  setMouseTracking(true);
 }
 /*!
  * \brief GLWidget::initializeGL
@@ -130,6 +203,10 @@ GLWidget::GLWidget(QWidget* parent)
  */
 void GLWidget::initializeGL() {
   initializeOpenGLFunctions();
+  GLint maxIndices = 0;
+  glGetIntegerv(GL_MAX_ELEMENTS_INDICES, &maxIndices);
+  drawBatch =
+      qBound(DRAW_MIN_BATCH, (long long)maxIndices, (long long)INT_MAX) & ~1LL;
   // Enable the use of vertex arrays for drawing
   glEnableClientState(GL_VERTEX_ARRAY);
   // Specify the format and the location of the vertex data in the array
@@ -150,21 +227,30 @@ void GLWidget::initializeGL() {
  * Renders the 3D model by drawing vertices and edges with the specified colors
  * and styles. It also sets up the projection and model-view matrices, updates
  * the vertex and index pointers, and enables/disables line stipple based on the
- * isDashedEdges flag.
+ * isDashedEdges flag. While input arrives the frame may be simplified to the
+ * level of the quality governor, see quality.h.
  */
 void GLWidget::paintGL() {
+  TraceScope trace("GLWidget::paintGL");
+  const double frameStart = stageTimerNow();
+  applyPendingTransform();
+  const QualityLevel_t level = interacting ? quality.level : QUALITY_FULL;
+  const bool reduced =
+      level >= QUALITY_REDUCED_RESOLUTION && bindReducedTarget();
   // Enable depth testing
   glEnable(GL_DEPTH_TEST);
   // Set background color: RGB and opacity
   glClearColor(backgroundColor.redF(), backgroundColor.greenF(),
                backgroundColor.blueF(), backgroundColor.alphaF());
 
-  // Enable line stipple for dashed lines
-  if (isDashedEdges) {
+  // Enable line stipple for dashed lines. Below full quality the edges are
+  // drawn thin and solid.
+  if (isDashedEdges && level == QUALITY_FULL) {
     glEnable(GL_LINE_STIPPLE);
   } else {
     glDisable(GL_LINE_STIPPLE);
   }
+  glLineWidth(level == QUALITY_FULL ? edgeThickness : 1.0f);
 
   // Clear the color buffer (color values of the pixels displayed on the screen)
   // and depth buffer (distance of each pixel)
@@ -173,13 +259,10 @@ void GLWidget::paintGL() {
   glLoadMatrixf(projectionMatrix.constData());
 
   // QMatrix4x4 is a data type that represents a 4x4 matrix, used for
-  // transformations in 3D graphics Set up the model-view matrix
+  // transformations in 3D graphics Set up the model-view matrix from the
+  // camera, which starts at (2, 2, 4) looking at the center with +y up
   QMatrix4x4 modelView;
-  // First set of values - position of the camera
-  // Second set of values - position of the center
-  // Third set of values - determines the orientation of the camera properly (in
-  // relation to the ground and other objects in the scene)
-  modelView.lookAt(QVector3D(2, 2, 4), QVector3D(0, 0, 0), QVector3D(0, 1, 0));
+  cameraViewMatrix(&camera, isParallelProjection, modelView.data());
 
   // Load the projection and model-view matrices
   glMatrixMode(GL_PROJECTION);
@@ -197,13 +280,23 @@ void GLWidget::paintGL() {
   // Draw the points
   glColor3f(vertexColor.redF(), vertexColor.greenF(), vertexColor.blueF());
 
-  if (vertexDisplayMethod == Circle) {
+  if (pointCloudActive) {
+    drawPointCloud(modelView, level);
+  } else if (vertexDisplayMethod == None || level >= QUALITY_NO_GLYPHS) {
+    // No vertices
+  } else if (level == QUALITY_POINT_GLYPHS) {
+    // One point per vertex instead of a glyph, float vertices only
+    if (!compactActive && _cubeVertices != NULL) {
+      drawPoints(_cubeVertices, 0, _n_vertices);
+    }
+  } else if (vertexDisplayMethod == Circle) {
     // Draw the vertices as circles
-    for (int i = 0; i < _n_vertices * 3; i += 3) {
+    for (long long i = 0; i < _n_vertices * 3; i += 3) {
       glBegin(GL_TRIANGLE_FAN);
-      float x = _cubeVertices[i];
-      float y = _cubeVertices[i + 1];
-      float z = _cubeVertices[i + 2];
+      const QVector3D position = vertexPosition(i / 3);
+      float x = position.x();
+      float y = position.y();
+      float z = position.z();
       glVertex3f(x, y, z);
       for (int angle = 0; angle <= 360; angle += 10) {
         float rad = M_PI * angle / 180.0f;
@@ -214,11 +307,12 @@ void GLWidget::paintGL() {
     }
   } else if (vertexDisplayMethod == Square) {
     // Draw the vertices as squares
-    for (int i = 0; i < _n_vertices * 3; i += 3) {
+    for (long long i = 0; i < _n_vertices * 3; i += 3) {
       glBegin(GL_QUADS);
-      float x = _cubeVertices[i];
-      float y = _cubeVertices[i + 1];
-      float z = _cubeVertices[i + 2];
+      const QVector3D position = vertexPosition(i / 3);
+      float x = position.x();
+      float y = position.y();
+      float z = position.z();
       float halfSize = vertexSize / 2.0f;
       glVertex3f(x - halfSize / width(), y - halfSize / height(), z);
       glVertex3f(x + halfSize / width(), y - halfSize / height(), z);
@@ -230,7 +324,322 @@ void GLWidget::paintGL() {
 
   // Draw the lines
   glColor3f(edgeColor.redF(), edgeColor.greenF(), edgeColor.blueF());
-  glDrawElements(GL_LINES, _n_indices, GL_UNSIGNED_INT, _cubeIndices);
+  if (pointCloudActive) {
+    // Points only
+  } else if (oocStore != nullptr) {
+    drawOutOfCore(modelView);
+  } else if (compactActive) {
+    drawCompactEdges(modelView);
+  } else if (level >= QUALITY_COARSE_EDGES && buildCoarseEdges()) {
+    drawLines(GL_UNSIGNED_INT, coarseIndices, n_coarseIndices);
+  } else {
+    drawLines(GL_UNSIGNED_INT, _cubeIndices, _n_indices);
+  }
+  if (hoverPick.kind != BVH_PICK_NONE) drawPickHighlight();
+
+  if (reduced) presentReducedTarget();
+  recordFrameTime(stageTimerNow() - frameStart);
+}
+/*!
+ * \brief GLWidget::recordFrameTime
+ *
+ * Passes the time paintGL took to the quality governor while the model is
+ * being moved, and reports when the quality level changes. Frames drawn
+ * without input are always drawn at full quality.
+ */
+void GLWidget::recordFrameTime(double frameNs) {
+  if (!interacting) return;
+  const QualityLevel_t before = quality.level;
+  qualityRecordFrame(&quality, frameNs);
+  if (quality.level != before) {
+    qDebug() << "Frame took" << frameNs / 1e6 << "ms of" << targetFrameMs
+             << "ms, quality:" << qualityLevelName(quality.level);
+    emit qualityChanged(quality.level);
+  }
+}
+/*!
+ * \brief GLWidget::onInteractionIdle
+ *
+ * The input has stopped: draws the model again at full quality and starts
+ * the picking hierarchy again if its build was cancelled.
+ */
+void GLWidget::onInteractionIdle() {
+  interacting = false;
+  if (pickRebuild) startPickBuild();
+  if (quality.level == QUALITY_FULL) return;
+  qualityRestore(&quality);
+  emit qualityChanged(quality.level);
+  update();
+}
+/*!
+ * \brief GLWidget::buildCoarseEdges
+ *
+ * Makes the edge subset of the coarse quality levels the first time it is
+ * needed for the current float model.
+ *
+ * \return Whether the subset is there.
+ */
+bool GLWidget::buildCoarseEdges() {
+  if (coarseIndices != NULL) return true;
+  if (_cubeIndices == NULL || _n_indices == 0) return false;
+  coarseCapacity =
+      ((size_t)_n_indices / QUALITY_EDGE_STRIDE + 2) * sizeof(unsigned int);
+  coarseIndices =
+      (unsigned int*)memAccountMalloc(MEM_INDICES, coarseCapacity);
+  if (coarseIndices == NULL) return false;
+  n_coarseIndices = qualityEdgeSubset(_cubeIndices, _n_indices,
+                                      QUALITY_EDGE_STRIDE, coarseIndices);
+  return true;
+}
+/*!
+ * \brief GLWidget::freeCoarseEdges
+ *
+ * Drops the edge subset when the edges change.
+ */
+void GLWidget::freeCoarseEdges() {
+  memAccountFree(MEM_INDICES, coarseIndices, coarseCapacity);
+  coarseIndices = NULL;
+  n_coarseIndices = 0;
+  coarseCapacity = 0;
+}
+/*!
+ * \brief GLWidget::bindReducedTarget
+ *
+ * Directs drawing into a framebuffer with QUALITY_RESOLUTION_DIVISOR times
+ * fewer pixels per axis than the widget, made or resized when needed.
+ *
+ * \return Whether the framebuffer is bound; the frame is drawn at full
+ * resolution otherwise.
+ */
+bool GLWidget::bindReducedTarget() {
+  const QSize reducedSize =
+      size() * devicePixelRatioF() / QUALITY_RESOLUTION_DIVISOR;
+  if (reducedSize.isEmpty()) return false;
+  if (reducedTarget == nullptr || reducedTarget->size() != reducedSize) {
+    releaseReducedTarget();
+    reducedTarget = new QOpenGLFramebufferObject(
+        reducedSize, QOpenGLFramebufferObject::Depth);
+    // Color and depth
+    reducedTargetBytes = (long long)reducedSize.width() *
+                         reducedSize.height() * 2 * 4;
+    memAccountAdd(MEM_GPU_BUFFERS, reducedTargetBytes);
+  }
+  if (!reducedTarget->isValid() || !reducedTarget->bind()) return false;
+  glViewport(0, 0, reducedSize.width(), reducedSize.height());
+  return true;
+}
+/*!
+ * \brief GLWidget::presentReducedTarget
+ *
+ * Scales the reduced frame up to the widget with linear filtering.
+ */
+void GLWidget::presentReducedTarget() {
+  const QSize reducedSize = reducedTarget->size();
+  const QSize fullSize = size() * devicePixelRatioF();
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, reducedTarget->handle());
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFramebufferObject());
+  glBlitFramebuffer(0, 0, reducedSize.width(), reducedSize.height(), 0, 0,
+                    fullSize.width(), fullSize.height(), GL_COLOR_BUFFER_BIT,
+                    GL_LINEAR);
+  glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+  glViewport(0, 0, fullSize.width(), fullSize.height());
+}
+/*!
+ * \brief GLWidget::releaseReducedTarget
+ *
+ * Deletes the reduced resolution framebuffer, with the context current.
+ */
+void GLWidget::releaseReducedTarget() {
+  delete reducedTarget;
+  reducedTarget = nullptr;
+  memAccountRelease(MEM_GPU_BUFFERS, reducedTargetBytes);
+  reducedTargetBytes = 0;
+}
+/*!
+ * \brief GLWidget::drawPickHighlight
+ *
+ * Draws the vertex or edge under the cursor over the model, larger than the
+ * others and not hidden by them.
+ */
+void GLWidget::drawPickHighlight() {
+  if (_cubeVertices == NULL) return;
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_LINE_STIPPLE);
+  glColor3f(1.0f, 0.8f, 0.0f);
+  if (hoverPick.kind == BVH_PICK_VERTEX) {
+    glPointSize(qMax(vertexSize, 4.0f) + 4.0f);
+    glBegin(GL_POINTS);
+    const QVector3D position = vertexPosition(hoverPick.index);
+    glVertex3f(position.x(), position.y(), position.z());
+    glEnd();
+  } else {
+    glLineWidth(edgeThickness + 3.0f);
+    glBegin(GL_LINES);
+    for (int end = 0; end < 2; ++end) {
+      const QVector3D position =
+          vertexPosition(_cubeIndices[hoverPick.index * 2 + end]);
+      glVertex3f(position.x(), position.y(), position.z());
+    }
+    glEnd();
+    glLineWidth(edgeThickness);
+  }
+  glPointSize(vertexSize);
+  glEnable(GL_DEPTH_TEST);
+}
+/*!
+ * \brief GLWidget::vertexPosition
+ *
+ * \return Position of a vertex with the model transforms applied, decoded
+ * from the compact mesh when one is shown.
+ */
+QVector3D GLWidget::vertexPosition(long long vertex) const {
+  if (!compactActive) {
+    return QVector3D(_cubeVertices[vertex * 3], _cubeVertices[vertex * 3 + 1],
+                     _cubeVertices[vertex * 3 + 2]);
+  }
+  float decoded[3];
+  compactMeshDecode(&compactMesh, vertex, decoded);
+  return modelTransform.map(QVector3D(decoded[0], decoded[1], decoded[2]));
+}
+/*!
+ * \brief GLWidget::drawLines
+ *
+ * glDrawElements of GL_LINES split into calls of at most drawBatch indices,
+ * so that index counts beyond the 32-bit GLsizei are drawn in full.
+ *
+ * \param type GL_UNSIGNED_INT or GL_UNSIGNED_SHORT.
+ */
+void GLWidget::drawLines(GLenum type, const void* indices, long long count) {
+  const size_t size =
+      type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+  const char* bytes = static_cast<const char*>(indices);
+  for (long long first = 0; first < count; first += drawBatch) {
+    glDrawElements(GL_LINES, (GLsizei)qMin(drawBatch, count - first), type,
+                   bytes + (size_t)first * size);
+  }
+}
+/*!
+ * \brief GLWidget::drawPoints
+ *
+ * glDrawArrays of GL_POINTS for count float vertices from first on. Ranges
+ * beyond the 32-bit GLint and GLsizei move the vertex pointer instead, one
+ * batch at a time, and put it back at positions.
+ */
+void GLWidget::drawPoints(const float* positions, long long first,
+                          long long count) {
+  if (first <= INT_MAX && count <= drawBatch) {
+    glDrawArrays(GL_POINTS, (GLint)first, (GLsizei)count);
+    return;
+  }
+  for (long long done = 0; done < count; done += drawBatch) {
+    glVertexPointer(3, GL_FLOAT, 0, positions + (size_t)(first + done) * 3);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)qMin(drawBatch, count - done));
+  }
+  glVertexPointer(3, GL_FLOAT, 0, positions);
+}
+/*!
+ * \brief GLWidget::drawCompactEdges
+ *
+ * Draws the edges of the compact mesh. The 16-bit positions are passed to
+ * OpenGL as they are and decoded by the model-view matrix, which also
+ * applies the accumulated transforms. Each chunk is drawn with the vertex
+ * pointer moved to its base vertex, so its 16-bit indices stay relative.
+ *
+ * \param modelView The camera matrix, loaded back when done.
+ */
+void GLWidget::drawCompactEdges(const QMatrix4x4& modelView) {
+  QMatrix4x4 decode;
+  decode.translate(compactMesh.decode_offset[0], compactMesh.decode_offset[1],
+                   compactMesh.decode_offset[2]);
+  decode.scale(compactMesh.decode_scale[0], compactMesh.decode_scale[1],
+               compactMesh.decode_scale[2]);
+  glLoadMatrixf((modelView * modelTransform * decode).constData());
+
+  for (int c = 0; c < compactMesh.n_chunks; ++c) {
+    const CompactChunk_t& chunk = compactMesh.chunks[c];
+    glVertexPointer(3, GL_SHORT, 0,
+                    compactMesh.positions + (size_t)chunk.base * 3);
+    drawLines(GL_UNSIGNED_SHORT, compactMesh.indices16 + chunk.first,
+              chunk.count);
+  }
+  if (compactMesh.n_indices32 > 0) {
+    glVertexPointer(3, GL_SHORT, 0, compactMesh.positions);
+    drawLines(GL_UNSIGNED_INT, compactMesh.indices32, compactMesh.n_indices32);
+  }
+  glLoadMatrixf(modelView.constData());
+}
+/*!
+ * \brief GLWidget::drawOutOfCore
+ *
+ * Draws the model of the chunk store. oocUpdate() picks the chunks of the
+ * current view and maps a few more of them per frame, the overview stands in
+ * for the ones not mapped yet or too small to matter. While chunks are
+ * pending another frame is scheduled, so the model sharpens without input.
+ *
+ * \param modelView The camera matrix, loaded back when done.
+ */
+void GLWidget::drawOutOfCore(const QMatrix4x4& modelView) {
+  TraceScope trace("GLWidget::drawOutOfCore");
+  const QMatrix4x4 mvp = projectionMatrix * modelView * modelTransform;
+  OocFrame_t frame;
+  oocUpdate(oocStore, mvp.constData(), height(), &frame);
+  glLoadMatrixf((modelView * modelTransform).constData());
+
+  OocMeshView_t view;
+  if (frame.pending > 0 || frame.coarse > 0) {
+    oocOverview(oocStore, &view);
+    glVertexPointer(3, GL_FLOAT, 0, view.positions);
+    drawLines(GL_UNSIGNED_INT, view.indices, view.n_indices);
+  }
+  const int* chunks = NULL;
+  const int n_chunks = oocDrawList(oocStore, &chunks);
+  for (int i = 0; i < n_chunks; ++i) {
+    if (oocChunk(oocStore, chunks[i], &view) != 0) continue;
+    glVertexPointer(3, GL_FLOAT, 0, view.positions);
+    drawLines(GL_UNSIGNED_INT, view.indices, view.n_indices);
+    // Circles and squares per vertex do not scale to such models, points do
+    if (vertexDisplayMethod != None) {
+      glColor3f(vertexColor.redF(), vertexColor.greenF(), vertexColor.blueF());
+      glDrawArrays(GL_POINTS, 0, view.n_vertices);
+      glColor3f(edgeColor.redF(), edgeColor.greenF(), edgeColor.blueF());
+    }
+  }
+  glLoadMatrixf(modelView.constData());
+
+  if (frame.pending > 0) {
+    QTimer::singleShot(0, this, [this]() { update(); });
+  }
+}
+/*!
+ * \brief GLWidget::drawPointCloud
+ *
+ * Draws the point cloud with pointCloudSelect() picking the octree nodes of
+ * the current view, largest on screen first, until pointBudget points are
+ * taken. Every node is one contiguous range of the positions. The coarse
+ * quality levels cut the budget like they cut the edges, and points are
+ * drawn a pixel wide below full quality or without vertex glyphs.
+ *
+ * \param modelView The camera matrix, loaded back when done.
+ */
+void GLWidget::drawPointCloud(const QMatrix4x4& modelView,
+                              QualityLevel_t level) {
+  TraceScope trace("GLWidget::drawPointCloud");
+  const QMatrix4x4 mvp = projectionMatrix * modelView * modelTransform;
+  const long long budget = level >= QUALITY_COARSE_EDGES
+                               ? pointBudget / QUALITY_EDGE_STRIDE
+                               : pointBudget;
+  PointCloudFrame_t frame;
+  pointCloudSelect(&pointCloud, mvp.constData(), height(), budget, &frame);
+  glLoadMatrixf((modelView * modelTransform).constData());
+  glPointSize(vertexDisplayMethod == None || level != QUALITY_FULL
+                  ? 1.0f
+                  : vertexSize);
+  glVertexPointer(3, GL_FLOAT, 0, pointCloud.positions);
+  for (int i = 0; i < pointCloud.n_draw; ++i) {
+    const PointCloudNode_t& node = pointCloud.nodes[pointCloud.draw[i]];
+    drawPoints(pointCloud.positions, node.first, node.count);
+  }
+  glLoadMatrixf(modelView.constData());
 }
 /*!
  * \brief GLWidget::resizeGL
@@ -253,6 +662,133 @@ void GLWidget::resizeGL(int width, int height) {
   }
   update();
 }
+/*!
+ * \brief GLWidget::mousePressEvent
+ *
+ * Remembers where a drag or a click starts.
+ */
+void GLWidget::mousePressEvent(QMouseEvent* event) {
+  lastMousePos = event->pos();
+  pressPos = event->pos();
+  event->accept();
+}
+/*!
+ * \brief GLWidget::mouseMoveEvent
+ *
+ * Orbits the camera while the left button is held and pans it while the
+ * right or middle button, or Shift and the left button, are held. Only the
+ * camera changes, the frame is drawn at the next vertical sync. Without a
+ * button held, the vertex or edge under the cursor is highlighted.
+ */
+void GLWidget::mouseMoveEvent(QMouseEvent* event) {
+  const QPoint position = event->pos();
+  const Qt::MouseButtons buttons = event->buttons();
+  const bool pan = (buttons & (Qt::RightButton | Qt::MiddleButton)) ||
+                   (event->modifiers() & Qt::ShiftModifier);
+  if (buttons & (Qt::LeftButton | Qt::RightButton | Qt::MiddleButton)) {
+    if (pan) {
+      cameraPan(&camera, position.x() - lastMousePos.x(),
+                position.y() - lastMousePos.y(), width(), height(),
+                isParallelProjection);
+    } else {
+      cameraOrbit(&camera, lastMousePos.x(), lastMousePos.y(), position.x(),
+                  position.y(), width(), height());
+    }
+    lastMousePos = position;
+    markInput();
+  } else {
+    BvhPick_t pick;
+    pickAt(position, &pick);
+    if (pick.kind != hoverPick.kind || pick.index != hoverPick.index) {
+      hoverPick = pick;
+      update();
+    }
+  }
+  event->accept();
+}
+/*!
+ * \brief GLWidget::mouseReleaseEvent
+ *
+ * A left click that did not drag picks the vertex or edge under the cursor
+ * and reports it with picked(). While a trace is recorded, the time from
+ * input events to the frames showing them is logged as well; it is kept in
+ * stageTimerGet(STAGE_INPUT_LATENCY) either way, see onFrameSwapped().
+ */
+void GLWidget::mouseReleaseEvent(QMouseEvent* event) {
+  if (event->button() == Qt::LeftButton &&
+      (event->pos() - pressPos).manhattanLength() <
+          QApplication::startDragDistance()) {
+    const double start = stageTimerNow();
+    pickAt(event->pos(), &hoverPick);
+    if (hoverPick.kind != BVH_PICK_NONE) {
+      qDebug() << "Picked in" << (stageTimerNow() - start) / 1e3 << "us,"
+               << hoverPick.nodes_visited << "of" << pickBvh.n_nodes
+               << "nodes";
+    }
+    emit picked(pickDescription(hoverPick));
+    update();
+  }
+  const StageTiming_t* latency = stageTimerGet(STAGE_INPUT_LATENCY);
+  if (trace_enabled && latency->calls > 0) {
+    qDebug() << "Input to frame latency: last" << latency->last_ns / 1e6
+             << "ms, mean" << latency->total_ns / latency->calls / 1e6
+             << "ms, max" << latency->max_ns / 1e6 << "ms over"
+             << latency->calls << "frames";
+  }
+  event->accept();
+}
+/*!
+ * \brief GLWidget::mouseDoubleClickEvent
+ *
+ * Puts the camera back where it starts.
+ */
+void GLWidget::mouseDoubleClickEvent(QMouseEvent* event) {
+  resetCamera();
+  event->accept();
+}
+/*!
+ * \brief GLWidget::wheelEvent
+ *
+ * Zooms the camera, one CAMERA_ZOOM_STEP per wheel notch.
+ */
+void GLWidget::wheelEvent(QWheelEvent* event) {
+  cameraZoom(&camera, event->angleDelta().y() / 120.0f);
+  markInput();
+  event->accept();
+}
+/*!
+ * \brief GLWidget::resetCamera
+ *
+ * Looks at the center of the model from the starting position again.
+ */
+void GLWidget::resetCamera() {
+  cameraReset(&camera);
+  markInput();
+}
+/*!
+ * \brief GLWidget::markInput
+ *
+ * Schedules a frame for an input event. However many events arrive before
+ * it, QOpenGLWidget draws one frame per vertical sync. Until the input
+ * stops for QUALITY_IDLE_MS the quality governor may simplify the frames.
+ */
+void GLWidget::markInput() {
+  if (inputStart < 0.0) inputStart = stageTimerNow();
+  interacting = true;
+  idleTimer->start();
+  update();
+}
+/*!
+ * \brief GLWidget::onFrameSwapped
+ *
+ * Records the time from the oldest input event the frame shows to its
+ * swap as the input latency stage.
+ */
+void GLWidget::onFrameSwapped() {
+  if (inputStart < 0.0) return;
+  stageTimerRecord(STAGE_INPUT_LATENCY, inputStart, 1);
+  inputStart = -1.0;
+}
 /*!
  * \brief GLWidget::~GLWidget
  *
@@ -262,12 +798,47 @@ void GLWidget::resizeGL(int width, int height) {
  */
 GLWidget::~GLWidget() {
   saveSettings();
-  if (_cubeVertices) {
-    free(_cubeVertices);
-  }
-  if (_cubeIndices) {
-    free(_cubeIndices);
+  makeCurrent();
+  releaseReducedTarget();
+  doneCurrent();
+  releaseModel();
+  modelCacheDestroy(modelCache);
+}
+/*!
+ * \brief GLWidget::releaseModel
+ *
+ * Frees the arrays of the current model. A model loaded into an arena is
+ * released by destroying the arena, whatever the number of its allocations.
+ */
+void GLWidget::releaseModel() {
+  freeCoarseEdges();
+  cancelPickBuild();
+  pickRebuild = false;
+  bvhFree(&pickBvh);
+  hoverPick = BvhPick_t();
+  pendingTransform.setToIdentity();
+  transformPending = false;
+  if (modelArena != nullptr) {
+    arenaSetCurrent(NULL);
+    arenaDestroy(modelArena);
+    modelArena = nullptr;
+    compactMesh = CompactMesh_t();
+    pointCloud = PointCloud_t();
+    halfEdges = HalfEdgeMesh_t();
+  } else {
+    freeModelC(_cubeVertices, _n_vertices, _cubeIndices, _n_indices);
+    compactMeshFree(&compactMesh);
+    pointCloudFree(&pointCloud);
+    halfEdgeFree(&halfEdges);
   }
+  _cubeVertices = NULL;
+  _cubeIndices = NULL;
+  compactActive = false;
+  pointCloudActive = false;
+  oocClose(oocStore);
+  oocStore = nullptr;
+  objReloadDestroy(modelReload);
+  modelReload = nullptr;
 }
 /*!
  * \brief GLWidget::loadModel
@@ -277,34 +848,428 @@ GLWidget::~GLWidget() {
  * get the filename of QString type and pass it to this function.
  */
 void GLWidget::loadModel(const QString& fileName) {
+  TraceScope trace("GLWidget::loadModel");
   QByteArray byteArray = fileName.toLocal8Bit();
   const char* filePath = byteArray.constData();
 
-  if (_cubeVertices) {
-    free(_cubeVertices);
-    _cubeVertices = NULL;
-  }
-  if (_cubeIndices) {
-    free(_cubeIndices);
-    _cubeIndices = NULL;
-  }
-
+  releaseModel();
+  modelPath = fileName;
+  watchModelFile();
+  bakedTransform.setToIdentity();
+  // Pipes and the standard input can be read only once, so they are
+  // neither cached, watched nor turned into chunk stores
+  const bool isStream = objStreamIsPipe(filePath) != 0;
   // Display the filename in the QLabel
   if (filenameLabel) {
     QFileInfo fileInfo(fileName);
-    filenameLabel->setText(fileInfo.fileName());
+    filenameLabel->setText(fileName == "-" ? tr("standard input")
+                                           : fileInfo.fileName());
   }
-
-  // Reset _n_vertices and _n_indices before parsing the new file
   _n_vertices = 0;
   _n_indices = 0;
+  // Chunk stores and incremental reloads are built from OBJ text
+  const MeshLoader_t* loader = meshLoaderFind(filePath);
+  const bool isObj = loader != nullptr && loader->load == meshLoadObj;
+  if (outOfCoreEnabled && isObj && !isStream && openOutOfCore(fileName)) {
+    const long long vertices = oocVertexCount(oocStore);
+    const long long edges = oocEdgeCount(oocStore);
+    emit modelLoaded(vertices, edges);
+    update();
+    return;
+  }
 
-  parseObjFile(filePath, &_cubeVertices, &_n_vertices, &_cubeIndices,
-               &_n_indices);
+  // Falls back to malloc if the arena cannot be created
+  modelArena = arenaCreate();
+  arenaSetCurrent(modelArena);
+
+  const unsigned int cacheOptions =
+      (weldingEnabled ? 1u : 0u) | (isReordering() ? 2u : 0u);
+  ModelCache_t* cache = isStream ? nullptr : modelCache;
+  const double cacheStart = stageTimerNow();
+  // Watched models keep what is needed to patch them when the file changes,
+  // without welding or reordering, which would renumber the vertices
+  if (watchEnabled && isObj && !isStream && !compactGeometryEnabled) {
+    ObjReloadStats_t reload;
+    modelReload = objReloadCreate();
+    if (modelReload != nullptr &&
+        objReload(modelReload, filePath, NULL, &_cubeVertices, &_n_vertices,
+                  &_cubeIndices, &_n_indices, &reload) == 0 &&
+        !hasBadIndex()) {
+      qDebug() << "Loaded" << _n_vertices << "vertices in" << reload.chunks
+               << "chunks for reloading in" << reload.elapsed_ns / 1e6 << "ms";
+    } else {
+      objReloadDestroy(modelReload);
+      modelReload = nullptr;
+      freeModelC(_cubeVertices, _n_vertices, _cubeIndices, _n_indices);
+      _cubeVertices = NULL;
+      _cubeIndices = NULL;
+      _n_vertices = 0;
+      _n_indices = 0;
+    }
+  }
+  if (modelReload != nullptr) {
+    // Already loaded
+  } else if (cache != nullptr &&
+             modelCacheGet(cache, filePath, cacheOptions, &_cubeVertices,
+                           &_n_vertices, &_cubeIndices, &_n_indices) == 0) {
+    qDebug() << "Loaded" << _n_vertices << "vertices from the model cache in"
+             << (stageTimerNow() - cacheStart) / 1e6 << "ms";
+  } else if (parseModel(filePath)) {
+    if (cache != nullptr) {
+      modelCachePut(cache, filePath, cacheOptions, _cubeVertices, _n_vertices,
+                    _cubeIndices, _n_indices);
+    }
+  }
+  // Also restored by a cache hit
+  getNormalization(modelOrigin, &modelScale);
+  if (cache != nullptr && modelReload == nullptr) {
+    ModelCacheStats_t stats;
+    modelCacheGetStats(cache, &stats);
+    qDebug() << "Model cache:" << stats.hits << "hits," << stats.misses
+             << "misses," << stats.evictions << "evictions," << stats.entries
+             << "models in" << stats.bytes << "of" << stats.budget_bytes
+             << "bytes";
+  }
+  if (topologyEnabled && _cubeIndices != NULL) buildTopology();
+  if (compactGeometryEnabled &&
+      compactMeshBuild(_cubeVertices, _n_vertices, _cubeIndices, _n_indices,
+                       &compactMesh) == 0) {
+    const long long floatBytes =
+        (long long)_n_vertices * 3 * sizeof(float) +
+        (long long)_n_indices * sizeof(unsigned int);
+    qDebug() << "Compact geometry:" << floatBytes << "->"
+             << compactMeshBytes(&compactMesh) << "bytes,"
+             << compactMesh.n_chunks << "16-bit chunks, quantization error max"
+             << compactMesh.max_error << "rms" << compactMesh.rms_error;
+    freeModelC(_cubeVertices, _n_vertices, _cubeIndices, _n_indices);
+    _cubeVertices = NULL;
+    _cubeIndices = NULL;
+    compactActive = true;
+    modelTransform.setToIdentity();
+  }
+  // Vertex-only files, such as scans, are drawn as points
+  if (!compactActive && _cubeVertices != NULL && _n_indices == 0 &&
+      pointCloudBuild(_cubeVertices, _n_vertices, &pointCloud) == 0) {
+    qDebug() << "Point cloud:" << pointCloud.n_nodes << "octree nodes,"
+             << pointCloud.depth << "levels, built in"
+             << stageTimerGet(STAGE_POINT_CLOUD)->last_ns / 1e6
+             << "ms, budget" << pointBudget << "points per frame";
+    freeModelC(_cubeVertices, _n_vertices, _cubeIndices, _n_indices);
+    _cubeVertices = NULL;
+    _cubeIndices = NULL;
+    pointCloudActive = true;
+    modelTransform.setToIdentity();
+  }
+  if (modelArena != nullptr) {
+    ArenaStats_t arena;
+    arenaGetStats(modelArena, &arena);
+    qDebug() << "Load arena: temporaries high-water" << arena.temp_high_water
+             << "bytes in" << arena.regions << "thread regions, mesh"
+             << arena.mesh_live << "bytes (high-water" << arena.mesh_high_water
+             << ", huge pages" << arena.huge_page_bytes << ", transparent"
+             << arena.thp_bytes << ")";
+    arenaResetTemp(modelArena);
+  }
+  startPickBuild();
 
   emit modelLoaded(_n_vertices, _n_indices / 2);
   update();
 }
+/*!
+ * \brief GLWidget::parseModel
+ *
+ * Loads a model file of any registered format (see mesh_loader.h) into
+ * _cubeVertices and _cubeIndices and runs the welding and reordering passes
+ * that are enabled. A file that cannot be loaded is reported with
+ * modelLoadFailed.
+ *
+ * \return false if the file could not be loaded, with no model then.
+ */
+bool GLWidget::parseModel(const char* filePath) {
+  const MeshLoader_t* loader = meshLoaderFind(filePath);
+  if (loader == nullptr) {
+    setLoadError(LOAD_ERROR_FORMAT, 0, -1, "unknown model format");
+  }
+  if (loader == nullptr || loader->load(filePath, &_cubeVertices, &_n_vertices,
+                                        &_cubeIndices, &_n_indices) != 0) {
+    LoadError_t error;
+    getLoadError(&error);
+    QString message = QString::fromLocal8Bit(error.message);
+    if (error.offset >= 0) {
+      message += tr(" (byte %1)").arg(error.offset);
+    }
+    qDebug() << "Could not load" << filePath << ":" << message;
+    emit modelLoadFailed(tr("Could not load %1:\n%2")
+                             .arg(QString::fromLocal8Bit(filePath), message));
+    return false;
+  }
+
+  const double total = stageTimerGet(STAGE_PARSE_TOTAL)->last_ns / 1e6;
+  if (loader->load == meshLoadObj) {
+    const StageTiming_t* count = stageTimerGet(STAGE_PARSE_COUNT);
+    const StageTiming_t* fill = stageTimerGet(STAGE_PARSE_FILL);
+    qDebug() << "Parsed" << _n_vertices << "vertices in" << total
+             << "ms (count pass" << count->last_ns / 1e6 << "ms, fill pass"
+             << fill->last_ns / 1e6 << "ms)";
+  } else {
+    qDebug() << "Loaded" << _n_vertices << "vertices from" << loader->name
+             << "in" << total << "ms";
+  }
+
+  // Each pass frees its temporaries before the next one starts
+  arenaResetTemp(modelArena);
+  if (weldingEnabled) {
+    WeldStats_t weld;
+    if (weldVertices(&_cubeVertices, &_n_vertices, _cubeIndices, _n_indices,
+                     weldEpsilon, &weld) == 0) {
+      qDebug() << "Welded" << weld.vertices_in << "->" << weld.vertices_out
+               << "vertices (" << weld.merge_ratio * 100.0 << "% merged) in"
+               << weld.elapsed_ns / 1e6 << "ms";
+    }
+    arenaResetTemp(modelArena);
+  }
+  if (isReordering()) {
+    ReorderStats_t reorder;
+    if (reorderModel(&_cubeVertices, _n_vertices, _cubeIndices, _n_indices,
+                     &reorder) == 0) {
+      qDebug() << "Reordered in" << reorder.elapsed_ns / 1e6
+               << "ms, mean edge span" << reorder.edge_span_before << "->"
+               << reorder.edge_span_after;
+    }
+    arenaResetTemp(modelArena);
+  }
+  return true;
+}
+/*!
+ * \brief GLWidget::hasBadIndex
+ *
+ * Checks the indices of a model patched by objReload, which leaves that to
+ * its caller. The full load that follows a failed check reports the line.
+ */
+bool GLWidget::hasBadIndex() const {
+  return objFindBadIndex(_cubeIndices, _n_indices, _n_vertices) >= 0;
+}
+/*!
+ * \brief GLWidget::modelCacheStats
+ *
+ * Fills the hit, miss and eviction counts and the size of the model cache.
+ */
+void GLWidget::modelCacheStats(ModelCacheStats_t* stats) const {
+  if (modelCache != nullptr) {
+    modelCacheGetStats(modelCache, stats);
+  } else {
+    *stats = ModelCacheStats_t();
+  }
+}
+/*!
+ * \brief GLWidget::buildTopology
+ *
+ * Builds the half-edges of the float model in place of the current ones,
+ * in the model arena.
+ */
+void GLWidget::buildTopology() {
+  halfEdgeFree(&halfEdges);
+  HalfEdgeStats_t topology;
+  if (halfEdgeBuild(_cubeIndices, _n_indices, _n_vertices, &halfEdges,
+                    &topology) == 0) {
+    qDebug() << "Topology:" << halfEdges.n_faces << "faces,"
+             << halfEdges.n_edges << "edges," << halfEdges.n_boundary
+             << "boundary," << halfEdges.n_non_manifold << "non-manifold,"
+             << topology.lines << "lines, built in"
+             << topology.elapsed_ns / 1e6 << "ms," << topology.bytes
+             << "bytes (peak" << topology.peak_bytes << ")";
+  }
+  if (modelArena != nullptr) arenaResetTemp(modelArena);
+}
+/*!
+ * \brief GLWidget::startPickBuild
+ *
+ * Starts building the picking hierarchy of the float model on a worker
+ * thread, in place of the current one. Compact, point-cloud and out-of-core
+ * models are not picked.
+ */
+void GLWidget::startPickBuild() {
+  cancelPickBuild();
+  bvhFree(&pickBvh);
+  pickTransform.setToIdentity();
+  pickRebuild = false;
+  hoverPick = BvhPick_t();
+  if (compactActive || pointCloudActive || oocStore != nullptr ||
+      _cubeVertices == NULL) {
+    return;
+  }
+  pickBuilder =
+      bvhBuildStart(_cubeVertices, _n_vertices, _cubeIndices, _n_indices);
+}
+/*!
+ * \brief GLWidget::cancelPickBuild
+ *
+ * Stops a build that is still reading the vertices before they change. It
+ * is started again by onInteractionIdle().
+ */
+void GLWidget::cancelPickBuild() {
+  if (pickBuilder == nullptr) return;
+  bvhBuildCancel(pickBuilder);
+  pickBuilder = nullptr;
+  pickRebuild = true;
+}
+/*!
+ * \brief GLWidget::pickHierarchyReady
+ *
+ * Takes over the hierarchy once its worker is done.
+ *
+ * \return Whether there is a hierarchy to pick with. Until the build is
+ * done nothing is picked.
+ */
+bool GLWidget::pickHierarchyReady() {
+  if (pickBuilder != nullptr) {
+    if (!bvhBuildDone(pickBuilder)) return false;
+    const int result = bvhBuildFinish(pickBuilder, &pickBvh);
+    pickBuilder = nullptr;
+    if (result != 0) return false;
+    qDebug() << "Picking hierarchy:" << pickBvh.n_nodes << "nodes,"
+             << pickBvh.depth << "levels," << bvhBytes(&pickBvh)
+             << "bytes, built in"
+             << stageTimerGet(STAGE_BVH)->last_ns / 1e6 << "ms";
+  }
+  return pickBvh.n_nodes > 0;
+}
+/*!
+ * \brief GLWidget::pickAt
+ *
+ * Finds the vertex or edge within BVH_PICK_PIXELS of a position in the
+ * widget, as the last frame shows the model.
+ */
+void GLWidget::pickAt(const QPoint& position, BvhPick_t* pick) {
+  *pick = BvhPick_t();
+  if (!pickHierarchyReady()) return;
+  QMatrix4x4 modelView;
+  cameraViewMatrix(&camera, isParallelProjection, modelView.data());
+  const QMatrix4x4 mvp = projectionMatrix * modelView;
+  bvhPick(&pickBvh, _cubeVertices, _cubeIndices, mvp.constData(),
+          pickTransform.isIdentity() ? NULL : pickTransform.constData(),
+          width(), height(), position.x(), position.y(), BVH_PICK_PIXELS,
+          pick);
+}
+/*!
+ * \brief GLWidget::pickDescription
+ *
+ * \return The index of a picked vertex or edge, numbered from 1, and the
+ * coordinates of its vertices in the file of the model, or an empty string
+ * if nothing was picked. The coordinates include the transforms applied
+ * since the load.
+ */
+QString GLWidget::pickDescription(const BvhPick_t& pick) const {
+  if (pick.kind == BVH_PICK_NONE) return QString();
+  auto coordinates = [this](long long vertex) {
+    const QVector3D position = vertexPosition(vertex) * modelScale +
+                               QVector3D(modelOrigin[0], modelOrigin[1],
+                                         modelOrigin[2]);
+    return QString("%1 (%2, %3, %4)")
+        .arg(vertex + 1)
+        .arg(position.x())
+        .arg(position.y())
+        .arg(position.z());
+  };
+  if (pick.kind == BVH_PICK_VERTEX) {
+    return tr("Vertex %1").arg(coordinates(pick.index));
+  }
+  return tr("Edge %1: %2 to %3")
+      .arg(pick.index + 1)
+      .arg(coordinates(_cubeIndices[pick.index * 2]))
+      .arg(coordinates(_cubeIndices[pick.index * 2 + 1]));
+}
+/*!
+ * \brief GLWidget::exportModel
+ *
+ * Writes the model as it is shown, with every transform applied, to an OBJ
+ * file. Triangles are written as faces, other edges as lines.
+ *
+ * \param fileName The OBJ file to write.
+ * \param fileCoordinates Whether to undo the normalization of the loader, so
+ * an untransformed model is written in the coordinates of its file.
+ * \return Whether the file was written. Compact, point-cloud and out-of-core
+ * models keep no float vertices in file order and cannot be exported.
+ */
+bool GLWidget::exportModel(const QString& fileName, bool fileCoordinates) {
+  TraceScope trace("GLWidget::exportModel");
+  if (compactActive || pointCloudActive || oocStore != nullptr ||
+      _cubeVertices == NULL) {
+    return false;
+  }
+  applyPendingTransform();
+  ObjExportOptions_t options;
+  objExportDefaults(&options);
+  if (fileCoordinates) {
+    memcpy(options.origin, modelOrigin, sizeof(options.origin));
+    options.scale = modelScale;
+  }
+  QByteArray byteArray = fileName.toLocal8Bit();
+  ObjExportStats_t stats;
+  if (objExport(byteArray.constData(), _cubeVertices, _n_vertices,
+                _cubeIndices, _n_indices, &options, &stats) != 0) {
+    qDebug() << "Could not export to" << fileName;
+    return false;
+  }
+  qDebug() << "Exported" << stats.vertices << "vertices," << stats.faces
+           << "faces and" << stats.lines << "lines (" << stats.bytes
+           << "bytes ) in" << stats.elapsed_ns / 1e6 << "ms";
+  return true;
+}
+/*!
+ * \brief GLWidget::openOutOfCore
+ *
+ * Opens the chunk store of an OBJ file, next to it or in the temporary
+ * directory if that one is not writable. The store is built first when it is
+ * missing or older than the OBJ file. The memory budget comes from
+ * S21_VIEWER_OOC_BUDGET_MB or the outOfCoreBudgetMB setting, in MiB.
+ *
+ * \return Whether a store is open, the model is parsed as usual otherwise.
+ */
+bool GLWidget::openOutOfCore(const QString& fileName) {
+  const QFileInfo objInfo(fileName);
+  QStringList candidates;
+  candidates << fileName + OOC_STORE_SUFFIX
+             << QDir(QDir::tempPath())
+                    .filePath(objInfo.fileName() + OOC_STORE_SUFFIX);
+  const QByteArray objPath = fileName.toLocal8Bit();
+
+  QString storePath;
+  for (const QString& candidate : candidates) {
+    const QFileInfo storeInfo(candidate);
+    if (storeInfo.exists() &&
+        storeInfo.lastModified() >= objInfo.lastModified()) {
+      storePath = candidate;
+      break;
+    }
+    OocBuildOptions_t options;
+    oocBuildDefaults(&options);
+    OocBuildStats_t stats;
+    if (oocBuild(objPath.constData(), candidate.toLocal8Bit().constData(),
+                 &options, &stats) == 0) {
+      qDebug() << "Built chunk store" << candidate << "in"
+               << stats.elapsed_ns / 1e6 << "ms:" << stats.vertices
+               << "vertices," << stats.edges << "edges in" << stats.chunks
+               << "chunks," << stats.file_bytes << "bytes";
+      storePath = candidate;
+      break;
+    }
+  }
+  if (storePath.isEmpty()) return false;
+
+  long long budgetMB = qgetenv("S21_VIEWER_OOC_BUDGET_MB").toLongLong();
+  if (budgetMB <= 0) {
+    QSettings settings("finchren", "3D_Viewer");
+    budgetMB = settings.value("outOfCoreBudgetMB", OOC_DEFAULT_BUDGET_MB)
+                   .toLongLong();
+  }
+  oocStore = oocOpen(storePath.toLocal8Bit().constData(), budgetMB << 20);
+  if (oocStore == nullptr) return false;
+  modelTransform.setToIdentity();
+  qDebug() << "Viewing" << storePath << "out of core:"
+           << oocChunkCount(oocStore) << "chunks, budget" << budgetMB << "MiB";
+  return true;
+}
 /*!
  * \brief GLWidget::setParallelProjection
  *
@@ -472,6 +1437,13 @@ void GLWidget::saveSettings() {
   settings.setValue("isParallelProjection", isParallelProjection);
   settings.setValue("isDashedEdges", isDashedEdges);
   settings.setValue("edgeThickness", edgeThickness);
+  settings.setValue("weldingEnabled", weldingEnabled);
+  settings.setValue("weldEpsilon", weldEpsilon);
+  settings.setValue("reorderingEnabled", reorderingEnabled);
+  settings.setValue("topologyEnabled", topologyEnabled);
+  settings.setValue("compactGeometryEnabled", compactGeometryEnabled);
+  settings.setValue("outOfCoreEnabled", outOfCoreEnabled);
+  settings.setValue("watchEnabled", watchEnabled);
 }
 /*!
  * \brief GLWidget::loadSettings
@@ -538,6 +1510,196 @@ void GLWidget::loadSettings() {
   } else {
     edgeThickness = 1.0f;
   }
+
+  weldingEnabled = settings.value("weldingEnabled", false).toBool();
+  weldEpsilon = settings.value("weldEpsilon", WELD_DEFAULT_EPSILON).toFloat();
+  reorderingEnabled = settings.value("reorderingEnabled", false).toBool();
+  topologyEnabled = settings.value("topologyEnabled", false).toBool();
+  compactGeometryEnabled =
+      settings.value("compactGeometryEnabled", false).toBool();
+  outOfCoreEnabled = settings.value("outOfCoreEnabled", false).toBool();
+  watchEnabled = settings.value("watchEnabled", false).toBool();
+}
+/*!
+ * \brief GLWidget::setWelding
+ *
+ * Enables or disables welding of loaded models: vertices closer than
+ * weldEpsilon (in normalized model coordinates) are merged and the edges are
+ * rewired to the kept vertices. Takes effect on the next load.
+ */
+void GLWidget::setWelding(bool enabled) { weldingEnabled = enabled; }
+/*!
+ * \brief GLWidget::setReordering
+ *
+ * Enables or disables sorting of loaded models for memory locality: vertices
+ * along a Morton curve and edges by their first vertex. The drawn model does
+ * not change, drawing the edges of large unordered models gets faster, but
+ * picked and exported vertices are numbered in the new order rather than the
+ * file's, so it is off by default. Takes effect on the next load.
+ */
+void GLWidget::setReordering(bool enabled) { reorderingEnabled = enabled; }
+/*!
+ * \brief GLWidget::isReordering
+ *
+ * \return Whether the next load reorders the model: reordering is on and
+ * topology is off, as the half-edges are found from the edges of each face
+ * in file order.
+ */
+bool GLWidget::isReordering() const {
+  return reorderingEnabled && !topologyEnabled;
+}
+/*!
+ * \brief GLWidget::setTopology
+ *
+ * Enables or disables building the half-edges of loaded models: the twin of
+ * every face edge, the valence of every vertex and the boundary and
+ * non-manifold edges, which are printed after loading. Models are not
+ * reordered while this is on. Takes effect on the next load.
+ */
+void GLWidget::setTopology(bool enabled) { topologyEnabled = enabled; }
+/*!
+ * \brief GLWidget::setCompactGeometry
+ *
+ * Enables or disables compact storage of loaded models: positions quantized
+ * to 16 bits over the bounding box and 16-bit indices where the vertex order
+ * allows, about half the memory and per-frame upload of float geometry. The
+ * quantization error is printed after loading. Takes effect on the next
+ * load.
+ */
+void GLWidget::setCompactGeometry(bool enabled) {
+  compactGeometryEnabled = enabled;
+}
+/*!
+ * \brief GLWidget::setOutOfCore
+ *
+ * Enables or disables out-of-core viewing: a model is split once into
+ * spatial chunks stored next to the OBJ file (see tools/build_ooc.c), and
+ * only the chunks in view are mapped into memory, within a budget. Models
+ * larger than the memory can be viewed this way. Welding, reordering and
+ * compact geometry do not apply to such models. Takes effect on the next
+ * load.
+ */
+void GLWidget::setOutOfCore(bool enabled) { outOfCoreEnabled = enabled; }
+/*!
+ * \brief GLWidget::setWatching
+ *
+ * Enables or disables reloading the model when its file changes on disk.
+ * The file is split into chunks on line boundaries and only the chunks that
+ * changed are parsed again; the transforms applied since the load are kept.
+ * Watched models are not welded or reordered. Watching starts at once,
+ * incremental reloads with the next load.
+ */
+void GLWidget::setWatching(bool enabled) {
+  watchEnabled = enabled;
+  watchModelFile();
+}
+/*!
+ * \brief GLWidget::watchModelFile
+ *
+ * Watches the model file and its directory, since editors often save by
+ * writing a new file and renaming it over the old one.
+ */
+void GLWidget::watchModelFile() {
+  if (!fileWatcher->files().isEmpty()) {
+    fileWatcher->removePaths(fileWatcher->files());
+  }
+  if (!fileWatcher->directories().isEmpty()) {
+    fileWatcher->removePaths(fileWatcher->directories());
+  }
+  if (watchEnabled && !modelPath.isEmpty() &&
+      !objStreamIsPipe(modelPath.toLocal8Bit().constData())) {
+    fileWatcher->addPath(modelPath);
+    fileWatcher->addPath(QFileInfo(modelPath).absolutePath());
+  }
+}
+void GLWidget::onWatchedFileChanged(const QString& path) {
+  bool changed = path == modelPath;
+  // A file replaced by a rename is no longer watched
+  if (!fileWatcher->files().contains(modelPath) && QFile::exists(modelPath)) {
+    fileWatcher->addPath(modelPath);
+    changed = true;
+  }
+  if (changed) reloadTimer->start();
+}
+/*!
+ * \brief GLWidget::reloadWatchedModel
+ *
+ * Patches the changed chunks of the model into the vertex and index arrays.
+ * The arrays are drawn from client memory, so the dirty ranges are only
+ * logged. The picking hierarchy is refit to the dirty vertices, or rebuilt
+ * when the edges changed, and so are the half-edges while "Build mesh
+ * topology" is on; otherwise they are dropped. Compact, point-cloud and
+ * out-of-core models are loaded again in full, keeping their transform.
+ */
+void GLWidget::reloadWatchedModel() {
+  TraceScope trace("GLWidget::reloadWatchedModel");
+  if (!QFile::exists(modelPath)) return;
+  applyPendingTransform();
+  if (modelReload != nullptr && !compactActive && !pointCloudActive &&
+      oocStore == nullptr) {
+    QByteArray byteArray = modelPath.toLocal8Bit();
+    ObjReloadStats_t reload;
+    arenaSetCurrent(modelArena);
+    cancelPickBuild();
+    const int result =
+        objReload(modelReload, byteArray.constData(),
+                  bakedTransform.constData(), &_cubeVertices, &_n_vertices,
+                  &_cubeIndices, &_n_indices, &reload);
+    if (modelArena != nullptr) arenaResetTemp(modelArena);
+    if (result != 0) {
+      if (pickRebuild) startPickBuild();
+      return;
+    }
+    // A bad index falls through to the full load below, which reports it
+    if (!hasBadIndex()) {
+      getNormalization(modelOrigin, &modelScale);
+      freeCoarseEdges();
+      qDebug() << "Reloaded" << reload.dirty_chunks << "of" << reload.chunks
+               << "chunks (" << reload.dirty_bytes << "bytes ) in"
+               << reload.elapsed_ns / 1e6 << "ms, vertices"
+               << reload.first_dirty_vertex << "+" << reload.dirty_vertices
+               << ", indices" << reload.first_dirty_index << "+"
+               << reload.dirty_indices
+               << (reload.relayout ? ", relaid out" : "")
+               << (reload.renormalized ? ", renormalized" : "");
+      // Twins and origins point into the old edges and vertex count
+      const bool edgesChanged = reload.relayout || reload.dirty_indices > 0 ||
+                                halfEdges.n_vertices != _n_vertices;
+      if (!topologyEnabled) {
+        halfEdgeFree(&halfEdges);
+      } else if (edgesChanged) {
+        buildTopology();
+      }
+      // The patched vertices have every transform applied, so boxes fit
+      // before a transform are all refit
+      if (pickRebuild || reload.relayout || reload.dirty_indices > 0 ||
+          pickBvh.n_vertices != _n_vertices) {
+        startPickBuild();
+      } else if (reload.renormalized || !pickTransform.isIdentity()) {
+        bvhRefit(&pickBvh, _cubeVertices, _cubeIndices, 0, _n_vertices);
+        pickTransform.setToIdentity();
+      } else {
+        bvhRefit(&pickBvh, _cubeVertices, _cubeIndices,
+                 reload.first_dirty_vertex, reload.dirty_vertices);
+      }
+      emit modelLoaded(_n_vertices, _n_indices / 2);
+      update();
+      return;
+    }
+  }
+
+  const QMatrix4x4 keptModelTransform = modelTransform;
+  const QMatrix4x4 keptBakedTransform = bakedTransform;
+  loadModel(modelPath);
+  if (compactActive || pointCloudActive || oocStore != nullptr) {
+    modelTransform = keptModelTransform;
+  } else if (!keptBakedTransform.isIdentity()) {
+    cancelPickBuild();
+    transformModelC(_cubeVertices, _n_vertices, keptBakedTransform.constData());
+    bakedTransform = keptBakedTransform;
+    startPickBuild();
+  }
+  update();
 }
 /*!
  * \brief GLWidget::takeScreenshot
@@ -2,13 +2,18 @@
 #define GLWIDGET_H
 #define GL_SILENCE_DEPRECATION
 #include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QLabel>
 #include <QMatrix4x4>
+#include <QMouseEvent>
 #include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLWidget>
 #include <QSettings>
+#include <QTimer>
+#include <QWheelEvent>
 
 // For max and min
 #include <stdio.h>
@@ -18,6 +23,23 @@
 #include <cfloat>
 #include <cmath>
 
+#include "arena.h"
+#include "bvh.h"
+#include "camera.h"
+#include "compact.h"
+#include "half_edge.h"
+#include "mesh_loader.h"
+#include "model_cache.h"
+#include "obj_export.h"
+#include "obj_reload.h"
+#include "out_of_core.h"
+#include "point_cloud.h"
+#include "quality.h"
+
+// Draw calls take at most INT_MAX indices or vertices (GLsizei), or fewer
+// when GL_MAX_ELEMENTS_INDICES says so, but never fewer than this
+#define DRAW_MIN_BATCH (1LL << 20)
+
 class GLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions {
   Q_OBJECT
  public:
@@ -56,25 +78,122 @@ class GLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions {
   void setVertexColor(const QColor& color);
   enum VertexDisplayMethod { None, Circle, Square };
   void setVertexDisplayMethod(VertexDisplayMethod method);
+  /*!
+   * \brief GLWidget::isWeldingEnabled
+   *
+   * \return Whether loaded models are welded, see setWelding().
+   */
+  bool isWeldingEnabled() const { return weldingEnabled; }
+  void setWelding(bool enabled);
+  /*!
+   * \brief GLWidget::isReorderingEnabled
+   *
+   * \return Whether loaded models are reordered, see setReordering().
+   */
+  bool isReorderingEnabled() const { return reorderingEnabled; }
+  void setReordering(bool enabled);
+  /*!
+   * \brief GLWidget::isCompactGeometryEnabled
+   *
+   * \return Whether loaded models are stored compact, see
+   * setCompactGeometry().
+   */
+  bool isCompactGeometryEnabled() const { return compactGeometryEnabled; }
+  void setCompactGeometry(bool enabled);
+  /*!
+   * \brief GLWidget::isTopologyEnabled
+   *
+   * \return Whether loaded models get half-edge adjacency, see setTopology().
+   */
+  bool isTopologyEnabled() const { return topologyEnabled; }
+  void setTopology(bool enabled);
+  /*!
+   * \brief GLWidget::meshTopology
+   *
+   * \return The half-edges of the loaded model, empty unless setTopology()
+   * was on when it was loaded.
+   */
+  const HalfEdgeMesh_t& meshTopology() const { return halfEdges; }
+  /*!
+   * \brief GLWidget::isOutOfCoreEnabled
+   *
+   * \return Whether models are viewed from a chunk store, see setOutOfCore().
+   */
+  bool isOutOfCoreEnabled() const { return outOfCoreEnabled; }
+  void setOutOfCore(bool enabled);
+  /*!
+   * \brief GLWidget::isWatchingEnabled
+   *
+   * \return Whether the loaded file is reloaded when it changes, see
+   * setWatching().
+   */
+  bool isWatchingEnabled() const { return watchEnabled; }
+  void setWatching(bool enabled);
+  void modelCacheStats(ModelCacheStats_t* stats) const;
+  void resetCamera();
+  bool exportModel(const QString& fileName, bool fileCoordinates);
   void saveSettings();
   void loadSettings();
   void resetPreferences();
 
  public:
-  int _n_vertices;
-  int _n_indices;
+  long long _n_vertices;
+  long long _n_indices;
   float* _cubeVertices;
   unsigned int* _cubeIndices;
 
  signals:
-  void modelLoaded(int numVertices, int numEdges);
+  void modelLoaded(qint64 numVertices, qint64 numEdges);
+  void modelLoadFailed(const QString& message);
+  void qualityChanged(int level);
+  void picked(const QString& description);
+
+ private slots:
+  void onWatchedFileChanged(const QString& path);
+  void reloadWatchedModel();
+  void onFrameSwapped();
+  void onInteractionIdle();
 
  protected:
   void initializeGL() override;
   void paintGL() override;
   void resizeGL(int width, int height) override;
+  void mousePressEvent(QMouseEvent* event) override;
+  void mouseMoveEvent(QMouseEvent* event) override;
+  void mouseReleaseEvent(QMouseEvent* event) override;
+  void mouseDoubleClickEvent(QMouseEvent* event) override;
+  void wheelEvent(QWheelEvent* event) override;
 
  private:
+  QVector3D vertexPosition(long long vertex) const;
+  void queueTransform(const QMatrix4x4& transform);
+  void applyPendingTransform();
+  void markInput();
+  void recordFrameTime(double frameNs);
+  bool buildCoarseEdges();
+  void freeCoarseEdges();
+  bool bindReducedTarget();
+  void presentReducedTarget();
+  void releaseReducedTarget();
+  void drawLines(GLenum type, const void* indices, long long count);
+  void drawPoints(const float* positions, long long first, long long count);
+  void drawCompactEdges(const QMatrix4x4& modelView);
+  void drawOutOfCore(const QMatrix4x4& modelView);
+  void drawPointCloud(const QMatrix4x4& modelView, QualityLevel_t level);
+  bool openOutOfCore(const QString& fileName);
+  void watchModelFile();
+  void releaseModel();
+  bool parseModel(const char* filePath);
+  bool hasBadIndex() const;
+  bool isReordering() const;
+  void buildTopology();
+  void startPickBuild();
+  void cancelPickBuild();
+  bool pickHierarchyReady();
+  void pickAt(const QPoint& position, BvhPick_t* pick);
+  QString pickDescription(const BvhPick_t& pick) const;
+  void drawPickHighlight();
+
   float scaleFactor;
   float vertexSize;
   bool isParallelProjection;
@@ -88,6 +207,94 @@ class GLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions {
   QColor vertexColor;
   QColor edgeColor;
   VertexDisplayMethod vertexDisplayMethod;
+  // Merge vertices closer than weldEpsilon when a model is loaded
+  bool weldingEnabled;
+  float weldEpsilon;
+  // Sort vertices and edges for memory locality when a model is loaded
+  bool reorderingEnabled;
+  // Build the half-edges of the triangles when a model is loaded. The faces
+  // are found in file order, so reordering is skipped while this is on.
+  bool topologyEnabled;
+  HalfEdgeMesh_t halfEdges;
+  // Store loaded models with 16-bit positions and indices. While a compact
+  // model is shown, _cubeVertices and _cubeIndices are NULL and transforms
+  // accumulate in modelTransform instead of changing the vertices.
+  bool compactGeometryEnabled;
+  bool compactActive;
+  CompactMesh_t compactMesh;
+  QMatrix4x4 modelTransform;
+  // View models from a chunk store next to the OBJ file, paged in under a
+  // memory budget. Like a compact model, a store is never modified and
+  // transforms accumulate in modelTransform.
+  bool outOfCoreEnabled;
+  OocStore_t* oocStore;
+  // Models without edges are shown as point clouds: an octree of point
+  // samples drawn nearest detail first, at most pointBudget points per frame
+  // (S21_VIEWER_POINT_BUDGET or the pointBudget setting). Like a compact
+  // model, the cloud is never modified and transforms accumulate in
+  // modelTransform.
+  bool pointCloudActive;
+  PointCloud_t pointCloud;
+  long long pointBudget;
+  // Owns every array of the loaded model, NULL for the built-in model
+  Arena_t* modelArena;
+  // Recently loaded models, keyed by file and the welding and reordering
+  // options; a hit replaces the parse and both passes with a copy
+  ModelCache_t* modelCache;
+  // Reload the model when its file changes. Watched models are loaded
+  // without welding and reordering, so that a reload only has to parse the
+  // changed chunks of the file (modelReload) and patch them in place.
+  // bakedTransform holds the transforms applied to _cubeVertices since the
+  // load, which are applied to the patched vertices as well.
+  bool watchEnabled;
+  QString modelPath;
+  QFileSystemWatcher* fileWatcher;
+  QTimer* reloadTimer;
+  ObjReload_t* modelReload;
+  QMatrix4x4 bakedTransform;
+  // Moves, scales and rotations of a float model since the last frame,
+  // applied to _cubeVertices in one pass before the next one is drawn
+  QMatrix4x4 pendingTransform;
+  bool transformPending;
+  // How the loader mapped the file coordinates into the unit cube, so that
+  // exports can write them back, see getNormalization()
+  float modelOrigin[3];
+  float modelScale;
+  // Mouse drags orbit (left) or pan (right, middle or Shift + left) the
+  // camera and the wheel zooms it; the vertices are not touched. inputStart
+  // is the time of the oldest input not shown yet, -1 when there is none.
+  Camera_t camera;
+  QPoint lastMousePos;
+  QPoint pressPos;
+  double inputStart;
+  // Vertices and edges under the cursor are found in a bounding volume
+  // hierarchy over the float model, built on a worker thread (pickBuilder)
+  // after each load. Transforms are not refit: pickTransform holds those
+  // applied since the boxes were fit, and picks project the boxes through
+  // it. A build still reading the vertices when they change is cancelled
+  // and started again once the input stops (pickRebuild). hoverPick is
+  // highlighted in paintGL.
+  BvhBuilder_t* pickBuilder;
+  Bvh_t pickBvh;
+  QMatrix4x4 pickTransform;
+  bool pickRebuild;
+  BvhPick_t hoverPick;
+  // While input arrives, the governor lowers the quality level when frames
+  // take longer than targetFrameMs (S21_VIEWER_TARGET_FRAME_MS or the
+  // targetFrameMs setting). coarseIndices is the edge subset of the coarse
+  // levels and reducedTarget the framebuffer of the reduced resolution.
+  bool interacting;
+  QTimer* idleTimer;
+  double targetFrameMs;
+  QualityGovernor_t quality;
+  unsigned int* coarseIndices;
+  long long n_coarseIndices;
+  size_t coarseCapacity;
+  QOpenGLFramebufferObject* reducedTarget;
+  long long reducedTargetBytes;
+  // Indices or vertices per draw call, an even number for whole segments.
+  // Models with more are drawn in several calls, see drawLines().
+  long long drawBatch;
 };
 
 #endif  // GLWIDGET_H
@@ -0,0 +1,378 @@
+#include "half_edge.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define HALF_EDGE_GRAIN 16384
+// Buckets up to this size are insertion sorted
+#define HALF_EDGE_SMALL_BUCKET 32
+
+/*!
+ * \brief HalfEdgeContext_t
+ *
+ * State shared by the parallel passes. Half-edges are counting sorted into
+ * a bucket per smaller vertex of their edge, as entries holding the larger
+ * vertex above the half-edge id, and every bucket is then sorted, so the
+ * half-edges of an edge end up next to each other. cursors counts the
+ * bucket sizes, then hands out the slots, then counts the valences.
+ */
+typedef struct HalfEdgeContext_t {
+  const unsigned int* origin;
+  long n_half_edges;
+  atomic_uint* cursors;
+  uint32_t* starts;
+  uint64_t* entries;
+  unsigned int* twin;
+  unsigned int* valence;
+  atomic_llong n_edges;
+  atomic_llong n_boundary;
+  atomic_llong n_non_manifold;
+} HalfEdgeContext_t;
+
+long long halfEdgeNext(long long half_edge) {
+  return half_edge - half_edge % 3 + (half_edge % 3 + 1) % 3;
+}
+
+static void edgeVertices(const HalfEdgeContext_t* context, long half_edge,
+                         uint32_t* low, uint32_t* high) {
+  const uint32_t a = context->origin[half_edge];
+  const uint32_t b = context->origin[halfEdgeNext(half_edge)];
+  *low = a < b ? a : b;
+  *high = a < b ? b : a;
+}
+
+static void countBuckets(void* argument, long begin, long end) {
+  HalfEdgeContext_t* context = argument;
+  for (long h = begin; h < end; ++h) {
+    uint32_t low, high;
+    edgeVertices(context, h, &low, &high);
+    atomic_fetch_add_explicit(&context->cursors[low], 1, memory_order_relaxed);
+  }
+}
+
+// The order inside a bucket depends on scheduling until sortBucket().
+static void scatterBuckets(void* argument, long begin, long end) {
+  HalfEdgeContext_t* context = argument;
+  for (long h = begin; h < end; ++h) {
+    uint32_t low, high;
+    edgeVertices(context, h, &low, &high);
+    const uint32_t slot = atomic_fetch_add_explicit(&context->cursors[low], 1,
+                                                    memory_order_relaxed);
+    context->entries[slot] = (uint64_t)high << 32 | (uint32_t)h;
+  }
+}
+
+static int compareEntries(const void* a, const void* b) {
+  const uint64_t x = *(const uint64_t*)a;
+  const uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static void sortBucket(uint64_t* entries, uint32_t count) {
+  if (count > HALF_EDGE_SMALL_BUCKET) {
+    qsort(entries, count, sizeof(uint64_t), compareEntries);
+    return;
+  }
+  for (uint32_t i = 1; i < count; ++i) {
+    const uint64_t entry = entries[i];
+    uint32_t j = i;
+    for (; j > 0 && entries[j - 1] > entry; --j) entries[j] = entries[j - 1];
+    entries[j] = entry;
+  }
+}
+
+// Whether the half-edges of a run of one edge pair up as twins.
+static int isManifold(const HalfEdgeContext_t* context, const uint64_t* run,
+                      uint32_t count) {
+  return count == 2 && context->origin[(uint32_t)run[0]] !=
+                           context->origin[(uint32_t)run[1]];
+}
+
+/*!
+ * \brief pairBuckets
+ *
+ * Sorts the buckets of the vertices in the range by larger vertex and
+ * half-edge id, then links the half-edges of each edge.
+ */
+static void pairBuckets(void* argument, long begin, long end) {
+  HalfEdgeContext_t* context = argument;
+  long long edges = 0;
+  long long boundary = 0;
+  long long non_manifold = 0;
+  for (long v = begin; v < end; ++v) {
+    uint64_t* bucket = &context->entries[context->starts[v]];
+    const uint32_t size = context->starts[v + 1] - context->starts[v];
+    sortBucket(bucket, size);
+    uint32_t runs = 0;
+    for (uint32_t i = 0; i < size;) {
+      uint32_t j = i + 1;
+      while (j < size && bucket[j] >> 32 == bucket[i] >> 32) ++j;
+      const uint32_t first = (uint32_t)bucket[i];
+      if (j - i == 1) {
+        context->twin[first] = HALF_EDGE_BOUNDARY;
+        ++boundary;
+      } else if (isManifold(context, &bucket[i], j - i)) {
+        context->twin[first] = (uint32_t)bucket[i + 1];
+        context->twin[(uint32_t)bucket[i + 1]] = first;
+      } else {
+        for (uint32_t k = i; k < j; ++k) {
+          context->twin[(uint32_t)bucket[k]] = HALF_EDGE_NON_MANIFOLD;
+        }
+        ++non_manifold;
+      }
+      atomic_fetch_add_explicit(&context->cursors[bucket[i] >> 32], 1,
+                                memory_order_relaxed);
+      ++runs;
+      i = j;
+    }
+    atomic_fetch_add_explicit(&context->cursors[v], runs,
+                              memory_order_relaxed);
+    edges += runs;
+  }
+  atomic_fetch_add_explicit(&context->n_edges, edges, memory_order_relaxed);
+  atomic_fetch_add_explicit(&context->n_boundary, boundary,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&context->n_non_manifold, non_manifold,
+                            memory_order_relaxed);
+}
+
+static void copyValence(void* argument, long begin, long end) {
+  HalfEdgeContext_t* context = argument;
+  for (long v = begin; v < end; ++v) {
+    context->valence[v] =
+        atomic_load_explicit(&context->cursors[v], memory_order_relaxed);
+  }
+}
+
+// Lists the non-manifold edges by vertex, which is rarely needed.
+static void collectNonManifold(const HalfEdgeContext_t* context,
+                               long long n_vertices, unsigned int* pairs) {
+  long long listed = 0;
+  for (long long v = 0; v < n_vertices; ++v) {
+    const uint64_t* bucket = &context->entries[context->starts[v]];
+    const uint32_t size = context->starts[v + 1] - context->starts[v];
+    for (uint32_t i = 0; i < size;) {
+      uint32_t j = i + 1;
+      while (j < size && bucket[j] >> 32 == bucket[i] >> 32) ++j;
+      if (j - i > 1 && !isManifold(context, &bucket[i], j - i)) {
+        pairs[listed * 2] = (unsigned int)v;
+        pairs[listed * 2 + 1] = (unsigned int)(bucket[i] >> 32);
+        ++listed;
+      }
+      i = j;
+    }
+  }
+}
+
+/*!
+ * \brief gatherFaces
+ *
+ * Finds the triangles in the segments of a loader, which writes face a b c
+ * as the segments a-b, b-c and c-a one after another (the same pattern
+ * obj_export.c writes back as faces), and copies their vertices to origin.
+ * parseObjFile keeps the first three corners of a face, so a polygon of an
+ * OBJ file gives one triangle here, not a triangulation of it.
+ *
+ * \return Number of faces.
+ */
+static long long gatherFaces(const unsigned int* indices, long long n_indices,
+                             long long n_vertices, unsigned int* origin,
+                             HalfEdgeStats_t* stats) {
+  const long long n_segments = n_indices / 2;
+  long long faces = 0;
+  long long segment = 0;
+  while (segment < n_segments) {
+    const unsigned int* e = &indices[segment * 2];
+    if (segment + 3 <= n_segments && e[1] == e[2] && e[3] == e[4] &&
+        e[5] == e[0]) {
+      if (e[0] != e[2] && e[2] != e[4] && e[4] != e[0] &&
+          e[0] < n_vertices && e[2] < n_vertices && e[4] < n_vertices) {
+        origin[faces * 3] = e[0];
+        origin[faces * 3 + 1] = e[2];
+        origin[faces * 3 + 2] = e[4];
+        ++faces;
+      } else {
+        ++stats->skipped;
+      }
+      segment += 3;
+    } else {
+      ++stats->lines;
+      ++segment;
+    }
+  }
+  return faces;
+}
+
+static void freeContext(HalfEdgeContext_t* context, long long n_vertices) {
+  const size_t n = (size_t)n_vertices;
+  loaderFree(MEM_LOADER_TEMP, context->cursors, n * sizeof(atomic_uint));
+  loaderFree(MEM_LOADER_TEMP, context->starts, (n + 1) * sizeof(uint32_t));
+  loaderFree(MEM_LOADER_TEMP, context->entries,
+             (size_t)context->n_half_edges * sizeof(uint64_t));
+}
+
+/*!
+ * \brief halfEdgeBuild
+ *
+ * Builds the half-edges of the triangles among the segments of a loaded
+ * model. Edges are paired by sorting rather than through a hash map: a
+ * counting sort by the smaller vertex of each edge, then a sort of every
+ * bucket. Keys, both sorts, pairing and valences run on
+ * parallelThreadCount() threads, and the result does not depend on the
+ * thread count. Finding the triangles is one sequential pass, as a segment
+ * only belongs to a face given the segments before it.
+ *
+ * \param indices Segments as parseObjFile writes them, before reordering,
+ * which splits up the segments of a face.
+ * \param stats Filled with the counts, memory and time, may be NULL.
+ * \return 0 on success, -1 if memory could not be allocated or the vertices
+ * or half-edges do not fit 32-bit numbers, with an empty mesh then.
+ */
+int halfEdgeBuild(const unsigned int* indices, long long n_indices,
+                  long long n_vertices, HalfEdgeMesh_t* mesh,
+                  HalfEdgeStats_t* stats) {
+  HalfEdgeStats_t counts = {0};
+  memset(mesh, 0, sizeof(*mesh));
+  if (stats != NULL) *stats = counts;
+  if (n_vertices < 0 || n_vertices >= UINT32_MAX || n_indices < 0) return -1;
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+
+  const size_t most_faces = (size_t)(n_indices / 2 / 3);
+  const size_t origin_bytes = most_faces * 3 * sizeof(unsigned int);
+  mesh->origin = loaderAlloc(MEM_INDICES, origin_bytes);
+  if (mesh->origin == NULL && origin_bytes > 0) return -1;
+  mesh->n_faces =
+      gatherFaces(indices, n_indices, n_vertices, mesh->origin, &counts);
+  mesh->n_vertices = n_vertices;
+  const long long n_half_edges = mesh->n_faces * 3;
+  if (n_half_edges >= HALF_EDGE_NON_MANIFOLD) {
+    halfEdgeFree(mesh);
+    return -1;
+  }
+  mesh->origin = loaderShrink(MEM_INDICES, mesh->origin, origin_bytes,
+                              (size_t)n_half_edges * sizeof(unsigned int));
+
+  HalfEdgeContext_t context = {0};
+  context.origin = mesh->origin;
+  context.n_half_edges = (long)n_half_edges;
+  const size_t n = (size_t)n_half_edges;
+  const size_t n_v = (size_t)n_vertices;
+  mesh->twin = loaderAlloc(MEM_INDICES, n * sizeof(unsigned int));
+  mesh->valence = loaderAlloc(MEM_INDICES, n_v * sizeof(unsigned int));
+  context.cursors = loaderAlloc(MEM_LOADER_TEMP, n_v * sizeof(atomic_uint));
+  context.starts = loaderAlloc(MEM_LOADER_TEMP, (n_v + 1) * sizeof(uint32_t));
+  context.entries = loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint64_t));
+  const int missing_edges = mesh->twin == NULL || context.entries == NULL;
+  const int missing_vertices =
+      mesh->valence == NULL || context.cursors == NULL;
+  if (context.starts == NULL || (n > 0 && missing_edges) ||
+      (n_v > 0 && missing_vertices)) {
+    freeContext(&context, n_vertices);
+    halfEdgeFree(mesh);
+    return -1;
+  }
+
+  for (size_t v = 0; v < n_v; ++v) atomic_init(&context.cursors[v], 0);
+  atomic_init(&context.n_edges, 0);
+  atomic_init(&context.n_boundary, 0);
+  atomic_init(&context.n_non_manifold, 0);
+  context.twin = mesh->twin;
+  context.valence = mesh->valence;
+  parallelFor((long)n, HALF_EDGE_GRAIN, countBuckets, &context);
+  uint32_t offset = 0;
+  for (size_t v = 0; v < n_v; ++v) {
+    context.starts[v] = offset;
+    offset += atomic_load_explicit(&context.cursors[v], memory_order_relaxed);
+    atomic_store_explicit(&context.cursors[v], context.starts[v],
+                          memory_order_relaxed);
+  }
+  context.starts[n_v] = offset;
+  parallelFor((long)n, HALF_EDGE_GRAIN, scatterBuckets, &context);
+  for (size_t v = 0; v < n_v; ++v) {
+    atomic_store_explicit(&context.cursors[v], 0, memory_order_relaxed);
+  }
+  parallelFor((long)n_v, HALF_EDGE_GRAIN, pairBuckets, &context);
+  parallelFor((long)n_v, HALF_EDGE_GRAIN, copyValence, &context);
+  mesh->n_edges = atomic_load(&context.n_edges);
+  mesh->n_boundary = atomic_load(&context.n_boundary);
+  mesh->n_non_manifold = atomic_load(&context.n_non_manifold);
+  if (mesh->n_non_manifold > 0) {
+    mesh->non_manifold = loaderAlloc(
+        MEM_INDICES, (size_t)mesh->n_non_manifold * 2 * sizeof(unsigned int));
+    if (mesh->non_manifold != NULL) {
+      collectNonManifold(&context, n_vertices, mesh->non_manifold);
+    } else {
+      mesh->n_non_manifold = 0;
+    }
+  }
+  freeContext(&context, n_vertices);
+
+  stageTimerRecord(STAGE_HALF_EDGE, start, mesh->n_faces);
+  TRACE_END(span, "halfEdgeBuild");
+  if (stats != NULL) {
+    counts.faces = mesh->n_faces;
+    counts.bytes = halfEdgeBytes(mesh);
+    const long long temporaries =
+        (long long)(n * sizeof(uint64_t) +
+                    n_v * (sizeof(atomic_uint) + sizeof(uint32_t)));
+    const long long most = counts.bytes + temporaries;
+    counts.peak_bytes =
+        most > (long long)origin_bytes ? most : (long long)origin_bytes;
+    counts.elapsed_ns = stageTimerNow() - start;
+    *stats = counts;
+  }
+  return 0;
+}
+
+void halfEdgeFree(HalfEdgeMesh_t* mesh) {
+  const size_t n = (size_t)mesh->n_faces * 3;
+  loaderFree(MEM_INDICES, mesh->origin, n * sizeof(unsigned int));
+  loaderFree(MEM_INDICES, mesh->twin, n * sizeof(unsigned int));
+  loaderFree(MEM_INDICES, mesh->valence,
+             (size_t)mesh->n_vertices * sizeof(unsigned int));
+  loaderFree(MEM_INDICES, mesh->non_manifold,
+             (size_t)mesh->n_non_manifold * 2 * sizeof(unsigned int));
+  memset(mesh, 0, sizeof(*mesh));
+}
+
+/*!
+ * \brief halfEdgeBytes
+ *
+ * \return Memory the mesh keeps, in bytes.
+ */
+long long halfEdgeBytes(const HalfEdgeMesh_t* mesh) {
+  return (mesh->n_faces * 3 * 2 + mesh->n_vertices + mesh->n_non_manifold * 2) *
+         (long long)sizeof(unsigned int);
+}
+
+/*!
+ * \brief halfEdgeBoundaryEdges
+ *
+ * Writes the two vertices of up to max_edges boundary edges to pairs, in
+ * the direction their face runs them, so consecutive boundary edges of a
+ * hole chain up.
+ *
+ * \param pairs May be NULL to count only.
+ * \return Number of boundary edges, including those past max_edges.
+ */
+long long halfEdgeBoundaryEdges(const HalfEdgeMesh_t* mesh,
+                                unsigned int* pairs, long long max_edges) {
+  long long found = 0;
+  for (long long h = 0; h < mesh->n_faces * 3; ++h) {
+    if (mesh->twin[h] != HALF_EDGE_BOUNDARY) continue;
+    if (pairs != NULL && found < max_edges) {
+      pairs[found * 2] = mesh->origin[h];
+      pairs[found * 2 + 1] = mesh->origin[halfEdgeNext(h)];
+    }
+    ++found;
+  }
+  return found;
+}
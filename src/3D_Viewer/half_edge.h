@@ -0,0 +1,65 @@
+#ifndef HALF_EDGE_H
+#define HALF_EDGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Twins of half-edges without a neighbouring face
+#define HALF_EDGE_BOUNDARY 0xffffffffu
+#define HALF_EDGE_NON_MANIFOLD 0xfffffffeu
+
+/*!
+ * \brief HalfEdgeMesh_t
+ *
+ * Adjacency of the triangles of a model, in the order of its file. Face f
+ * owns half-edges 3f, 3f + 1 and 3f + 2; half-edge h runs from origin[h] to
+ * the origin of halfEdgeNext(h). twin[h] is the half-edge running the other
+ * way on the neighbouring face, HALF_EDGE_BOUNDARY when no other face has
+ * the edge and HALF_EDGE_NON_MANIFOLD when it has more than two faces or two
+ * faces that run it the same way. valence[v] counts the distinct face edges
+ * at vertex v, and non_manifold holds the two vertices of each non-manifold
+ * edge.
+ */
+typedef struct HalfEdgeMesh_t {
+  unsigned int* origin;
+  unsigned int* twin;
+  unsigned int* valence;
+  unsigned int* non_manifold;
+  long long n_faces;
+  long long n_vertices;
+  long long n_edges;
+  long long n_boundary;
+  long long n_non_manifold;
+} HalfEdgeMesh_t;
+
+/*!
+ * \brief HalfEdgeStats_t
+ *
+ * Result of a build. lines counts the segments that are not part of a
+ * triangle and skipped the triangles with a repeated or out of range
+ * vertex, both left out of the mesh. peak_bytes includes the temporaries.
+ */
+typedef struct HalfEdgeStats_t {
+  long long faces;
+  long long lines;
+  long long skipped;
+  long long bytes;
+  long long peak_bytes;
+  double elapsed_ns;
+} HalfEdgeStats_t;
+
+int halfEdgeBuild(const unsigned int* indices, long long n_indices,
+                  long long n_vertices, HalfEdgeMesh_t* mesh,
+                  HalfEdgeStats_t* stats);
+void halfEdgeFree(HalfEdgeMesh_t* mesh);
+long long halfEdgeBytes(const HalfEdgeMesh_t* mesh);
+long long halfEdgeNext(long long half_edge);
+long long halfEdgeBoundaryEdges(const HalfEdgeMesh_t* mesh,
+                                unsigned int* pairs, long long max_edges);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HALF_EDGE_H
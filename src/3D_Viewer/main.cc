@@ -1,12 +1,26 @@
 #include <QApplication>
 #include <QDebug>
+#include <QSurfaceFormat>
 #include <QtGlobal>
 
+#include "cpu_dispatch.h"
 #include "mainwindow.h"
+#include "trace.h"
 
 int main(int argc, char *argv[]) {
+  traceInitFromEnvironment();
+  traceSetThreadName("GUI");
+  // Binds the vertex kernels before any thread can use them
+  cpuSetLevel(-1);
+  // Present at most one frame per vertical sync, mouse input is drawn at
+  // the display refresh rate
+  QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+  format.setSwapInterval(1);
+  QSurfaceFormat::setDefaultFormat(format);
   QApplication a(argc, argv);
   MainWindow w;
   w.show();
+  // A model given on the command line, "-" reads it from the standard input
+  if (argc > 1) w.loadModel(QString::fromLocal8Bit(argv[1]));
   return a.exec();
 }
@@ -20,11 +20,20 @@
  * \b Ctrl + NUM 2 \b - Rotate model down \n
  * \b Ctrl + NUM 1 \b - Rotate model clockwise \n
  * \b Ctrl + NUM 9 \b - Rotate model couterclowise \n
+ * \b Ctrl + Shift + T \b - Start trace recording / save the trace \n
  */
 
 #include "mainwindow.h"
 
+#include <QMessageBox>
+#include <QVector>
+
 #include "glwidget.h"
+#include "memory_stats.h"
+#include "mesh_loader.h"
+#include "parallel.h"
+#include "quality.h"
+#include "trace.h"
 #include "ui_mainwindow.h"
 /*!
  * \brief MainWindow::MainWindow
@@ -42,12 +51,37 @@ MainWindow::MainWindow(QWidget *parent)
     glWidget->filenameLabel = ui->filenameLabel;
   }
   connect(glWidget, &GLWidget::modelLoaded, this, &MainWindow::onModelLoaded);
+  connect(glWidget, &GLWidget::modelLoadFailed, this,
+          &MainWindow::onModelLoadFailed);
   numVerticesLabel = ui->numVerticesLabel;
   numEdgesLabel = ui->numEdgesLabel;
+  memoryLabel = ui->memoryLabel;
+  qualityLabel = ui->qualityLabel;
+  connect(glWidget, &GLWidget::qualityChanged, this,
+          &MainWindow::onQualityChanged);
+  onQualityChanged(QUALITY_FULL);
+  connect(glWidget, &GLWidget::picked, ui->pickLabel, &QLabel::setText);
+  ui->weldVerticesCheckBox->setChecked(glWidget->isWeldingEnabled());
+  ui->reorderVerticesCheckBox->setChecked(glWidget->isReorderingEnabled());
+  ui->compactGeometryCheckBox->setChecked(
+      glWidget->isCompactGeometryEnabled());
+  ui->outOfCoreCheckBox->setChecked(glWidget->isOutOfCoreEnabled());
+  ui->watchFileCheckBox->setChecked(glWidget->isWatchingEnabled());
+  ui->topologyCheckBox->setChecked(glWidget->isTopologyEnabled());
   screencastTimer = new QTimer(this);
   screencastFrameCount = 0;
+  screencastFramesBytes = 0;
   connect(screencastTimer, &QTimer::timeout, this,
           &MainWindow::captureScreencastFrame);
+  QShortcut *traceShortcut =
+      new QShortcut(QKeySequence(tr("Ctrl+Shift+T")), this);
+  connect(traceShortcut, &QShortcut::activated, this,
+          &MainWindow::toggleTraceRecording);
+  // The process RSS changes without model events, so sample it every second
+  memoryTimer = new QTimer(this);
+  connect(memoryTimer, &QTimer::timeout, this, &MainWindow::updateMemoryLabel);
+  memoryTimer->start(1000);
+  updateMemoryLabel();
 }
 /*!
  * \brief MainWindow::~MainWindow
@@ -63,20 +97,46 @@ void MainWindow::on_QuitButton_clicked() { close(); }
 /*!
  * \brief MainWindow::on_loadModelFileButton_clicked
  * Function is used to load the file using the QFileDialog to open the file
- * dialog. All .obj files are displayed. Absolute path is loaded.
+ * dialog. Files of every registered format (OBJ, PLY, STL) are displayed.
+ * Absolute path is loaded.
  */
 void MainWindow::on_loadModelFileButton_clicked() {
-  QString fileFilter = "OBJ Files (*.obj);;All Files (*)";
+  // One entry per registered format, after one for all of them
+  QStringList formats;
+  QStringList patterns;
+  for (int i = 0; i < meshLoaderCount(); ++i) {
+    const MeshLoader_t* loader = meshLoaderAt(i);
+    QStringList extensions;
+    for (const QString& extension : QString(loader->extensions).split(' ')) {
+      if (!extension.isEmpty()) extensions << "*." + extension;
+    }
+    patterns << extensions;
+    formats << QString("%1 (%2)").arg(loader->name, extensions.join(' '));
+  }
+  QString fileFilter = QString("Models (%1);;%2;;All Files (*)")
+                           .arg(patterns.join(' '), formats.join(";;"));
   QString fileName =
       QFileDialog::getOpenFileName(this, tr("Load Model File"), "", fileFilter);
 
   if (!fileName.isEmpty()) {
     qDebug() << "Selected file:" << fileName;
-    QFileInfo fileInfo(fileName);
-    QString absoluteFilePath = fileInfo.absoluteFilePath();
-    qDebug() << "Absolute file path:" << absoluteFilePath;
-    glWidget->loadModel(absoluteFilePath);
+    loadModel(fileName);
+  }
+}
+/*!
+ * \brief MainWindow::loadModel
+ * Loads a model by its absolute path, or from the standard input if
+ * fileName is "-".
+ */
+void MainWindow::loadModel(const QString &fileName) {
+  if (fileName == "-") {
+    glWidget->loadModel(fileName);
+    return;
   }
+  QFileInfo fileInfo(fileName);
+  QString absoluteFilePath = fileInfo.absoluteFilePath();
+  qDebug() << "Absolute file path:" << absoluteFilePath;
+  glWidget->loadModel(absoluteFilePath);
 }
 /*!
  * \brief MainWindow::on_changeBGColorButton_clicked
@@ -212,9 +272,33 @@ void MainWindow::on_circleDisplayMethodButton_clicked() {
   glWidget->setVertexDisplayMethod(GLWidget::Circle);
 }
 
-void MainWindow::onModelLoaded(int numVertices, int numEdges) {
+void MainWindow::onModelLoaded(qint64 numVertices, qint64 numEdges) {
   numVerticesLabel->setText(QString("Vertices: %1").arg(numVertices));
   numEdgesLabel->setText(QString("Edges: %1").arg(numEdges));
+  // The picked vertex or edge may be gone
+  ui->pickLabel->clear();
+  updateMemoryLabel();
+}
+
+/*!
+ * \brief MainWindow::onModelLoadFailed
+ *
+ * Shows why a model could not be loaded, with the line and byte offset of
+ * the file when one is to blame.
+ */
+void MainWindow::onModelLoadFailed(const QString &message) {
+  QMessageBox::warning(this, tr("Load Model"), message);
+}
+
+/*!
+ * \brief MainWindow::onQualityChanged
+ *
+ * Shows the quality level the model is drawn at, see GLWidget.
+ */
+void MainWindow::onQualityChanged(int level) {
+  qualityLabel->setText(
+      QString("Quality: %1")
+          .arg(qualityLevelName(static_cast<QualityLevel_t>(level))));
 }
 
 void MainWindow::on_screenshotButton_clicked() {
@@ -238,6 +322,25 @@ void MainWindow::on_screenshotButton_clicked() {
     screenshot.save(fileName);
   }
 }
+// Frames to write as PNG images and whether each one was written
+struct ScreencastSave {
+  const QList<QImage> *frames;
+  QVector<char> saved;
+};
+
+static QString screencastFrameName(int index) {
+  return QString("screencast_frame_%1.png").arg(index, 3, 10, QChar('0'));
+}
+
+static void saveScreencastFrames(void *context, long begin, long end) {
+  ScreencastSave *save = static_cast<ScreencastSave *>(context);
+  for (long i = begin; i < end; ++i) {
+    const int index = static_cast<int>(i);
+    const QImage &frame = save->frames->at(index);
+    save->saved[index] = frame.save(screencastFrameName(index));
+  }
+}
+
 /*!
  * \brief MainWindow::on_screencastButton_clicked
  *
@@ -250,7 +353,7 @@ void MainWindow::on_screencastButton_clicked() {
   if (!screencastTimer->isActive()) {
     // Start recording
     screencastFrameCount = 0;
-    screencastFrames.clear();
+    clearScreencastFrames();
     screencastTimer->start(100);  // Capture every 100 ms
     ui->screencastButton->setText("Stop Recording");
   } else {
@@ -258,15 +361,24 @@ void MainWindow::on_screencastButton_clicked() {
     screencastTimer->stop();
     // Save the frames as PNG images
     QStringList imageFilenames;
-    for (int i = 0; i < screencastFrames.count(); ++i) {
-      const QImage &frame = screencastFrames.at(i);
-      QString fileName =
-          QString("screencast_frame_%1.png").arg(i, 3, 10, QChar('0'));
-      if (!frame.save(fileName)) {
-        qDebug() << "Error saving frame:" << fileName;
-        break;
+    {
+      TraceScope trace("MainWindow::saveScreencastFrames");
+      // PNG encoding is the slow part, so frames are saved on the shared
+      // thread pool; the GIF still gets the frames before the first failure
+      ScreencastSave save = {&screencastFrames,
+                             QVector<char>(screencastFrames.count(), 0)};
+      parallelFor(screencastFrames.count(), 1, saveScreencastFrames, &save);
+      int failed = -1;
+      for (int i = 0; i < screencastFrames.count(); ++i) {
+        if (failed >= 0) {
+          if (save.saved[i]) QFile::remove(screencastFrameName(i));
+        } else if (!save.saved[i]) {
+          qDebug() << "Error saving frame:" << screencastFrameName(i);
+          failed = i;
+        } else {
+          imageFilenames << screencastFrameName(i);
+        }
       }
-      imageFilenames << fileName;
     }
 
     // Open the file picker for saving the GIF
@@ -285,7 +397,7 @@ void MainWindow::on_screencastButton_clicked() {
       // Create a GIF from the saved PNG images
       createGifFromImages(fileName, imageFilenames, 10);
     }
-    screencastFrames.clear();
+    clearScreencastFrames();
     ui->screencastButton->setText("Start Recording");
     // Delete the saved PNG images
     for (const QString &filename : imageFilenames) {
@@ -301,10 +413,13 @@ void MainWindow::on_screencastButton_clicked() {
  * reaches 50 (5 seconds at 10 fps).
  */
 void MainWindow::captureScreencastFrame() {
+  TraceScope trace("MainWindow::captureScreencastFrame");
   QImage frame = glWidget->grabFramebuffer();
   QImage scaledFrame = frame.scaled(640, 480, Qt::KeepAspectRatio);
 
   screencastFrames.append(scaledFrame);
+  screencastFramesBytes += scaledFrame.sizeInBytes();
+  memAccountAdd(MEM_CAPTURE_FRAMES, scaledFrame.sizeInBytes());
   screencastFrameCount++;
   // 5 seconds at 10 fps
   if (screencastFrameCount >= 50) {
@@ -385,3 +500,156 @@ void MainWindow::on_zRotateDoubleSpinBox_editingFinished() {
   double value = ui->zRotateDoubleSpinBox->value();
   glWidget->rotateModel(0.0f, 0.0f, value);
 }
+/*!
+ * \brief MainWindow::toggleTraceRecording
+ *
+ * The first press starts recording trace spans, the second one stops it and
+ * asks where to save them as Chrome trace-event JSON (chrome://tracing or
+ * https://ui.perfetto.dev).
+ */
+void MainWindow::toggleTraceRecording() {
+  if (!trace_enabled) {
+    traceEnable(1);
+    qDebug() << "Trace recording started";
+    return;
+  }
+  traceEnable(0);
+  QString fileName = QFileDialog::getSaveFileName(
+      this, tr("Save Trace"), "trace.json", "JSON Files (*.json)");
+  if (!fileName.isEmpty()) {
+    QByteArray path = fileName.toLocal8Bit();
+    if (traceDump(path.constData()) != 0) {
+      qDebug() << "Error saving trace:" << fileName;
+    }
+  }
+}
+/*!
+ * \brief MainWindow::clearScreencastFrames
+ *
+ * Drops the captured frames and removes them from the memory accounting.
+ */
+void MainWindow::clearScreencastFrames() {
+  screencastFrames.clear();
+  memAccountRelease(MEM_CAPTURE_FRAMES, screencastFramesBytes);
+  screencastFramesBytes = 0;
+}
+/*!
+ * \brief MainWindow::updateMemoryLabel
+ *
+ * Shows the accounted live and peak bytes of model buffers, capture frames
+ * and caches next to the vertex and edge counts, and the process RSS. The
+ * tooltip breaks the accounted memory down by category and shows the
+ * counters of the model cache.
+ */
+void MainWindow::updateMemoryLabel() {
+  auto megabytes = [](long long bytes) {
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+  };
+  memoryLabel->setText(
+      QString("Memory: %1 MB (peak %2) | RSS: %3 MB (peak %4)")
+          .arg(megabytes(memAccountTotalLive()))
+          .arg(megabytes(memAccountTotalPeak()))
+          .arg(megabytes(memProcessRss()))
+          .arg(megabytes(memProcessPeakRss())));
+  QStringList lines;
+  for (int i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+    MemCategoryStats_t stats;
+    memAccountGet(static_cast<MemCategory_t>(i), &stats);
+    lines << QString("%1: %2 MB live, %3 MB peak")
+                 .arg(stats.name)
+                 .arg(megabytes(stats.live_bytes))
+                 .arg(megabytes(stats.peak_bytes));
+  }
+  ModelCacheStats_t cache;
+  glWidget->modelCacheStats(&cache);
+  lines << QString("Model cache: %1 of %2 models, %3 of %4 MB, %5 hits, "
+                   "%6 misses, %7 evictions")
+               .arg(cache.entries)
+               .arg(cache.max_entries)
+               .arg(megabytes(cache.bytes))
+               .arg(megabytes(cache.budget_bytes))
+               .arg(cache.hits)
+               .arg(cache.misses)
+               .arg(cache.evictions);
+  ParallelStats_t pool;
+  parallelGetStats(&pool);
+  lines << QString("Thread pool: %1 threads, %2% busy, %3 loops, %4 tasks, "
+                   "%5 steals, %6 cancelled")
+               .arg(pool.threads)
+               .arg(pool.utilization * 100.0, 0, 'f', 1)
+               .arg(pool.loops)
+               .arg(pool.tasks)
+               .arg(pool.steals)
+               .arg(pool.cancelled);
+  memoryLabel->setToolTip(lines.join("\n"));
+}
+/*!
+ * \brief MainWindow::on_weldVerticesCheckBox_toggled
+ *
+ * Turns welding of duplicate vertices on or off for the next loaded model.
+ */
+void MainWindow::on_weldVerticesCheckBox_toggled(bool checked) {
+  glWidget->setWelding(checked);
+}
+/*!
+ * \brief MainWindow::on_reorderVerticesCheckBox_toggled
+ *
+ * Turns the memory locality reordering on or off for the next loaded model.
+ */
+void MainWindow::on_reorderVerticesCheckBox_toggled(bool checked) {
+  glWidget->setReordering(checked);
+}
+/*!
+ * \brief MainWindow::on_compactGeometryCheckBox_toggled
+ *
+ * Turns 16-bit compact storage on or off for the next loaded model.
+ */
+void MainWindow::on_compactGeometryCheckBox_toggled(bool checked) {
+  glWidget->setCompactGeometry(checked);
+}
+/*!
+ * \brief MainWindow::on_outOfCoreCheckBox_toggled
+ *
+ * Turns out-of-core viewing on or off for the next loaded model.
+ */
+void MainWindow::on_outOfCoreCheckBox_toggled(bool checked) {
+  glWidget->setOutOfCore(checked);
+}
+/*!
+ * \brief MainWindow::on_watchFileCheckBox_toggled
+ *
+ * Turns reloading the model when its file changes on or off.
+ */
+void MainWindow::on_watchFileCheckBox_toggled(bool checked) {
+  glWidget->setWatching(checked);
+}
+/*!
+ * \brief MainWindow::on_topologyCheckBox_toggled
+ *
+ * Turns building the half-edges on or off for the next loaded model.
+ */
+void MainWindow::on_topologyCheckBox_toggled(bool checked) {
+  glWidget->setTopology(checked);
+}
+/*!
+ * \brief MainWindow::on_exportModelButton_clicked
+ *
+ * Asks where to save the model as an OBJ file and whether to write it in the
+ * coordinates of the loaded file instead of the normalized ones.
+ */
+void MainWindow::on_exportModelButton_clicked() {
+  QString fileName = QFileDialog::getSaveFileName(
+      this, tr("Export Model"), "", "OBJ Files (*.obj)");
+  if (fileName.isEmpty()) return;
+  if (QFileInfo(fileName).suffix().toLower() != "obj") {
+    fileName += ".obj";
+  }
+  const bool fileCoordinates =
+      QMessageBox::question(
+          this, tr("Export Model"),
+          tr("Write the vertices in the coordinates of the loaded file?")) ==
+      QMessageBox::Yes;
+  if (!glWidget->exportModel(fileName, fileCoordinates)) {
+    qDebug() << "Error exporting model:" << fileName;
+  }
+}
@@ -25,6 +25,7 @@ class MainWindow : public QMainWindow {
  public:
   MainWindow(QWidget *parent = nullptr);
   ~MainWindow();
+  void loadModel(const QString &fileName);
 
  private slots:
   void on_QuitButton_clicked();
@@ -63,7 +64,8 @@ class MainWindow : public QMainWindow {
   void on_squareDisplayMethodButton_clicked();
   void on_circleDisplayMethodButton_clicked();
 
-  void onModelLoaded(int numVertices, int numEdges);
+  void onModelLoaded(qint64 numVertices, qint64 numEdges);
+  void onModelLoadFailed(const QString &message);
 
   void on_screenshotButton_clicked();
   void on_screencastButton_clicked();
@@ -81,14 +83,30 @@ class MainWindow : public QMainWindow {
   void on_yRotateDoubleSpinBox_editingFinished();
   void on_zRotateDoubleSpinBox_editingFinished();
 
+  void toggleTraceRecording();
+  void on_weldVerticesCheckBox_toggled(bool checked);
+  void on_reorderVerticesCheckBox_toggled(bool checked);
+  void on_compactGeometryCheckBox_toggled(bool checked);
+  void on_outOfCoreCheckBox_toggled(bool checked);
+  void on_watchFileCheckBox_toggled(bool checked);
+  void on_topologyCheckBox_toggled(bool checked);
+  void on_exportModelButton_clicked();
+  void updateMemoryLabel();
+  void onQualityChanged(int level);
+
  private:
   Ui::MainWindow *ui;
   GLWidget *glWidget;
   QLabel *numVerticesLabel;
   QLabel *numEdgesLabel;
+  QLabel *memoryLabel;
+  QLabel *qualityLabel;
+  QTimer *memoryTimer;
   // Variables for screencast
   QTimer *screencastTimer;
   int screencastFrameCount;
   QList<QImage> screencastFrames;
+  qint64 screencastFramesBytes;
+  void clearScreencastFrames();
 };
 #endif  // MAINWINDOW_H
@@ -0,0 +1,142 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "memory_stats.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+typedef struct MemCounter_t {
+  atomic_llong live;
+  atomic_llong peak;
+  atomic_llong allocations;
+} MemCounter_t;
+
+static MemCounter_t mem_counters[MEM_CATEGORY_COUNT];
+static atomic_llong mem_total_live;
+static atomic_llong mem_total_peak;
+
+static const char* const kCategoryNames[MEM_CATEGORY_COUNT] = {
+    "vertices", "indices", "gpu", "capture", "caches", "loader"};
+
+static void raisePeak(atomic_llong* peak, long long value) {
+  long long current = atomic_load_explicit(peak, memory_order_relaxed);
+  while (value > current &&
+         !atomic_compare_exchange_weak_explicit(peak, &current, value,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+/*!
+ * \brief memAccountAdd
+ *
+ * Adds bytes to the live size of a category and updates its peak and the
+ * peak of all categories together. Safe to call from any thread.
+ */
+void memAccountAdd(MemCategory_t category, long long bytes) {
+  if ((unsigned)category >= MEM_CATEGORY_COUNT || bytes == 0) return;
+  MemCounter_t* counter = &mem_counters[category];
+  const long long live = atomic_fetch_add(&counter->live, bytes) + bytes;
+  const long long total = atomic_fetch_add(&mem_total_live, bytes) + bytes;
+  if (bytes > 0) {
+    atomic_fetch_add(&counter->allocations, 1);
+    raisePeak(&counter->peak, live);
+    raisePeak(&mem_total_peak, total);
+  }
+}
+
+void memAccountRelease(MemCategory_t category, long long bytes) {
+  memAccountAdd(category, -bytes);
+}
+
+void* memAccountMalloc(MemCategory_t category, size_t bytes) {
+  void* pointer = malloc(bytes);
+  if (pointer != NULL) memAccountAdd(category, (long long)bytes);
+  return pointer;
+}
+
+/*!
+ * \brief memAccountFree
+ *
+ * Frees memory from memAccountMalloc. bytes must be the size it was
+ * allocated with; NULL is ignored.
+ */
+void memAccountFree(MemCategory_t category, void* pointer, size_t bytes) {
+  if (pointer == NULL) return;
+  free(pointer);
+  memAccountRelease(category, (long long)bytes);
+}
+
+void memAccountGet(MemCategory_t category, MemCategoryStats_t* stats) {
+  if ((unsigned)category >= MEM_CATEGORY_COUNT) return;
+  MemCounter_t* counter = &mem_counters[category];
+  stats->name = kCategoryNames[category];
+  stats->live_bytes = atomic_load(&counter->live);
+  stats->peak_bytes = atomic_load(&counter->peak);
+  stats->allocations = atomic_load(&counter->allocations);
+}
+
+long long memAccountTotalLive(void) { return atomic_load(&mem_total_live); }
+
+long long memAccountTotalPeak(void) { return atomic_load(&mem_total_peak); }
+
+/*!
+ * \brief memAccountResetPeaks
+ *
+ * Lowers every peak to the current live size, e.g. before measuring a load.
+ */
+void memAccountResetPeaks(void) {
+  for (int i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+    atomic_store(&mem_counters[i].peak, atomic_load(&mem_counters[i].live));
+  }
+  atomic_store(&mem_total_peak, atomic_load(&mem_total_live));
+}
+
+/*!
+ * \brief memProcessRss
+ *
+ * \return Resident set size of the process in bytes, -1 if unavailable.
+ */
+long long memProcessRss(void) {
+#if defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info,
+                &count) != KERN_SUCCESS) {
+    return -1;
+  }
+  return (long long)info.resident_size;
+#else
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (file == NULL) return -1;
+  long long pages_total = 0;
+  long long pages_resident = 0;
+  const int read = fscanf(file, "%lld %lld", &pages_total, &pages_resident);
+  fclose(file);
+  if (read != 2) return -1;
+  return pages_resident * (long long)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/*!
+ * \brief memProcessPeakRss
+ *
+ * \return Highest resident set size of the process in bytes, -1 if
+ * unavailable.
+ */
+long long memProcessPeakRss(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#if defined(__APPLE__)
+  return (long long)usage.ru_maxrss;
+#else
+  return (long long)usage.ru_maxrss * 1024;
+#endif
+}
@@ -0,0 +1,50 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief MemCategory_t
+ *
+ * What an accounted allocation holds. Loader temporaries are buffers that
+ * only live while a file is being parsed, like the my_getline line buffer.
+ */
+typedef enum MemCategory_t {
+  MEM_VERTICES,
+  MEM_INDICES,
+  MEM_GPU_BUFFERS,
+  MEM_CAPTURE_FRAMES,
+  MEM_CACHES,
+  MEM_LOADER_TEMP,
+  MEM_CATEGORY_COUNT
+} MemCategory_t;
+
+typedef struct MemCategoryStats_t {
+  const char* name;
+  long long live_bytes;
+  long long peak_bytes;
+  long long allocations;
+} MemCategoryStats_t;
+
+void memAccountAdd(MemCategory_t category, long long bytes);
+void memAccountRelease(MemCategory_t category, long long bytes);
+void* memAccountMalloc(MemCategory_t category, size_t bytes);
+void memAccountFree(MemCategory_t category, void* pointer, size_t bytes);
+
+void memAccountGet(MemCategory_t category, MemCategoryStats_t* stats);
+long long memAccountTotalLive(void);
+long long memAccountTotalPeak(void);
+void memAccountResetPeaks(void);
+
+long long memProcessRss(void);
+long long memProcessPeakRss(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MEMORY_STATS_H
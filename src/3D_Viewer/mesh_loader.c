@@ -0,0 +1,778 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "mesh_loader.h"
+
+#include <fcntl.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "backend.h"
+#include "cpu_dispatch.h"
+#include "memory_stats.h"
+#include "obj_stream.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define PLY_MAX_HEADER_BYTES 65536
+#define PLY_MAX_ELEMENTS 16
+#define PLY_MAX_PROPERTIES 32
+#define PLY_NAME_SIZE 32
+#define STL_HEADER_BYTES 84
+#define STL_TRIANGLE_BYTES 50
+
+// Searched from the end, so a registered loader takes precedence over the
+// built-in one for the same extension
+static MeshLoader_t loaders[MESH_LOADER_MAX] = {
+    {"Wavefront OBJ", "obj", NULL, 0, meshLoadObj},
+    {"Binary PLY", "ply", "ply", 3, meshLoadPly},
+    {"Binary STL", "stl", NULL, 0, meshLoadStl},
+};
+static int n_loaders = 3;
+
+/*!
+ * \brief meshLoaderRegister
+ *
+ * Adds a file format. The strings of the loader are not copied and must
+ * outlive the registry.
+ *
+ * \return 0 on success, -1 if the registry is full or the loader invalid.
+ */
+int meshLoaderRegister(const MeshLoader_t* loader) {
+  if (n_loaders == MESH_LOADER_MAX || loader->load == NULL ||
+      loader->extensions == NULL || loader->magic_size < 0 ||
+      loader->magic_size > MESH_LOADER_MAGIC_BYTES) {
+    return -1;
+  }
+  loaders[n_loaders++] = *loader;
+  return 0;
+}
+
+int meshLoaderCount(void) { return n_loaders; }
+
+const MeshLoader_t* meshLoaderAt(int index) {
+  return index >= 0 && index < n_loaders ? &loaders[index] : NULL;
+}
+
+static int hasExtension(const char* extensions, const char* extension) {
+  const size_t length = strlen(extension);
+  const char* start = extensions;
+  while (*start != '\0') {
+    const char* end = strchr(start, ' ');
+    if (end == NULL) end = start + strlen(start);
+    if ((size_t)(end - start) == length &&
+        strncasecmp(start, extension, length) == 0) {
+      return 1;
+    }
+    start = *end == ' ' ? end + 1 : end;
+  }
+  return 0;
+}
+
+/*!
+ * \brief meshLoaderFind
+ *
+ * Chooses the loader of a file: the one whose magic starts the file, else
+ * the one registered for its extension. Pipes and the standard input ("-")
+ * are read as OBJ text, their first bytes cannot be looked at without
+ * taking them from the parser.
+ *
+ * \return The loader, or NULL if the format is unknown.
+ */
+const MeshLoader_t* meshLoaderFind(const char* path) {
+  if (objStreamIsPipe(path)) return &loaders[0];
+  unsigned char head[MESH_LOADER_MAGIC_BYTES];
+  size_t n_head = 0;
+  FILE* file = fopen(path, "rb");
+  if (file != NULL) {
+    n_head = fread(head, 1, sizeof(head), file);
+    fclose(file);
+  }
+  for (int i = n_loaders - 1; i >= 0; --i) {
+    const MeshLoader_t* loader = &loaders[i];
+    if (loader->magic != NULL && loader->magic_size > 0 &&
+        (size_t)loader->magic_size <= n_head &&
+        memcmp(head, loader->magic, loader->magic_size) == 0) {
+      return loader;
+    }
+  }
+  const char* dot = strrchr(path, '.');
+  const char* slash = strrchr(path, '/');
+  if (dot == NULL || (slash != NULL && dot < slash)) return NULL;
+  for (int i = n_loaders - 1; i >= 0; --i) {
+    if (hasExtension(loaders[i].extensions, dot + 1)) return &loaders[i];
+  }
+  return NULL;
+}
+
+/*!
+ * \brief meshLoad
+ *
+ * Loads a model with the loader meshLoaderFind() chooses for it.
+ *
+ * \return 0 on success, -1 if the format is unknown or the file could not
+ * be read.
+ */
+int meshLoad(const char* path, float** vertices, long long* n_vertices,
+             unsigned int** indices, long long* n_indices) {
+  const MeshLoader_t* loader = meshLoaderFind(path);
+  if (loader == NULL) {
+    fprintf(stderr, "%s: unknown model format\n", path);
+    setLoadError(LOAD_ERROR_FORMAT, 0, -1, "unknown model format");
+    return -1;
+  }
+  return loader->load(path, vertices, n_vertices, indices, n_indices);
+}
+
+/*!
+ * \brief meshLoadObj
+ *
+ * Loads an OBJ file with parseObjFile, or streams it with parseObjStream
+ * when it is a pipe or the standard input, see objStreamIsPipe().
+ */
+int meshLoadObj(const char* path, float** vertices, long long* n_vertices,
+                unsigned int** indices, long long* n_indices) {
+  if (objStreamIsPipe(path)) {
+    const int fd = objStreamOpenPath(path);
+    if (fd < 0) {
+      setLoadError(LOAD_ERROR_OPEN, 0, -1, "cannot open %s", path);
+      return -1;
+    }
+    long long count = 0;
+    long long n_edges = 0;
+    const int status =
+        parseObjStream(fd, vertices, &count, indices, &n_edges, NULL);
+    close(fd);
+    if (status != 0) return -1;
+    *n_vertices = count;
+    *n_indices = n_edges;
+    return 0;
+  }
+  long long count = 0;
+  long long n_edges = 0;
+  float* vertex_data = NULL;
+  unsigned int* index_data = NULL;
+  if (parseObjFile(path, &vertex_data, &count, &index_data, &n_edges) != 0) {
+    return -1;
+  }
+  *vertices = vertex_data;
+  *n_vertices = count;
+  *indices = index_data;
+  *n_indices = n_edges;
+  return 0;
+}
+
+typedef struct MappedFile_t {
+  const unsigned char* data;
+  size_t size;
+} MappedFile_t;
+
+// The binary formats are read straight from a read-only mapping of the file,
+// without a read buffer in between
+static int mapFile(const char* path, MappedFile_t* file) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  struct stat info;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return -1;
+  posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+  file->data = data;
+  file->size = (size_t)info.st_size;
+  return 0;
+}
+
+static void unmapFile(MappedFile_t* file) {
+  munmap((void*)file->data, file->size);
+}
+
+// Same bounding box and scale as parseObjFile, so that every format gives
+// the same vertices for the same model
+static void normalizeVertices(float* vertices, long long n_vertices) {
+  float min[3], max[3];
+  cpuKernels()->bounds(vertices, n_vertices, min, max);
+  // parseObjFile starts the maximum at FLT_MIN rather than -FLT_MAX
+  for (int axis = 0; axis < 3; ++axis) max[axis] = fmax(FLT_MIN, max[axis]);
+  const float min_x = min[0], min_y = min[1], min_z = min[2];
+  const float range =
+      fmax(fmax(max[0] - min_x, max[1] - min_y), max[2] - min_z);
+  for (long long i = 0; i < n_vertices * 3; i += 3) {
+    vertices[i] = (vertices[i] - min_x) / range;
+    vertices[i + 1] = (vertices[i + 1] - min_y) / range;
+    vertices[i + 2] = (vertices[i + 2] - min_z) / range;
+  }
+  const float origin[3] = {min_x, min_y, min_z};
+  setNormalization(origin, range);
+}
+
+static void recordLoad(const char* name, double start, long long n_vertices) {
+  stageTimerRecord(STAGE_PARSE_TOTAL, start, n_vertices);
+  if (trace_enabled) traceRecordSpanArg(name, start, "vertices", n_vertices);
+}
+
+typedef enum PlyType_t {
+  PLY_NONE,
+  PLY_INT8,
+  PLY_UINT8,
+  PLY_INT16,
+  PLY_UINT16,
+  PLY_INT32,
+  PLY_UINT32,
+  PLY_FLOAT32,
+  PLY_FLOAT64
+} PlyType_t;
+
+static const size_t kPlyTypeSizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+static const struct {
+  const char* name;
+  PlyType_t type;
+} kPlyTypeNames[] = {
+    {"char", PLY_INT8},     {"int8", PLY_INT8},       {"uchar", PLY_UINT8},
+    {"uint8", PLY_UINT8},   {"short", PLY_INT16},     {"int16", PLY_INT16},
+    {"ushort", PLY_UINT16}, {"uint16", PLY_UINT16},   {"int", PLY_INT32},
+    {"int32", PLY_INT32},   {"uint", PLY_UINT32},     {"uint32", PLY_UINT32},
+    {"float", PLY_FLOAT32}, {"float32", PLY_FLOAT32}, {"double", PLY_FLOAT64},
+    {"float64", PLY_FLOAT64}};
+
+/*!
+ * \brief PlyProperty_t
+ *
+ * A property of a PLY element. count_type is PLY_NONE for a scalar, the type
+ * of the item count for a list of type items.
+ */
+typedef struct PlyProperty_t {
+  char name[PLY_NAME_SIZE];
+  PlyType_t type;
+  PlyType_t count_type;
+} PlyProperty_t;
+
+/*!
+ * \brief PlyElement_t
+ *
+ * An element of the PLY header. data is where its records start in the
+ * file, fixed_size the size of a record when it has no list property.
+ * edges counts the edges of face and edge elements.
+ */
+typedef struct PlyElement_t {
+  char name[PLY_NAME_SIZE];
+  long long count;
+  PlyProperty_t properties[PLY_MAX_PROPERTIES];
+  int n_properties;
+  size_t fixed_size;
+  const unsigned char* data;
+  long long edges;
+} PlyElement_t;
+
+typedef struct PlyHeader_t {
+  PlyElement_t elements[PLY_MAX_ELEMENTS];
+  int n_elements;
+  size_t data_offset;
+} PlyHeader_t;
+
+static PlyType_t plyType(const char* name) {
+  for (size_t i = 0; i < sizeof(kPlyTypeNames) / sizeof(kPlyTypeNames[0]);
+       ++i) {
+    if (strcmp(name, kPlyTypeNames[i].name) == 0) return kPlyTypeNames[i].type;
+  }
+  return PLY_NONE;
+}
+
+// Binary PLY is only read on little-endian machines, like every target of
+// the viewer, so values are copied as they are
+static double plyValue(const unsigned char* p, PlyType_t type) {
+  switch (type) {
+    case PLY_INT8:
+      return (int8_t)p[0];
+    case PLY_UINT8:
+      return p[0];
+    case PLY_INT16: {
+      int16_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    case PLY_UINT16: {
+      uint16_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    case PLY_INT32: {
+      int32_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    case PLY_UINT32: {
+      uint32_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    case PLY_FLOAT32: {
+      float value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    case PLY_FLOAT64: {
+      double value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    default:
+      return 0.0;
+  }
+}
+
+static int parsePlyLine(char* line, PlyHeader_t* header, int* format_ok) {
+  char word[PLY_NAME_SIZE];
+  char a[PLY_NAME_SIZE];
+  char b[PLY_NAME_SIZE];
+  char c[PLY_NAME_SIZE];
+  long long count = 0;
+  if (sscanf(line, "%31s", word) != 1 || strcmp(word, "ply") == 0 ||
+      strcmp(word, "comment") == 0 || strcmp(word, "obj_info") == 0) {
+    return 0;
+  }
+  if (strcmp(word, "format") == 0) {
+    *format_ok = sscanf(line, "format %31s", a) == 1 &&
+                 strcmp(a, "binary_little_endian") == 0;
+    return 0;
+  }
+  if (strcmp(word, "element") == 0) {
+    if (header->n_elements == PLY_MAX_ELEMENTS ||
+        sscanf(line, "element %31s %lld", a, &count) != 2 || count < 0) {
+      return -1;
+    }
+    PlyElement_t* element = &header->elements[header->n_elements++];
+    memset(element, 0, sizeof(*element));
+    memcpy(element->name, a, sizeof(a));
+    element->count = count;
+    return 0;
+  }
+  if (strcmp(word, "property") == 0) {
+    if (header->n_elements == 0) return -1;
+    PlyElement_t* element = &header->elements[header->n_elements - 1];
+    if (element->n_properties == PLY_MAX_PROPERTIES) return -1;
+    PlyProperty_t* property = &element->properties[element->n_properties++];
+    if (sscanf(line, "property list %31s %31s %31s", a, b, c) == 3) {
+      property->count_type = plyType(a);
+      property->type = plyType(b);
+      memcpy(property->name, c, sizeof(c));
+      if (property->count_type == PLY_NONE) return -1;
+    } else if (sscanf(line, "property %31s %31s", a, b) == 2) {
+      property->count_type = PLY_NONE;
+      property->type = plyType(a);
+      memcpy(property->name, b, sizeof(b));
+    } else {
+      return -1;
+    }
+    return property->type == PLY_NONE ? -1 : 0;
+  }
+  return -1;
+}
+
+static int parsePlyHeader(const MappedFile_t* file, PlyHeader_t* header) {
+  const size_t limit = file->size < PLY_MAX_HEADER_BYTES
+                           ? file->size
+                           : (size_t)PLY_MAX_HEADER_BYTES;
+  char* text = malloc(limit + 1);
+  if (text == NULL) return -1;
+  memcpy(text, file->data, limit);
+  text[limit] = '\0';
+  char* end = strstr(text, "end_header");
+  char* newline = end != NULL ? strchr(end, '\n') : NULL;
+  int result = newline != NULL ? 0 : -1;
+  int format_ok = 0;
+  header->n_elements = 0;
+  if (result == 0) {
+    header->data_offset = (size_t)(newline - text) + 1;
+    *end = '\0';
+    char* save = NULL;
+    for (char* line = strtok_r(text, "\r\n", &save); line != NULL && !result;
+         line = strtok_r(NULL, "\r\n", &save)) {
+      result = parsePlyLine(line, header, &format_ok);
+    }
+  }
+  free(text);
+  return result == 0 && format_ok ? 0 : -1;
+}
+
+static int findPlyProperty(const PlyElement_t* element, const char* name) {
+  for (int i = 0; i < element->n_properties; ++i) {
+    if (strcmp(element->properties[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+static size_t plyPropertyOffset(const PlyElement_t* element, int property) {
+  size_t offset = 0;
+  for (int i = 0; i < property; ++i) {
+    offset += kPlyTypeSizes[element->properties[i].type];
+  }
+  return offset;
+}
+
+// The face list of an element, -1 if it is not a face element
+static int plyFaceList(const PlyElement_t* element) {
+  if (strcmp(element->name, "face") != 0) return -1;
+  int list = findPlyProperty(element, "vertex_indices");
+  if (list < 0) list = findPlyProperty(element, "vertex_index");
+  return list >= 0 && element->properties[list].count_type != PLY_NONE ? list
+                                                                        : -1;
+}
+
+static int isPlyEdgeElement(const PlyElement_t* element) {
+  const int first = findPlyProperty(element, "vertex1");
+  const int second = findPlyProperty(element, "vertex2");
+  return strcmp(element->name, "edge") == 0 && element->fixed_size > 0 &&
+         first >= 0 && second >= 0;
+}
+
+// Walks one record with list properties, checking it lies in the file.
+// n_items and items receive the length and start of the list property list.
+static const unsigned char* plyNextRecord(const PlyElement_t* element,
+                                          const unsigned char* p,
+                                          const unsigned char* end,
+                                          int list, long long* n_items,
+                                          const unsigned char** items) {
+  for (int i = 0; i < element->n_properties; ++i) {
+    const PlyProperty_t* property = &element->properties[i];
+    const size_t item_size = kPlyTypeSizes[property->type];
+    if (property->count_type == PLY_NONE) {
+      if ((size_t)(end - p) < item_size) return NULL;
+      p += item_size;
+      continue;
+    }
+    const size_t count_size = kPlyTypeSizes[property->count_type];
+    if ((size_t)(end - p) < count_size) return NULL;
+    const double count = plyValue(p, property->count_type);
+    p += count_size;
+    if (count < 0 || count > (double)(size_t)(end - p) / item_size) {
+      return NULL;
+    }
+    if (i == list) {
+      *n_items = (long long)count;
+      *items = p;
+    }
+    p += (size_t)count * item_size;
+  }
+  return p;
+}
+
+// Finds where the records of every element start, and counts the edges
+static int locatePlyElements(const MappedFile_t* file, PlyHeader_t* header) {
+  const unsigned char* p = file->data + header->data_offset;
+  const unsigned char* end = file->data + file->size;
+  for (int e = 0; e < header->n_elements; ++e) {
+    PlyElement_t* element = &header->elements[e];
+    element->data = p;
+    element->fixed_size = 0;
+    int fixed = 1;
+    for (int i = 0; i < element->n_properties; ++i) {
+      if (element->properties[i].count_type != PLY_NONE) fixed = 0;
+      element->fixed_size += kPlyTypeSizes[element->properties[i].type];
+    }
+    if (!fixed) element->fixed_size = 0;
+    const int list = plyFaceList(element);
+    if (fixed) {
+      if (element->fixed_size > 0 &&
+          (size_t)element->count > (size_t)(end - p) / element->fixed_size) {
+        return -1;
+      }
+      p += (size_t)element->count * element->fixed_size;
+      if (isPlyEdgeElement(element)) element->edges = element->count;
+      continue;
+    }
+    for (long long r = 0; r < element->count; ++r) {
+      long long n_items = 0;
+      const unsigned char* items = NULL;
+      p = plyNextRecord(element, p, end, list, &n_items, &items);
+      if (p == NULL) return -1;
+      if (n_items >= 3) element->edges += n_items;
+    }
+  }
+  return 0;
+}
+
+static int readPlyVertices(const PlyElement_t* element, float* vertices) {
+  const int xyz[3] = {findPlyProperty(element, "x"),
+                      findPlyProperty(element, "y"),
+                      findPlyProperty(element, "z")};
+  if (xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0 || element->fixed_size == 0) {
+    return -1;
+  }
+  size_t offsets[3];
+  PlyType_t types[3];
+  for (int k = 0; k < 3; ++k) {
+    offsets[k] = plyPropertyOffset(element, xyz[k]);
+    types[k] = element->properties[xyz[k]].type;
+  }
+  const size_t stride = element->fixed_size;
+  const unsigned char* p = element->data;
+  if (types[0] == PLY_FLOAT32 && types[1] == PLY_FLOAT32 &&
+      types[2] == PLY_FLOAT32 && offsets[1] == offsets[0] + 4 &&
+      offsets[2] == offsets[0] + 8) {
+    for (long long i = 0; i < element->count; ++i, p += stride) {
+      memcpy(&vertices[i * 3], p + offsets[0], 3 * sizeof(float));
+    }
+    return 0;
+  }
+  for (long long i = 0; i < element->count; ++i, p += stride) {
+    for (int k = 0; k < 3; ++k) {
+      vertices[i * 3 + k] = (float)plyValue(p + offsets[k], types[k]);
+    }
+  }
+  return 0;
+}
+
+// Outlines of the faces: a face a b c gives the edges a-b, b-c and c-a, like
+// parseObjFile, and larger polygons one edge per side
+static int readPlyFaces(const PlyElement_t* element, const unsigned char* end,
+                        long long n_vertices, unsigned int* indices) {
+  const int list = plyFaceList(element);
+  const PlyType_t type = element->properties[list].type;
+  const size_t item_size = kPlyTypeSizes[type];
+  const unsigned char* p = element->data;
+  long long written = 0;
+  for (long long r = 0; r < element->count; ++r) {
+    long long n_items = 0;
+    const unsigned char* items = NULL;
+    p = plyNextRecord(element, p, end, list, &n_items, &items);
+    if (p == NULL) return -1;
+    if (n_items < 3) continue;
+    const double first = plyValue(items, type);
+    for (long long k = 0; k < n_items; ++k) {
+      const double from = plyValue(items + k * item_size, type);
+      const double to = k + 1 < n_items
+                            ? plyValue(items + (k + 1) * item_size, type)
+                            : first;
+      if (from < 0 || from >= n_vertices || to < 0 || to >= n_vertices) {
+        return -1;
+      }
+      indices[written++] = (unsigned int)from;
+      indices[written++] = (unsigned int)to;
+    }
+  }
+  return 0;
+}
+
+static int readPlyEdges(const PlyElement_t* element, long long n_vertices,
+                        unsigned int* indices) {
+  const int ends[2] = {findPlyProperty(element, "vertex1"),
+                       findPlyProperty(element, "vertex2")};
+  const size_t offsets[2] = {plyPropertyOffset(element, ends[0]),
+                             plyPropertyOffset(element, ends[1])};
+  const unsigned char* p = element->data;
+  for (long long r = 0; r < element->count; ++r, p += element->fixed_size) {
+    for (int k = 0; k < 2; ++k) {
+      const double index =
+          plyValue(p + offsets[k], element->properties[ends[k]].type);
+      if (index < 0 || index >= n_vertices) return -1;
+      indices[r * 2 + k] = (unsigned int)index;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * \brief meshLoadPly
+ *
+ * Loads a binary little-endian PLY file: the x, y and z properties of the
+ * vertex element, the outlines of the face element (vertex_indices or
+ * vertex_index lists) and the edge element (vertex1, vertex2). Other
+ * elements and properties are skipped.
+ */
+int meshLoadPly(const char* path, float** vertices, long long* n_vertices,
+                unsigned int** indices, long long* n_indices) {
+  const double start = stageTimerNow();
+  MappedFile_t file;
+  if (mapFile(path, &file) != 0) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    setLoadError(LOAD_ERROR_OPEN, 0, -1, "cannot open %s", path);
+    return -1;
+  }
+  PlyHeader_t* header = malloc(sizeof(PlyHeader_t));
+  const PlyElement_t* vertex_element = NULL;
+  long long edges = 0;
+  int result = header != NULL && parsePlyHeader(&file, header) == 0 &&
+                       locatePlyElements(&file, header) == 0
+                   ? 0
+                   : -1;
+  for (int e = 0; result == 0 && e < header->n_elements; ++e) {
+    if (strcmp(header->elements[e].name, "vertex") == 0) {
+      vertex_element = &header->elements[e];
+    }
+    edges += header->elements[e].edges;
+  }
+  // Every vertex must have a 32-bit index
+  if (vertex_element == NULL || vertex_element->count > UINT_MAX) {
+    result = -1;
+  }
+
+  float* vertex_data = NULL;
+  unsigned int* index_data = NULL;
+  const long long count = result == 0 ? vertex_element->count : 0;
+  const size_t vertex_bytes = (size_t)count * 3 * sizeof(float);
+  const size_t index_bytes = (size_t)edges * 2 * sizeof(unsigned int);
+  if (result == 0) {
+    vertex_data = loaderAlloc(MEM_VERTICES, vertex_bytes);
+    index_data = loaderAlloc(MEM_INDICES, index_bytes);
+    if ((vertex_data == NULL && vertex_bytes > 0) ||
+        (index_data == NULL && index_bytes > 0) ||
+        readPlyVertices(vertex_element, vertex_data) != 0) {
+      result = -1;
+    }
+  }
+  unsigned int* next = index_data;
+  for (int e = 0; result == 0 && e < header->n_elements; ++e) {
+    const PlyElement_t* element = &header->elements[e];
+    if (element->edges == 0) continue;
+    if (plyFaceList(element) >= 0) {
+      result = readPlyFaces(element, file.data + file.size, count, next);
+    } else {
+      result = readPlyEdges(element, count, next);
+    }
+    next += element->edges * 2;
+  }
+  free(header);
+  unmapFile(&file);
+  if (result != 0) {
+    fprintf(stderr, "%s: not a valid binary little-endian PLY file\n", path);
+    setLoadError(LOAD_ERROR_FORMAT, 0, -1,
+                 "not a valid binary little-endian PLY file");
+    loaderFree(MEM_VERTICES, vertex_data, vertex_bytes);
+    loaderFree(MEM_INDICES, index_data, index_bytes);
+    return -1;
+  }
+
+  normalizeVertices(vertex_data, count);
+  *vertices = vertex_data;
+  *n_vertices = count;
+  *indices = index_data;
+  *n_indices = edges * 2;
+  recordLoad("meshLoadPly", start, *n_vertices);
+  return 0;
+}
+
+static uint32_t mixBits(uint32_t h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static uint32_t hashPosition(const float position[3]) {
+  uint32_t bits[3];
+  memcpy(bits, position, sizeof(bits));
+  return mixBits(bits[0] ^ mixBits(bits[1] ^ mixBits(bits[2])));
+}
+
+/*!
+ * \brief meshLoadStl
+ *
+ * Loads a binary STL file. STL repeats the corners of every triangle, so
+ * corners at exactly the same position are merged into one vertex, in the
+ * order they first appear; welding can merge nearby ones afterwards.
+ */
+int meshLoadStl(const char* path, float** vertices, long long* n_vertices,
+                unsigned int** indices, long long* n_indices) {
+  const double start = stageTimerNow();
+  MappedFile_t file;
+  if (mapFile(path, &file) != 0) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    setLoadError(LOAD_ERROR_OPEN, 0, -1, "cannot open %s", path);
+    return -1;
+  }
+  uint32_t n_triangles = 0;
+  if (file.size >= STL_HEADER_BYTES) {
+    memcpy(&n_triangles, file.data + 80, sizeof(n_triangles));
+  }
+  if (file.size < STL_HEADER_BYTES ||
+      (file.size - STL_HEADER_BYTES) / STL_TRIANGLE_BYTES < n_triangles ||
+      n_triangles > UINT_MAX / 3) {
+    const int ascii = file.size >= 5 && memcmp(file.data, "solid", 5) == 0;
+    fprintf(stderr, "%s: not a binary STL file%s\n", path,
+            ascii ? " (ASCII STL is not supported)" : "");
+    setLoadError(LOAD_ERROR_FORMAT, 0, -1, "not a binary STL file%s",
+                 ascii ? " (ASCII STL is not supported)" : "");
+    unmapFile(&file);
+    return -1;
+  }
+
+  // Fewer corners than UINT_MAX, which marks the empty slots
+  const long long corners = (long long)n_triangles * 3;
+  size_t capacity = 16;
+  while (capacity < (size_t)corners * 2) capacity *= 2;
+  const size_t vertex_bytes = (size_t)corners * 3 * sizeof(float);
+  const size_t index_bytes = (size_t)corners * 2 * sizeof(unsigned int);
+  const size_t table_bytes = capacity * sizeof(unsigned int);
+  float* vertex_data = loaderAlloc(MEM_VERTICES, vertex_bytes);
+  unsigned int* index_data = loaderAlloc(MEM_INDICES, index_bytes);
+  unsigned int* table = loaderAlloc(MEM_LOADER_TEMP, table_bytes);
+  if ((vertex_data == NULL && vertex_bytes > 0) ||
+      (index_data == NULL && index_bytes > 0) || table == NULL) {
+    loaderFree(MEM_VERTICES, vertex_data, vertex_bytes);
+    loaderFree(MEM_INDICES, index_data, index_bytes);
+    loaderFree(MEM_LOADER_TEMP, table, table_bytes);
+    unmapFile(&file);
+    setLoadError(LOAD_ERROR_MEMORY, 0, -1,
+                 "not enough memory for %lld triangles", corners / 3);
+    return -1;
+  }
+  memset(table, 0xff, table_bytes);
+
+  unsigned int count = 0;
+  const unsigned char* p = file.data + STL_HEADER_BYTES;
+  for (size_t t = 0; t < n_triangles; ++t, p += STL_TRIANGLE_BYTES) {
+    unsigned int corner[3];
+    for (int c = 0; c < 3; ++c) {
+      float position[3];
+      // Skips the normal; -0 and 0 are the same position
+      memcpy(position, p + 12 + c * 12, sizeof(position));
+      for (int k = 0; k < 3; ++k) position[k] += 0.0f;
+      size_t slot = hashPosition(position) & (capacity - 1);
+      while (table[slot] != UINT_MAX &&
+             memcmp(&vertex_data[(size_t)table[slot] * 3], position,
+                    sizeof(position)) != 0) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+      if (table[slot] == UINT_MAX) {
+        table[slot] = count;
+        memcpy(&vertex_data[(size_t)count * 3], position, sizeof(position));
+        ++count;
+      }
+      corner[c] = table[slot];
+    }
+    unsigned int* edge = &index_data[t * 6];
+    edge[0] = corner[0];
+    edge[1] = corner[1];
+    edge[2] = corner[1];
+    edge[3] = corner[2];
+    edge[4] = corner[2];
+    edge[5] = corner[0];
+  }
+  loaderFree(MEM_LOADER_TEMP, table, table_bytes);
+  unmapFile(&file);
+
+  vertex_data = loaderShrink(MEM_VERTICES, vertex_data, vertex_bytes,
+                             (size_t)count * 3 * sizeof(float));
+  normalizeVertices(vertex_data, count);
+  *vertices = vertex_data;
+  *n_vertices = count;
+  *indices = index_data;
+  *n_indices = corners * 2;
+  recordLoad("meshLoadStl", start, count);
+  return 0;
+}
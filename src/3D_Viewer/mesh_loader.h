@@ -0,0 +1,61 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_LOADER_MAX 16
+// Bytes of the file compared against the magic of the loaders
+#define MESH_LOADER_MAGIC_BYTES 16
+
+/*!
+ * \brief MeshLoadFunc_t
+ *
+ * Reads a model file into the arrays of parseObjFile: vertices normalized
+ * into [0, 1] the same way, two indices per edge, allocated with
+ * loaderAlloc and released with freeModelC. Counts are 64-bit, vertex
+ * numbers fit the 32-bit indices.
+ *
+ * \return 0 on success, -1 if the file could not be read; the arrays are
+ * left untouched then and the reason is recorded with setLoadError().
+ */
+typedef int (*MeshLoadFunc_t)(const char* path, float** vertices,
+                              long long* n_vertices, unsigned int** indices,
+                              long long* n_indices);
+
+/*!
+ * \brief MeshLoader_t
+ *
+ * A registered file format. extensions is a space separated list without
+ * dots, compared ignoring case. A file whose first bytes are magic is read
+ * by this loader whatever its extension; formats without a reliable magic
+ * leave it NULL and are chosen by extension only.
+ */
+typedef struct MeshLoader_t {
+  const char* name;
+  const char* extensions;
+  const char* magic;
+  int magic_size;
+  MeshLoadFunc_t load;
+} MeshLoader_t;
+
+int meshLoaderRegister(const MeshLoader_t* loader);
+int meshLoaderCount(void);
+const MeshLoader_t* meshLoaderAt(int index);
+const MeshLoader_t* meshLoaderFind(const char* path);
+int meshLoad(const char* path, float** vertices, long long* n_vertices,
+             unsigned int** indices, long long* n_indices);
+
+int meshLoadObj(const char* path, float** vertices, long long* n_vertices,
+                unsigned int** indices, long long* n_indices);
+int meshLoadPly(const char* path, float** vertices, long long* n_vertices,
+                unsigned int** indices, long long* n_indices);
+int meshLoadStl(const char* path, float** vertices, long long* n_vertices,
+                unsigned int** indices, long long* n_indices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MESH_LOADER_H
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "model_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "arena.h"
+#include "backend.h"
+#include "memory_stats.h"
+
+typedef struct ModelStamp_t {
+  long long size;
+  long long mtime_ns;
+} ModelStamp_t;
+
+typedef struct ModelCacheEntry_t {
+  char* path;
+  unsigned int options;
+  ModelStamp_t stamp;
+  // One block: the vertices followed by the indices
+  void* data;
+  long long bytes;
+  long long n_vertices;
+  long long n_indices;
+  // Normalization of the loader, see getNormalization()
+  float origin[3];
+  float scale;
+  unsigned long long last_used;
+} ModelCacheEntry_t;
+
+struct ModelCache_t {
+  ModelCacheEntry_t* entries;
+  int n_entries;
+  int capacity;
+  int max_entries;
+  long long budget_bytes;
+  long long bytes;
+  unsigned long long clock;
+  ModelCacheStats_t counters;
+};
+
+static int readStamp(const char* path, ModelStamp_t* stamp) {
+  struct stat info;
+  if (stat(path, &info) != 0) return -1;
+  stamp->size = (long long)info.st_size;
+  stamp->mtime_ns =
+      (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+  return 0;
+}
+
+static void dropEntry(ModelCache_t* cache, int index) {
+  ModelCacheEntry_t* entry = &cache->entries[index];
+  memAccountFree(MEM_CACHES, entry->data, (size_t)entry->bytes);
+  memAccountFree(MEM_CACHES, entry->path, strlen(entry->path) + 1);
+  cache->bytes -= entry->bytes;
+  cache->entries[index] = cache->entries[--cache->n_entries];
+}
+
+static int findEntry(const ModelCache_t* cache, const char* path,
+                     unsigned int options) {
+  for (int i = 0; i < cache->n_entries; ++i) {
+    const ModelCacheEntry_t* entry = &cache->entries[i];
+    if (entry->options == options && strcmp(entry->path, path) == 0) return i;
+  }
+  return -1;
+}
+
+// Evicts least recently used entries until at most max_entries entries and
+// budget_bytes bytes are left.
+static void evictTo(ModelCache_t* cache, int max_entries,
+                    long long budget_bytes) {
+  while (cache->n_entries > 0 && (cache->n_entries > max_entries ||
+                                  cache->bytes > budget_bytes)) {
+    int oldest = 0;
+    for (int i = 1; i < cache->n_entries; ++i) {
+      if (cache->entries[i].last_used < cache->entries[oldest].last_used) {
+        oldest = i;
+      }
+    }
+    dropEntry(cache, oldest);
+    ++cache->counters.evictions;
+  }
+}
+
+/*!
+ * \brief modelCacheCreate
+ *
+ * \return An empty cache, or NULL if it could not be allocated.
+ */
+ModelCache_t* modelCacheCreate(int max_entries, long long budget_bytes) {
+  ModelCache_t* cache = calloc(1, sizeof(ModelCache_t));
+  if (cache == NULL) return NULL;
+  modelCacheSetLimits(cache, max_entries, budget_bytes);
+  return cache;
+}
+
+void modelCacheDestroy(ModelCache_t* cache) {
+  if (cache == NULL) return;
+  modelCacheClear(cache);
+  free(cache->entries);
+  free(cache);
+}
+
+/*!
+ * \brief modelCacheSetLimits
+ *
+ * Changes the number of entries and bytes kept, evicting as needed. A limit
+ * of zero disables the cache.
+ */
+void modelCacheSetLimits(ModelCache_t* cache, int max_entries,
+                         long long budget_bytes) {
+  cache->max_entries = max_entries > 0 ? max_entries : 0;
+  cache->budget_bytes = budget_bytes > 0 ? budget_bytes : 0;
+  evictTo(cache, cache->max_entries, cache->budget_bytes);
+}
+
+void modelCacheClear(ModelCache_t* cache) {
+  while (cache->n_entries > 0) dropEntry(cache, cache->n_entries - 1);
+}
+
+/*!
+ * \brief modelCacheGet
+ *
+ * Looks a model up and, on a hit, copies it into new arrays allocated like
+ * the parser's (loaderAlloc), so the caller owns and may modify them as if
+ * the file had been parsed, and restores the normalization the loader
+ * recorded. An entry whose file changed is dropped.
+ *
+ * \return 0 on a hit, -1 on a miss.
+ */
+int modelCacheGet(ModelCache_t* cache, const char* path, unsigned int options,
+                  float** vertices, long long* n_vertices,
+                  unsigned int** indices, long long* n_indices) {
+  const int index = findEntry(cache, path, options);
+  ModelStamp_t stamp;
+  if (index < 0 || readStamp(path, &stamp) != 0) {
+    ++cache->counters.misses;
+    return -1;
+  }
+  ModelCacheEntry_t* entry = &cache->entries[index];
+  if (entry->stamp.size != stamp.size ||
+      entry->stamp.mtime_ns != stamp.mtime_ns) {
+    dropEntry(cache, index);
+    ++cache->counters.misses;
+    return -1;
+  }
+
+  const size_t vertex_bytes = (size_t)entry->n_vertices * 3 * sizeof(float);
+  const size_t index_bytes = (size_t)entry->n_indices * sizeof(unsigned int);
+  float* vertex_copy = loaderAlloc(MEM_VERTICES, vertex_bytes);
+  unsigned int* index_copy = loaderAlloc(MEM_INDICES, index_bytes);
+  if ((vertex_copy == NULL && vertex_bytes > 0) ||
+      (index_copy == NULL && index_bytes > 0)) {
+    loaderFree(MEM_VERTICES, vertex_copy, vertex_bytes);
+    loaderFree(MEM_INDICES, index_copy, index_bytes);
+    ++cache->counters.misses;
+    return -1;
+  }
+  if (vertex_bytes > 0) memcpy(vertex_copy, entry->data, vertex_bytes);
+  if (index_bytes > 0) {
+    memcpy(index_copy, (const char*)entry->data + vertex_bytes, index_bytes);
+  }
+  entry->last_used = ++cache->clock;
+  ++cache->counters.hits;
+  setNormalization(entry->origin, entry->scale);
+
+  *vertices = vertex_copy;
+  *n_vertices = entry->n_vertices;
+  *indices = index_copy;
+  *n_indices = entry->n_indices;
+  return 0;
+}
+
+/*!
+ * \brief modelCachePut
+ *
+ * Stores a copy of a model, replacing an older entry of the same file and
+ * options, with the normalization recorded by its loader. The file is
+ * stamped now, so put a model right after loading it.
+ * Empty models and models larger than the whole budget are not kept.
+ *
+ * \return 0 if the model was stored, -1 otherwise.
+ */
+int modelCachePut(ModelCache_t* cache, const char* path, unsigned int options,
+                  const float* vertices, long long n_vertices,
+                  const unsigned int* indices, long long n_indices) {
+  ModelStamp_t stamp;
+  if (n_vertices < 0 || n_indices < 0 || readStamp(path, &stamp) != 0) {
+    return -1;
+  }
+  const int old = findEntry(cache, path, options);
+  if (old >= 0) dropEntry(cache, old);
+
+  const size_t vertex_bytes = (size_t)n_vertices * 3 * sizeof(float);
+  const size_t index_bytes = (size_t)n_indices * sizeof(unsigned int);
+  const long long bytes = (long long)(vertex_bytes + index_bytes);
+  if (bytes == 0 || cache->max_entries == 0 || bytes > cache->budget_bytes) {
+    return -1;
+  }
+  evictTo(cache, cache->max_entries - 1, cache->budget_bytes - bytes);
+
+  if (cache->n_entries == cache->capacity) {
+    const int capacity = cache->capacity ? cache->capacity * 2 : 8;
+    ModelCacheEntry_t* entries =
+        realloc(cache->entries, capacity * sizeof(ModelCacheEntry_t));
+    if (entries == NULL) return -1;
+    cache->entries = entries;
+    cache->capacity = capacity;
+  }
+  const size_t path_bytes = strlen(path) + 1;
+  char* path_copy = memAccountMalloc(MEM_CACHES, path_bytes);
+  void* data = memAccountMalloc(MEM_CACHES, (size_t)bytes);
+  if (path_copy == NULL || data == NULL) {
+    memAccountFree(MEM_CACHES, path_copy, path_bytes);
+    memAccountFree(MEM_CACHES, data, (size_t)bytes);
+    return -1;
+  }
+  memcpy(path_copy, path, path_bytes);
+  if (vertex_bytes > 0) memcpy(data, vertices, vertex_bytes);
+  if (index_bytes > 0) {
+    memcpy((char*)data + vertex_bytes, indices, index_bytes);
+  }
+
+  ModelCacheEntry_t* entry = &cache->entries[cache->n_entries++];
+  entry->path = path_copy;
+  entry->options = options;
+  entry->stamp = stamp;
+  entry->data = data;
+  entry->bytes = bytes;
+  entry->n_vertices = n_vertices;
+  entry->n_indices = n_indices;
+  getNormalization(entry->origin, &entry->scale);
+  entry->last_used = ++cache->clock;
+  cache->bytes += bytes;
+  ++cache->counters.insertions;
+  return 0;
+}
+
+void modelCacheGetStats(const ModelCache_t* cache, ModelCacheStats_t* stats) {
+  *stats = cache->counters;
+  stats->entries = cache->n_entries;
+  stats->max_entries = cache->max_entries;
+  stats->bytes = cache->bytes;
+  stats->budget_bytes = cache->budget_bytes;
+}
@@ -0,0 +1,51 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MODEL_CACHE_DEFAULT_ENTRIES 8
+#define MODEL_CACHE_DEFAULT_BUDGET_MB 512
+
+/*!
+ * \brief ModelCache_t
+ *
+ * Parsed models kept after they are replaced, so loading one of them again
+ * is a copy instead of a parse. Entries are keyed by the file path, its size
+ * and modification time and the load options of the caller (welding,
+ * reordering), so a changed file or other options are a miss. At most
+ * max_entries models and budget_bytes of them are kept; the least recently
+ * used ones are evicted first.
+ */
+typedef struct ModelCache_t ModelCache_t;
+
+typedef struct ModelCacheStats_t {
+  long long hits;
+  long long misses;
+  long long insertions;
+  long long evictions;
+  int entries;
+  int max_entries;
+  long long bytes;
+  long long budget_bytes;
+} ModelCacheStats_t;
+
+ModelCache_t* modelCacheCreate(int max_entries, long long budget_bytes);
+void modelCacheDestroy(ModelCache_t* cache);
+void modelCacheSetLimits(ModelCache_t* cache, int max_entries,
+                         long long budget_bytes);
+void modelCacheClear(ModelCache_t* cache);
+int modelCacheGet(ModelCache_t* cache, const char* path, unsigned int options,
+                  float** vertices, long long* n_vertices,
+                  unsigned int** indices, long long* n_indices);
+int modelCachePut(ModelCache_t* cache, const char* path, unsigned int options,
+                  const float* vertices, long long n_vertices,
+                  const unsigned int* indices, long long n_indices);
+void modelCacheGetStats(const ModelCache_t* cache, ModelCacheStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MODEL_CACHE_H
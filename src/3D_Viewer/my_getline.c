@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "my_getline.h"
 
 #ifdef __cplusplus
@@ -53,6 +54,58 @@ ssize_t my_getline_allocate(char **line, size_t *allocated_size, FILE *stream) {
   return pos;
 }
 
+/*!
+ * \brief my_getline_arena
+ *
+ * my_getline_allocate for a buffer taken from the temporaries of arena. The
+ * buffer grows by doubling into a new temporary; the old one is released
+ * with the other temporaries, so at most twice the longest line is used.
+ */
+ssize_t my_getline_arena(char **line, size_t *allocated_size, FILE *stream,
+                         Arena_t *arena) {
+
+  if (line == NULL || stream == NULL || allocated_size == NULL ||
+      arena == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  int c = getc(stream);
+  if (c == EOF) {
+    return -1;
+  }
+
+  if (*line == NULL) {
+    *line = arenaAllocTemp(arena, 128);
+    if (*line == NULL) {
+      return -1;
+    }
+    *allocated_size = 128;
+  }
+
+  size_t pos = 0u;
+  while (c != EOF) {
+    if (pos + 1 >= *allocated_size) {
+      char *new_ptr = arenaAllocTemp(arena, *allocated_size * 2);
+      if (new_ptr == NULL) {
+        return -1;
+      }
+      memcpy(new_ptr, *line, pos);
+      *allocated_size *= 2;
+      *line = new_ptr;
+    }
+
+    ((unsigned char *)(*line))[pos++] = c;
+    if (c == '\n') {
+      break;
+    }
+    c = getc(stream);
+  }
+
+  (*line)[pos] = '\0';
+  return pos;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,11 +8,15 @@ extern "C" {
 #include <stdio.h>
 #include <sys/types.h>
 
+#include "arena.h"
+
 #ifdef _WIN32
 //  if typedef doesn't exist (msvc, blah)
 typedef intptr_t ssize_t;
 #endif  // _WIN32
 ssize_t my_getline_allocate(char **line, size_t *allocated_size, FILE *stream);
+ssize_t my_getline_arena(char **line, size_t *allocated_size, FILE *stream,
+                         Arena_t *arena);
 
 #ifdef __cplusplus
 }
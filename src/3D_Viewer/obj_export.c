@@ -0,0 +1,347 @@
+#include "obj_export.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory_stats.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+// Upper bounds of the text of one vertex (v and three floats) and of one
+// edge (a third of an f line, or an l line)
+#define OBJ_EXPORT_VERTEX_BYTES 64
+#define OBJ_EXPORT_EDGE_BYTES 24
+#define OBJ_EXPORT_MAX_DIGITS 9
+
+static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                1e18, 1e19, 1e20, 1e21, 1e22};
+// Powers of ten up to this are exact doubles
+#define OBJ_EXPORT_EXACT_POW10 22
+
+void objExportDefaults(ObjExportOptions_t* options) {
+  memset(options, 0, sizeof(*options));
+  options->scale = 1.0f;
+  options->faces = 1;
+}
+
+// Nearest integer to value / 10^exponent
+static double nearestMantissa(double value, int exponent) {
+  return nearbyint(exponent >= 0 ? value / kPow10[exponent]
+                                 : value * kPow10[-exponent]);
+}
+
+// Whether mantissa * 10^exponent reads back as target. The product or
+// quotient is one correctly rounded double operation, and rounding that to
+// float gives the correctly rounded float unless it lies exactly halfway
+// between two floats; that rare case is left to strtof.
+static int readsAs(double mantissa, int exponent, float target) {
+  const double x = exponent >= 0 ? mantissa * kPow10[exponent]
+                                 : mantissa / kPow10[-exponent];
+  const float rounded = (float)x;
+  const float other = (double)rounded < x ? nextafterf(rounded, INFINITY)
+                                          : nextafterf(rounded, 0.0f);
+  if ((double)rounded != x && x == ((double)rounded + (double)other) * 0.5) {
+    char text[40];
+    snprintf(text, sizeof(text), "%.0fe%d", mantissa, exponent);
+    return strtof(text, NULL) == target;
+  }
+  return rounded == target;
+}
+
+// Writes mantissa * 10^exponent without trailing zeros, in plain notation
+// for moderate exponents and as 1.5e-08 style otherwise
+static int writeDecimal(char* out, unsigned long long mantissa, int exponent) {
+  char digits[24];
+  int n_digits = 0;
+  while (mantissa != 0 && mantissa % 10 == 0) {
+    mantissa /= 10;
+    ++exponent;
+  }
+  do {
+    digits[n_digits++] = (char)('0' + mantissa % 10);
+    mantissa /= 10;
+  } while (mantissa != 0);
+  char* p = out;
+  const int leading = exponent + n_digits - 1;
+  if (leading >= -5 && leading < OBJ_EXPORT_MAX_DIGITS) {
+    if (leading < 0) {
+      *p++ = '0';
+      *p++ = '.';
+      for (int i = -1; i > leading; --i) *p++ = '0';
+    }
+    for (int i = n_digits - 1; i >= 0; --i) {
+      *p++ = digits[i];
+      if (i > 0 && n_digits - 1 - i == leading) *p++ = '.';
+    }
+    for (int i = 0; i < exponent; ++i) *p++ = '0';
+  } else {
+    *p++ = digits[n_digits - 1];
+    if (n_digits > 1) *p++ = '.';
+    for (int i = n_digits - 2; i >= 0; --i) *p++ = digits[i];
+    p += sprintf(p, "e%d", leading);
+  }
+  *p = '\0';
+  return (int)(p - out);
+}
+
+/*!
+ * \brief objFormatFloat
+ *
+ * Writes the shortest decimal that reads back as exactly value, the nearest
+ * one if there are several, like Ryu does. The number of significant
+ * digits is found by a binary search over 1 to 9, each candidate checked
+ * with exact double arithmetic; values too small or too large for exact
+ * powers of ten fall back to printf and strtof.
+ *
+ * \return The length written to out, which holds OBJ_EXPORT_FLOAT_CHARS.
+ */
+int objFormatFloat(float value, char* out) {
+  if (value == 0.0f || !isfinite(value)) {
+    return snprintf(out, OBJ_EXPORT_FLOAT_CHARS, "%g", value);
+  }
+  const int negative = signbit(value) != 0;
+  const float target = fabsf(value);
+  const double d = target;
+  int e10 = (int)floor(log10(d));
+  char* p = out;
+  if (negative) *p++ = '-';
+
+  if (e10 - OBJ_EXPORT_MAX_DIGITS < -OBJ_EXPORT_EXACT_POW10 ||
+      e10 + 1 > OBJ_EXPORT_EXACT_POW10) {
+    for (int digits = 1; digits <= OBJ_EXPORT_MAX_DIGITS; ++digits) {
+      snprintf(p, OBJ_EXPORT_FLOAT_CHARS - 1, "%.*g", digits, d);
+      if (strtof(p, NULL) == target) break;
+    }
+    return (int)strlen(out);
+  }
+  // log10 may be off by one next to a power of ten
+  const double widest = nearestMantissa(d, e10 - OBJ_EXPORT_MAX_DIGITS + 1);
+  if (widest >= kPow10[OBJ_EXPORT_MAX_DIGITS]) ++e10;
+  if (widest < kPow10[OBJ_EXPORT_MAX_DIGITS - 1]) --e10;
+
+  int low = 1;
+  int high = OBJ_EXPORT_MAX_DIGITS;
+  while (low < high) {
+    const int digits = (low + high) / 2;
+    const int exponent = e10 - digits + 1;
+    if (readsAs(nearestMantissa(d, exponent), exponent, target)) {
+      high = digits;
+    } else {
+      low = digits + 1;
+    }
+  }
+  const int exponent = e10 - low + 1;
+  const double mantissa = nearestMantissa(d, exponent);
+  if (!readsAs(mantissa, exponent, target)) {
+    snprintf(p, OBJ_EXPORT_FLOAT_CHARS - 1, "%.9g", d);
+    return (int)strlen(out);
+  }
+  return (int)(p - out) +
+         writeDecimal(p, (unsigned long long)mantissa, exponent);
+}
+
+static char* writeIndex(char* p, unsigned int index) {
+  char digits[12];
+  int n_digits = 0;
+  unsigned long long value = (unsigned long long)index + 1;
+  do {
+    digits[n_digits++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (n_digits > 0) *p++ = digits[--n_digits];
+  return p;
+}
+
+typedef struct ExportBatch_t {
+  const float* vertices;
+  long long n_vertices;
+  const unsigned int* indices;
+  long long n_edges;
+  const ObjExportOptions_t* options;
+  int transformed;
+  int edges;
+  long first_chunk;
+  char** buffers;
+  size_t* lengths;
+  int* faces;
+  int* lines;
+} ExportBatch_t;
+
+static size_t formatVertices(const ExportBatch_t* batch, long first,
+                             long end, char* out) {
+  const ObjExportOptions_t* options = batch->options;
+  char* p = out;
+  for (long v = first; v < end; ++v) {
+    *p++ = 'v';
+    for (int axis = 0; axis < 3; ++axis) {
+      float value = batch->vertices[v * 3 + axis];
+      if (batch->transformed) {
+        value = value * options->scale + options->origin[axis];
+      }
+      *p++ = ' ';
+      p += objFormatFloat(value, p);
+    }
+    *p++ = '\n';
+  }
+  return (size_t)(p - out);
+}
+
+// Each chunk decides between f and l lines on its own, which may group the
+// edges differently than one pass over the whole array would; any grouping
+// reads back as the same edges.
+static size_t formatEdges(const ExportBatch_t* batch, long first, long end,
+                          char* out, int* faces, int* lines) {
+  const unsigned int* indices = batch->indices;
+  char* p = out;
+  long edge = first;
+  while (edge < end) {
+    const unsigned int* e = &indices[edge * 2];
+    if (batch->options->faces && edge + 3 <= end && e[1] == e[2] &&
+        e[3] == e[4] && e[5] == e[0]) {
+      *p++ = 'f';
+      for (int k = 0; k < 6; k += 2) {
+        *p++ = ' ';
+        p = writeIndex(p, e[k]);
+      }
+      edge += 3;
+      ++*faces;
+    } else {
+      *p++ = 'l';
+      *p++ = ' ';
+      p = writeIndex(p, e[0]);
+      *p++ = ' ';
+      p = writeIndex(p, e[1]);
+      edge += 1;
+      ++*lines;
+    }
+    *p++ = '\n';
+  }
+  return (size_t)(p - out);
+}
+
+static void formatChunks(void* context, long begin, long end) {
+  ExportBatch_t* batch = context;
+  for (long c = begin; c < end; ++c) {
+    const long first = (batch->first_chunk + c) * OBJ_EXPORT_CHUNK_RECORDS;
+    long last = first + OBJ_EXPORT_CHUNK_RECORDS;
+    batch->faces[c] = 0;
+    batch->lines[c] = 0;
+    if (batch->edges) {
+      if (last > batch->n_edges) last = batch->n_edges;
+      batch->lengths[c] = formatEdges(batch, first, last, batch->buffers[c],
+                                      &batch->faces[c], &batch->lines[c]);
+    } else {
+      if (last > batch->n_vertices) last = batch->n_vertices;
+      batch->lengths[c] = formatVertices(batch, first, last, batch->buffers[c]);
+    }
+  }
+}
+
+// Formats the vertices or the edges a batch of chunks at a time, in
+// parallel, and writes each batch in order
+static int writeRecords(FILE* file, ExportBatch_t* batch, long records,
+                        int n_buffers, ObjExportStats_t* stats) {
+  const long chunks =
+      (records + OBJ_EXPORT_CHUNK_RECORDS - 1) / OBJ_EXPORT_CHUNK_RECORDS;
+  for (long first = 0; first < chunks; first += n_buffers) {
+    const long count =
+        chunks - first < n_buffers ? chunks - first : (long)n_buffers;
+    batch->first_chunk = first;
+    parallelFor(count, 1, formatChunks, batch);
+    for (long c = 0; c < count; ++c) {
+      if (fwrite(batch->buffers[c], 1, batch->lengths[c], file) !=
+          batch->lengths[c]) {
+        return -1;
+      }
+      stats->bytes += (long long)batch->lengths[c];
+      stats->faces += batch->faces[c];
+      stats->lines += batch->lines[c];
+    }
+  }
+  return 0;
+}
+
+/*!
+ * \brief objExport
+ *
+ * Writes a model as OBJ: the vertices, with the options' scale and origin
+ * applied, then the edges as f or l lines. Chunks of
+ * OBJ_EXPORT_CHUNK_RECORDS vertices or edges are formatted in parallel into
+ * their own buffers, which are written in order with one large write each.
+ * The buffers are accounted as loader temporaries.
+ *
+ * \return 0 on success, -1 if the file could not be written; a partly
+ * written file is removed.
+ */
+int objExport(const char* path, const float* vertices, long long n_vertices,
+              const unsigned int* indices, long long n_indices,
+              const ObjExportOptions_t* options, ObjExportStats_t* stats) {
+  const double start = stageTimerNow();
+  TRACE_BEGIN(export_span);
+  memset(stats, 0, sizeof(*stats));
+  if (n_vertices < 0 || n_indices < 0) return -1;
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) return -1;
+
+  const int n_buffers = parallelThreadCount() * 4;
+  const size_t buffer_bytes = (size_t)OBJ_EXPORT_CHUNK_RECORDS *
+                              (OBJ_EXPORT_VERTEX_BYTES > OBJ_EXPORT_EDGE_BYTES
+                                   ? OBJ_EXPORT_VERTEX_BYTES
+                                   : OBJ_EXPORT_EDGE_BYTES);
+  const size_t table_bytes =
+      (size_t)n_buffers * (sizeof(char*) + sizeof(size_t) + 2 * sizeof(int));
+  char* table = memAccountMalloc(MEM_LOADER_TEMP, table_bytes);
+  int result = table != NULL ? 0 : -1;
+  ExportBatch_t batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.vertices = vertices;
+  batch.n_vertices = n_vertices;
+  batch.indices = indices;
+  batch.n_edges = n_indices / 2;
+  batch.options = options;
+  if (result == 0) {
+    batch.buffers = (char**)table;
+    batch.lengths = (size_t*)(batch.buffers + n_buffers);
+    batch.faces = (int*)(batch.lengths + n_buffers);
+    batch.lines = batch.faces + n_buffers;
+    for (int i = 0; i < n_buffers; ++i) {
+      batch.buffers[i] = memAccountMalloc(MEM_LOADER_TEMP, buffer_bytes);
+      if (batch.buffers[i] == NULL) result = -1;
+    }
+  }
+  batch.transformed = options->scale != 1.0f || options->origin[0] != 0.0f ||
+                      options->origin[1] != 0.0f || options->origin[2] != 0.0f;
+
+  if (result == 0) {
+    const int header =
+        fprintf(file, "# %lld vertices, %lld edges\n", n_vertices,
+                n_indices / 2);
+    result = header < 0 ? -1 : 0;
+    stats->bytes = header;
+  }
+  if (result == 0) {
+    result = writeRecords(file, &batch, n_vertices, n_buffers, stats);
+  }
+  if (result == 0) {
+    batch.edges = 1;
+    result = writeRecords(file, &batch, n_indices / 2, n_buffers, stats);
+  }
+  if (fclose(file) != 0) result = -1;
+  if (result != 0) remove(path);
+
+  if (table != NULL) {
+    for (int i = 0; i < n_buffers; ++i) {
+      memAccountFree(MEM_LOADER_TEMP, batch.buffers[i], buffer_bytes);
+    }
+    memAccountFree(MEM_LOADER_TEMP, table, table_bytes);
+  }
+  stats->vertices = n_vertices;
+  stats->elapsed_ns = stageTimerNow() - start;
+  TRACE_END(export_span, "objExport");
+  return result;
+}
@@ -0,0 +1,46 @@
+#ifndef OBJ_EXPORT_H
+#define OBJ_EXPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Room for the longest float objFormatFloat writes, -0.0000 followed by nine
+// digits, and the NUL
+#define OBJ_EXPORT_FLOAT_CHARS 24
+// Vertices or edges formatted by one parallel task
+#define OBJ_EXPORT_CHUNK_RECORDS 16384
+
+/*!
+ * \brief ObjExportOptions_t
+ *
+ * Vertices are written as v * scale + origin per axis; the identity writes
+ * them as they are, getNormalization() gives back the coordinates of the
+ * loaded file. With faces set, edge triples a-b, b-c, c-a (how the loaders
+ * store a triangle) are written as f lines, all other edges as l lines.
+ */
+typedef struct ObjExportOptions_t {
+  float origin[3];
+  float scale;
+  int faces;
+} ObjExportOptions_t;
+
+typedef struct ObjExportStats_t {
+  long long bytes;
+  long long vertices;
+  long long faces;
+  long long lines;
+  double elapsed_ns;
+} ObjExportStats_t;
+
+void objExportDefaults(ObjExportOptions_t* options);
+int objExport(const char* path, const float* vertices, long long n_vertices,
+              const unsigned int* indices, long long n_indices,
+              const ObjExportOptions_t* options, ObjExportStats_t* stats);
+int objFormatFloat(float value, char* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OBJ_EXPORT_H
@@ -0,0 +1,167 @@
+#include "obj_index.h"
+
+#include <stdlib.h>
+
+#include "backend.h"
+#include "cpu_dispatch.h"
+#include "parallel.h"
+
+// Blocks a thread of objFindBadIndex checks at least
+#define OBJ_INDEX_GRAIN 16
+
+static unsigned int resolveIndex(long long value, long long n_before) {
+  // Positive numbers count from the first vertex of the file, negative ones
+  // back from the last vertex defined before the line
+  const long long index = value > 0 ? value - 1 : n_before + value;
+  if (value == 0 || index < 0 || index >= (long long)OBJ_INDEX_INVALID) {
+    return OBJ_INDEX_INVALID;
+  }
+  return (unsigned int)index;
+}
+
+/*!
+ * \brief objParseIndices
+ *
+ * Reads the vertex references of an "f" or "l" line, such as "f 1 -2/1/1
+ * 3//4", into zero-based indices. Texture and normal references are
+ * skipped. References past count are ignored.
+ *
+ * \param n_before Vertices defined before the line, which relative
+ * (negative) references count back from.
+ * \param corners Filled with count indices; the ones missing or invalid,
+ * such as 0 or a relative reference before the first vertex, are
+ * OBJ_INDEX_INVALID.
+ * \return The number of references read, less than count if the line is
+ * short or malformed.
+ */
+int objParseIndices(const char* line, long long n_before,
+                    unsigned int* corners, int count) {
+  const char* text = line + 1;
+  int parsed = 0;
+  while (parsed < count) {
+    while (*text == ' ' || *text == '\t') ++text;
+    char* end = NULL;
+    const long long value = strtoll(text, &end, 10);
+    if (end == text) break;
+    corners[parsed++] = resolveIndex(value, n_before);
+    text = end;
+    while (*text != '\0' && *text != ' ' && *text != '\t' && *text != '\n' &&
+           *text != '\r') {
+      ++text;
+    }
+  }
+  for (int i = parsed; i < count; ++i) corners[i] = OBJ_INDEX_INVALID;
+  return parsed;
+}
+
+typedef struct IndexCheck_t {
+  const unsigned int* indices;
+  long long n_indices;
+  unsigned int last;
+  unsigned int (*index_max)(const unsigned int* indices, long long count);
+} IndexCheck_t;
+
+// First index over the limit in blocks [begin, end), kept in partial.
+static void findInBlocks(void* context, long begin, long end, void* partial) {
+  const IndexCheck_t* check = context;
+  long long* bad = partial;
+  for (long b = begin; b < end && *bad < 0; ++b) {
+    const long long first = (long long)b * OBJ_INDEX_BLOCK;
+    const long long left = check->n_indices - first;
+    const int n = left < OBJ_INDEX_BLOCK ? (int)left : OBJ_INDEX_BLOCK;
+    if (check->index_max(check->indices + first, n) <= check->last) continue;
+    for (long long i = first; i < first + n && *bad < 0; ++i) {
+      if (check->indices[i] > check->last) *bad = i;
+    }
+  }
+}
+
+// Partials come in order, so the first one found is the first in the array.
+static void keepFirstBad(void* context, void* result, const void* partial) {
+  (void)context;
+  long long* bad = result;
+  if (*bad < 0) *bad = *(const long long*)partial;
+}
+
+/*!
+ * \brief objFindBadIndex
+ *
+ * Checks that every index refers to one of n_vertices vertices. The indices
+ * are unsigned and unresolved references are OBJ_INDEX_INVALID, so one
+ * maximum per block of OBJ_INDEX_BLOCK decides, taken by the index_max
+ * kernel of cpuKernels(); only a block over the limit is searched for its
+ * first bad index. The blocks are spread with parallelReduce().
+ *
+ * \return Position of the first index out of range, -1 if there is none.
+ */
+long long objFindBadIndex(const unsigned int* indices, long long n_indices,
+                          long long n_vertices) {
+  if (n_vertices <= 0) return n_indices > 0 ? 0 : -1;
+  IndexCheck_t check = {indices, n_indices,
+                        n_vertices >= (long long)OBJ_INDEX_INVALID
+                            ? OBJ_INDEX_INVALID - 1
+                            : (unsigned int)(n_vertices - 1),
+                        cpuKernels()->index_max};
+  const long n_blocks =
+      (long)((n_indices + OBJ_INDEX_BLOCK - 1) / OBJ_INDEX_BLOCK);
+  long long bad = -1;
+  if (parallelReduce(n_blocks, OBJ_INDEX_GRAIN, findInBlocks, keepFirstBad,
+                     &check, &bad, sizeof(bad)) != 0) {
+    findInBlocks(&check, 0, n_blocks, &bad);
+  }
+  return bad;
+}
+
+/*!
+ * \brief objNoteSuspect
+ *
+ * Keeps the line of corners as the suspect unless an earlier line is one.
+ *
+ * \param first_index Position in the index array of the line's first index.
+ */
+void objNoteSuspect(ObjIndexSuspect_t* suspect, const unsigned int* corners,
+                    int parsed, int count, long long n_before,
+                    long long first_index, long long line, long long offset) {
+  if (suspect->first_index >= 0) return;
+  int suspicious = parsed < count;
+  for (int i = 0; i < count; ++i) {
+    if ((long long)corners[i] >= n_before) suspicious = 1;
+  }
+  if (!suspicious) return;
+  suspect->first_index = first_index;
+  suspect->width = count == 3 ? 6 : 2;
+  suspect->parsed = parsed;
+  suspect->count = count;
+  suspect->line = line;
+  suspect->offset = offset;
+}
+
+/*!
+ * \brief objReportBadIndex
+ *
+ * Records for getLoadError() why the index at position, found by
+ * objFindBadIndex(), is bad, naming the line when it is the suspect one.
+ */
+void objReportBadIndex(const ObjIndexSuspect_t* suspect, long long position,
+                       unsigned int index, long long n_vertices) {
+  const long long line = suspect->line;
+  if (suspect->first_index < 0 || position < suspect->first_index ||
+      position >= suspect->first_index + suspect->width) {
+    setLoadError(LOAD_ERROR_INDEX, 0, -1,
+                 "vertex index %lld of the model is out of range", position);
+  } else if (suspect->parsed < suspect->count) {
+    setLoadError(LOAD_ERROR_SYNTAX, line, suspect->offset,
+                 "line %lld: %s needs %d vertex indices, found %d", line,
+                 suspect->count == 3 ? "face" : "line", suspect->count,
+                 suspect->parsed);
+  } else if (index == OBJ_INDEX_INVALID) {
+    setLoadError(LOAD_ERROR_INDEX, line, suspect->offset,
+                 "line %lld: a vertex reference does not name a vertex",
+                 line);
+  } else {
+    setLoadError(LOAD_ERROR_INDEX, line, suspect->offset,
+                 "line %lld: vertex %u is out of range, the model has %lld "
+                 "vertices",
+                 line, index + 1, n_vertices);
+  }
+}
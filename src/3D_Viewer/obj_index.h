@@ -0,0 +1,45 @@
+#ifndef OBJ_INDEX_H
+#define OBJ_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Stored for vertex references that cannot be resolved, never a valid index
+#define OBJ_INDEX_INVALID 0xffffffffu
+// Indices reduced at a time before the maximum is compared with the limit
+#define OBJ_INDEX_BLOCK 4096
+
+/*!
+ * \brief ObjIndexSuspect_t
+ *
+ * The first line whose indices could turn out out of range once a single
+ * pass over the model ends: a short line, a reference that names no vertex
+ * or one past the vertices read so far. The first bad line is at or after
+ * it, and input read once cannot be read again to find it. Starts as
+ * {-1, 0, 0, 0, 0, -1}.
+ */
+typedef struct ObjIndexSuspect_t {
+  long long first_index;  // -1 while no line is suspect
+  int width;
+  int parsed;
+  int count;
+  long long line;
+  long long offset;
+} ObjIndexSuspect_t;
+
+int objParseIndices(const char* line, long long n_before,
+                    unsigned int* corners, int count);
+long long objFindBadIndex(const unsigned int* indices, long long n_indices,
+                          long long n_vertices);
+void objNoteSuspect(ObjIndexSuspect_t* suspect, const unsigned int* corners,
+                    int parsed, int count, long long n_before,
+                    long long first_index, long long line, long long offset);
+void objReportBadIndex(const ObjIndexSuspect_t* suspect, long long position,
+                       unsigned int index, long long n_vertices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OBJ_INDEX_H
@@ -0,0 +1,528 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "obj_reload.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "backend.h"
+#include "memory_stats.h"
+#include "my_getline.h"
+#include "obj_index.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+typedef struct ReloadChunk_t {
+  uint64_t hash;
+  long long offset;
+  long long bytes;
+  int n_vertices;
+  int n_indices;
+  long long first_vertex;
+  long long first_index;
+  int order;
+  // Bounds of the chunk's positions, with the initial values of the parser
+  float min[3];
+  float max[3];
+  // Relative vertex references depend on first_vertex, so such a chunk is
+  // parsed again when it moves
+  int relative;
+} ReloadChunk_t;
+
+struct ObjReload_t {
+  ReloadChunk_t* chunks;
+  int n_chunks;
+  int capacity;
+  // Positions as read, before normalization
+  float* raw;
+  size_t raw_bytes;
+  long long n_vertices;
+  long long n_indices;
+  float min[3];
+  float max[3];
+  int loaded;
+};
+
+static uint64_t hashBytes(uint64_t hash, const char* bytes, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= (unsigned char)bytes[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+static void emptyBounds(float min[3], float max[3]) {
+  for (int axis = 0; axis < 3; ++axis) {
+    min[axis] = FLT_MAX;
+    max[axis] = FLT_MIN;
+  }
+}
+
+static int reserveChunks(ReloadChunk_t** chunks, int* capacity, int needed) {
+  if (needed <= *capacity) return 0;
+  const int grown = *capacity ? *capacity * 2 : 64;
+  ReloadChunk_t* resized = realloc(*chunks, grown * sizeof(ReloadChunk_t));
+  if (resized == NULL) return -1;
+  memAccountAdd(MEM_CACHES, (long long)(grown - *capacity) *
+                                (long long)sizeof(ReloadChunk_t));
+  *chunks = resized;
+  *capacity = grown;
+  return 0;
+}
+
+typedef struct ScanState_t {
+  ReloadChunk_t** chunks;
+  int* capacity;
+  int n_chunks;
+  long long offset;
+  ReloadChunk_t current;
+} ScanState_t;
+
+static int finishLine(ScanState_t* scan, uint64_t line_hash,
+                      long long line_bytes, const char prefix[2]) {
+  ReloadChunk_t* current = &scan->current;
+  current->hash = (current->hash ^ line_hash) * FNV_PRIME;
+  current->bytes += line_bytes;
+  scan->offset += line_bytes;
+  if (prefix[0] == 'v' && prefix[1] == ' ') {
+    ++current->n_vertices;
+  } else if (prefix[0] == 'l' && prefix[1] == ' ') {
+    current->n_indices += 2;
+  } else if (prefix[0] == 'f' && prefix[1] == ' ') {
+    current->n_indices += 6;
+  }
+  const int boundary = current->bytes >= OBJ_RELOAD_MIN_CHUNK_BYTES &&
+                       (line_hash & OBJ_RELOAD_BOUNDARY_MASK) == 0;
+  if (!boundary && current->bytes < OBJ_RELOAD_MAX_CHUNK_BYTES) return 0;
+  if (reserveChunks(scan->chunks, scan->capacity, scan->n_chunks + 1) != 0) {
+    return -1;
+  }
+  (*scan->chunks)[scan->n_chunks++] = *current;
+  current->hash = FNV_OFFSET;
+  current->offset = scan->offset;
+  current->bytes = 0;
+  current->n_vertices = 0;
+  current->n_indices = 0;
+  return 0;
+}
+
+/*!
+ * \brief scanChunks
+ *
+ * Splits the file into chunks and counts the vertices and indices of each
+ * the way parseObjFile does, without parsing any numbers. The file is read
+ * in blocks, lines are only looked at for their first two characters.
+ *
+ * \return Number of chunks, -1 if the table could not be allocated.
+ */
+static int scanChunks(FILE* file, ReloadChunk_t** chunks, int* capacity) {
+  const size_t block_bytes = 1 << 20;
+  char* block = memAccountMalloc(MEM_LOADER_TEMP, block_bytes);
+  if (block == NULL) return -1;
+  ScanState_t scan = {chunks, capacity, 0, 0, {FNV_OFFSET, 0, 0, 0, 0, 0, 0,
+                                               0, {0}, {0}, 0}};
+  uint64_t line_hash = FNV_OFFSET;
+  long long line_bytes = 0;
+  char prefix[2] = {0, 0};
+  int status = 0;
+  size_t read = 0;
+  while (status == 0 && (read = fread(block, 1, block_bytes, file)) > 0) {
+    size_t position = 0;
+    while (status == 0 && position < read) {
+      const char* newline = memchr(block + position, '\n', read - position);
+      const size_t end = newline ? (size_t)(newline - block) + 1 : read;
+      // The first two characters of a line may be in two blocks
+      for (size_t i = position; i < end; ++i) {
+        const long long column = line_bytes + (long long)(i - position);
+        if (column >= 2) break;
+        prefix[column] = block[i];
+      }
+      line_hash = hashBytes(line_hash, block + position, end - position);
+      line_bytes += (long long)(end - position);
+      position = end;
+      if (newline != NULL) {
+        status = finishLine(&scan, line_hash, line_bytes, prefix);
+        line_hash = FNV_OFFSET;
+        line_bytes = 0;
+        prefix[0] = prefix[1] = 0;
+      }
+    }
+  }
+  // The last line may have no newline
+  if (status == 0 && line_bytes > 0) {
+    status = finishLine(&scan, line_hash, line_bytes, prefix);
+  }
+  if (status == 0 && scan.current.bytes > 0) {
+    status = reserveChunks(chunks, capacity, scan.n_chunks + 1);
+    if (status == 0) (*chunks)[scan.n_chunks++] = scan.current;
+  }
+  memAccountFree(MEM_LOADER_TEMP, block, block_bytes);
+  return status == 0 ? scan.n_chunks : -1;
+}
+
+/*!
+ * \brief parseChunk
+ *
+ * Parses the lines of one chunk into raw positions and indices, with the
+ * same rules as parseObjFile, and fills the chunk's bounds. Writes stay
+ * within the counts of the scan, in case the file changes in between.
+ */
+static void parseChunk(FILE* file, ReloadChunk_t* chunk, float* raw,
+                       unsigned int* indices, char** line, size_t* length) {
+  emptyBounds(chunk->min, chunk->max);
+  chunk->relative = 0;
+  fseeko(file, (off_t)chunk->offset, SEEK_SET);
+  float* const first = raw + (size_t)chunk->first_vertex * 3;
+  float* vertex = first;
+  const float* vertex_end = vertex + (size_t)chunk->n_vertices * 3;
+  unsigned int* index = indices + chunk->first_index;
+  const unsigned int* index_end = index + chunk->n_indices;
+  long long consumed = 0;
+  ssize_t read = 0;
+  while (consumed < chunk->bytes &&
+         (read = my_getline_allocate(line, length, file)) != -1) {
+    consumed += read;
+    const char* text = *line;
+    if (text[0] == 'v' && text[1] == ' ' && vertex < vertex_end) {
+      float position[3] = {0.0f, 0.0f, 0.0f};
+      sscanf(text, "v %f %f %f", &position[0], &position[1], &position[2]);
+      for (int axis = 0; axis < 3; ++axis) {
+        chunk->min[axis] = fmin(chunk->min[axis], position[axis]);
+        chunk->max[axis] = fmax(chunk->max[axis], position[axis]);
+        *vertex++ = position[axis];
+      }
+    } else if (text[0] == 'l' && text[1] == ' ' && index + 2 <= index_end) {
+      const long long n_before = chunk->first_vertex + (vertex - first) / 3;
+      objParseIndices(text, n_before, index, 2);
+      index += 2;
+      if (strchr(text, '-') != NULL) chunk->relative = 1;
+    } else if (text[0] == 'f' && text[1] == ' ' && index + 6 <= index_end) {
+      const long long n_before = chunk->first_vertex + (vertex - first) / 3;
+      unsigned int corners[3];
+      objParseIndices(text, n_before, corners, 3);
+      for (int i = 0; i < 3; ++i) {
+        *index++ = corners[i];
+        *index++ = corners[(i + 1) % 3];
+      }
+      if (strchr(text, '-') != NULL) chunk->relative = 1;
+    }
+  }
+  while (vertex < vertex_end) *vertex++ = 0.0f;
+  while (index < index_end) *index++ = 0;
+}
+
+/*!
+ * \brief writeVertices
+ *
+ * Normalizes raw positions like parseObjFile and applies the column-major
+ * transform, unless it is NULL.
+ */
+static void writeVertices(float* out, const float* raw, long long first,
+                          long long count, const float min[3], float range,
+                          const float* transform) {
+  for (long long v = first; v < first + count; ++v) {
+    float p[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      p[axis] = (raw[v * 3 + axis] - min[axis]) / range;
+    }
+    if (transform == NULL) {
+      memcpy(out + (size_t)v * 3, p, sizeof(p));
+      continue;
+    }
+    for (int row = 0; row < 3; ++row) {
+      out[(size_t)v * 3 + row] =
+          transform[row] * p[0] + transform[4 + row] * p[1] +
+          transform[8 + row] * p[2] + transform[12 + row];
+    }
+  }
+}
+
+static int isIdentity(const float* transform) {
+  if (transform == NULL) return 1;
+  for (int i = 0; i < 16; ++i) {
+    if (transform[i] != (i % 5 == 0 ? 1.0f : 0.0f)) return 0;
+  }
+  return 1;
+}
+
+static int compareChunkHashes(const void* a, const void* b) {
+  const uint64_t x = ((const ReloadChunk_t*)a)->hash;
+  const uint64_t y = ((const ReloadChunk_t*)b)->hash;
+  return (x > y) - (x < y);
+}
+
+// Finds an old chunk with the hash of chunk, preferring the one at *cursor
+// so unchanged runs keep their order.
+static const ReloadChunk_t* findOldChunk(const ObjReload_t* reload,
+                                         const ReloadChunk_t* sorted,
+                                         const ReloadChunk_t* chunk,
+                                         int* cursor) {
+  if (*cursor < reload->n_chunks &&
+      reload->chunks[*cursor].hash == chunk->hash) {
+    return &reload->chunks[(*cursor)++];
+  }
+  const ReloadChunk_t* match =
+      bsearch(chunk, sorted, reload->n_chunks, sizeof(ReloadChunk_t),
+              compareChunkHashes);
+  if (match == NULL) return NULL;
+  *cursor = match->order + 1;
+  return &reload->chunks[match->order];
+}
+
+ObjReload_t* objReloadCreate(void) {
+  return calloc(1, sizeof(ObjReload_t));
+}
+
+void objReloadDestroy(ObjReload_t* reload) {
+  if (reload == NULL) return;
+  memAccountRelease(MEM_CACHES, (long long)reload->capacity *
+                                    (long long)sizeof(ReloadChunk_t));
+  free(reload->chunks);
+  memAccountFree(MEM_CACHES, reload->raw, reload->raw_bytes);
+  free(reload);
+}
+
+/*!
+ * \brief objReload
+ *
+ * Loads an OBJ file into the arrays of the previous load, parsing only the
+ * chunks that changed since then. The first call on a new ObjReload_t
+ * parses everything and gives the same arrays as parseObjFile. Unchanged
+ * chunks are copied, or left in place when no counts changed before them;
+ * if the bounding box changed every vertex is normalized again from the
+ * kept raw positions.
+ *
+ * \param transform Column-major matrix applied to the written vertices, the
+ * transforms made to the model since it was loaded. NULL for none.
+ * \param vertices,indices The arrays of the previous call (NULL the first
+ * time), replaced with loaderAlloc/loaderFree when counts changed.
+ * \return 0 on success, -1 if the file could not be read; the arrays are
+ * unchanged then. The indices are not checked against the vertex count,
+ * see objFindBadIndex().
+ */
+int objReload(ObjReload_t* reload, const char* path, const float transform[16],
+              float** vertices, long long* n_vertices,
+              unsigned int** indices, long long* n_indices,
+              ObjReloadStats_t* stats) {
+  TRACE_BEGIN(span);
+  const double start = stageTimerNow();
+  memset(stats, 0, sizeof(*stats));
+  stats->first_dirty_vertex = -1;
+  stats->first_dirty_index = -1;
+  FILE* file = fopen(path, "r");
+  if (file == NULL) return -1;
+
+  ReloadChunk_t* chunks = NULL;
+  int capacity = 0;
+  const int n_chunks = scanChunks(file, &chunks, &capacity);
+  ReloadChunk_t* sorted = NULL;
+  if (n_chunks >= 0 && reload->n_chunks > 0) {
+    sorted = malloc(reload->n_chunks * sizeof(ReloadChunk_t));
+  }
+  if (n_chunks < 0 || (reload->n_chunks > 0 && sorted == NULL)) {
+    memAccountRelease(MEM_CACHES,
+                      (long long)capacity * (long long)sizeof(ReloadChunk_t));
+    free(chunks);
+    fclose(file);
+    return -1;
+  }
+  if (sorted != NULL) {
+    memcpy(sorted, reload->chunks, reload->n_chunks * sizeof(ReloadChunk_t));
+    qsort(sorted, reload->n_chunks, sizeof(ReloadChunk_t), compareChunkHashes);
+  }
+
+  // Lay the new chunks out and match them with the old ones
+  long long total_vertices = 0;
+  long long total_indices = 0;
+  for (int i = 0; i < n_chunks; ++i) {
+    chunks[i].order = i;
+    chunks[i].first_vertex = total_vertices;
+    chunks[i].first_index = total_indices;
+    total_vertices += chunks[i].n_vertices;
+    total_indices += chunks[i].n_indices;
+  }
+  const ReloadChunk_t** old = calloc(n_chunks ? n_chunks : 1, sizeof(*old));
+  int in_place = reload->loaded && total_vertices == reload->n_vertices &&
+                 total_indices == reload->n_indices;
+  int cursor = 0;
+  for (int i = 0; i < n_chunks && old != NULL; ++i) {
+    if (reload->loaded) {
+      old[i] = findOldChunk(reload, sorted, &chunks[i], &cursor);
+    }
+    if (old[i] != NULL && old[i]->relative &&
+        old[i]->first_vertex != chunks[i].first_vertex) {
+      old[i] = NULL;
+    }
+    if (old[i] != NULL && (old[i]->first_vertex != chunks[i].first_vertex ||
+                           old[i]->first_index != chunks[i].first_index)) {
+      in_place = 0;
+    }
+  }
+
+  // Everything that can fail is allocated before the arrays are touched
+  float* raw = reload->raw;
+  float* new_vertices = *vertices;
+  unsigned int* new_indices = *indices;
+  const size_t vertex_bytes = (size_t)total_vertices * 3 * sizeof(float);
+  const size_t raw_bytes = vertex_bytes ? vertex_bytes : 1;
+  const size_t index_bytes = (size_t)total_indices * sizeof(unsigned int);
+  int allocated = old != NULL;
+  if (allocated && !in_place) {
+    raw = memAccountMalloc(MEM_CACHES, raw_bytes);
+    new_indices = loaderAlloc(MEM_INDICES, index_bytes);
+    allocated = raw != NULL && (new_indices != NULL || index_bytes == 0);
+  }
+  if (allocated && (total_vertices != *n_vertices || *vertices == NULL)) {
+    new_vertices = loaderAlloc(MEM_VERTICES, vertex_bytes);
+    allocated = new_vertices != NULL || vertex_bytes == 0;
+  }
+  if (!allocated) {
+    if (raw != reload->raw) memAccountFree(MEM_CACHES, raw, raw_bytes);
+    if (new_indices != *indices) {
+      loaderFree(MEM_INDICES, new_indices, index_bytes);
+    }
+    if (new_vertices != *vertices) {
+      loaderFree(MEM_VERTICES, new_vertices, vertex_bytes);
+    }
+    free(old);
+    free(sorted);
+    memAccountRelease(MEM_CACHES,
+                      (long long)capacity * (long long)sizeof(ReloadChunk_t));
+    free(chunks);
+    fclose(file);
+    return -1;
+  }
+
+  char* line = NULL;
+  size_t length = 0;
+  long long dirty_vertex_end = -1;
+  long long dirty_index_end = -1;
+  for (int i = 0; i < n_chunks; ++i) {
+    ReloadChunk_t* chunk = &chunks[i];
+    stats->bytes += chunk->bytes;
+    if (old[i] != NULL) {
+      memcpy(chunk->min, old[i]->min, sizeof(chunk->min));
+      memcpy(chunk->max, old[i]->max, sizeof(chunk->max));
+      chunk->relative = old[i]->relative;
+      if (!in_place) {
+        memcpy(raw + (size_t)chunk->first_vertex * 3,
+               reload->raw + (size_t)old[i]->first_vertex * 3,
+               (size_t)chunk->n_vertices * 3 * sizeof(float));
+        if (chunk->n_indices > 0) {
+          memcpy(new_indices + chunk->first_index,
+                 *indices + old[i]->first_index,
+                 (size_t)chunk->n_indices * sizeof(unsigned int));
+        }
+      }
+      continue;
+    }
+    parseChunk(file, chunk, raw, new_indices, &line, &length);
+    ++stats->dirty_chunks;
+    stats->dirty_bytes += chunk->bytes;
+    if (chunk->n_vertices > 0) {
+      if (stats->first_dirty_vertex < 0) {
+        stats->first_dirty_vertex = chunk->first_vertex;
+      }
+      dirty_vertex_end = chunk->first_vertex + chunk->n_vertices;
+    }
+    if (chunk->n_indices > 0) {
+      if (stats->first_dirty_index < 0) {
+        stats->first_dirty_index = chunk->first_index;
+      }
+      dirty_index_end = chunk->first_index + chunk->n_indices;
+    }
+  }
+  if (line) {
+    memAccountAdd(MEM_LOADER_TEMP, (long long)length);
+    memAccountRelease(MEM_LOADER_TEMP, (long long)length);
+    free(line);
+  }
+  fclose(file);
+  free(sorted);
+
+  float min[3];
+  float max[3];
+  emptyBounds(min, max);
+  for (int i = 0; i < n_chunks; ++i) {
+    for (int axis = 0; axis < 3; ++axis) {
+      min[axis] = fmin(min[axis], chunks[i].min[axis]);
+      max[axis] = fmax(max[axis], chunks[i].max[axis]);
+    }
+  }
+  const float range = fmax(fmax(max[0] - min[0], max[1] - min[1]),
+                           max[2] - min[2]);
+  const int same_bounds = reload->loaded &&
+                          memcmp(min, reload->min, sizeof(min)) == 0 &&
+                          memcmp(max, reload->max, sizeof(max)) == 0;
+  const float* matrix = isIdentity(transform) ? NULL : transform;
+  setNormalization(min, range);
+
+  if (in_place && same_bounds) {
+    for (int i = 0; i < n_chunks; ++i) {
+      if (old[i] == NULL) {
+        writeVertices(new_vertices, raw, chunks[i].first_vertex,
+                      chunks[i].n_vertices, min, range, matrix);
+      }
+    }
+  } else {
+    writeVertices(new_vertices, raw, 0, total_vertices, min, range, matrix);
+    stats->renormalized = !same_bounds;
+  }
+  free(old);
+
+  if (new_vertices != *vertices) {
+    loaderFree(MEM_VERTICES, *vertices,
+               (size_t)*n_vertices * 3 * sizeof(float));
+  }
+  if (new_indices != *indices) {
+    loaderFree(MEM_INDICES, *indices,
+               (size_t)*n_indices * sizeof(unsigned int));
+  }
+  if (raw != reload->raw) {
+    memAccountFree(MEM_CACHES, reload->raw, reload->raw_bytes);
+    reload->raw_bytes = raw_bytes;
+  }
+  memAccountRelease(MEM_CACHES, (long long)reload->capacity *
+                                    (long long)sizeof(ReloadChunk_t));
+  free(reload->chunks);
+  reload->chunks = chunks;
+  reload->n_chunks = n_chunks;
+  reload->capacity = capacity;
+  reload->raw = raw;
+  reload->n_vertices = total_vertices;
+  reload->n_indices = total_indices;
+  memcpy(reload->min, min, sizeof(min));
+  memcpy(reload->max, max, sizeof(max));
+  reload->loaded = 1;
+
+  *vertices = new_vertices;
+  *n_vertices = total_vertices;
+  *indices = new_indices;
+  *n_indices = total_indices;
+
+  stats->chunks = n_chunks;
+  stats->relayout = !in_place;
+  if (!in_place || !same_bounds) {
+    stats->first_dirty_vertex = total_vertices > 0 ? 0 : -1;
+    stats->dirty_vertices = total_vertices;
+  } else if (stats->first_dirty_vertex >= 0) {
+    stats->dirty_vertices = dirty_vertex_end - stats->first_dirty_vertex;
+  }
+  if (!in_place) {
+    stats->first_dirty_index = total_indices > 0 ? 0 : -1;
+    stats->dirty_indices = total_indices;
+  } else if (stats->first_dirty_index >= 0) {
+    stats->dirty_indices = dirty_index_end - stats->first_dirty_index;
+  }
+  stats->elapsed_ns = stageTimerNow() - start;
+  TRACE_END(span, "objReload");
+  return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef OBJ_RELOAD_H
+#define OBJ_RELOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Chunks end at a line boundary after at least OBJ_RELOAD_MIN_CHUNK_BYTES,
+// where the hash of the line has its low bits clear, so an inserted line
+// only changes the chunk around it. No chunk exceeds the maximum by more
+// than one line.
+#define OBJ_RELOAD_MIN_CHUNK_BYTES (16 << 10)
+#define OBJ_RELOAD_MAX_CHUNK_BYTES (1 << 20)
+#define OBJ_RELOAD_BOUNDARY_MASK 1023u
+
+/*!
+ * \brief ObjReload_t
+ *
+ * What is needed to reload a changed OBJ file incrementally: the hash,
+ * position and vertex and index counts of every chunk of the previous load,
+ * and the positions before normalization. Only chunks whose hash changed are
+ * parsed again.
+ */
+typedef struct ObjReload_t ObjReload_t;
+
+/*!
+ * \brief ObjReloadStats_t
+ *
+ * Result of objReload(). The dirty ranges are the parts of the vertex and
+ * index arrays that were written, first_dirty_* is -1 when nothing changed.
+ * relayout is set when vertex or index counts of the chunks changed and new
+ * arrays were allocated, renormalized when the bounding box changed and all
+ * vertices were normalized again.
+ */
+typedef struct ObjReloadStats_t {
+  int chunks;
+  int dirty_chunks;
+  long long bytes;
+  long long dirty_bytes;
+  long long first_dirty_vertex;
+  long long dirty_vertices;
+  long long first_dirty_index;
+  long long dirty_indices;
+  int relayout;
+  int renormalized;
+  double elapsed_ns;
+} ObjReloadStats_t;
+
+ObjReload_t* objReloadCreate(void);
+void objReloadDestroy(ObjReload_t* reload);
+int objReload(ObjReload_t* reload, const char* path, const float transform[16],
+              float** vertices, long long* n_vertices,
+              unsigned int** indices, long long* n_indices,
+              ObjReloadStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OBJ_RELOAD_H
@@ -0,0 +1,459 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "obj_stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "backend.h"
+#include "memory_stats.h"
+#include "obj_index.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+typedef struct StreamBlock_t {
+  char* data;
+  size_t length;
+  // Filled by the reader and not handed back by the parser yet
+  int full;
+  // Nothing follows this block
+  int last;
+} StreamBlock_t;
+
+struct ObjStream_t {
+  int fd;
+  pthread_t reader;
+  pthread_mutex_t mutex;
+  pthread_cond_t filled;
+  pthread_cond_t emptied;
+  StreamBlock_t blocks[2];
+  int stop;
+  int error;
+  // Parser side, only touched by the thread reading lines
+  int current;
+  size_t position;
+  int finished;
+  char* carry;
+  size_t carry_size;
+  ObjStreamStats_t stats;
+};
+
+// Reads until the block is full or the input ends.
+static size_t fillBlock(ObjStream_t* stream, char* data, int* last,
+                        int* error) {
+  size_t length = 0;
+  while (length < OBJ_STREAM_BLOCK_BYTES) {
+    const ssize_t got =
+        read(stream->fd, data + length, OBJ_STREAM_BLOCK_BYTES - length);
+    if (got > 0) {
+      length += (size_t)got;
+    } else if (got < 0 && errno == EINTR) {
+      continue;
+    } else {
+      *last = 1;
+      *error = got < 0;
+      break;
+    }
+  }
+  return length;
+}
+
+/*!
+ * \brief readBlocks
+ *
+ * Reader thread: fills the two blocks in turn, each as soon as the parser
+ * has handed it back, until the input ends or the stream is closed.
+ */
+static void* readBlocks(void* argument) {
+  ObjStream_t* stream = argument;
+  traceSetThreadName("obj stream");
+  for (int index = 0;; index ^= 1) {
+    StreamBlock_t* block = &stream->blocks[index];
+    pthread_mutex_lock(&stream->mutex);
+    while (block->full && !stream->stop) {
+      pthread_cond_wait(&stream->emptied, &stream->mutex);
+    }
+    const int stop = stream->stop;
+    pthread_mutex_unlock(&stream->mutex);
+    if (stop) break;
+
+    int last = 0;
+    int error = 0;
+    const double start = stageTimerNow();
+    const size_t length = fillBlock(stream, block->data, &last, &error);
+    const double read_ns = stageTimerNow() - start;
+
+    pthread_mutex_lock(&stream->mutex);
+    block->length = length;
+    block->last = last;
+    block->full = 1;
+    stream->error |= error;
+    stream->stats.bytes += (long long)length;
+    stream->stats.blocks++;
+    stream->stats.read_ns += read_ns;
+    pthread_cond_signal(&stream->filled);
+    pthread_mutex_unlock(&stream->mutex);
+    if (last) break;
+  }
+  return NULL;
+}
+
+/*!
+ * \brief objStreamOpen
+ *
+ * Starts reading fd on a thread of its own. The descriptor is not closed by
+ * objStreamClose.
+ *
+ * \return The stream, or NULL if its memory or thread could not be had.
+ */
+ObjStream_t* objStreamOpen(int fd) {
+  ObjStream_t* stream = calloc(1, sizeof(ObjStream_t));
+  if (stream == NULL) return NULL;
+  stream->fd = fd;
+  stream->current = -1;
+  for (int i = 0; i < 2; ++i) {
+    stream->blocks[i].data =
+        memAccountMalloc(MEM_LOADER_TEMP, OBJ_STREAM_BLOCK_BYTES);
+  }
+  if (stream->blocks[0].data == NULL || stream->blocks[1].data == NULL) {
+    for (int i = 0; i < 2; ++i) {
+      memAccountFree(MEM_LOADER_TEMP, stream->blocks[i].data,
+                     OBJ_STREAM_BLOCK_BYTES);
+    }
+    free(stream);
+    return NULL;
+  }
+  pthread_mutex_init(&stream->mutex, NULL);
+  pthread_cond_init(&stream->filled, NULL);
+  pthread_cond_init(&stream->emptied, NULL);
+  if (pthread_create(&stream->reader, NULL, readBlocks, stream) != 0) {
+    pthread_mutex_destroy(&stream->mutex);
+    pthread_cond_destroy(&stream->filled);
+    pthread_cond_destroy(&stream->emptied);
+    for (int i = 0; i < 2; ++i) {
+      memAccountFree(MEM_LOADER_TEMP, stream->blocks[i].data,
+                     OBJ_STREAM_BLOCK_BYTES);
+    }
+    free(stream);
+    return NULL;
+  }
+  return stream;
+}
+
+// Hands the current block back to the reader and waits for the next one.
+// Returns 0 once the block handed back was the last.
+static int nextBlock(ObjStream_t* stream) {
+  int next = 0;
+  if (stream->current >= 0) {
+    StreamBlock_t* done = &stream->blocks[stream->current];
+    pthread_mutex_lock(&stream->mutex);
+    const int last = done->last;
+    done->full = 0;
+    pthread_cond_signal(&stream->emptied);
+    pthread_mutex_unlock(&stream->mutex);
+    stream->current = -1;
+    if (last) {
+      stream->finished = 1;
+      return 0;
+    }
+    next = (int)(done - stream->blocks) ^ 1;
+  }
+  const double start = stageTimerNow();
+  pthread_mutex_lock(&stream->mutex);
+  while (!stream->blocks[next].full) {
+    pthread_cond_wait(&stream->filled, &stream->mutex);
+  }
+  pthread_mutex_unlock(&stream->mutex);
+  stream->stats.wait_ns += stageTimerNow() - start;
+  stream->current = next;
+  stream->position = 0;
+  return 1;
+}
+
+static int appendCarry(ObjStream_t* stream, size_t used, const char* bytes,
+                       size_t length) {
+  if (used + length + 1 > stream->carry_size) {
+    size_t size = stream->carry_size ? stream->carry_size : 128;
+    while (used + length + 1 > size) size *= 2;
+    char* carry = memAccountMalloc(MEM_LOADER_TEMP, size);
+    if (carry == NULL) return -1;
+    if (used > 0) memcpy(carry, stream->carry, used);
+    memAccountFree(MEM_LOADER_TEMP, stream->carry, stream->carry_size);
+    stream->carry = carry;
+    stream->carry_size = size;
+  }
+  memcpy(stream->carry + used, bytes, length);
+  stream->carry[used + length] = '\0';
+  return 0;
+}
+
+/*!
+ * \brief objStreamGetLine
+ *
+ * Returns the next line without its newline. Lines within a block are
+ * handed out in place, only lines that span blocks are copied together.
+ * The line stays valid until the next call.
+ *
+ * \return Length of the line, -1 at the end of the input or if a line
+ * could not be copied.
+ */
+ssize_t objStreamGetLine(ObjStream_t* stream, char** line) {
+  size_t carried = 0;
+  int partial = 0;
+  for (;;) {
+    if (stream->current < 0 ||
+        stream->position >= stream->blocks[stream->current].length) {
+      if (stream->finished || !nextBlock(stream)) break;
+      continue;
+    }
+    StreamBlock_t* block = &stream->blocks[stream->current];
+    char* start = block->data + stream->position;
+    const size_t available = block->length - stream->position;
+    char* newline = memchr(start, '\n', available);
+    if (newline == NULL) {
+      // The line goes on in the next block
+      if (appendCarry(stream, carried, start, available) != 0) return -1;
+      carried += available;
+      partial = 1;
+      stream->position = block->length;
+      continue;
+    }
+    const size_t length = (size_t)(newline - start);
+    *newline = '\0';
+    stream->position += length + 1;
+    if (!partial) {
+      *line = start;
+      return (ssize_t)length;
+    }
+    if (appendCarry(stream, carried, start, length) != 0) return -1;
+    *line = stream->carry;
+    return (ssize_t)(carried + length);
+  }
+  if (!partial) return -1;
+  // The last line has no newline
+  *line = stream->carry;
+  return (ssize_t)carried;
+}
+
+// Whether reading the input failed, as opposed to ending.
+int objStreamError(ObjStream_t* stream) {
+  pthread_mutex_lock(&stream->mutex);
+  const int error = stream->error;
+  pthread_mutex_unlock(&stream->mutex);
+  return error;
+}
+
+void objStreamGetStats(ObjStream_t* stream, ObjStreamStats_t* stats) {
+  pthread_mutex_lock(&stream->mutex);
+  *stats = stream->stats;
+  pthread_mutex_unlock(&stream->mutex);
+}
+
+/*!
+ * \brief objStreamClose
+ *
+ * Stops the reader and frees the stream. Closed before the end of the
+ * input, it waits for the read in progress to return.
+ */
+void objStreamClose(ObjStream_t* stream) {
+  if (stream == NULL) return;
+  pthread_mutex_lock(&stream->mutex);
+  stream->stop = 1;
+  pthread_cond_signal(&stream->emptied);
+  pthread_mutex_unlock(&stream->mutex);
+  pthread_join(stream->reader, NULL);
+  pthread_mutex_destroy(&stream->mutex);
+  pthread_cond_destroy(&stream->filled);
+  pthread_cond_destroy(&stream->emptied);
+  for (int i = 0; i < 2; ++i) {
+    memAccountFree(MEM_LOADER_TEMP, stream->blocks[i].data,
+                   OBJ_STREAM_BLOCK_BYTES);
+  }
+  memAccountFree(MEM_LOADER_TEMP, stream->carry, stream->carry_size);
+  free(stream);
+}
+
+/*!
+ * \brief objStreamIsPipe
+ *
+ * Whether a model path has to be read as a stream: "-" for the standard
+ * input, or anything that is not a regular file, such as a named pipe or
+ * /dev/stdin. Such inputs can be read only once and from the start.
+ */
+int objStreamIsPipe(const char* path) {
+  if (strcmp(path, "-") == 0) return 1;
+  struct stat info;
+  return stat(path, &info) == 0 && !S_ISREG(info.st_mode) &&
+         !S_ISDIR(info.st_mode);
+}
+
+// The descriptor to stream a path from, see objStreamIsPipe().
+int objStreamOpenPath(const char* path) {
+  if (strcmp(path, "-") == 0) return dup(STDIN_FILENO);
+  return open(path, O_RDONLY);
+}
+
+typedef struct GrowingArray_t {
+  void* data;
+  size_t used;
+  size_t capacity;
+  MemCategory_t category;
+} GrowingArray_t;
+
+// Makes room for bytes more, doubling the capacity.
+static int reserveBytes(GrowingArray_t* array, size_t bytes) {
+  if (array->used + bytes <= array->capacity) return 0;
+  size_t capacity =
+      array->capacity ? array->capacity * 2 : OBJ_STREAM_INITIAL_BYTES;
+  while (capacity < array->used + bytes) capacity *= 2;
+  void* data = loaderAlloc(array->category, capacity);
+  if (data == NULL) return -1;
+  if (array->used > 0) memcpy(data, array->data, array->used);
+  loaderFree(array->category, array->data, array->capacity);
+  array->data = data;
+  array->capacity = capacity;
+  return 0;
+}
+
+// Shrinks the array to what is used, NULL when that is nothing.
+static void* finishArray(GrowingArray_t* array) {
+  if (array->used == 0) {
+    loaderFree(array->category, array->data, array->capacity);
+    return NULL;
+  }
+  return loaderShrink(array->category, array->data, array->capacity,
+                      array->used);
+}
+
+/*!
+ * \brief parseObjStream
+ *
+ * parseObjFile for input that can be read only once: a single pass over the
+ * lines of an ObjStream_t, with the vertex and index arrays growing as
+ * lines arrive. Gives the same arrays and normalization as parseObjFile,
+ * and checks the indices the same way.
+ *
+ * \param fd Read to its end and left open.
+ * \param stats Filled with the stream statistics, may be NULL.
+ * \return 0 on success, -1 if reading failed, memory ran out or an index is
+ * out of range; the reason is kept for getLoadError() and the arrays are
+ * left untouched then.
+ */
+int parseObjStream(int fd, float** vertices, long long* n_vertices,
+                   unsigned int** indices, long long* n_indices,
+                   ObjStreamStats_t* stats) {
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+  ObjStream_t* stream = objStreamOpen(fd);
+  if (stream == NULL) {
+    setLoadError(LOAD_ERROR_MEMORY, 0, -1, "cannot start the stream reader");
+    return -1;
+  }
+  GrowingArray_t positions = {NULL, 0, 0, MEM_VERTICES};
+  GrowingArray_t edges = {NULL, 0, 0, MEM_INDICES};
+  float min_x = FLT_MAX, min_y = FLT_MAX, min_z = FLT_MAX;
+  float max_x = FLT_MIN, max_y = FLT_MIN, max_z = FLT_MIN;
+  int status = 0;
+  char* line = NULL;
+  ssize_t length;
+  long long number = 0;
+  long long offset = 0;
+  ObjIndexSuspect_t suspect = {-1, 0, 0, 0, 0, -1};
+  while (status == 0 && (length = objStreamGetLine(stream, &line)) != -1) {
+    ++number;
+    const long long n_before =
+        (long long)(positions.used / (3 * sizeof(float)));
+    const long long first_index =
+        (long long)(edges.used / sizeof(unsigned int));
+    if (line[0] == 'v' && line[1] == ' ') {
+      float v[3] = {0.0f, 0.0f, 0.0f};
+      sscanf(line, "v %f %f %f", &v[0], &v[1], &v[2]);
+      min_x = fmin(min_x, v[0]);
+      min_y = fmin(min_y, v[1]);
+      min_z = fmin(min_z, v[2]);
+      max_x = fmax(max_x, v[0]);
+      max_y = fmax(max_y, v[1]);
+      max_z = fmax(max_z, v[2]);
+      status = reserveBytes(&positions, sizeof(v));
+      if (status == 0) {
+        memcpy((char*)positions.data + positions.used, v, sizeof(v));
+        positions.used += sizeof(v);
+      }
+    } else if (line[0] == 'l' && line[1] == ' ') {
+      unsigned int segment[2];
+      const int parsed = objParseIndices(line, n_before, segment, 2);
+      objNoteSuspect(&suspect, segment, parsed, 2, n_before, first_index,
+                     number, offset);
+      status = reserveBytes(&edges, sizeof(segment));
+      if (status == 0) {
+        memcpy((char*)edges.data + edges.used, segment, sizeof(segment));
+        edges.used += sizeof(segment);
+      }
+    } else if (line[0] == 'f' && line[1] == ' ') {
+      unsigned int corners[3];
+      const int parsed = objParseIndices(line, n_before, corners, 3);
+      objNoteSuspect(&suspect, corners, parsed, 3, n_before, first_index,
+                     number, offset);
+      // Triangulate into line segments like parseObjFile
+      const unsigned int segments[6] = {corners[0], corners[1], corners[1],
+                                        corners[2], corners[2], corners[0]};
+      status = reserveBytes(&edges, sizeof(segments));
+      if (status == 0) {
+        memcpy((char*)edges.data + edges.used, segments, sizeof(segments));
+        edges.used += sizeof(segments);
+      }
+    }
+    offset += length + 1;
+  }
+  const int read_failed = objStreamError(stream);
+  if (read_failed) status = -1;
+  if (stats != NULL) objStreamGetStats(stream, stats);
+  objStreamClose(stream);
+  const long long count = (long long)(positions.used / (3 * sizeof(float)));
+  const long long n_edges = (long long)(edges.used / sizeof(unsigned int));
+  if (status != 0) {
+    setLoadError(read_failed ? LOAD_ERROR_OPEN : LOAD_ERROR_MEMORY, 0, -1,
+                 read_failed ? "reading the stream failed"
+                             : "not enough memory for the streamed model");
+  } else {
+    TRACE_BEGIN(validate_span);
+    const long long bad = objFindBadIndex(edges.data, n_edges, count);
+    TRACE_END(validate_span, "parseObjStream.validate");
+    if (bad >= 0) {
+      objReportBadIndex(&suspect, bad, ((unsigned int*)edges.data)[bad],
+                        count);
+      status = -1;
+    }
+  }
+  if (status != 0) {
+    loaderFree(MEM_VERTICES, positions.data, positions.capacity);
+    loaderFree(MEM_INDICES, edges.data, edges.capacity);
+    return -1;
+  }
+
+  *n_vertices = count;
+  *n_indices = n_edges;
+  *vertices = finishArray(&positions);
+  *indices = finishArray(&edges);
+  const float max_range =
+      fmax(fmax(max_x - min_x, max_y - min_y), max_z - min_z);
+  for (long long i = 0; i < count * 3; i += 3) {
+    (*vertices)[i] = ((*vertices)[i] - min_x) / max_range;
+    (*vertices)[i + 1] = ((*vertices)[i + 1] - min_y) / max_range;
+    (*vertices)[i + 2] = ((*vertices)[i + 2] - min_z) / max_range;
+  }
+  const float origin[3] = {min_x, min_y, min_z};
+  setNormalization(origin, max_range);
+  stageTimerRecord(STAGE_PARSE_TOTAL, start, count);
+  TRACE_END(span, "parseObjStream");
+  return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef OBJ_STREAM_H
+#define OBJ_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+
+// Bytes read per block, two blocks are in use at a time
+#define OBJ_STREAM_BLOCK_BYTES (1 << 20)
+// First capacity of the growing vertex and index arrays
+#define OBJ_STREAM_INITIAL_BYTES (64 << 10)
+
+/*!
+ * \brief ObjStreamStats_t
+ *
+ * Bytes and blocks read, and the time the reader thread spent in read()
+ * and the parser spent waiting for a block, in nanoseconds. A small wait
+ * means reading was hidden behind parsing.
+ */
+typedef struct ObjStreamStats_t {
+  long long bytes;
+  long long blocks;
+  double read_ns;
+  double wait_ns;
+} ObjStreamStats_t;
+
+/*!
+ * \brief ObjStream_t
+ *
+ * Line reader over a file descriptor that need not be seekable, such as a
+ * pipe. A reader thread fills one block while the lines of the other are
+ * handed out.
+ */
+typedef struct ObjStream_t ObjStream_t;
+
+ObjStream_t* objStreamOpen(int fd);
+ssize_t objStreamGetLine(ObjStream_t* stream, char** line);
+int objStreamError(ObjStream_t* stream);
+void objStreamGetStats(ObjStream_t* stream, ObjStreamStats_t* stats);
+void objStreamClose(ObjStream_t* stream);
+
+int objStreamIsPipe(const char* path);
+int objStreamOpenPath(const char* path);
+int parseObjStream(int fd, float** vertices, long long* n_vertices,
+                   unsigned int** indices, long long* n_indices,
+                   ObjStreamStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OBJ_STREAM_H
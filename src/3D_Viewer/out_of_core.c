@@ -0,0 +1,1190 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "out_of_core.h"
+
+#include <fcntl.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "memory_stats.h"
+#include "obj_index.h"
+#include "obj_stream.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define OOC_MAGIC "S21OOC1"
+#define OOC_VERSION 1
+// Chunk data offsets are multiples of this, so any page size up to it can
+// map a chunk on its own
+#define OOC_CHUNK_ALIGNMENT 65536
+#define OOC_MAX_DEPTH 7
+#define OOC_MAX_OVERVIEW_GRID 128
+#define OOC_INVALID_INDEX UINT32_MAX
+
+/*!
+ * \brief OocHeader_t
+ *
+ * Start of a store file. It is followed by the node table, the chunk table,
+ * the overview positions and edges and, from data_offset, the chunk data.
+ * All values are in the byte order of the machine that built the store.
+ */
+typedef struct OocHeader_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t alignment;
+  uint64_t n_vertices;
+  uint64_t n_edges;
+  uint32_t n_chunks;
+  uint32_t n_nodes;
+  uint32_t n_overview_vertices;
+  uint32_t n_overview_edges;
+  uint64_t nodes_offset;
+  uint64_t chunks_offset;
+  uint64_t overview_offset;
+  uint64_t data_offset;
+  uint64_t file_bytes;
+} OocHeader_t;
+
+/*!
+ * \brief OocNode_t
+ *
+ * Octree node. Children of a node are contiguous and the root is node 0.
+ * Leaves have no children and refer to one chunk.
+ */
+typedef struct OocNode_t {
+  float min[3];
+  float max[3];
+  int32_t first_child;
+  int32_t n_children;
+  int32_t chunk;
+  int32_t reserved;
+} OocNode_t;
+
+/*!
+ * \brief OocChunkEntry_t
+ *
+ * A chunk holds the vertices of one leaf cell, followed by copies of the
+ * vertices in other cells that its edges reach, and then its edges as pairs
+ * of local indices. An edge belongs to the cell of its first vertex.
+ */
+typedef struct OocChunkEntry_t {
+  float min[3];
+  float max[3];
+  uint64_t offset;
+  uint32_t n_vertices;
+  uint32_t n_edges;
+} OocChunkEntry_t;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t chunkBytes(const OocChunkEntry_t* chunk) {
+  return (uint64_t)chunk->n_vertices * 3 * sizeof(float) +
+         (uint64_t)chunk->n_edges * 2 * sizeof(uint32_t);
+}
+
+static void* allocZeroed(size_t bytes) {
+  void* pointer = memAccountMalloc(MEM_LOADER_TEMP, bytes ? bytes : 1);
+  if (pointer != NULL) memset(pointer, 0, bytes);
+  return pointer;
+}
+
+static void freeZeroed(void* pointer, size_t bytes) {
+  memAccountFree(MEM_LOADER_TEMP, pointer, bytes ? bytes : 1);
+}
+
+/*!
+ * \brief openScratch
+ *
+ * Creates an unlinked file next to the store for arrays the size of the
+ * model, which are then used through mmap instead of having to fit in
+ * memory. The file disappears when the last descriptor and mapping go.
+ */
+static int openScratch(const char* store_path) {
+  const size_t length = strlen(store_path) + 16;
+  char* path = malloc(length);
+  if (path == NULL) return -1;
+  snprintf(path, length, "%s.tmpXXXXXX", store_path);
+  const int fd = mkstemp(path);
+  if (fd >= 0) unlink(path);
+  free(path);
+  return fd;
+}
+
+static void* mapScratch(int fd, size_t bytes, int writable) {
+  if (bytes == 0) return NULL;
+  if (writable && ftruncate(fd, (off_t)bytes) != 0) return NULL;
+  void* data = mmap(NULL, bytes, PROT_READ | (writable ? PROT_WRITE : 0),
+                    MAP_SHARED, fd, 0);
+  return data == MAP_FAILED ? NULL : data;
+}
+
+static void unmapScratch(void* data, size_t bytes) {
+  if (data != NULL) munmap(data, bytes);
+}
+
+static uint32_t spreadBits(uint32_t value) {
+  value &= 0x3ff;
+  value = (value | (value << 16)) & 0x030000ff;
+  value = (value | (value << 8)) & 0x0300f00f;
+  value = (value | (value << 4)) & 0x030c30c3;
+  value = (value | (value << 2)) & 0x09249249;
+  return value;
+}
+
+static uint32_t gridCoordinate(float value, uint32_t resolution) {
+  const float scaled = value * (float)resolution;
+  if (!(scaled > 0.0f)) return 0;
+  const uint32_t cell = (uint32_t)scaled;
+  return cell < resolution ? cell : resolution - 1;
+}
+
+/*!
+ * \brief OocBuilder_t
+ *
+ * State of oocBuild(). Per-vertex and per-edge arrays are scratch file
+ * mappings; per-cell and per-chunk arrays are in memory.
+ */
+typedef struct OocBuilder_t {
+  const OocBuildOptions_t* options;
+  int vertex_fd;
+  int edge_fd;
+  int cell_fd;
+  int local_fd;
+  float* raw;  // positions as read
+  uint32_t* edges;
+  uint32_t* cell;
+  uint32_t* local;
+  uint64_t n_vertices;
+  uint64_t n_edges;
+  float min[3];
+  float max[3];
+  float range;
+
+  int depth;
+  uint32_t n_cells;
+  uint32_t* vertex_count;
+  uint32_t* edge_count;
+  uint32_t* ghost_count;
+  int32_t* chunk_of_cell;
+
+  uint32_t n_chunks;
+  OocChunkEntry_t* chunks;
+  uint32_t* chunk_code;
+
+  uint32_t overview_grid;
+  uint32_t n_clusters;
+  double* cluster_sum;
+  uint32_t* cluster_count;
+  int32_t* cluster_vertex;
+  uint32_t n_overview_vertices;
+  uint64_t* edge_set;
+  uint32_t edge_set_mask;
+  uint32_t n_overview_edges;
+
+  int n_levels;
+  uint32_t level_size[OOC_MAX_DEPTH + 1];
+  uint32_t* level_code[OOC_MAX_DEPTH + 1];
+  uint32_t* level_begin[OOC_MAX_DEPTH + 1];
+  uint32_t n_nodes;
+  OocNode_t* nodes;
+} OocBuilder_t;
+
+static void freeBuilder(OocBuilder_t* b) {
+  unmapScratch(b->raw, b->n_vertices * 3 * sizeof(float));
+  unmapScratch(b->edges, b->n_edges * 2 * sizeof(uint32_t));
+  unmapScratch(b->cell, b->n_vertices * sizeof(uint32_t));
+  unmapScratch(b->local, b->n_vertices * sizeof(uint32_t));
+  const int fds[] = {b->vertex_fd, b->edge_fd, b->cell_fd, b->local_fd};
+  for (int i = 0; i < 4; ++i) {
+    if (fds[i] >= 0) close(fds[i]);
+  }
+  const size_t cells = (size_t)b->n_cells;
+  freeZeroed(b->vertex_count, cells * sizeof(uint32_t));
+  freeZeroed(b->edge_count, cells * sizeof(uint32_t));
+  freeZeroed(b->ghost_count, cells * sizeof(uint32_t));
+  freeZeroed(b->chunk_of_cell, cells * sizeof(int32_t));
+  freeZeroed(b->chunks, b->n_chunks * sizeof(OocChunkEntry_t));
+  freeZeroed(b->chunk_code, b->n_chunks * sizeof(uint32_t));
+  const size_t clusters = (size_t)b->n_clusters;
+  freeZeroed(b->cluster_sum, clusters * 3 * sizeof(double));
+  freeZeroed(b->cluster_count, clusters * sizeof(uint32_t));
+  freeZeroed(b->cluster_vertex, clusters * sizeof(int32_t));
+  if (b->edge_set != NULL) {
+    freeZeroed(b->edge_set, ((size_t)b->edge_set_mask + 1) * sizeof(uint64_t));
+  }
+  for (int l = 0; l < b->n_levels; ++l) {
+    freeZeroed(b->level_code[l], b->level_size[l] * sizeof(uint32_t));
+    freeZeroed(b->level_begin[l], b->level_size[l] * sizeof(uint32_t));
+  }
+  freeZeroed(b->nodes, b->n_nodes * sizeof(OocNode_t));
+}
+
+static void writeEdge(FILE* edges, uint32_t a, uint32_t b, uint64_t* count) {
+  const uint32_t pair[2] = {a, b};
+  fwrite(pair, sizeof(pair), 1, edges);
+  ++*count;
+}
+
+/*!
+ * \brief readObj
+ *
+ * Single pass over the OBJ file that appends positions and edges to the
+ * scratch files. Vertex references are read with objParseIndices() like
+ * parseObjFile does, relative ones and v/vt/vn forms included, and faces
+ * become their three edges. The file is read in blocks ahead of the
+ * parsing, so it may as well be a pipe or the standard input, and the
+ * indices are checked once it ends; a bad one fails the build with its line
+ * kept for getLoadError().
+ */
+static int readObj(const char* obj_path, OocBuilder_t* b) {
+  const int fd = objStreamOpenPath(obj_path);
+  if (fd < 0) return -1;
+  ObjStream_t* file = objStreamOpen(fd);
+  FILE* vertices = fdopen(dup(b->vertex_fd), "wb");
+  FILE* edges = fdopen(dup(b->edge_fd), "wb");
+  if (file == NULL || vertices == NULL || edges == NULL) {
+    if (vertices) fclose(vertices);
+    if (edges) fclose(edges);
+    objStreamClose(file);
+    close(fd);
+    return -1;
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    b->min[axis] = FLT_MAX;
+    b->max[axis] = -FLT_MAX;
+  }
+  char* line = NULL;
+  int status = 0;
+  ssize_t length;
+  long long number = 0;
+  long long offset = 0;
+  ObjIndexSuspect_t suspect = {-1, 0, 0, 0, 0, -1};
+  while ((length = objStreamGetLine(file, &line)) != -1) {
+    ++number;
+    const long long n_before = (long long)b->n_vertices;
+    const long long first_index = (long long)b->n_edges * 2;
+    if (line[0] == 'v' && line[1] == ' ') {
+      float position[3] = {0.0f, 0.0f, 0.0f};
+      sscanf(line, "v %f %f %f", &position[0], &position[1], &position[2]);
+      for (int axis = 0; axis < 3; ++axis) {
+        b->min[axis] = fminf(b->min[axis], position[axis]);
+        b->max[axis] = fmaxf(b->max[axis], position[axis]);
+      }
+      fwrite(position, sizeof(position), 1, vertices);
+      if (++b->n_vertices >= OOC_INVALID_INDEX) {
+        fprintf(stderr, "%s: too many vertices for a chunk store\n", obj_path);
+        status = -1;
+        break;
+      }
+    } else if (line[0] == 'l' && line[1] == ' ') {
+      unsigned int segment[2];
+      const int parsed = objParseIndices(line, n_before, segment, 2);
+      objNoteSuspect(&suspect, segment, parsed, 2, n_before, first_index,
+                     number, offset);
+      writeEdge(edges, segment[0], segment[1], &b->n_edges);
+    } else if (line[0] == 'f' && line[1] == ' ') {
+      unsigned int corners[3];
+      const int parsed = objParseIndices(line, n_before, corners, 3);
+      objNoteSuspect(&suspect, corners, parsed, 3, n_before, first_index,
+                     number, offset);
+      for (int i = 0; i < 3; ++i) {
+        writeEdge(edges, corners[i], corners[(i + 1) % 3], &b->n_edges);
+      }
+    }
+    offset += length + 1;
+  }
+  if (objStreamError(file)) status = -1;
+  objStreamClose(file);
+  close(fd);
+  if (fclose(vertices) != 0 || fclose(edges) != 0) status = -1;
+  if (status != 0) return -1;
+
+  float range = 0.0f;
+  for (int axis = 0; axis < 3 && b->n_vertices > 0; ++axis) {
+    range = fmaxf(range, b->max[axis] - b->min[axis]);
+  }
+  b->range = range > 0.0f ? range : 1.0f;
+  if (b->n_vertices == 0) memset(b->min, 0, sizeof(b->min));
+
+  b->raw = mapScratch(b->vertex_fd, b->n_vertices * 3 * sizeof(float), 0);
+  b->edges = mapScratch(b->edge_fd, b->n_edges * 2 * sizeof(uint32_t), 0);
+  if ((b->n_vertices > 0 && b->raw == NULL) ||
+      (b->n_edges > 0 && b->edges == NULL)) {
+    return -1;
+  }
+  const long long bad = objFindBadIndex(b->edges, (long long)b->n_edges * 2,
+                                        (long long)b->n_vertices);
+  if (bad >= 0) {
+    objReportBadIndex(&suspect, bad, b->edges[bad], (long long)b->n_vertices);
+    LoadError_t error;
+    getLoadError(&error);
+    fprintf(stderr, "%s: %s\n", obj_path, error.message);
+    return -1;
+  }
+  return 0;
+}
+
+// Position of vertex v normalized into [0, 1] like parseObjFile does.
+static void normalized(const OocBuilder_t* b, uint64_t v, float out[3]) {
+  for (int axis = 0; axis < 3; ++axis) {
+    out[axis] = (b->raw[v * 3 + axis] - b->min[axis]) / b->range;
+  }
+}
+
+static uint32_t cellOf(const float position[3], int depth) {
+  const uint32_t resolution = 1u << depth;
+  return spreadBits(gridCoordinate(position[0], resolution)) |
+         spreadBits(gridCoordinate(position[1], resolution)) << 1 |
+         spreadBits(gridCoordinate(position[2], resolution)) << 2;
+}
+
+static uint32_t clusterOf(const OocBuilder_t* b, const float position[3]) {
+  const uint32_t g = b->overview_grid;
+  return (gridCoordinate(position[0], g) * g + gridCoordinate(position[1], g)) *
+             g +
+         gridCoordinate(position[2], g);
+}
+
+/*!
+ * \brief chooseDepth
+ *
+ * Finest-level cell counts decide the depth: the shallowest level whose
+ * non-empty cells hold at most target vertices on average. Counting only
+ * non-empty cells keeps flat or sparse models from getting huge chunks.
+ */
+static int chooseDepth(const uint32_t* fine_count, uint64_t n_vertices,
+                       long target) {
+  for (int depth = 0; depth < OOC_MAX_DEPTH; ++depth) {
+    const int shift = 3 * (OOC_MAX_DEPTH - depth);
+    uint64_t occupied = 0;
+    uint32_t previous = UINT32_MAX;
+    for (uint32_t cell = 0; cell < 1u << (3 * OOC_MAX_DEPTH); ++cell) {
+      if (fine_count[cell] == 0 || cell >> shift == previous) continue;
+      previous = cell >> shift;
+      occupied++;
+    }
+    if (n_vertices <= occupied * (uint64_t)target) return depth;
+  }
+  return OOC_MAX_DEPTH;
+}
+
+/*!
+ * \brief assignCells
+ *
+ * Puts every vertex in a leaf cell, counts vertices, edges and foreign
+ * vertex copies per cell and turns the non-empty cells into chunks, in
+ * Morton order of their cells.
+ */
+static int assignCells(const char* store_path, OocBuilder_t* b,
+                       OocBuildStats_t* stats) {
+  const long target = b->options->target_chunk_vertices > 0
+                          ? b->options->target_chunk_vertices
+                          : 1;
+  b->cell_fd = openScratch(store_path);
+  b->local_fd = openScratch(store_path);
+  if (b->cell_fd < 0 || b->local_fd < 0) return -1;
+  b->cell = mapScratch(b->cell_fd, b->n_vertices * sizeof(uint32_t), 1);
+  b->local = mapScratch(b->local_fd, b->n_vertices * sizeof(uint32_t), 1);
+  if (b->n_vertices > 0 && (b->cell == NULL || b->local == NULL)) return -1;
+
+  const size_t fine_bytes = ((size_t)1 << (3 * OOC_MAX_DEPTH)) * 4;
+  uint32_t* fine_count = allocZeroed(fine_bytes);
+  if (fine_count == NULL) return -1;
+  for (uint64_t v = 0; v < b->n_vertices; ++v) {
+    float position[3];
+    normalized(b, v, position);
+    b->cell[v] = cellOf(position, OOC_MAX_DEPTH);
+    fine_count[b->cell[v]]++;
+  }
+  b->depth = chooseDepth(fine_count, b->n_vertices, target);
+  freeZeroed(fine_count, fine_bytes);
+
+  b->n_cells = 1u << (3 * b->depth);
+  b->vertex_count = allocZeroed(b->n_cells * sizeof(uint32_t));
+  b->edge_count = allocZeroed(b->n_cells * sizeof(uint32_t));
+  b->ghost_count = allocZeroed(b->n_cells * sizeof(uint32_t));
+  b->chunk_of_cell = allocZeroed(b->n_cells * sizeof(int32_t));
+  if (b->vertex_count == NULL || b->edge_count == NULL ||
+      b->ghost_count == NULL || b->chunk_of_cell == NULL) {
+    return -1;
+  }
+  const int shift = 3 * (OOC_MAX_DEPTH - b->depth);
+  for (uint64_t v = 0; v < b->n_vertices; ++v) {
+    const uint32_t cell = b->cell[v] >> shift;
+    b->cell[v] = cell;
+    b->local[v] = b->vertex_count[cell]++;
+  }
+  for (uint64_t e = 0; e < b->n_edges; ++e) {
+    const uint32_t owner = b->cell[b->edges[e * 2]];
+    b->edge_count[owner]++;
+    if (b->cell[b->edges[e * 2 + 1]] != owner) {
+      b->ghost_count[owner]++;
+      stats->cross_edges++;
+    }
+  }
+
+  for (uint32_t cell = 0; cell < b->n_cells; ++cell) {
+    b->n_chunks += b->vertex_count[cell] > 0;
+  }
+  b->chunks = allocZeroed(b->n_chunks * sizeof(OocChunkEntry_t));
+  b->chunk_code = allocZeroed(b->n_chunks * sizeof(uint32_t));
+  if (b->chunks == NULL || b->chunk_code == NULL) return -1;
+  uint32_t chunk = 0;
+  for (uint32_t cell = 0; cell < b->n_cells; ++cell) {
+    if (b->vertex_count[cell] == 0) {
+      b->chunk_of_cell[cell] = -1;
+      continue;
+    }
+    OocChunkEntry_t* entry = &b->chunks[chunk];
+    entry->n_vertices = b->vertex_count[cell] + b->ghost_count[cell];
+    entry->n_edges = b->edge_count[cell];
+    for (int axis = 0; axis < 3; ++axis) {
+      entry->min[axis] = FLT_MAX;
+      entry->max[axis] = -FLT_MAX;
+    }
+    b->chunk_code[chunk] = cell;
+    b->chunk_of_cell[cell] = (int32_t)chunk++;
+  }
+  return 0;
+}
+
+/*!
+ * \brief buildLevels
+ *
+ * Groups the leaf cells into octree levels up to the root. Level n_levels-1
+ * are the chunks; a node of level l has the nodes of level l + 1 whose codes
+ * share all but the last three bits as its children.
+ */
+static int buildLevels(OocBuilder_t* b) {
+  if (b->n_chunks == 0) return 0;
+  b->n_levels = b->depth + 1;
+  const int leaf = b->depth;
+  b->level_size[leaf] = b->n_chunks;
+  b->level_code[leaf] = allocZeroed(b->n_chunks * sizeof(uint32_t));
+  b->level_begin[leaf] = allocZeroed(b->n_chunks * sizeof(uint32_t));
+  if (b->level_code[leaf] == NULL || b->level_begin[leaf] == NULL) return -1;
+  memcpy(b->level_code[leaf], b->chunk_code, b->n_chunks * sizeof(uint32_t));
+  for (int l = leaf - 1; l >= 0; --l) {
+    const uint32_t* children = b->level_code[l + 1];
+    const uint32_t n_children = b->level_size[l + 1];
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < n_children; ++i) {
+      n += i == 0 || children[i] >> 3 != children[i - 1] >> 3;
+    }
+    b->level_size[l] = n;
+    b->level_code[l] = allocZeroed(n * sizeof(uint32_t));
+    b->level_begin[l] = allocZeroed(n * sizeof(uint32_t));
+    if (b->level_code[l] == NULL || b->level_begin[l] == NULL) return -1;
+    n = 0;
+    for (uint32_t i = 0; i < n_children; ++i) {
+      if (i == 0 || children[i] >> 3 != children[i - 1] >> 3) {
+        b->level_code[l][n] = children[i] >> 3;
+        b->level_begin[l][n++] = i;
+      }
+    }
+  }
+  for (int l = 0; l < b->n_levels; ++l) b->n_nodes += b->level_size[l];
+  b->nodes = allocZeroed(b->n_nodes * sizeof(OocNode_t));
+  return b->nodes != NULL ? 0 : -1;
+}
+
+// Fills the node table from the finished chunk bounds, leaves first.
+static void fillNodes(OocBuilder_t* b) {
+  uint32_t level_offset[OOC_MAX_DEPTH + 2] = {0};
+  for (int l = 0; l < b->n_levels; ++l) {
+    level_offset[l + 1] = level_offset[l] + b->level_size[l];
+  }
+  for (int l = b->n_levels - 1; l >= 0; --l) {
+    for (uint32_t k = 0; k < b->level_size[l]; ++k) {
+      OocNode_t* node = &b->nodes[level_offset[l] + k];
+      if (l == b->n_levels - 1) {
+        const OocChunkEntry_t* chunk = &b->chunks[k];
+        memcpy(node->min, chunk->min, sizeof(node->min));
+        memcpy(node->max, chunk->max, sizeof(node->max));
+        node->first_child = -1;
+        node->chunk = (int32_t)k;
+        continue;
+      }
+      const uint32_t begin = b->level_begin[l][k];
+      const uint32_t end = k + 1 < b->level_size[l] ? b->level_begin[l][k + 1]
+                                                     : b->level_size[l + 1];
+      node->first_child = (int32_t)(level_offset[l + 1] + begin);
+      node->n_children = (int32_t)(end - begin);
+      node->chunk = -1;
+      for (int axis = 0; axis < 3; ++axis) {
+        node->min[axis] = FLT_MAX;
+        node->max[axis] = -FLT_MAX;
+      }
+      for (uint32_t c = begin; c < end; ++c) {
+        const OocNode_t* child = &b->nodes[level_offset[l + 1] + c];
+        for (int axis = 0; axis < 3; ++axis) {
+          node->min[axis] = fminf(node->min[axis], child->min[axis]);
+          node->max[axis] = fmaxf(node->max[axis], child->max[axis]);
+        }
+      }
+    }
+  }
+}
+
+static int allocOverview(OocBuilder_t* b) {
+  int grid = b->options->overview_grid;
+  if (grid < 1) grid = 1;
+  if (grid > OOC_MAX_OVERVIEW_GRID) grid = OOC_MAX_OVERVIEW_GRID;
+  b->overview_grid = (uint32_t)grid;
+  b->n_clusters = b->overview_grid * b->overview_grid * b->overview_grid;
+  b->cluster_sum = allocZeroed(b->n_clusters * 3 * sizeof(double));
+  b->cluster_count = allocZeroed(b->n_clusters * sizeof(uint32_t));
+  b->cluster_vertex = allocZeroed(b->n_clusters * sizeof(int32_t));
+  uint32_t capacity = 1024;
+  const uint32_t wanted =
+      b->options->max_overview_edges > 0 ? b->options->max_overview_edges : 0;
+  while (capacity < 2 * wanted && capacity < (1u << 30)) capacity *= 2;
+  b->edge_set_mask = capacity - 1;
+  b->edge_set = allocZeroed((size_t)capacity * sizeof(uint64_t));
+  return b->cluster_sum && b->cluster_count && b->cluster_vertex &&
+                 b->edge_set
+             ? 0
+             : -1;
+}
+
+static void addOverviewEdge(OocBuilder_t* b, uint32_t first, uint32_t second) {
+  if (first == second ||
+      (int)b->n_overview_edges >= b->options->max_overview_edges) {
+    return;
+  }
+  const uint32_t low = first < second ? first : second;
+  const uint32_t high = first < second ? second : first;
+  const uint64_t key = (uint64_t)low << 32 | high;
+  uint32_t slot = (uint32_t)((key * 0x9e3779b97f4a7c15ull) >> 32) &
+                  b->edge_set_mask;
+  while (b->edge_set[slot] != 0) {
+    if (b->edge_set[slot] == key) return;
+    slot = (slot + 1) & b->edge_set_mask;
+  }
+  b->edge_set[slot] = key;
+  b->n_overview_edges++;
+}
+
+static void extendBounds(OocChunkEntry_t* chunk, const float position[3]) {
+  for (int axis = 0; axis < 3; ++axis) {
+    chunk->min[axis] = fminf(chunk->min[axis], position[axis]);
+    chunk->max[axis] = fmaxf(chunk->max[axis], position[axis]);
+  }
+}
+
+/*!
+ * \brief scatterChunks
+ *
+ * Writes the vertices and edges into the chunk data of the mapped store and
+ * gathers the overview clusters on the way.
+ */
+static int scatterChunks(OocBuilder_t* b, unsigned char* out) {
+  uint32_t* edge_cursor = allocZeroed(b->n_chunks * sizeof(uint32_t));
+  uint32_t* ghost_cursor = allocZeroed(b->n_chunks * sizeof(uint32_t));
+  if (edge_cursor == NULL || ghost_cursor == NULL) {
+    freeZeroed(edge_cursor, b->n_chunks * sizeof(uint32_t));
+    freeZeroed(ghost_cursor, b->n_chunks * sizeof(uint32_t));
+    return -1;
+  }
+  for (uint32_t c = 0; c < b->n_chunks; ++c) {
+    ghost_cursor[c] = b->vertex_count[b->chunk_code[c]];
+  }
+
+  for (uint64_t v = 0; v < b->n_vertices; ++v) {
+    float position[3];
+    normalized(b, v, position);
+    const int32_t c = b->chunk_of_cell[b->cell[v]];
+    float* positions = (float*)(out + b->chunks[c].offset);
+    memcpy(&positions[(size_t)b->local[v] * 3], position, sizeof(position));
+    extendBounds(&b->chunks[c], position);
+    const uint32_t cluster = clusterOf(b, position);
+    for (int axis = 0; axis < 3; ++axis) {
+      b->cluster_sum[(size_t)cluster * 3 + axis] += position[axis];
+    }
+    b->cluster_count[cluster]++;
+  }
+  for (uint32_t k = 0; k < b->n_clusters; ++k) {
+    b->cluster_vertex[k] =
+        b->cluster_count[k] > 0 ? (int32_t)b->n_overview_vertices++ : -1;
+  }
+
+  for (uint64_t e = 0; e < b->n_edges; ++e) {
+    const uint32_t first = b->edges[e * 2];
+    const uint32_t second = b->edges[e * 2 + 1];
+    const int32_t c = b->chunk_of_cell[b->cell[first]];
+    OocChunkEntry_t* chunk = &b->chunks[c];
+    float* positions = (float*)(out + chunk->offset);
+    uint32_t* indices = (uint32_t*)(positions + (size_t)chunk->n_vertices * 3);
+    float second_position[3];
+    normalized(b, second, second_position);
+    uint32_t second_local = b->local[second];
+    if (b->cell[second] != b->cell[first]) {
+      second_local = ghost_cursor[c]++;
+      memcpy(&positions[(size_t)second_local * 3], second_position,
+             sizeof(second_position));
+      extendBounds(chunk, second_position);
+    }
+    const uint32_t slot = edge_cursor[c]++;
+    indices[(size_t)slot * 2] = b->local[first];
+    indices[(size_t)slot * 2 + 1] = second_local;
+
+    float first_position[3];
+    normalized(b, first, first_position);
+    addOverviewEdge(b, b->cluster_vertex[clusterOf(b, first_position)],
+                    b->cluster_vertex[clusterOf(b, second_position)]);
+  }
+  freeZeroed(edge_cursor, b->n_chunks * sizeof(uint32_t));
+  freeZeroed(ghost_cursor, b->n_chunks * sizeof(uint32_t));
+  return 0;
+}
+
+static void writeOverview(const OocBuilder_t* b, unsigned char* out) {
+  float* positions = (float*)out;
+  for (uint32_t k = 0; k < b->n_clusters; ++k) {
+    if (b->cluster_vertex[k] < 0) continue;
+    for (int axis = 0; axis < 3; ++axis) {
+      positions[(size_t)b->cluster_vertex[k] * 3 + axis] =
+          (float)(b->cluster_sum[(size_t)k * 3 + axis] / b->cluster_count[k]);
+    }
+  }
+  uint32_t* edges = (uint32_t*)(positions + (size_t)b->n_overview_vertices * 3);
+  uint32_t n = 0;
+  for (uint32_t slot = 0; slot <= b->edge_set_mask; ++slot) {
+    const uint64_t key = b->edge_set[slot];
+    if (key == 0) continue;
+    edges[n * 2] = (uint32_t)(key >> 32);
+    edges[n * 2 + 1] = (uint32_t)key;
+    ++n;
+  }
+}
+
+void oocBuildDefaults(OocBuildOptions_t* options) {
+  options->target_chunk_vertices = 65536;
+  options->overview_grid = 64;
+  options->max_overview_edges = 1 << 20;
+}
+
+/*!
+ * \brief oocBuild
+ *
+ * Converts an OBJ file into a chunk store for oocOpen(). Vertices are
+ * normalized into [0, 1] like parseObjFile does and split over the cells of
+ * a uniform octree grid; the store also gets a clustered overview of the
+ * whole model. Memory use depends on the grids, not on the model: arrays
+ * over all vertices or edges are scratch files next to store_path. The
+ * store is written under a temporary name and renamed when complete.
+ *
+ * \param obj_path The OBJ file, a pipe or "-" for the standard input.
+ * \return 0 on success, -1 if a file could not be read or written or an
+ * index is out of range, which is reported like parseObjFile does.
+ */
+int oocBuild(const char* obj_path, const char* store_path,
+             const OocBuildOptions_t* options, OocBuildStats_t* stats) {
+  OocBuildOptions_t defaults;
+  if (options == NULL) {
+    oocBuildDefaults(&defaults);
+    options = &defaults;
+  }
+  OocBuildStats_t local_stats;
+  if (stats == NULL) stats = &local_stats;
+  memset(stats, 0, sizeof(*stats));
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+
+  OocBuilder_t b;
+  memset(&b, 0, sizeof(b));
+  b.options = options;
+  b.cell_fd = b.local_fd = -1;
+  b.vertex_fd = openScratch(store_path);
+  b.edge_fd = openScratch(store_path);
+  int status = b.vertex_fd >= 0 && b.edge_fd >= 0 ? 0 : -1;
+  if (status == 0) status = readObj(obj_path, &b);
+  if (status == 0) status = assignCells(store_path, &b, stats);
+  if (status == 0) status = buildLevels(&b);
+  if (status == 0) status = allocOverview(&b);
+  if (status != 0) {
+    freeBuilder(&b);
+    return -1;
+  }
+
+  OocHeader_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, OOC_MAGIC, sizeof(OOC_MAGIC));
+  header.version = OOC_VERSION;
+  header.alignment = OOC_CHUNK_ALIGNMENT;
+  header.n_vertices = b.n_vertices;
+  header.n_edges = b.n_edges;
+  header.n_chunks = b.n_chunks;
+  header.n_nodes = b.n_nodes;
+  header.nodes_offset = alignUp(sizeof(OocHeader_t), 8);
+  header.chunks_offset =
+      header.nodes_offset + (uint64_t)b.n_nodes * sizeof(OocNode_t);
+  header.overview_offset =
+      header.chunks_offset + (uint64_t)b.n_chunks * sizeof(OocChunkEntry_t);
+  // The overview is sized for its maximum, its final counts are known only
+  // after the scatter
+  const uint64_t overview_bytes =
+      (uint64_t)(b.n_clusters < b.n_vertices ? b.n_clusters : b.n_vertices) *
+          3 * sizeof(float) +
+      (uint64_t)options->max_overview_edges * 2 * sizeof(uint32_t);
+  header.data_offset =
+      alignUp(header.overview_offset + overview_bytes, OOC_CHUNK_ALIGNMENT);
+  uint64_t cursor = header.data_offset;
+  for (uint32_t c = 0; c < b.n_chunks; ++c) {
+    b.chunks[c].offset = cursor;
+    cursor = alignUp(cursor + chunkBytes(&b.chunks[c]), OOC_CHUNK_ALIGNMENT);
+  }
+  header.file_bytes = cursor;
+
+  const size_t partial_length = strlen(store_path) + 16;
+  char* partial = malloc(partial_length);
+  int fd = -1;
+  unsigned char* out = NULL;
+  if (partial != NULL) {
+    snprintf(partial, partial_length, "%s.partial", store_path);
+    fd = open(partial, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd >= 0 && ftruncate(fd, (off_t)header.file_bytes) == 0) {
+    void* data = mmap(NULL, header.file_bytes, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    out = data == MAP_FAILED ? NULL : data;
+  }
+  status = out != NULL ? scatterChunks(&b, out) : -1;
+  if (status == 0) {
+    fillNodes(&b);
+    header.n_overview_vertices = b.n_overview_vertices;
+    header.n_overview_edges = b.n_overview_edges;
+    writeOverview(&b, out + header.overview_offset);
+    memcpy(out + header.nodes_offset, b.nodes, b.n_nodes * sizeof(OocNode_t));
+    memcpy(out + header.chunks_offset, b.chunks,
+           b.n_chunks * sizeof(OocChunkEntry_t));
+    memcpy(out, &header, sizeof(header));
+    status = msync(out, header.file_bytes, MS_SYNC);
+  }
+  if (out != NULL) munmap(out, header.file_bytes);
+  if (fd >= 0 && close(fd) != 0) status = -1;
+  if (status == 0 && rename(partial, store_path) != 0) status = -1;
+  if (status != 0 && partial != NULL) unlink(partial);
+  free(partial);
+
+  stats->vertices = (long long)b.n_vertices;
+  stats->edges = (long long)header.n_edges;
+  stats->chunks = (int)b.n_chunks;
+  stats->nodes = (int)b.n_nodes;
+  stats->overview_vertices = (int)b.n_overview_vertices;
+  stats->overview_edges = (int)b.n_overview_edges;
+  stats->file_bytes = (long long)header.file_bytes;
+  stats->elapsed_ns = stageTimerNow() - start;
+  if (span >= 0.0) traceRecordSpanArg("oocBuild", span, "chunks", b.n_chunks);
+  freeBuilder(&b);
+  return status;
+}
+
+typedef struct OocCandidate_t {
+  int chunk;
+  float pixels;
+} OocCandidate_t;
+
+struct OocStore_t {
+  int fd;
+  size_t page_size;
+  OocHeader_t header;
+  OocNode_t* nodes;
+  OocChunkEntry_t* chunks;
+  float* overview_positions;
+  uint32_t* overview_edges;
+  void** mapped;
+  uint64_t* last_used;
+  uint64_t* wanted;
+  int* resident;
+  int n_resident;
+  int* draw;
+  int n_draw;
+  OocCandidate_t* candidates;
+  int* stack;
+  long long fixed_bytes;
+  long long resident_bytes;
+  long long budget_bytes;
+  uint64_t frame;
+};
+
+static void* storeArray(OocStore_t* store, size_t bytes) {
+  void* pointer = memAccountMalloc(MEM_CACHES, bytes ? bytes : 1);
+  if (pointer != NULL) {
+    memset(pointer, 0, bytes);
+    store->fixed_bytes += (long long)(bytes ? bytes : 1);
+  }
+  return pointer;
+}
+
+static int readAt(int fd, void* data, size_t bytes, uint64_t offset) {
+  unsigned char* cursor = data;
+  while (bytes > 0) {
+    const ssize_t n = pread(fd, cursor, bytes, (off_t)offset);
+    if (n <= 0) return -1;
+    cursor += n;
+    bytes -= (size_t)n;
+    offset += (uint64_t)n;
+  }
+  return 0;
+}
+
+static size_t mappedBytes(const OocStore_t* store, int chunk) {
+  return (size_t)alignUp(chunkBytes(&store->chunks[chunk]), store->page_size);
+}
+
+/*!
+ * \brief oocOpen
+ *
+ * Opens a store written by oocBuild(). The tables and the overview are read
+ * into memory, no chunk is mapped yet.
+ *
+ * \param budget_bytes Cap for everything the store keeps resident, tables
+ * and overview included.
+ * \return NULL if the file is missing or not a store of this version.
+ */
+OocStore_t* oocOpen(const char* store_path, long long budget_bytes) {
+  const int fd = open(store_path, O_RDONLY);
+  if (fd < 0) return NULL;
+  OocHeader_t header;
+  struct stat file_stat;
+  const long page_size = sysconf(_SC_PAGESIZE);
+  if (readAt(fd, &header, sizeof(header), 0) != 0 ||
+      memcmp(header.magic, OOC_MAGIC, sizeof(OOC_MAGIC)) != 0 ||
+      header.version != OOC_VERSION || page_size <= 0 ||
+      header.alignment % (uint64_t)page_size != 0 ||
+      fstat(fd, &file_stat) != 0 ||
+      (uint64_t)file_stat.st_size < header.file_bytes) {
+    close(fd);
+    return NULL;
+  }
+  OocStore_t* store = calloc(1, sizeof(OocStore_t));
+  if (store == NULL) {
+    close(fd);
+    return NULL;
+  }
+  store->fd = fd;
+  store->page_size = (size_t)page_size;
+  store->header = header;
+  const size_t n_chunks = header.n_chunks;
+  const size_t n_nodes = header.n_nodes;
+  store->nodes = storeArray(store, n_nodes * sizeof(OocNode_t));
+  store->chunks = storeArray(store, n_chunks * sizeof(OocChunkEntry_t));
+  store->overview_positions =
+      storeArray(store, header.n_overview_vertices * 3 * sizeof(float));
+  store->overview_edges =
+      storeArray(store, header.n_overview_edges * 2 * sizeof(uint32_t));
+  store->mapped = storeArray(store, n_chunks * sizeof(void*));
+  store->last_used = storeArray(store, n_chunks * sizeof(uint64_t));
+  store->wanted = storeArray(store, n_chunks * sizeof(uint64_t));
+  store->resident = storeArray(store, n_chunks * sizeof(int));
+  store->draw = storeArray(store, n_chunks * sizeof(int));
+  store->candidates = storeArray(store, n_chunks * sizeof(OocCandidate_t));
+  store->stack = storeArray(store, n_nodes * sizeof(int));
+  const uint64_t overview_edges_offset =
+      header.overview_offset +
+      (uint64_t)header.n_overview_vertices * 3 * sizeof(float);
+  if (store->nodes == NULL || store->chunks == NULL ||
+      store->overview_positions == NULL || store->overview_edges == NULL ||
+      store->mapped == NULL || store->last_used == NULL ||
+      store->wanted == NULL || store->resident == NULL ||
+      store->draw == NULL || store->candidates == NULL ||
+      store->stack == NULL ||
+      readAt(fd, store->nodes, n_nodes * sizeof(OocNode_t),
+             header.nodes_offset) != 0 ||
+      readAt(fd, store->chunks, n_chunks * sizeof(OocChunkEntry_t),
+             header.chunks_offset) != 0 ||
+      readAt(fd, store->overview_positions,
+             header.n_overview_vertices * 3 * sizeof(float),
+             header.overview_offset) != 0 ||
+      readAt(fd, store->overview_edges,
+             header.n_overview_edges * 2 * sizeof(uint32_t),
+             overview_edges_offset) != 0) {
+    oocClose(store);
+    return NULL;
+  }
+  store->budget_bytes = budget_bytes;
+  return store;
+}
+
+static void unmapChunk(OocStore_t* store, int slot) {
+  const int chunk = store->resident[slot];
+  const size_t bytes = mappedBytes(store, chunk);
+  munmap(store->mapped[chunk], bytes);
+  store->mapped[chunk] = NULL;
+  store->resident_bytes -= (long long)bytes;
+  memAccountRelease(MEM_CACHES, (long long)bytes);
+  store->resident[slot] = store->resident[--store->n_resident];
+}
+
+void oocClose(OocStore_t* store) {
+  if (store == NULL) return;
+  while (store->n_resident > 0) unmapChunk(store, store->n_resident - 1);
+  const size_t n_chunks = store->header.n_chunks;
+  const size_t n_nodes = store->header.n_nodes;
+  void* arrays[] = {store->nodes,     store->chunks,
+                    store->overview_positions,
+                    store->overview_edges,
+                    store->mapped,    store->last_used,
+                    store->wanted,    store->resident,
+                    store->draw,      store->candidates,
+                    store->stack};
+  const size_t sizes[] = {n_nodes * sizeof(OocNode_t),
+                          n_chunks * sizeof(OocChunkEntry_t),
+                          store->header.n_overview_vertices * 3 * sizeof(float),
+                          store->header.n_overview_edges * 2 * sizeof(uint32_t),
+                          n_chunks * sizeof(void*),
+                          n_chunks * sizeof(uint64_t),
+                          n_chunks * sizeof(uint64_t),
+                          n_chunks * sizeof(int),
+                          n_chunks * sizeof(int),
+                          n_chunks * sizeof(OocCandidate_t),
+                          n_nodes * sizeof(int)};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    memAccountFree(MEM_CACHES, arrays[i], sizes[i] ? sizes[i] : 1);
+  }
+  close(store->fd);
+  free(store);
+}
+
+static long long chunkBudget(const OocStore_t* store) {
+  const long long budget = store->budget_bytes - store->fixed_bytes;
+  return budget > 0 ? budget : 0;
+}
+
+/*!
+ * \brief evictOne
+ *
+ * Unmaps the least recently drawn chunk that the current frame does not
+ * want, or any chunk if evict_wanted is set.
+ *
+ * \return 0 if a chunk was unmapped, -1 if none could be.
+ */
+static int evictOne(OocStore_t* store, int evict_wanted) {
+  int victim = -1;
+  for (int slot = 0; slot < store->n_resident; ++slot) {
+    const int chunk = store->resident[slot];
+    if (!evict_wanted && store->wanted[chunk] == store->frame) continue;
+    if (victim < 0 ||
+        store->last_used[chunk] < store->last_used[store->resident[victim]]) {
+      victim = slot;
+    }
+  }
+  if (victim < 0) return -1;
+  unmapChunk(store, victim);
+  return 0;
+}
+
+void oocSetBudget(OocStore_t* store, long long budget_bytes) {
+  store->budget_bytes = budget_bytes;
+  while (store->resident_bytes > chunkBudget(store)) {
+    if (evictOne(store, 1) != 0) break;
+  }
+}
+
+static int mapChunk(OocStore_t* store, int chunk) {
+  const size_t bytes = mappedBytes(store, chunk);
+  void* data = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, store->fd,
+                    (off_t)store->chunks[chunk].offset);
+  if (data == MAP_FAILED) return -1;
+  // Start reading the chunk in the background, it is touched when drawn
+  posix_madvise(data, bytes, POSIX_MADV_WILLNEED);
+  store->mapped[chunk] = data;
+  store->resident[store->n_resident++] = chunk;
+  store->resident_bytes += (long long)bytes;
+  memAccountAdd(MEM_CACHES, (long long)bytes);
+  return 0;
+}
+
+/*!
+ * \brief projectBox
+ *
+ * Projects the corners of a box with the column-major mvp matrix.
+ *
+ * \return -1 if the box is outside the view volume, otherwise its larger
+ * screen extent in pixels (FLT_MAX if it reaches behind the camera).
+ */
+static float projectBox(const float mvp[16], const float min[3],
+                        const float max[3], int viewport_height) {
+  unsigned outside = 0x3f;
+  float low[2] = {FLT_MAX, FLT_MAX};
+  float high[2] = {-FLT_MAX, -FLT_MAX};
+  int behind = 0;
+  for (int corner = 0; corner < 8; ++corner) {
+    const float p[3] = {corner & 1 ? max[0] : min[0],
+                        corner & 2 ? max[1] : min[1],
+                        corner & 4 ? max[2] : min[2]};
+    float clip[4];
+    for (int row = 0; row < 4; ++row) {
+      clip[row] = mvp[row] * p[0] + mvp[4 + row] * p[1] + mvp[8 + row] * p[2] +
+                  mvp[12 + row];
+    }
+    const float w = clip[3];
+    outside &= (clip[0] < -w) | (clip[0] > w) << 1 | (clip[1] < -w) << 2 |
+               (clip[1] > w) << 3 | (clip[2] < -w) << 4 | (clip[2] > w) << 5;
+    if (w <= 1e-6f) {
+      behind = 1;
+      continue;
+    }
+    for (int axis = 0; axis < 2; ++axis) {
+      low[axis] = fminf(low[axis], clip[axis] / w);
+      high[axis] = fmaxf(high[axis], clip[axis] / w);
+    }
+  }
+  if (outside != 0) return -1.0f;
+  if (behind) return FLT_MAX;
+  return fmaxf(high[0] - low[0], high[1] - low[1]) * 0.5f *
+         (float)viewport_height;
+}
+
+static int compareCandidates(const void* a, const void* b) {
+  const float x = ((const OocCandidate_t*)a)->pixels;
+  const float y = ((const OocCandidate_t*)b)->pixels;
+  return (x < y) - (x > y);
+}
+
+/*!
+ * \brief oocUpdate
+ *
+ * Chooses the chunks for a view and maps or unmaps chunk data accordingly.
+ * Visible chunks are ranked by their size on screen and the largest that
+ * fit in the budget are wanted; at most OOC_LOADS_PER_UPDATE of them are
+ * mapped per call, so detail streams in over a few frames while the
+ * overview is drawn. Chunks no longer wanted stay mapped until their space
+ * is needed, least recently drawn first.
+ *
+ * \param mvp Column-major model-view-projection matrix.
+ */
+void oocUpdate(OocStore_t* store, const float mvp[16], int viewport_height,
+               OocFrame_t* frame) {
+  memset(frame, 0, sizeof(*frame));
+  store->frame++;
+  store->n_draw = 0;
+  int n_candidates = 0;
+  int depth = 0;
+  if (store->header.n_nodes > 0) store->stack[depth++] = 0;
+  while (depth > 0) {
+    const OocNode_t* node = &store->nodes[store->stack[--depth]];
+    const float pixels =
+        projectBox(mvp, node->min, node->max, viewport_height);
+    if (pixels < 0.0f) continue;
+    if (node->chunk < 0) {
+      for (int c = 0; c < node->n_children; ++c) {
+        store->stack[depth++] = node->first_child + c;
+      }
+      continue;
+    }
+    frame->visible++;
+    if (pixels < OOC_MIN_CHUNK_PIXELS) {
+      frame->coarse++;
+    } else {
+      store->candidates[n_candidates].chunk = node->chunk;
+      store->candidates[n_candidates++].pixels = pixels;
+    }
+  }
+  qsort(store->candidates, n_candidates, sizeof(OocCandidate_t),
+        compareCandidates);
+
+  const long long budget = chunkBudget(store);
+  long long wanted_bytes = 0;
+  int n_wanted = 0;
+  for (int k = 0; k < n_candidates; ++k) {
+    const int chunk = store->candidates[k].chunk;
+    const long long bytes = (long long)mappedBytes(store, chunk);
+    if (wanted_bytes + bytes > budget) {
+      frame->coarse++;
+      continue;
+    }
+    wanted_bytes += bytes;
+    store->wanted[chunk] = store->frame;
+    store->candidates[n_wanted++] = store->candidates[k];
+  }
+
+  for (int k = 0; k < n_wanted; ++k) {
+    const int chunk = store->candidates[k].chunk;
+    if (store->mapped[chunk] == NULL) {
+      if (frame->loaded >= OOC_LOADS_PER_UPDATE) {
+        frame->pending++;
+        continue;
+      }
+      const long long bytes = (long long)mappedBytes(store, chunk);
+      while (store->resident_bytes + bytes > budget &&
+             evictOne(store, 0) == 0) {
+        frame->evicted++;
+      }
+      if (store->resident_bytes + bytes > budget ||
+          mapChunk(store, chunk) != 0) {
+        frame->pending++;
+        continue;
+      }
+      frame->loaded++;
+    }
+    store->last_used[chunk] = store->frame;
+    store->draw[store->n_draw++] = chunk;
+  }
+  frame->drawn = store->n_draw;
+  frame->resident_bytes = store->resident_bytes + store->fixed_bytes;
+  frame->budget_bytes = store->budget_bytes;
+}
+
+/*!
+ * \brief oocDrawList
+ *
+ * \return Number of chunks to draw for the last oocUpdate(), largest on
+ * screen first; *chunks points to their indices.
+ */
+int oocDrawList(const OocStore_t* store, const int** chunks) {
+  *chunks = store->draw;
+  return store->n_draw;
+}
+
+/*!
+ * \brief oocChunk
+ *
+ * Positions and local edge indices of a mapped chunk. They stay valid until
+ * a later oocUpdate() or oocSetBudget().
+ *
+ * \return 0, or -1 if the chunk is not mapped.
+ */
+int oocChunk(const OocStore_t* store, int chunk, OocMeshView_t* view) {
+  memset(view, 0, sizeof(*view));
+  if (chunk < 0 || chunk >= (int)store->header.n_chunks ||
+      store->mapped[chunk] == NULL) {
+    return -1;
+  }
+  const OocChunkEntry_t* entry = &store->chunks[chunk];
+  view->positions = store->mapped[chunk];
+  view->n_vertices = (int)entry->n_vertices;
+  view->indices =
+      (const uint32_t*)(view->positions + (size_t)entry->n_vertices * 3);
+  view->n_indices = (long)entry->n_edges * 2;
+  return 0;
+}
+
+void oocOverview(const OocStore_t* store, OocMeshView_t* view) {
+  view->positions = store->overview_positions;
+  view->n_vertices = (int)store->header.n_overview_vertices;
+  view->indices = store->overview_edges;
+  view->n_indices = (long)store->header.n_overview_edges * 2;
+}
+
+int oocChunkCount(const OocStore_t* store) {
+  return (int)store->header.n_chunks;
+}
+
+long long oocVertexCount(const OocStore_t* store) {
+  return (long long)store->header.n_vertices;
+}
+
+long long oocEdgeCount(const OocStore_t* store) {
+  return (long long)store->header.n_edges;
+}
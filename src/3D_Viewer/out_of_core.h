@@ -0,0 +1,96 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OOC_STORE_SUFFIX ".s21ooc"
+#define OOC_DEFAULT_BUDGET_MB 1024
+#define OOC_LOADS_PER_UPDATE 16
+#define OOC_MIN_CHUNK_PIXELS 8.0f
+
+/*!
+ * \brief OocBuildOptions_t
+ *
+ * target_chunk_vertices sets the leaf grid: the finest octree level with
+ * about that many vertices per non-empty cell on average.
+ * overview_grid is the resolution of the vertex clustering of the overview,
+ * which keeps at most max_overview_edges edges.
+ */
+typedef struct OocBuildOptions_t {
+  long target_chunk_vertices;
+  int overview_grid;
+  int max_overview_edges;
+} OocBuildOptions_t;
+
+typedef struct OocBuildStats_t {
+  long long vertices;
+  long long edges;
+  long long cross_edges;
+  int chunks;
+  int nodes;
+  int overview_vertices;
+  int overview_edges;
+  long long file_bytes;
+  double elapsed_ns;
+} OocBuildStats_t;
+
+/*!
+ * \brief OocStore_t
+ *
+ * An opened chunk store. The node and chunk tables and the overview are
+ * always resident; chunk data is mapped from the file when the view needs it
+ * and unmapped in least recently used order to stay under the budget.
+ */
+typedef struct OocStore_t OocStore_t;
+
+/*!
+ * \brief OocFrame_t
+ *
+ * Result of oocUpdate(). visible chunks intersect the view; drawn of them
+ * are mapped, pending ones are still to be mapped by a later update and
+ * coarse ones are too small on screen or do not fit in the budget. While
+ * pending or coarse is not zero the overview stands in for them.
+ */
+typedef struct OocFrame_t {
+  int visible;
+  int drawn;
+  int pending;
+  int coarse;
+  int loaded;
+  int evicted;
+  long long resident_bytes;
+  long long budget_bytes;
+} OocFrame_t;
+
+typedef struct OocMeshView_t {
+  const float* positions;
+  int n_vertices;
+  const uint32_t* indices;
+  long n_indices;
+} OocMeshView_t;
+
+void oocBuildDefaults(OocBuildOptions_t* options);
+int oocBuild(const char* obj_path, const char* store_path,
+             const OocBuildOptions_t* options, OocBuildStats_t* stats);
+
+OocStore_t* oocOpen(const char* store_path, long long budget_bytes);
+void oocClose(OocStore_t* store);
+void oocSetBudget(OocStore_t* store, long long budget_bytes);
+void oocUpdate(OocStore_t* store, const float mvp[16], int viewport_height,
+               OocFrame_t* frame);
+int oocDrawList(const OocStore_t* store, const int** chunks);
+int oocChunk(const OocStore_t* store, int chunk, OocMeshView_t* view);
+void oocOverview(const OocStore_t* store, OocMeshView_t* view);
+int oocChunkCount(const OocStore_t* store);
+long long oocVertexCount(const OocStore_t* store);
+long long oocEdgeCount(const OocStore_t* store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OUT_OF_CORE_H
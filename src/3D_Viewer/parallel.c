@@ -0,0 +1,581 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "stage_timer.h"
+#include "trace.h"
+
+#define PARALLEL_MAX_THREADS 64
+// Chunks per thread a loop is cut into, so that threads done early have
+// something left to steal
+#define PARALLEL_CHUNKS_PER_THREAD 8
+// Ranges one deque holds; a thread whose deque is full stops splitting
+#define PARALLEL_DEQUE_SIZE 256
+// Most chunks of a reduction, whatever the thread count
+#define PARALLEL_REDUCE_CHUNKS 256
+
+struct ParallelToken_t {
+  atomic_int cancelled;
+};
+
+/*!
+ * \brief ParallelJob_t
+ *
+ * One parallel loop, on the stack of the thread that started it until
+ * remaining reaches 0. [0, count) is cut into chunks of chunk items.
+ */
+typedef struct ParallelJob_t {
+  ParallelRangeFn_t body;
+  void* context;
+  long count;
+  long chunk;
+  ParallelPriority_t priority;
+  const ParallelToken_t* token;
+  atomic_long remaining;
+  atomic_long skipped;
+} ParallelJob_t;
+
+// Chunks [first, end) of a job
+typedef struct ParallelTask_t {
+  ParallelJob_t* job;
+  long first;
+  long end;
+} ParallelTask_t;
+
+/*!
+ * \brief ParallelDeque_t
+ *
+ * Ranges queued by one thread. It pushes and pops the newest at the bottom,
+ * other threads steal the oldest, and largest, at the top. size mirrors
+ * bottom - top so that empty deques are skipped without the lock.
+ */
+typedef struct ParallelDeque_t {
+  pthread_mutex_t lock;
+  int top;
+  int bottom;
+  atomic_int size;
+  ParallelTask_t tasks[PARALLEL_DEQUE_SIZE];
+} ParallelDeque_t;
+
+// A worker, or the last one shared by threads outside the pool
+typedef struct ParallelSlot_t {
+  ParallelDeque_t deques[PARALLEL_PRIORITY_COUNT];
+  atomic_llong tasks;
+  atomic_llong steals;
+  atomic_llong busy_ns;
+  struct ParallelPool_t* pool;
+  int index;
+} ParallelSlot_t;
+
+/*!
+ * \brief ParallelPool_t
+ *
+ * threads - 1 workers and their slots, plus the shared slot at index
+ * n_workers. Idle threads sleep on wake until generation changes, which
+ * happens whenever ranges are queued or a loop finishes.
+ */
+typedef struct ParallelPool_t {
+  int threads;
+  int n_workers;
+  pthread_t workers[PARALLEL_MAX_THREADS];
+  ParallelSlot_t* slots;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  atomic_long generation;
+  int stop;
+  atomic_llong loops;
+  atomic_llong cancelled;
+  double stats_start;
+} ParallelPool_t;
+
+// 0 until the first parallelThreadCount() call picks the default.
+static atomic_int parallel_threads = 0;
+// Guards parallel_pool, which is made by the first loop that needs it
+static pthread_mutex_t parallel_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static ParallelPool_t* parallel_pool = NULL;
+// Slot of a worker thread, -1 on threads outside the pool
+static _Thread_local int parallel_slot = -1;
+static _Thread_local ParallelPriority_t parallel_priority =
+    PARALLEL_INTERACTIVE;
+
+/*!
+ * \brief parallelThreadCount
+ *
+ * Number of threads parallelFor uses: the S21_VIEWER_THREADS environment
+ * variable if set, otherwise the number of online processors.
+ */
+int parallelThreadCount(void) {
+  int threads = atomic_load(&parallel_threads);
+  if (threads <= 0) {
+    const char* env = getenv("S21_VIEWER_THREADS");
+    long count = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) count = 1;
+    if (count > PARALLEL_MAX_THREADS) count = PARALLEL_MAX_THREADS;
+    threads = (int)count;
+    atomic_store(&parallel_threads, threads);
+  }
+  return threads;
+}
+
+/*!
+ * \brief parallelSetThreadCount
+ *
+ * Overrides the thread count, 0 restores the default. The pool is made
+ * again for the new count by the next loop. Not thread-safe, call it while
+ * no parallel loop is running.
+ */
+void parallelSetThreadCount(int threads) {
+  atomic_store(&parallel_threads, threads > PARALLEL_MAX_THREADS
+                                      ? PARALLEL_MAX_THREADS
+                                      : threads);
+}
+
+ParallelPriority_t parallelPriority(void) { return parallel_priority; }
+
+/*!
+ * \brief parallelSetPriority
+ *
+ * Sets the priority of the loops the calling thread starts. Threads that
+ * build caches in the background lower theirs, so that the loops of
+ * transforms on the GUI thread are run first.
+ */
+void parallelSetPriority(ParallelPriority_t priority) {
+  parallel_priority = priority;
+}
+
+ParallelToken_t* parallelTokenCreate(void) {
+  ParallelToken_t* token = malloc(sizeof(ParallelToken_t));
+  if (token != NULL) atomic_init(&token->cancelled, 0);
+  return token;
+}
+
+// Chunks not started yet are skipped by every loop given the token.
+void parallelTokenCancel(ParallelToken_t* token) {
+  if (token != NULL) atomic_store(&token->cancelled, 1);
+}
+
+int parallelTokenCancelled(const ParallelToken_t* token) {
+  return token != NULL &&
+         atomic_load_explicit(&token->cancelled, memory_order_relaxed);
+}
+
+void parallelTokenDestroy(ParallelToken_t* token) { free(token); }
+
+static int pushTask(ParallelDeque_t* deque, ParallelTask_t task) {
+  pthread_mutex_lock(&deque->lock);
+  if (deque->bottom == PARALLEL_DEQUE_SIZE && deque->top > 0) {
+    memmove(deque->tasks, deque->tasks + deque->top,
+            (size_t)(deque->bottom - deque->top) * sizeof(ParallelTask_t));
+    deque->bottom -= deque->top;
+    deque->top = 0;
+  }
+  const int pushed = deque->bottom < PARALLEL_DEQUE_SIZE;
+  if (pushed) {
+    deque->tasks[deque->bottom++] = task;
+    atomic_fetch_add(&deque->size, 1);
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return pushed;
+}
+
+// The newest range, if it belongs to job or job is NULL.
+static int popTask(ParallelDeque_t* deque, const ParallelJob_t* job,
+                   ParallelTask_t* task) {
+  if (atomic_load_explicit(&deque->size, memory_order_relaxed) == 0) return 0;
+  pthread_mutex_lock(&deque->lock);
+  const int found = deque->bottom > deque->top &&
+                    (job == NULL || deque->tasks[deque->bottom - 1].job == job);
+  if (found) {
+    *task = deque->tasks[--deque->bottom];
+    atomic_fetch_sub(&deque->size, 1);
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+// The oldest range, or the oldest of job when it is not NULL.
+static int stealTask(ParallelDeque_t* deque, const ParallelJob_t* job,
+                     ParallelTask_t* task) {
+  if (atomic_load_explicit(&deque->size, memory_order_relaxed) == 0) return 0;
+  pthread_mutex_lock(&deque->lock);
+  int found = 0;
+  for (int i = deque->top; i < deque->bottom && !found; ++i) {
+    if (job != NULL && deque->tasks[i].job != job) continue;
+    *task = deque->tasks[i];
+    if (i == deque->top) {
+      deque->top++;
+    } else {
+      memmove(deque->tasks + i, deque->tasks + i + 1,
+              (size_t)(deque->bottom - i - 1) * sizeof(ParallelTask_t));
+      deque->bottom--;
+    }
+    atomic_fetch_sub(&deque->size, 1);
+    found = 1;
+  }
+  if (deque->top == deque->bottom) deque->top = deque->bottom = 0;
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+static void wakeAll(ParallelPool_t* pool) {
+  pthread_mutex_lock(&pool->lock);
+  atomic_fetch_add(&pool->generation, 1);
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/*!
+ * \brief findTask
+ *
+ * Looks for a range to run on slot self: interactive ranges before
+ * background ones, and for each its own deque first, then the ranges
+ * queued from outside the pool, then the other workers' deques. With job
+ * set, only ranges of that loop are taken, so a thread waiting for its
+ * loop never starts a long range of another one.
+ */
+static int findTask(ParallelPool_t* pool, int self, const ParallelJob_t* job,
+                    ParallelTask_t* task) {
+  const int shared = pool->n_workers;
+  for (int p = 0; p < PARALLEL_PRIORITY_COUNT; ++p) {
+    if (job != NULL && (int)job->priority != p) continue;
+    if (self != shared && popTask(&pool->slots[self].deques[p], job, task)) {
+      return 1;
+    }
+    if (stealTask(&pool->slots[shared].deques[p], job, task)) return 1;
+    for (int k = 1; k <= pool->n_workers; ++k) {
+      const int victim = (self + k) % (pool->n_workers + 1);
+      if (victim == shared || victim == self) continue;
+      if (stealTask(&pool->slots[victim].deques[p], job, task)) {
+        atomic_fetch_add_explicit(&pool->slots[self].steals, 1,
+                                  memory_order_relaxed);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*!
+ * \brief runTask
+ *
+ * Queues the second half of the range on slot self until one chunk is
+ * left, runs that chunk, and counts the range as done. Nested loops of
+ * the body run at the priority of the job.
+ */
+static void runTask(ParallelPool_t* pool, int self, ParallelTask_t task) {
+  ParallelJob_t* job = task.job;
+  ParallelSlot_t* slot = &pool->slots[self];
+  int queued = 0;
+  while (task.end - task.first > 1) {
+    const long middle = task.first + (task.end - task.first) / 2;
+    const ParallelTask_t rest = {job, middle, task.end};
+    if (!pushTask(&slot->deques[job->priority], rest)) break;
+    task.end = middle;
+    queued = 1;
+  }
+  if (queued) wakeAll(pool);
+
+  const ParallelPriority_t outer = parallel_priority;
+  parallel_priority = job->priority;
+  const double start = stageTimerNow();
+  long skipped = 0;
+  for (long c = task.first; c < task.end; ++c) {
+    if (parallelTokenCancelled(job->token)) {
+      ++skipped;
+      continue;
+    }
+    const long begin = c * job->chunk;
+    const long end =
+        job->count - begin < job->chunk ? job->count : begin + job->chunk;
+    job->body(job->context, begin, end);
+  }
+  atomic_fetch_add_explicit(&slot->busy_ns,
+                            (long long)(stageTimerNow() - start),
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&slot->tasks, 1, memory_order_relaxed);
+  parallel_priority = outer;
+  if (skipped > 0) atomic_fetch_add(&job->skipped, skipped);
+  // The job may be gone once its last chunk is counted
+  const long n = task.end - task.first;
+  if (atomic_fetch_sub(&job->remaining, n) == n) wakeAll(pool);
+}
+
+static void* runWorker(void* argument) {
+  ParallelSlot_t* slot = argument;
+  ParallelPool_t* pool = slot->pool;
+  parallel_slot = slot->index;
+  char name[32];
+  snprintf(name, sizeof(name), "parallel worker %d", slot->index);
+  traceSetThreadName(name);
+  for (;;) {
+    const long seen = atomic_load(&pool->generation);
+    ParallelTask_t task;
+    if (findTask(pool, slot->index, NULL, &task)) {
+      runTask(pool, slot->index, task);
+      continue;
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop && atomic_load(&pool->generation) == seen) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    const int stop = pool->stop;
+    pthread_mutex_unlock(&pool->lock);
+    if (stop) break;
+  }
+  return NULL;
+}
+
+static void destroyPool(ParallelPool_t* pool, int started) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < started; ++i) pthread_join(pool->workers[i], NULL);
+  for (int s = 0; s <= pool->n_workers; ++s) {
+    for (int p = 0; p < PARALLEL_PRIORITY_COUNT; ++p) {
+      pthread_mutex_destroy(&pool->slots[s].deques[p].lock);
+    }
+  }
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->slots);
+  free(pool);
+}
+
+// NULL if the memory or a worker thread could not be had.
+static ParallelPool_t* createPool(int threads) {
+  ParallelPool_t* pool = calloc(1, sizeof(ParallelPool_t));
+  if (pool == NULL) return NULL;
+  pool->slots = calloc((size_t)threads, sizeof(ParallelSlot_t));
+  if (pool->slots == NULL) {
+    free(pool);
+    return NULL;
+  }
+  pool->threads = threads;
+  pool->n_workers = threads - 1;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  atomic_init(&pool->generation, 0);
+  atomic_init(&pool->loops, 0);
+  atomic_init(&pool->cancelled, 0);
+  pool->stats_start = stageTimerNow();
+  for (int s = 0; s < threads; ++s) {
+    ParallelSlot_t* slot = &pool->slots[s];
+    for (int p = 0; p < PARALLEL_PRIORITY_COUNT; ++p) {
+      pthread_mutex_init(&slot->deques[p].lock, NULL);
+      atomic_init(&slot->deques[p].size, 0);
+    }
+    atomic_init(&slot->tasks, 0);
+    atomic_init(&slot->steals, 0);
+    atomic_init(&slot->busy_ns, 0);
+    slot->pool = pool;
+    slot->index = s;
+  }
+  for (int i = 0; i < pool->n_workers; ++i) {
+    if (pthread_create(&pool->workers[i], NULL, runWorker, &pool->slots[i]) !=
+        0) {
+      destroyPool(pool, i);
+      return NULL;
+    }
+  }
+  return pool;
+}
+
+// The pool for the current thread count, made on first use.
+static ParallelPool_t* acquirePool(int threads) {
+  pthread_mutex_lock(&parallel_pool_lock);
+  if (parallel_pool != NULL && parallel_pool->threads != threads) {
+    destroyPool(parallel_pool, parallel_pool->n_workers);
+    parallel_pool = NULL;
+  }
+  if (parallel_pool == NULL) parallel_pool = createPool(threads);
+  ParallelPool_t* pool = parallel_pool;
+  pthread_mutex_unlock(&parallel_pool_lock);
+  return pool;
+}
+
+/*!
+ * \brief parallelForCancellable
+ *
+ * Runs body over [0, count) on the thread pool and returns when it is
+ * done. The range is cut into chunks of at least grain items; the calling
+ * thread splits it in halves, keeping one and queueing the other, and
+ * idle workers steal the queued halves and split them further. While it
+ * waits, the calling thread runs chunks of its own loop only. Loops run
+ * from inside a body nest, and are run at the priority of the outer one.
+ * Runs inline when count is below two grains, there is one thread or the
+ * pool cannot be started.
+ *
+ * \param token Chunks not started when it is cancelled are skipped; NULL
+ * for none.
+ * \return 0 if every chunk ran, -1 if some were skipped.
+ */
+int parallelForCancellable(long count, long grain, ParallelRangeFn_t body,
+                           void* context, const ParallelToken_t* token) {
+  if (count <= 0) return 0;
+  if (grain < 1) grain = 1;
+  const int threads = parallelThreadCount();
+  ParallelPool_t* pool =
+      threads > 1 && count / grain >= 2 ? acquirePool(threads) : NULL;
+  if (pool == NULL) {
+    if (parallelTokenCancelled(token)) return -1;
+    body(context, 0, count);
+    return 0;
+  }
+
+  long chunk = count / ((long)threads * PARALLEL_CHUNKS_PER_THREAD);
+  if (chunk < grain) chunk = grain;
+  const long n_chunks = count / chunk + (count % chunk != 0);
+  ParallelJob_t job;
+  job.body = body;
+  job.context = context;
+  job.count = count;
+  job.chunk = chunk;
+  job.priority = parallel_priority;
+  job.token = token;
+  atomic_init(&job.remaining, n_chunks);
+  atomic_init(&job.skipped, 0);
+  atomic_fetch_add_explicit(&pool->loops, 1, memory_order_relaxed);
+
+  const int self = parallel_slot >= 0 ? parallel_slot : pool->n_workers;
+  const ParallelTask_t all = {&job, 0, n_chunks};
+  runTask(pool, self, all);
+  while (atomic_load(&job.remaining) > 0) {
+    const long seen = atomic_load(&pool->generation);
+    ParallelTask_t task;
+    if (findTask(pool, self, &job, &task)) {
+      runTask(pool, self, task);
+      continue;
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&job.remaining) > 0 &&
+           atomic_load(&pool->generation) == seen) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+  }
+  const long skipped = atomic_load(&job.skipped);
+  if (skipped > 0) {
+    atomic_fetch_add_explicit(&pool->cancelled, skipped, memory_order_relaxed);
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * \brief parallelFor
+ *
+ * parallelForCancellable() without a token.
+ *
+ * \param grain Smallest range worth handing to a thread.
+ */
+void parallelFor(long count, long grain, ParallelRangeFn_t body,
+                 void* context) {
+  parallelForCancellable(count, grain, body, context, NULL);
+}
+
+typedef struct ParallelReduction_t {
+  ParallelReduceFn_t body;
+  void* context;
+  long count;
+  long chunk;
+  size_t size;
+  unsigned char* partials;
+} ParallelReduction_t;
+
+static void reduceChunks(void* argument, long begin, long end) {
+  ParallelReduction_t* reduction = argument;
+  for (long c = begin; c < end; ++c) {
+    const long first = c * reduction->chunk;
+    const long last = reduction->count - first < reduction->chunk
+                          ? reduction->count
+                          : first + reduction->chunk;
+    reduction->body(reduction->context, first, last,
+                    reduction->partials + (size_t)c * reduction->size);
+  }
+}
+
+/*!
+ * \brief parallelReduce
+ *
+ * Folds [0, count) into result with parallelFor: every chunk of at least
+ * grain items into its own partial, starting from the value result has on
+ * entry, then all partials into result in order. The chunks depend on
+ * count and grain only, so the result is the same on any number of
+ * threads, floating-point sums included.
+ *
+ * \return 0 on success, -1 if the partials could not be allocated, with
+ * result unchanged then.
+ */
+int parallelReduce(long count, long grain, ParallelReduceFn_t body,
+                   ParallelCombineFn_t combine, void* context, void* result,
+                   size_t result_size) {
+  if (count <= 0) return 0;
+  if (grain < 1) grain = 1;
+  long chunk = count / PARALLEL_REDUCE_CHUNKS + 1;
+  if (chunk < grain) chunk = grain;
+  const long n_chunks = count / chunk + (count % chunk != 0);
+  ParallelReduction_t reduction = {body,        context,
+                                   count,       chunk,
+                                   result_size, malloc(n_chunks * result_size)};
+  if (reduction.partials == NULL) return -1;
+  for (long c = 0; c < n_chunks; ++c) {
+    memcpy(reduction.partials + (size_t)c * result_size, result, result_size);
+  }
+  parallelFor(n_chunks, 1, reduceChunks, &reduction);
+  for (long c = 0; c < n_chunks; ++c) {
+    combine(context, result, reduction.partials + (size_t)c * result_size);
+  }
+  free(reduction.partials);
+  return 0;
+}
+
+/*!
+ * \brief parallelGetStats
+ *
+ * Counters of the pool; all zero until the first loop starts it.
+ */
+void parallelGetStats(ParallelStats_t* stats) {
+  memset(stats, 0, sizeof(*stats));
+  pthread_mutex_lock(&parallel_pool_lock);
+  const ParallelPool_t* pool = parallel_pool;
+  stats->threads = pool != NULL ? pool->threads : parallelThreadCount();
+  if (pool != NULL) {
+    stats->loops = atomic_load(&pool->loops);
+    stats->cancelled = atomic_load(&pool->cancelled);
+    for (int s = 0; s < pool->threads; ++s) {
+      stats->tasks += atomic_load(&pool->slots[s].tasks);
+      stats->steals += atomic_load(&pool->slots[s].steals);
+      stats->busy_ns += (double)atomic_load(&pool->slots[s].busy_ns);
+    }
+    stats->elapsed_ns = stageTimerNow() - pool->stats_start;
+    if (stats->elapsed_ns > 0.0) {
+      stats->utilization =
+          stats->busy_ns / (stats->threads * stats->elapsed_ns);
+    }
+  }
+  pthread_mutex_unlock(&parallel_pool_lock);
+}
+
+void parallelResetStats(void) {
+  pthread_mutex_lock(&parallel_pool_lock);
+  ParallelPool_t* pool = parallel_pool;
+  if (pool != NULL) {
+    atomic_store(&pool->loops, 0);
+    atomic_store(&pool->cancelled, 0);
+    for (int s = 0; s < pool->threads; ++s) {
+      atomic_store(&pool->slots[s].tasks, 0);
+      atomic_store(&pool->slots[s].steals, 0);
+      atomic_store(&pool->slots[s].busy_ns, 0);
+    }
+    pool->stats_start = stageTimerNow();
+  }
+  pthread_mutex_unlock(&parallel_pool_lock);
+}
@@ -0,0 +1,94 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief ParallelRangeFn_t
+ *
+ * Body of a parallel loop. Called with disjoint [begin, end) ranges that
+ * together cover [0, count).
+ */
+typedef void (*ParallelRangeFn_t)(void* context, long begin, long end);
+
+/*!
+ * \brief ParallelReduceFn_t
+ *
+ * Body of a parallel reduction: folds [begin, end) into partial, which
+ * starts as a copy of the identity the reduction was given.
+ */
+typedef void (*ParallelReduceFn_t)(void* context, long begin, long end,
+                                   void* partial);
+
+/*!
+ * \brief ParallelCombineFn_t
+ *
+ * Folds partial into result. Called on one thread, in the order of the
+ * ranges.
+ */
+typedef void (*ParallelCombineFn_t)(void* context, void* result,
+                                    const void* partial);
+
+/*!
+ * \brief ParallelPriority_t
+ *
+ * Loops started by a thread run at its priority, see parallelSetPriority().
+ * Idle workers take interactive ranges before background ones.
+ */
+typedef enum ParallelPriority_t {
+  PARALLEL_INTERACTIVE,
+  PARALLEL_BACKGROUND,
+  PARALLEL_PRIORITY_COUNT
+} ParallelPriority_t;
+
+/*!
+ * \brief ParallelStats_t
+ *
+ * Counters of the thread pool since it started or parallelResetStats().
+ * threads counts the workers and the thread waiting for a loop, which
+ * runs ranges of it too. busy_ns is the time spent in loop bodies on any
+ * of them, and utilization busy_ns over threads times elapsed_ns.
+ */
+typedef struct ParallelStats_t {
+  int threads;
+  long long loops;
+  long long tasks;
+  long long steals;
+  long long cancelled;
+  double busy_ns;
+  double elapsed_ns;
+  double utilization;
+} ParallelStats_t;
+
+typedef struct ParallelToken_t ParallelToken_t;
+
+int parallelThreadCount(void);
+void parallelSetThreadCount(int threads);
+void parallelFor(long count, long grain, ParallelRangeFn_t body,
+                 void* context);
+int parallelForCancellable(long count, long grain, ParallelRangeFn_t body,
+                           void* context, const ParallelToken_t* token);
+int parallelReduce(long count, long grain, ParallelReduceFn_t body,
+                   ParallelCombineFn_t combine, void* context, void* result,
+                   size_t result_size);
+
+ParallelPriority_t parallelPriority(void);
+void parallelSetPriority(ParallelPriority_t priority);
+
+ParallelToken_t* parallelTokenCreate(void);
+void parallelTokenCancel(ParallelToken_t* token);
+int parallelTokenCancelled(const ParallelToken_t* token);
+void parallelTokenDestroy(ParallelToken_t* token);
+
+void parallelGetStats(ParallelStats_t* stats);
+void parallelResetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PARALLEL_H
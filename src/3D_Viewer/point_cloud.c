@@ -0,0 +1,459 @@
+#include "point_cloud.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define POINT_CLOUD_GRAIN 16384
+// Three passes of 10 bits sort the 30-bit keys, 1024 counters stay in cache
+#define POINT_CLOUD_RADIX_BITS 10
+#define POINT_CLOUD_RADIX_PASSES 3
+
+typedef struct PointCloudBuild_t {
+  const float* vertices;
+  float minimum[3];
+  float scale;
+  uint32_t* keys;
+  uint32_t* ids;
+  float* sorted;
+  long long n_placed;
+  PointCloud_t* cloud;
+} PointCloudBuild_t;
+
+// Spreads the low 10 bits of v so that two zero bits follow each bit.
+static uint32_t spreadBits(uint32_t v) {
+  v &= 0x3FF;
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+static uint32_t quantize(float value, float minimum, float scale) {
+  const float q = (value - minimum) * scale;
+  const float limit = (float)((1 << POINT_CLOUD_MAX_DEPTH) - 1);
+  // Written so that NaN ends up at 0
+  return q > 0.0f ? (uint32_t)(q < limit ? q : limit) : 0;
+}
+
+static void computeKeys(void* argument, long begin, long end) {
+  PointCloudBuild_t* build = argument;
+  for (long i = begin; i < end; ++i) {
+    const float* v = &build->vertices[i * 3];
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      code |= spreadBits(quantize(v[axis], build->minimum[axis], build->scale))
+              << axis;
+    }
+    build->keys[i] = code;
+  }
+}
+
+// The octree cells are cubes, so one scale over the largest extent.
+static void computeBounds(PointCloudBuild_t* build, long long n) {
+  float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int axis = 0; axis < 3; ++axis) build->minimum[axis] = FLT_MAX;
+  for (long long i = 0; i < n; ++i) {
+    for (int axis = 0; axis < 3; ++axis) {
+      const float value = build->vertices[(size_t)i * 3 + axis];
+      if (value < build->minimum[axis]) build->minimum[axis] = value;
+      if (value > maximum[axis]) maximum[axis] = value;
+    }
+  }
+  float extent = 0.0f;
+  for (int axis = 0; axis < 3; ++axis) {
+    extent = fmaxf(extent, maximum[axis] - build->minimum[axis]);
+  }
+  build->scale =
+      extent > 0.0f ? (float)(1 << POINT_CLOUD_MAX_DEPTH) / extent : 0.0f;
+}
+
+/*!
+ * \brief sortByKey
+ *
+ * LSD radix sort of keys together with the point ids 0..n-1. Stable, so
+ * points in the same cell keep their file order.
+ *
+ * \return 0 on success, -1 if out of memory.
+ */
+static int sortByKey(PointCloudBuild_t* build, uint32_t n) {
+  const size_t bytes = n * sizeof(uint32_t);
+  uint32_t* other_keys = loaderAlloc(MEM_LOADER_TEMP, bytes);
+  uint32_t* other_ids = loaderAlloc(MEM_LOADER_TEMP, bytes);
+  if (other_keys == NULL || other_ids == NULL) {
+    loaderFree(MEM_LOADER_TEMP, other_keys, bytes);
+    loaderFree(MEM_LOADER_TEMP, other_ids, bytes);
+    return -1;
+  }
+  const uint32_t mask = (1u << POINT_CLOUD_RADIX_BITS) - 1;
+  uint32_t* keys = build->keys;
+  uint32_t* ids = build->ids;
+  for (uint32_t i = 0; i < n; ++i) ids[i] = i;
+  for (int pass = 0; pass < POINT_CLOUD_RADIX_PASSES; ++pass) {
+    const int shift = pass * POINT_CLOUD_RADIX_BITS;
+    uint32_t offsets[1 << POINT_CLOUD_RADIX_BITS] = {0};
+    for (uint32_t i = 0; i < n; ++i) offsets[(keys[i] >> shift) & mask]++;
+    uint32_t total = 0;
+    for (int digit = 0; digit < (1 << POINT_CLOUD_RADIX_BITS); ++digit) {
+      const uint32_t count = offsets[digit];
+      offsets[digit] = total;
+      total += count;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+      const uint32_t slot = offsets[(keys[i] >> shift) & mask]++;
+      other_keys[slot] = keys[i];
+      other_ids[slot] = ids[i];
+    }
+    uint32_t* swap = keys;
+    keys = other_keys;
+    other_keys = swap;
+    swap = ids;
+    ids = other_ids;
+    other_ids = swap;
+  }
+  // After an odd number of passes the sorted data is in the other arrays
+  build->keys = keys;
+  build->ids = ids;
+  loaderFree(MEM_LOADER_TEMP, other_keys, bytes);
+  loaderFree(MEM_LOADER_TEMP, other_ids, bytes);
+  return 0;
+}
+
+static void gatherSorted(void* argument, long begin, long end) {
+  PointCloudBuild_t* build = argument;
+  for (long i = begin; i < end; ++i) {
+    memcpy(&build->sorted[i * 3], &build->vertices[(size_t)build->ids[i] * 3],
+           3 * sizeof(float));
+  }
+}
+
+static void emptyBounds(PointCloudNode_t* node) {
+  for (int axis = 0; axis < 3; ++axis) {
+    node->min[axis] = FLT_MAX;
+    node->max[axis] = -FLT_MAX;
+  }
+}
+
+static void growBounds(PointCloudNode_t* node, const float min[3],
+                       const float max[3]) {
+  for (int axis = 0; axis < 3; ++axis) {
+    node->min[axis] = fminf(node->min[axis], min[axis]);
+    node->max[axis] = fmaxf(node->max[axis], max[axis]);
+  }
+}
+
+// Moves the point at from into the node's own points.
+static void placePoint(PointCloudBuild_t* build, PointCloudNode_t* node,
+                       long long from) {
+  const float* v = &build->sorted[(size_t)from * 3];
+  float* out = &build->cloud->positions[(size_t)build->n_placed++ * 3];
+  out[0] = v[0];
+  out[1] = v[1];
+  out[2] = v[2];
+  growBounds(node, v, v);
+}
+
+/*!
+ * \brief buildNode
+ *
+ * Fills a node from the Morton-sorted points begin..end. Small ranges and
+ * the deepest cells become leaves holding all their points. Otherwise
+ * POINT_CLOUD_NODE_POINTS points evenly spaced along the curve are taken as
+ * the node's sample, the rest are moved together keeping their order and
+ * split into the child cells by the next three bits of their keys.
+ */
+static void buildNode(PointCloudBuild_t* build, int index, long long begin,
+                      long long end, int depth) {
+  PointCloud_t* cloud = build->cloud;
+  PointCloudNode_t* node = &cloud->nodes[index];
+  emptyBounds(node);
+  node->first = build->n_placed;
+  node->first_child = 0;
+  node->n_children = 0;
+  if (depth > cloud->depth) cloud->depth = depth;
+  const long long count = end - begin;
+  if (count <= POINT_CLOUD_NODE_POINTS || depth == POINT_CLOUD_MAX_DEPTH) {
+    for (long long i = begin; i < end; ++i) placePoint(build, node, i);
+    node->count = count;
+    return;
+  }
+
+  long long taken = 0;
+  long long rest = begin;
+  for (long long i = begin; i < end; ++i) {
+    if (taken < POINT_CLOUD_NODE_POINTS &&
+        (i - begin) * POINT_CLOUD_NODE_POINTS >= taken * count) {
+      placePoint(build, node, i);
+      ++taken;
+    } else {
+      float* v = &build->sorted[(size_t)rest * 3];
+      const float* from = &build->sorted[(size_t)i * 3];
+      v[0] = from[0];
+      v[1] = from[1];
+      v[2] = from[2];
+      build->keys[rest++] = build->keys[i];
+    }
+  }
+  node->count = taken;
+
+  const int shift = 3 * (POINT_CLOUD_MAX_DEPTH - 1 - depth);
+  int n_children = 0;
+  for (long long i = begin; i < rest; ++i) {
+    if (i == begin || ((build->keys[i] ^ build->keys[i - 1]) >> shift) & 7) {
+      ++n_children;
+    }
+  }
+  // Siblings are contiguous, their slots are taken before any is filled
+  const int first_child = cloud->n_nodes;
+  node->first_child = first_child;
+  node->n_children = n_children;
+  cloud->n_nodes += n_children;
+  int child = first_child;
+  long long start = begin;
+  for (long long i = begin + 1; i <= rest; ++i) {
+    if (i == rest || ((build->keys[i] ^ build->keys[start]) >> shift) & 7) {
+      buildNode(build, child++, start, i, depth + 1);
+      start = i;
+    }
+  }
+  // The box holds the points of the whole subtree
+  for (child = first_child; child < first_child + n_children; ++child) {
+    growBounds(node, cloud->nodes[child].min, cloud->nodes[child].max);
+  }
+}
+
+static int nodeCapacity(long long n_points) {
+  // Every inner node takes a full sample and has at most eight children
+  return (int)(9 * (n_points / POINT_CLOUD_NODE_POINTS) + 1);
+}
+
+/*!
+ * \brief pointCloudBuild
+ *
+ * Builds the octree of a model without edges. The points are sorted along a
+ * Morton curve through the bounding cube, whose prefixes are the octree
+ * cells, and every inner node keeps an even sample of its cell, so a coarse
+ * view draws the upper nodes only and a close one refines into the leaves.
+ *
+ * \param vertices Array returned by parseObjFile, left unchanged.
+ * \return 0 on success, -1 if out of memory or there are more points than
+ * the 32-bit sort handles, in which case the cloud is left empty.
+ */
+int pointCloudBuild(const float* vertices, long long n_vertices,
+                    PointCloud_t* cloud) {
+  memset(cloud, 0, sizeof(*cloud));
+  if (n_vertices <= 0) return 0;
+  if (n_vertices > UINT32_MAX) return -1;
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+  const uint32_t n = (uint32_t)n_vertices;
+  const size_t id_bytes = (size_t)n * sizeof(uint32_t);
+  const size_t position_bytes = (size_t)n * 3 * sizeof(float);
+  const int capacity = nodeCapacity(n_vertices);
+
+  PointCloudBuild_t build = {0};
+  build.vertices = vertices;
+  build.cloud = cloud;
+  build.keys = loaderAlloc(MEM_LOADER_TEMP, id_bytes);
+  build.ids = loaderAlloc(MEM_LOADER_TEMP, id_bytes);
+  build.sorted = loaderAlloc(MEM_LOADER_TEMP, position_bytes);
+  cloud->n_points = n_vertices;
+  cloud->positions = loaderAlloc(MEM_VERTICES, position_bytes);
+  cloud->nodes =
+      loaderAlloc(MEM_INDICES, capacity * sizeof(PointCloudNode_t));
+  int failed = build.keys == NULL || build.ids == NULL ||
+               build.sorted == NULL || cloud->positions == NULL ||
+               cloud->nodes == NULL;
+  if (!failed) {
+    computeBounds(&build, n_vertices);
+    parallelFor(n, POINT_CLOUD_GRAIN, computeKeys, &build);
+    failed = sortByKey(&build, n) != 0;
+  }
+  if (!failed) {
+    // One gather into curve order, every level after it reads sequentially
+    parallelFor(n, POINT_CLOUD_GRAIN, gatherSorted, &build);
+    cloud->n_nodes = 1;
+    buildNode(&build, 0, 0, n_vertices, 0);
+    cloud->nodes =
+        loaderShrink(MEM_INDICES, cloud->nodes,
+                     capacity * sizeof(PointCloudNode_t),
+                     cloud->n_nodes * sizeof(PointCloudNode_t));
+    cloud->heap = loaderAlloc(MEM_INDICES, cloud->n_nodes * sizeof(int));
+    cloud->heap_pixels =
+        loaderAlloc(MEM_INDICES, cloud->n_nodes * sizeof(float));
+    cloud->draw = loaderAlloc(MEM_INDICES, cloud->n_nodes * sizeof(int));
+    failed = cloud->heap == NULL || cloud->heap_pixels == NULL ||
+             cloud->draw == NULL;
+  } else {
+    // Nothing was built yet, free the node table at the size it was taken
+    loaderFree(MEM_INDICES, cloud->nodes,
+               capacity * sizeof(PointCloudNode_t));
+    cloud->nodes = NULL;
+  }
+  loaderFree(MEM_LOADER_TEMP, build.keys, id_bytes);
+  loaderFree(MEM_LOADER_TEMP, build.ids, id_bytes);
+  loaderFree(MEM_LOADER_TEMP, build.sorted, position_bytes);
+  if (failed) {
+    pointCloudFree(cloud);
+    TRACE_END(span, "pointCloudBuild");
+    return -1;
+  }
+  stageTimerRecord(STAGE_POINT_CLOUD, start, n);
+  TRACE_END(span, "pointCloudBuild");
+  return 0;
+}
+
+void pointCloudFree(PointCloud_t* cloud) {
+  loaderFree(MEM_VERTICES, cloud->positions,
+             (size_t)cloud->n_points * 3 * sizeof(float));
+  loaderFree(MEM_INDICES, cloud->nodes,
+             (size_t)cloud->n_nodes * sizeof(PointCloudNode_t));
+  loaderFree(MEM_INDICES, cloud->heap, (size_t)cloud->n_nodes * sizeof(int));
+  loaderFree(MEM_INDICES, cloud->heap_pixels,
+             (size_t)cloud->n_nodes * sizeof(float));
+  loaderFree(MEM_INDICES, cloud->draw, (size_t)cloud->n_nodes * sizeof(int));
+  memset(cloud, 0, sizeof(*cloud));
+}
+
+/*!
+ * \brief projectBox
+ *
+ * Projects the corners of a box with the column-major mvp matrix.
+ *
+ * \return -1 if the box is outside the view volume, otherwise its larger
+ * screen extent in pixels (FLT_MAX if it reaches behind the camera).
+ */
+static float projectBox(const float mvp[16], const float min[3],
+                        const float max[3], int viewport_height) {
+  unsigned outside = 0x3f;
+  float low[2] = {FLT_MAX, FLT_MAX};
+  float high[2] = {-FLT_MAX, -FLT_MAX};
+  int behind = 0;
+  for (int corner = 0; corner < 8; ++corner) {
+    const float p[3] = {corner & 1 ? max[0] : min[0],
+                        corner & 2 ? max[1] : min[1],
+                        corner & 4 ? max[2] : min[2]};
+    float clip[4];
+    for (int row = 0; row < 4; ++row) {
+      clip[row] = mvp[row] * p[0] + mvp[4 + row] * p[1] + mvp[8 + row] * p[2] +
+                  mvp[12 + row];
+    }
+    const float w = clip[3];
+    outside &= (clip[0] < -w) | (clip[0] > w) << 1 | (clip[1] < -w) << 2 |
+               (clip[1] > w) << 3 | (clip[2] < -w) << 4 | (clip[2] > w) << 5;
+    if (w <= 1e-6f) {
+      behind = 1;
+      continue;
+    }
+    for (int axis = 0; axis < 2; ++axis) {
+      low[axis] = fminf(low[axis], clip[axis] / w);
+      high[axis] = fmaxf(high[axis], clip[axis] / w);
+    }
+  }
+  if (outside != 0) return -1.0f;
+  if (behind) return FLT_MAX;
+  return fmaxf(high[0] - low[0], high[1] - low[1]) * 0.5f *
+         (float)viewport_height;
+}
+
+// Max-heap of node indices keyed by pixels.
+static void heapPush(PointCloud_t* cloud, int* size, int node, float pixels) {
+  int slot = (*size)++;
+  while (slot > 0) {
+    const int parent = (slot - 1) / 2;
+    if (cloud->heap_pixels[parent] >= pixels) break;
+    cloud->heap[slot] = cloud->heap[parent];
+    cloud->heap_pixels[slot] = cloud->heap_pixels[parent];
+    slot = parent;
+  }
+  cloud->heap[slot] = node;
+  cloud->heap_pixels[slot] = pixels;
+}
+
+static int heapPop(PointCloud_t* cloud, int* size, float* pixels) {
+  const int top = cloud->heap[0];
+  *pixels = cloud->heap_pixels[0];
+  const int last = --(*size);
+  const int moved = cloud->heap[last];
+  const float moved_pixels = cloud->heap_pixels[last];
+  int slot = 0;
+  for (;;) {
+    int child = slot * 2 + 1;
+    if (child >= last) break;
+    if (child + 1 < last &&
+        cloud->heap_pixels[child + 1] > cloud->heap_pixels[child]) {
+      ++child;
+    }
+    if (cloud->heap_pixels[child] <= moved_pixels) break;
+    cloud->heap[slot] = cloud->heap[child];
+    cloud->heap_pixels[slot] = cloud->heap_pixels[child];
+    slot = child;
+  }
+  if (last > 0) {
+    cloud->heap[slot] = moved;
+    cloud->heap_pixels[slot] = moved_pixels;
+  }
+  return top;
+}
+
+/*!
+ * \brief pointCloudSelect
+ *
+ * Picks the nodes to draw for a view into cloud->draw. Nodes are taken in
+ * order of their screen-space error, the spacing of their sample on screen,
+ * which for samples of equal size follows their projected extent. A node's
+ * children are considered only once it is drawn and while its points lie
+ * more than a pixel apart; nodes outside the view are skipped with their
+ * subtrees. Selection stops at the first node that would exceed the budget,
+ * so the coarse levels are always complete before any detail is added.
+ *
+ * \param budget Points drawn at most, the root's sample is drawn regardless.
+ */
+void pointCloudSelect(PointCloud_t* cloud, const float mvp[16],
+                      int viewport_height, long long budget,
+                      PointCloudFrame_t* frame) {
+  memset(frame, 0, sizeof(*frame));
+  cloud->n_draw = 0;
+  if (cloud->n_nodes == 0) return;
+  int size = 0;
+  const float root_pixels = projectBox(mvp, cloud->nodes[0].min,
+                                       cloud->nodes[0].max, viewport_height);
+  if (root_pixels < 0.0f) return;
+  frame->visible_nodes++;
+  heapPush(cloud, &size, 0, root_pixels);
+  while (size > 0) {
+    float pixels;
+    const int index = heapPop(cloud, &size, &pixels);
+    const PointCloudNode_t* node = &cloud->nodes[index];
+    if (cloud->n_draw > 0 && frame->drawn_points + node->count > budget) {
+      frame->budget_reached = 1;
+      break;
+    }
+    cloud->draw[cloud->n_draw++] = index;
+    frame->drawn_points += node->count;
+    // Spacing of the sample if it covered a square of the node's extent
+    if (pixels / sqrtf((float)node->count) <= 1.0f) continue;
+    for (int c = 0; c < node->n_children; ++c) {
+      const PointCloudNode_t* child = &cloud->nodes[node->first_child + c];
+      const float child_pixels =
+          projectBox(mvp, child->min, child->max, viewport_height);
+      if (child_pixels < 0.0f) continue;
+      frame->visible_nodes++;
+      heapPush(cloud, &size, node->first_child + c, child_pixels);
+    }
+  }
+  frame->drawn_nodes = cloud->n_draw;
+}
+
+// Bytes of geometry held for drawing.
+long long pointCloudBytes(const PointCloud_t* cloud) {
+  return (long long)cloud->n_points * 3 * sizeof(float) +
+         (long long)cloud->n_nodes * sizeof(PointCloudNode_t);
+}
@@ -0,0 +1,77 @@
+#ifndef POINT_CLOUD_H
+#define POINT_CLOUD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Points sampled into each inner node, and the most a leaf holds
+#define POINT_CLOUD_NODE_POINTS 4096
+// Octree levels, one per bit of the 10-bit Morton coordinates
+#define POINT_CLOUD_MAX_DEPTH 10
+// Points drawn per frame unless set otherwise
+#define POINT_CLOUD_DEFAULT_BUDGET 2000000LL
+
+/*!
+ * \brief PointCloudNode_t
+ *
+ * Octree node with the bounding box of all points below it. Its own points,
+ * count of them from first on, are an even sample of those below it; the
+ * children add the rest, so drawing a node and all its descendants draws
+ * every point of its cell exactly once.
+ */
+typedef struct PointCloudNode_t {
+  float min[3];
+  float max[3];
+  long long first;
+  long long count;
+  int first_child;
+  int n_children;
+} PointCloudNode_t;
+
+/*!
+ * \brief PointCloud_t
+ *
+ * Positions of a model without edges, ordered so that the points of every
+ * node are contiguous, and the octree over them with node 0 as the root.
+ * draw holds the nodes picked by the last pointCloudSelect.
+ */
+typedef struct PointCloud_t {
+  float* positions;
+  long long n_points;
+  PointCloudNode_t* nodes;
+  int n_nodes;
+  int depth;
+  int* heap;
+  float* heap_pixels;
+  int* draw;
+  int n_draw;
+} PointCloud_t;
+
+/*!
+ * \brief PointCloudFrame_t
+ *
+ * What pointCloudSelect drew: nodes inside the view, nodes picked and their
+ * points, and whether the budget stopped refinement before the points got
+ * closer than a pixel.
+ */
+typedef struct PointCloudFrame_t {
+  int visible_nodes;
+  int drawn_nodes;
+  long long drawn_points;
+  int budget_reached;
+} PointCloudFrame_t;
+
+int pointCloudBuild(const float* vertices, long long n_vertices,
+                    PointCloud_t* cloud);
+void pointCloudFree(PointCloud_t* cloud);
+void pointCloudSelect(PointCloud_t* cloud, const float mvp[16],
+                      int viewport_height, long long budget,
+                      PointCloudFrame_t* frame);
+long long pointCloudBytes(const PointCloud_t* cloud);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // POINT_CLOUD_H
@@ -0,0 +1,97 @@
+#include "quality.h"
+
+#include <string.h>
+
+static const char* const kLevelNames[QUALITY_LEVEL_COUNT] = {
+    "full", "point vertices", "no vertices", "coarse edges",
+    "reduced resolution"};
+
+static void changeLevel(QualityGovernor_t* governor, QualityLevel_t level) {
+  governor->level = level;
+  // The frames of the old level say nothing about the new one
+  governor->n_frames = 0;
+}
+
+/*!
+ * \brief qualityInit
+ *
+ * Starts at full quality with no frames measured.
+ *
+ * \param target_ns Frame time to hold, in nanoseconds.
+ */
+void qualityInit(QualityGovernor_t* governor, double target_ns) {
+  memset(governor, 0, sizeof(*governor));
+  governor->target_ns = target_ns;
+  governor->level = QUALITY_FULL;
+}
+
+/*!
+ * \brief qualityRecordFrame
+ *
+ * Adds the duration of a frame drawn at the current level. Once
+ * QUALITY_WINDOW frames are measured, their mean lowers the level by one if
+ * it is over the target, or raises it by one if it is under
+ * QUALITY_RAISE_RATIO of the target. A frame over QUALITY_OVERLOAD times
+ * the target lowers the level right away.
+ *
+ * \return The level to draw the next frame at.
+ */
+QualityLevel_t qualityRecordFrame(QualityGovernor_t* governor,
+                                  double frame_ns) {
+  const QualityLevel_t last = QUALITY_REDUCED_RESOLUTION;
+  if (frame_ns > QUALITY_OVERLOAD * governor->target_ns &&
+      governor->level < last) {
+    changeLevel(governor, governor->level + 1);
+    return governor->level;
+  }
+  governor->frames_ns[governor->n_frames++] = frame_ns;
+  if (governor->n_frames < QUALITY_WINDOW) return governor->level;
+
+  double sum = 0.0;
+  for (int i = 0; i < QUALITY_WINDOW; ++i) sum += governor->frames_ns[i];
+  const double mean = sum / QUALITY_WINDOW;
+  governor->n_frames = 0;
+  if (mean > governor->target_ns && governor->level < last) {
+    changeLevel(governor, governor->level + 1);
+  } else if (mean < QUALITY_RAISE_RATIO * governor->target_ns &&
+             governor->level > QUALITY_FULL) {
+    changeLevel(governor, governor->level - 1);
+  }
+  return governor->level;
+}
+
+/*!
+ * \brief qualityRestore
+ *
+ * Goes back to full quality, when the input has stopped and a slow frame
+ * no longer matters.
+ */
+void qualityRestore(QualityGovernor_t* governor) {
+  changeLevel(governor, QUALITY_FULL);
+}
+
+const char* qualityLevelName(QualityLevel_t level) {
+  if ((unsigned)level >= QUALITY_LEVEL_COUNT) return "unknown";
+  return kLevelNames[level];
+}
+
+/*!
+ * \brief qualityEdgeSubset
+ *
+ * Copies every stride-th edge, starting with the first one. Reordered
+ * models have their edges sorted along a space-filling curve, so the subset
+ * covers the whole model evenly.
+ *
+ * \param subset Room for n_indices / stride + 2 indices.
+ * \return Number of indices written, two per kept edge.
+ */
+long long qualityEdgeSubset(const unsigned int* indices, long long n_indices,
+                            int stride, unsigned int* subset) {
+  if (stride < 1) stride = 1;
+  long long count = 0;
+  for (long long edge = 0; edge < n_indices / 2; edge += stride) {
+    subset[count++] = indices[edge * 2];
+    subset[count++] = indices[edge * 2 + 1];
+  }
+  return count;
+}
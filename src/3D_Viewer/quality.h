@@ -0,0 +1,67 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 60 frames per second
+#define QUALITY_DEFAULT_TARGET_MS 16.0
+// Frames averaged before the level changes
+#define QUALITY_WINDOW 4
+// A single frame this many times over the target lowers the level at once
+#define QUALITY_OVERLOAD 3.0
+// The level is raised again when frames take less than this part of the
+// target, low enough that the better level is likely to fit as well
+#define QUALITY_RAISE_RATIO 0.4
+// Every QUALITY_EDGE_STRIDE-th edge is kept by the coarse levels
+#define QUALITY_EDGE_STRIDE 4
+// Each axis of the reduced resolution is divided by this
+#define QUALITY_RESOLUTION_DIVISOR 2
+// Input pause after which full quality returns
+#define QUALITY_IDLE_MS 300
+
+/*!
+ * \brief QualityLevel_t
+ *
+ * Rendering simplifications, each level including those before it: vertex
+ * glyphs drawn as plain points with thin solid edges, no vertices at all,
+ * a subset of the edges, and drawing at a reduced resolution that is then
+ * scaled up.
+ */
+typedef enum QualityLevel_t {
+  QUALITY_FULL,
+  QUALITY_POINT_GLYPHS,
+  QUALITY_NO_GLYPHS,
+  QUALITY_COARSE_EDGES,
+  QUALITY_REDUCED_RESOLUTION,
+  QUALITY_LEVEL_COUNT
+} QualityLevel_t;
+
+/*!
+ * \brief QualityGovernor_t
+ *
+ * Picks the quality level from the durations of the last frames drawn at
+ * the current level: lower while they average over target_ns, higher while
+ * they average well under it.
+ */
+typedef struct QualityGovernor_t {
+  double target_ns;
+  double frames_ns[QUALITY_WINDOW];
+  int n_frames;
+  QualityLevel_t level;
+} QualityGovernor_t;
+
+void qualityInit(QualityGovernor_t* governor, double target_ns);
+QualityLevel_t qualityRecordFrame(QualityGovernor_t* governor,
+                                  double frame_ns);
+void qualityRestore(QualityGovernor_t* governor);
+const char* qualityLevelName(QualityLevel_t level);
+long long qualityEdgeSubset(const unsigned int* indices, long long n_indices,
+                            int stride, unsigned int* subset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // QUALITY_H
@@ -0,0 +1,293 @@
+#include "reorder.h"
+
+#include <float.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define REORDER_GRAIN 16384
+// Bits per axis of the Morton code, 3 * 10 fit in a 32-bit key.
+#define REORDER_MORTON_BITS 10
+#define REORDER_RADIX_BITS 8
+#define REORDER_RADIX_PASSES 4
+
+typedef struct ReorderContext_t {
+  const float* vertices;
+  float minimum[3];
+  float scale[3];
+  uint32_t* keys;
+  const uint32_t* rank;
+  unsigned int* indices;
+  uint32_t n_vertices;
+} ReorderContext_t;
+
+// Spreads the low 10 bits of v so that two zero bits follow each bit.
+static uint32_t spreadBits(uint32_t v) {
+  v &= 0x3FF;
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+static uint32_t quantize(float value, float minimum, float scale) {
+  const float q = (value - minimum) * scale;
+  const float limit = (float)((1 << REORDER_MORTON_BITS) - 1);
+  // Written so that NaN ends up at 0
+  return q > 0.0f ? (uint32_t)(q < limit ? q : limit) : 0;
+}
+
+static void computeKeys(void* argument, long begin, long end) {
+  ReorderContext_t* context = argument;
+  for (long i = begin; i < end; ++i) {
+    const float* v = &context->vertices[i * 3];
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      code |= spreadBits(quantize(v[axis], context->minimum[axis],
+                                  context->scale[axis]))
+              << axis;
+    }
+    context->keys[i] = code;
+  }
+}
+
+static void remapIndices(void* argument, long begin, long end) {
+  ReorderContext_t* context = argument;
+  for (long k = begin; k < end; ++k) {
+    if (context->indices[k] < context->n_vertices) {
+      context->indices[k] = context->rank[context->indices[k]];
+    }
+  }
+}
+
+static double meanEdgeSpan(const unsigned int* indices, long long n_indices) {
+  if (n_indices < 2) return 0.0;
+  double sum = 0.0;
+  for (long long k = 0; k + 1 < n_indices; k += 2) {
+    sum += indices[k] > indices[k + 1] ? indices[k] - indices[k + 1]
+                                       : indices[k + 1] - indices[k];
+  }
+  return sum / (n_indices / 2);
+}
+
+static void computeBounds(ReorderContext_t* context) {
+  float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int axis = 0; axis < 3; ++axis) context->minimum[axis] = FLT_MAX;
+  for (uint32_t i = 0; i < context->n_vertices; ++i) {
+    for (int axis = 0; axis < 3; ++axis) {
+      const float value = context->vertices[(size_t)i * 3 + axis];
+      if (value < context->minimum[axis]) context->minimum[axis] = value;
+      if (value > maximum[axis]) maximum[axis] = value;
+    }
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = maximum[axis] - context->minimum[axis];
+    context->scale[axis] =
+        extent > 0.0f ? (float)(1 << REORDER_MORTON_BITS) / extent : 0.0f;
+  }
+}
+
+/*!
+ * \brief sortByKey
+ *
+ * LSD radix sort of the vertex ids 0..n-1 by keys. Stable, so vertices in
+ * the same Morton cell keep their file order.
+ *
+ * \return Array of old vertex ids in the new order, or NULL if out of memory.
+ * On success keys is freed.
+ */
+static uint32_t* sortByKey(uint32_t* keys, uint32_t n) {
+  uint32_t* ids = loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  uint32_t* other_ids = loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  uint32_t* other_keys =
+      loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  if (ids == NULL || other_ids == NULL || other_keys == NULL) {
+    loaderFree(MEM_LOADER_TEMP, ids, n * sizeof(uint32_t));
+    loaderFree(MEM_LOADER_TEMP, other_ids, n * sizeof(uint32_t));
+    loaderFree(MEM_LOADER_TEMP, other_keys, n * sizeof(uint32_t));
+    return NULL;
+  }
+  for (uint32_t i = 0; i < n; ++i) ids[i] = i;
+  for (int pass = 0; pass < REORDER_RADIX_PASSES; ++pass) {
+    const int shift = pass * REORDER_RADIX_BITS;
+    uint32_t offsets[1 << REORDER_RADIX_BITS] = {0};
+    for (uint32_t i = 0; i < n; ++i) offsets[(keys[i] >> shift) & 0xFF]++;
+    uint32_t total = 0;
+    for (int digit = 0; digit < (1 << REORDER_RADIX_BITS); ++digit) {
+      const uint32_t count = offsets[digit];
+      offsets[digit] = total;
+      total += count;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+      const uint32_t slot = offsets[(keys[i] >> shift) & 0xFF]++;
+      other_keys[slot] = keys[i];
+      other_ids[slot] = ids[i];
+    }
+    uint32_t* swap = keys;
+    keys = other_keys;
+    other_keys = swap;
+    swap = ids;
+    ids = other_ids;
+    other_ids = swap;
+  }
+  // After an even number of passes keys is the caller's array again
+  loaderFree(MEM_LOADER_TEMP, other_ids, n * sizeof(uint32_t));
+  loaderFree(MEM_LOADER_TEMP, other_keys, n * sizeof(uint32_t));
+  loaderFree(MEM_LOADER_TEMP, keys, n * sizeof(uint32_t));
+  return ids;
+}
+
+// Segments in a run that is sorted as one: the three edges a-b, b-c, c-a of
+// a triangle, or a single segment. Keeping the triangles whole lets the
+// exporter and the half-edges still find the faces.
+static size_t segmentRun(const unsigned int* indices, size_t s,
+                         size_t n_segments, uint32_t* key) {
+  const unsigned int* e = &indices[s * 2];
+  size_t run = 1;
+  if (s + 3 <= n_segments && e[1] == e[2] && e[3] == e[4] && e[5] == e[0]) {
+    run = 3;
+  }
+  uint32_t smallest = UINT32_MAX;
+  for (size_t k = 0; k < run * 2; ++k) {
+    if (e[k] < smallest) smallest = e[k];
+  }
+  *key = smallest;
+  return run;
+}
+
+/*!
+ * \brief sortSegments
+ *
+ * Counting sort of the segments by their smallest vertex index, so segments
+ * sharing a vertex are drawn one after another. The edges of a triangle move
+ * together. Stable; segments with an out of range index go last.
+ *
+ * \return 0 on success, -1 if out of memory or there are more segments than
+ * the 32-bit offsets count (indices unchanged).
+ */
+static int sortSegments(unsigned int* indices, long long n_indices,
+                        uint32_t n_vertices) {
+  const size_t n_segments = (size_t)n_indices / 2;
+  if (n_segments > UINT32_MAX) return -1;
+  const size_t counts_bytes = ((size_t)n_vertices + 2) * sizeof(uint32_t);
+  const size_t sorted_bytes = n_segments * 2 * sizeof(unsigned int);
+  uint32_t* offsets = loaderAlloc(MEM_LOADER_TEMP, counts_bytes);
+  unsigned int* sorted = loaderAlloc(MEM_LOADER_TEMP, sorted_bytes);
+  if (offsets == NULL || sorted == NULL) {
+    loaderFree(MEM_LOADER_TEMP, offsets, counts_bytes);
+    loaderFree(MEM_LOADER_TEMP, sorted, sorted_bytes);
+    return -1;
+  }
+  memset(offsets, 0, counts_bytes);
+  uint32_t key;
+  for (size_t s = 0; s < n_segments;) {
+    const size_t run = segmentRun(indices, s, n_segments, &key);
+    offsets[(key < n_vertices ? key : n_vertices) + 1] += (uint32_t)run;
+    s += run;
+  }
+  for (uint32_t vertex = 0; vertex <= n_vertices; ++vertex) {
+    offsets[vertex + 1] += offsets[vertex];
+  }
+  for (size_t s = 0; s < n_segments;) {
+    const size_t run = segmentRun(indices, s, n_segments, &key);
+    uint32_t* offset = &offsets[key < n_vertices ? key : n_vertices];
+    const uint32_t slot = *offset;
+    *offset += (uint32_t)run;
+    memcpy(&sorted[(size_t)slot * 2], &indices[s * 2],
+           run * 2 * sizeof(unsigned int));
+    s += run;
+  }
+  memcpy(indices, sorted, sorted_bytes);
+  loaderFree(MEM_LOADER_TEMP, offsets, counts_bytes);
+  loaderFree(MEM_LOADER_TEMP, sorted, sorted_bytes);
+  return 0;
+}
+
+/*!
+ * \brief reorderModel
+ *
+ * Improves memory locality of a loaded model. Vertices are sorted along a
+ * Morton (Z-order) curve through the model's bounding box, so vertices close
+ * in space are close in memory, the indices are remapped, and segments are
+ * sorted by their smallest vertex so consecutive segments reuse the vertices
+ * just fetched. The three edges of a triangle stay together, so its face is
+ * still found, but the vertices are numbered in the new order. The drawn
+ * model is unchanged. Key computation and index remapping run in parallel.
+ *
+ * \param vertices Array returned by parseObjFile, replaced by a reordered
+ * array of the same size.
+ * \param stats Filled with the edge spans, may be NULL.
+ * \return 0 on success, -1 if temporary memory could not be allocated, in
+ * which case the model is left unchanged.
+ */
+int reorderModel(float** vertices, long long n_vertices,
+                 unsigned int* indices, long long n_indices,
+                 ReorderStats_t* stats) {
+  // Vertex numbers are 32-bit like the indices
+  if (n_vertices > UINT32_MAX) return -1;
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+  const uint32_t n = n_vertices > 0 ? (uint32_t)n_vertices : 0;
+  const size_t vertex_bytes = (size_t)n * 3 * sizeof(float);
+  if (stats != NULL) {
+    memset(stats, 0, sizeof(*stats));
+    stats->edge_span_before = meanEdgeSpan(indices, n_indices);
+  }
+  if (n == 0) return 0;
+
+  ReorderContext_t context = {0};
+  context.vertices = *vertices;
+  context.indices = indices;
+  context.n_vertices = n;
+  computeBounds(&context);
+  context.keys = loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  float* reordered = loaderAlloc(MEM_VERTICES, vertex_bytes);
+  if (context.keys == NULL || reordered == NULL) {
+    loaderFree(MEM_LOADER_TEMP, context.keys, n * sizeof(uint32_t));
+    loaderFree(MEM_VERTICES, reordered, vertex_bytes);
+    return -1;
+  }
+  parallelFor(n, REORDER_GRAIN, computeKeys, &context);
+  uint32_t* order = sortByKey(context.keys, n);
+  if (order == NULL) {
+    loaderFree(MEM_LOADER_TEMP, context.keys, n * sizeof(uint32_t));
+    loaderFree(MEM_VERTICES, reordered, vertex_bytes);
+    return -1;
+  }
+
+  // sortByKey consumed the keys array, allocate the rank in its place
+  uint32_t* rank = loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  if (rank == NULL) {
+    loaderFree(MEM_LOADER_TEMP, order, n * sizeof(uint32_t));
+    loaderFree(MEM_VERTICES, reordered, vertex_bytes);
+    return -1;
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    const uint32_t old = order[i];
+    rank[old] = i;
+    memcpy(&reordered[(size_t)i * 3], &(*vertices)[(size_t)old * 3],
+           3 * sizeof(float));
+  }
+  loaderFree(MEM_LOADER_TEMP, order, n * sizeof(uint32_t));
+  context.rank = rank;
+  parallelFor(n_indices, REORDER_GRAIN, remapIndices, &context);
+  loaderFree(MEM_LOADER_TEMP, rank, n * sizeof(uint32_t));
+  loaderFree(MEM_VERTICES, *vertices, vertex_bytes);
+  *vertices = reordered;
+  // Without memory for the segment sort the vertex order alone still helps
+  sortSegments(indices, n_indices, n);
+
+  stageTimerRecord(STAGE_REORDER, start, n);
+  if (stats != NULL) {
+    stats->edge_span_after = meanEdgeSpan(indices, n_indices);
+    stats->elapsed_ns = stageTimerGet(STAGE_REORDER)->last_ns;
+  }
+  TRACE_END(span, "reorderModel");
+  return 0;
+}
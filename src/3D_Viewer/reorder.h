@@ -0,0 +1,29 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief ReorderStats_t
+ *
+ * Result of a reordering pass. The edge span is the mean distance between
+ * the two vertex indices of a segment: the smaller it is, the closer in
+ * memory the vertices of neighbouring segments are.
+ */
+typedef struct ReorderStats_t {
+  double edge_span_before;
+  double edge_span_after;
+  double elapsed_ns;
+} ReorderStats_t;
+
+int reorderModel(float** vertices, long long n_vertices,
+                 unsigned int* indices, long long n_indices,
+                 ReorderStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // REORDER_H
@@ -0,0 +1,53 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stage_timer.h"
+
+#include <string.h>
+#include <time.h>
+
+static StageTiming_t stage_timings[STAGE_COUNT];
+
+static const char* const kStageNames[STAGE_COUNT] = {
+    "parse",     "parse.count",   "parse.fill",  "scale",
+    "move",      "rotate",        "weld",        "reorder",
+    "transform", "input.latency", "point_cloud", "half_edge",
+    "bvh"};
+
+/*!
+ * \brief stageTimerNow
+ *
+ * \return Monotonic time in nanoseconds.
+ */
+double stageTimerNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*!
+ * \brief stageTimerRecord
+ *
+ * Adds the time elapsed since start_ns to the given stage.
+ *
+ * \param start_ns Value of stageTimerNow() taken when the stage began.
+ * \param items Number of vertices processed by the stage.
+ */
+void stageTimerRecord(StageId_t stage, double start_ns, long long items) {
+  if ((unsigned)stage >= STAGE_COUNT) return;
+  const double elapsed = stageTimerNow() - start_ns;
+  StageTiming_t* timing = &stage_timings[stage];
+  timing->name = kStageNames[stage];
+  timing->calls++;
+  timing->items += items;
+  timing->last_ns = elapsed;
+  timing->total_ns += elapsed;
+  if (elapsed > timing->max_ns) timing->max_ns = elapsed;
+}
+
+const StageTiming_t* stageTimerGet(StageId_t stage) {
+  if ((unsigned)stage >= STAGE_COUNT) return NULL;
+  stage_timings[stage].name = kStageNames[stage];
+  return &stage_timings[stage];
+}
+
+void stageTimerReset(void) { memset(stage_timings, 0, sizeof(stage_timings)); }
@@ -0,0 +1,56 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief StageId_t
+ *
+ * Timed stages of loading and transforming a model. The parse stages are the
+ * two passes of parseObjFile over the file. The input latency runs from a
+ * mouse event to the swap of the first frame showing it.
+ */
+typedef enum StageId_t {
+  STAGE_PARSE_TOTAL,
+  STAGE_PARSE_COUNT,
+  STAGE_PARSE_FILL,
+  STAGE_SCALE,
+  STAGE_MOVE,
+  STAGE_ROTATE,
+  STAGE_WELD,
+  STAGE_REORDER,
+  STAGE_TRANSFORM,
+  STAGE_INPUT_LATENCY,
+  STAGE_POINT_CLOUD,
+  STAGE_HALF_EDGE,
+  STAGE_BVH,
+  STAGE_COUNT
+} StageId_t;
+
+/*!
+ * \brief StageTiming_t
+ *
+ * Accumulated timings of one stage. items is the number of vertices the
+ * stage processed, so items / total_ns gives the throughput.
+ */
+typedef struct StageTiming_t {
+  const char* name;
+  unsigned long long calls;
+  long long items;
+  double last_ns;
+  double total_ns;
+  double max_ns;
+} StageTiming_t;
+
+double stageTimerNow(void);
+void stageTimerRecord(StageId_t stage, double start_ns, long long items);
+const StageTiming_t* stageTimerGet(StageId_t stage);
+void stageTimerReset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STAGE_TIMER_H
@@ -0,0 +1,171 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../arena.h"
+#include "../backend.h"
+#include "../memory_stats.h"
+#include "../parallel.h"
+#include "../weld.h"
+
+START_TEST(arena_temp_bump_and_reset) {
+  Arena_t *arena = arenaCreate();
+  ck_assert_ptr_nonnull(arena);
+
+  char *first = arenaAllocTemp(arena, 10);
+  char *second = arenaAllocTemp(arena, 100);
+  ck_assert_ptr_nonnull(first);
+  ck_assert_uint_eq((uintptr_t)first % 16, 0);
+  ck_assert_uint_eq((uintptr_t)second % 16, 0);
+  ck_assert(second >= first + 10);
+  ck_assert_ptr_null(arenaAllocTemp(arena, 0));
+  // Larger than the first block, needs a block of its own
+  char *large = arenaAllocTemp(arena, 3u << 20);
+  ck_assert_ptr_nonnull(large);
+  memset(large, 1, 3u << 20);
+
+  ArenaStats_t stats;
+  arenaGetStats(arena, &stats);
+  ck_assert_int_eq(stats.regions, 1);
+  ck_assert_int_eq(stats.temp_used, 16 + 112 + (3 << 20));
+  ck_assert_int_eq(stats.temp_high_water, stats.temp_used);
+  ck_assert(stats.temp_reserved >= stats.temp_used);
+
+  arenaResetTemp(arena);
+  arenaGetStats(arena, &stats);
+  ck_assert_int_eq(stats.temp_used, 0);
+  ck_assert_int_eq(stats.temp_high_water, 16 + 112 + (3 << 20));
+  ck_assert_int_eq(stats.temp_reserved, 1 << 20);
+  // The kept block is reused from its start
+  ck_assert_ptr_eq(arenaAllocTemp(arena, 10), first);
+  arenaDestroy(arena);
+}
+END_TEST
+
+START_TEST(arena_mesh_alloc_and_free) {
+  const long long live_before = memAccountTotalLive();
+  Arena_t *arena = arenaCreate();
+  const size_t big = 5u << 20;
+  float *vertices = arenaAllocMesh(arena, MEM_VERTICES, big);
+  unsigned int *indices = arenaAllocMesh(arena, MEM_INDICES, 64);
+  ck_assert_ptr_nonnull(vertices);
+  ck_assert_ptr_nonnull(indices);
+  memset(vertices, 0, big);
+  ck_assert_int_eq(memAccountTotalLive() - live_before, (long long)big + 64);
+
+  ArenaStats_t stats;
+  arenaGetStats(arena, &stats);
+  ck_assert_int_eq(stats.mesh_live, (long long)big + 64);
+  ck_assert(stats.huge_page_bytes + stats.thp_bytes <= (long long)big);
+
+  arenaFreeMesh(arena, MEM_VERTICES, vertices, big);
+  arenaGetStats(arena, &stats);
+  ck_assert_int_eq(stats.mesh_live, 64);
+  ck_assert_int_eq(stats.mesh_high_water, (long long)big + 64);
+  ck_assert_int_eq(memAccountTotalLive() - live_before, 64);
+
+  arenaDestroy(arena);
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+}
+END_TEST
+
+START_TEST(arena_parse_and_weld) {
+  const long long live_before = memAccountTotalLive();
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  Arena_t *arena = arenaCreate();
+  arenaSetCurrent(arena);
+
+  parseObjFile("tests/test_f.obj", &vertices, &n_vertices, &indices,
+               &n_indices);
+  ck_assert_int_eq(n_vertices, 8);
+  ck_assert_int_eq(n_indices, 72);
+  ck_assert_float_eq_tol(vertices[3], 1.0f, 1e-6);
+  ck_assert_uint_eq(indices[0], 4);
+  ck_assert_int_eq(weldVertices(&vertices, &n_vertices, indices, n_indices,
+                                WELD_DEFAULT_EPSILON, NULL),
+                   0);
+
+  ArenaStats_t stats;
+  arenaGetStats(arena, &stats);
+  ck_assert(stats.temp_high_water > 0);
+  ck_assert_int_eq(stats.mesh_live,
+                   (long long)n_vertices * 3 * (long long)sizeof(float) +
+                       n_indices * (long long)sizeof(unsigned int));
+
+  arenaSetCurrent(NULL);
+  arenaDestroy(arena);
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+}
+END_TEST
+
+typedef struct ArenaThreadContext_t {
+  Arena_t *arena;
+  char **pointers;
+} ArenaThreadContext_t;
+
+static void allocateRange(void *context, long begin, long end) {
+  ArenaThreadContext_t *threads = context;
+  for (long i = begin; i < end; ++i) {
+    threads->pointers[i] = arenaAllocTemp(threads->arena, 64);
+    memset(threads->pointers[i], (int)(i & 0x7f), 64);
+  }
+}
+
+START_TEST(arena_thread_regions) {
+  enum { kCount = 4096 };
+  Arena_t *arena = arenaCreate();
+  char **pointers = calloc(kCount, sizeof(char *));
+  ArenaThreadContext_t context = {arena, pointers};
+  parallelSetThreadCount(4);
+  parallelFor(kCount, 256, allocateRange, &context);
+  parallelSetThreadCount(0);
+
+  ArenaStats_t stats;
+  arenaGetStats(arena, &stats);
+  ck_assert_int_ge(stats.regions, 1);
+  ck_assert_int_le(stats.regions, 4);
+  ck_assert_int_eq(stats.temp_used, kCount * 64);
+  // No allocation overwrote another one
+  for (int i = 0; i < kCount; ++i) {
+    ck_assert_ptr_nonnull(pointers[i]);
+    ck_assert_int_eq(pointers[i][0], i & 0x7f);
+    ck_assert_int_eq(pointers[i][63], i & 0x7f);
+  }
+  free(pointers);
+  arenaDestroy(arena);
+}
+END_TEST
+
+START_TEST(arena_loader_without_arena) {
+  const long long live_before = memAccountTotalLive();
+  ck_assert_ptr_null(arenaCurrent());
+  float *data = loaderAlloc(MEM_VERTICES, 1000 * sizeof(float));
+  ck_assert_ptr_nonnull(data);
+  data[99] = 7.0f;
+  data = loaderShrink(MEM_VERTICES, data, 1000 * sizeof(float),
+                      100 * sizeof(float));
+  ck_assert_float_eq_tol(data[99], 7.0f, 1e-9);
+  ck_assert_int_eq(memAccountTotalLive() - live_before, 100 * sizeof(float));
+  loaderFree(MEM_VERTICES, data, 100 * sizeof(float));
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+}
+END_TEST
+
+Suite *arena_suite(void) {
+  Suite *s = suite_create("ARENA");
+  TCase *tc = tcase_create("arena");
+
+  tcase_add_test(tc, arena_temp_bump_and_reset);
+  tcase_add_test(tc, arena_mesh_alloc_and_free);
+  tcase_add_test(tc, arena_parse_and_weld);
+  tcase_add_test(tc, arena_thread_regions);
+  tcase_add_test(tc, arena_loader_without_arena);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,233 @@
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../bvh.h"
+#include "../parallel.h"
+
+// Identity view: x and y in [-1, 1] fill a 200 x 200 window
+static const float kIdentity[16] = {1, 0, 0, 0, 0, 1, 0, 0,
+                                    0, 0, 1, 0, 0, 0, 0, 1};
+
+static void windowOf(const float *vertices, unsigned int vertex, float *x,
+                     float *y) {
+  *x = (vertices[vertex * 3] + 1.0f) * 100.0f;
+  *y = (1.0f - vertices[vertex * 3 + 1]) * 100.0f;
+}
+
+// Random segments in [-0.9, 0.9]^2 at depths in [-0.5, 0.5]
+static float *makeVertices(long long n_vertices) {
+  float *vertices = malloc((size_t)n_vertices * 3 * sizeof(float));
+  for (long long i = 0; i < n_vertices * 3; ++i) {
+    const float unit = (float)((i * 7919 + 13) % 1009) / 1008.0f;
+    vertices[i] = i % 3 == 2 ? unit - 0.5f : 1.8f * unit - 0.9f;
+  }
+  return vertices;
+}
+
+static unsigned int *makeSegments(long long n_indices, long long n_vertices) {
+  unsigned int *indices = malloc((size_t)n_indices * sizeof(unsigned int));
+  for (long long i = 0; i < n_indices; i += 2) {
+    indices[i] = (unsigned int)((i * 31) % n_vertices);
+    indices[i + 1] = (unsigned int)((indices[i] + 1 + i % 5) % n_vertices);
+  }
+  return indices;
+}
+
+// Every node's box holds what is below it.
+static void checkBoxes(const Bvh_t *bvh, const float *vertices,
+                       const unsigned int *indices) {
+  for (long long n = 0; n < bvh->n_nodes; ++n) {
+    const BvhNode_t *node = &bvh->nodes[n];
+    if (node->count == 0) continue;
+    for (unsigned int i = node->first; i < node->first + node->count; ++i) {
+      const unsigned int primitive = bvh->primitives[i];
+      unsigned int ends[2] = {primitive & ~BVH_VERTEX_FLAG,
+                              primitive & ~BVH_VERTEX_FLAG};
+      if (!(primitive & BVH_VERTEX_FLAG)) {
+        ends[0] = indices[primitive * 2];
+        ends[1] = indices[primitive * 2 + 1];
+      }
+      for (int e = 0; e < 2; ++e) {
+        for (int axis = 0; axis < 3; ++axis) {
+          const float value = vertices[ends[e] * 3 + axis];
+          ck_assert(value >= node->min[axis] && value <= node->max[axis]);
+          ck_assert(value >= bvh->nodes[0].min[axis]);
+          ck_assert(value <= bvh->nodes[0].max[axis]);
+        }
+      }
+    }
+  }
+}
+
+START_TEST(bvh_picks_vertices_and_edges) {
+  // A square of segments and a vertex without edges at the center
+  const float vertices[15] = {-0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f, 0.5f,
+                              0.5f,  0.0f,  -0.5f, 0.5f, 0.0f, 0.0f, 0.0f,
+                              0.0f};
+  const unsigned int indices[8] = {0, 1, 1, 2, 2, 3, 3, 0};
+  Bvh_t bvh;
+  ck_assert_int_eq(bvhBuild(vertices, 5, indices, 8, &bvh), 0);
+  ck_assert_int_eq(bvh.n_primitives, 5);
+  ck_assert_int_ge(bvh.n_nodes, 1);
+  const long long node_bytes = bvh.n_nodes * (long long)sizeof(BvhNode_t);
+  ck_assert_int_eq(bvhBytes(&bvh),
+                   node_bytes + 9 * (long long)sizeof(unsigned int));
+
+  BvhPick_t pick;
+  // Vertex 2 is drawn at (150, 50)
+  bvhPick(&bvh, vertices, indices, kIdentity, NULL, 200, 200, 152.0f,
+          51.0f, BVH_PICK_PIXELS, &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_VERTEX);
+  ck_assert_int_eq(pick.index, 2);
+  ck_assert_float_eq_tol(pick.pixels, sqrtf(5.0f), 1e-4f);
+  ck_assert_int_ge(pick.nodes_visited, 1);
+  // The middle of the bottom edge, segment 0
+  bvhPick(&bvh, vertices, indices, kIdentity, NULL, 200, 200, 100.0f,
+          147.0f, BVH_PICK_PIXELS, &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_EDGE);
+  ck_assert_int_eq(pick.index, 0);
+  ck_assert_float_eq_tol(pick.pixels, 3.0f, 1e-4f);
+  ck_assert_float_eq_tol(pick.depth, 0.5f, 1e-6f);
+  bvhPick(&bvh, vertices, indices, kIdentity, NULL, 200, 200, 99.0f,
+          100.0f, BVH_PICK_PIXELS, &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_VERTEX);
+  ck_assert_int_eq(pick.index, 4);
+  bvhPick(&bvh, vertices, indices, kIdentity, NULL, 200, 200, 125.0f,
+          75.0f, BVH_PICK_PIXELS, &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_NONE);
+  ck_assert_int_eq(pick.index, -1);
+  bvhFree(&bvh);
+  ck_assert_ptr_null(bvh.nodes);
+
+  // Nothing to pick in an empty model
+  ck_assert_int_eq(bvhBuild(NULL, 0, NULL, 0, &bvh), 0);
+  bvhPick(&bvh, NULL, NULL, kIdentity, NULL, 200, 200, 0.0f, 0.0f,
+          BVH_PICK_PIXELS, &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_NONE);
+  bvhFree(&bvh);
+}
+END_TEST
+
+START_TEST(bvh_matches_linear_scan) {
+  const long long n_vertices = 3000;
+  const long long n_indices = 4000;
+  float *vertices = makeVertices(n_vertices);
+  unsigned int *indices = makeSegments(n_indices, n_vertices);
+  Bvh_t bvh;
+  parallelSetThreadCount(3);
+  ck_assert_int_eq(bvhBuild(vertices, n_vertices, indices, n_indices, &bvh),
+                   0);
+  parallelSetThreadCount(1);
+  Bvh_t serial;
+  ck_assert_int_eq(
+      bvhBuild(vertices, n_vertices, indices, n_indices, &serial), 0);
+  parallelSetThreadCount(0);
+  ck_assert_int_eq(serial.n_nodes, bvh.n_nodes);
+  ck_assert_int_eq(memcmp(serial.nodes, bvh.nodes,
+                          (size_t)bvh.n_nodes * sizeof(BvhNode_t)),
+                   0);
+  bvhFree(&serial);
+  checkBoxes(&bvh, vertices, indices);
+  ck_assert_int_le(bvh.depth, 64);
+
+  for (int query = 0; query < 300; ++query) {
+    const float x = (float)((query * 37) % 200) + 0.25f;
+    const float y = (float)((query * 53) % 200) + 0.5f;
+    // Closest vertex by a scan over all of them
+    float closest = BVH_PICK_PIXELS;
+    long long expected = -1;
+    for (unsigned int v = 0; v < n_vertices; ++v) {
+      float vx, vy;
+      windowOf(vertices, v, &vx, &vy);
+      const float pixels = hypotf(vx - x, vy - y);
+      if (pixels < closest) {
+        closest = pixels;
+        expected = v;
+      }
+    }
+    BvhPick_t pick;
+    bvhPick(&bvh, vertices, indices, kIdentity, NULL, 200, 200, x, y,
+            BVH_PICK_PIXELS, &pick);
+    if (expected >= 0) {
+      ck_assert_int_eq(pick.kind, BVH_PICK_VERTEX);
+      ck_assert_float_eq_tol(pick.pixels, closest, 1e-3f);
+    } else {
+      ck_assert_int_ne(pick.kind, BVH_PICK_VERTEX);
+      ck_assert_int_lt(pick.nodes_visited, bvh.n_nodes);
+    }
+  }
+  bvhFree(&bvh);
+  free(vertices);
+  free(indices);
+}
+END_TEST
+
+START_TEST(bvh_refits_and_builds_in_background) {
+  const long long n_vertices = 2000;
+  const long long n_indices = 3000;
+  float *vertices = makeVertices(n_vertices);
+  unsigned int *indices = makeSegments(n_indices, n_vertices);
+  BvhBuilder_t *builder =
+      bvhBuildStart(vertices, n_vertices, indices, n_indices);
+  ck_assert_ptr_nonnull(builder);
+  Bvh_t bvh;
+  ck_assert_int_eq(bvhBuildFinish(builder, &bvh), 0);
+  // Vertices without segments are primitives of their own
+  long long unused = n_vertices;
+  char *used = calloc((size_t)n_vertices, 1);
+  for (long long i = 0; i < n_indices; ++i) {
+    unused -= !used[indices[i]];
+    used[indices[i]] = 1;
+  }
+  free(used);
+  ck_assert_int_gt(unused, 0);
+  ck_assert_int_eq(bvh.n_primitives, n_indices / 2 + unused);
+  checkBoxes(&bvh, vertices, indices);
+
+  // Move a range of vertices, then all of them
+  for (long long v = 100; v < 200; ++v) vertices[v * 3] += 0.05f;
+  bvhRefit(&bvh, vertices, indices, 100, 100);
+  checkBoxes(&bvh, vertices, indices);
+  // A transform is picked through without a refit
+  const float half[16] = {0.5f, 0, 0, 0, 0, 0.5f, 0, 0,
+                          0, 0, 0.5f, 0, 0, 0, 0, 1};
+  for (long long i = 0; i < n_vertices * 3; ++i) vertices[i] *= 0.5f;
+  float x, y;
+  windowOf(vertices, 150, &x, &y);
+  BvhPick_t pick;
+  bvhPick(&bvh, vertices, indices, kIdentity, half, 200, 200, x, y, 0.5f,
+          &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_VERTEX);
+  ck_assert_float_eq_tol(pick.pixels, 0.0f, 1e-4f);
+  bvhRefit(&bvh, vertices, indices, 0, n_vertices);
+  checkBoxes(&bvh, vertices, indices);
+  bvhPick(&bvh, vertices, indices, kIdentity, NULL, 200, 200, x, y, 0.5f,
+          &pick);
+  ck_assert_int_eq(pick.kind, BVH_PICK_VERTEX);
+  ck_assert_float_eq_tol(pick.pixels, 0.0f, 1e-4f);
+  bvhFree(&bvh);
+
+  // A cancelled build frees what it made
+  bvhBuildCancel(bvhBuildStart(vertices, n_vertices, indices, n_indices));
+  bvhBuildCancel(NULL);
+  ck_assert_int_eq(bvhBuildDone(NULL), 1);
+  ck_assert_int_eq(bvhBuildFinish(NULL, &bvh), -1);
+  free(vertices);
+  free(indices);
+}
+END_TEST
+
+Suite *bvh_suite(void) {
+  Suite *s = suite_create("BVH");
+  TCase *tc = tcase_create("bvh");
+
+  tcase_add_test(tc, bvh_picks_vertices_and_edges);
+  tcase_add_test(tc, bvh_matches_linear_scan);
+  tcase_add_test(tc, bvh_refits_and_builds_in_background);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
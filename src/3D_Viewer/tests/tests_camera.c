@@ -0,0 +1,128 @@
+#include <check.h>
+#include <math.h>
+
+#include "../camera.h"
+
+static void transformPoint(const float view[16], const float point[3],
+                           float out[3]) {
+  for (int row = 0; row < 3; ++row) {
+    out[row] = view[row] * point[0] + view[4 + row] * point[1] +
+               view[8 + row] * point[2] + view[12 + row];
+  }
+}
+
+START_TEST(camera_reset_matches_look_at) {
+  Camera_t camera;
+  cameraReset(&camera);
+  float view[16];
+  cameraViewMatrix(&camera, 0, view);
+
+  // The eye at (2, 2, 4) looks down -z at the origin, +y stays up
+  const float eye[3] = {2.0f, 2.0f, 4.0f};
+  const float origin[3] = {0.0f, 0.0f, 0.0f};
+  const float above[3] = {0.0f, 1.0f, 0.0f};
+  float out[3];
+  transformPoint(view, eye, out);
+  for (int axis = 0; axis < 3; ++axis) {
+    ck_assert_float_eq_tol(out[axis], 0.0f, 1e-5);
+  }
+  transformPoint(view, origin, out);
+  ck_assert_float_eq_tol(out[0], 0.0f, 1e-5);
+  ck_assert_float_eq_tol(out[1], 0.0f, 1e-5);
+  ck_assert_float_eq_tol(out[2], -sqrtf(24.0f), 1e-5);
+  transformPoint(view, above, out);
+  ck_assert_float_eq_tol(out[0], 0.0f, 1e-5);
+  ck_assert_float_gt(out[1], 0.0f);
+  ck_assert_float_eq(view[15], 1.0f);
+}
+END_TEST
+
+START_TEST(camera_orbit_follows_cursor) {
+  Camera_t camera;
+  cameraReset(&camera);
+  float before[16];
+  cameraViewMatrix(&camera, 0, before);
+
+  // The front of the arcball, one unit before the target, goes half way to
+  // the right edge of an 800x600 widget: 30 degrees about the view's y axis
+  float front[3];
+  for (int axis = 0; axis < 3; ++axis) front[axis] = before[axis * 4 + 2];
+  cameraOrbit(&camera, 400.0f, 300.0f, 550.0f, 300.0f, 800, 600);
+  float view[16];
+  cameraViewMatrix(&camera, 0, view);
+  float out[3];
+  transformPoint(view, front, out);
+  ck_assert_float_eq_tol(out[0], 0.5f, 1e-5);
+  ck_assert_float_eq_tol(out[1], 0.0f, 1e-5);
+  ck_assert_float_eq_tol(out[2], -sqrtf(24.0f) + sqrtf(0.75f), 1e-5);
+
+  // Dragging back and forth many times neither drifts nor skews the view
+  for (int i = 0; i < 1000; ++i) {
+    cameraOrbit(&camera, 410.0f, 290.0f, 430.0f, 320.0f, 800, 600);
+    cameraOrbit(&camera, 430.0f, 320.0f, 410.0f, 290.0f, 800, 600);
+  }
+  cameraOrbit(&camera, 550.0f, 300.0f, 400.0f, 300.0f, 800, 600);
+  cameraViewMatrix(&camera, 0, view);
+  for (int i = 0; i < 16; ++i) {
+    ck_assert_float_eq_tol(view[i], before[i], 1e-4);
+  }
+  const float *q = camera.orientation;
+  ck_assert_float_eq_tol(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3],
+                         1.0f, 1e-6);
+}
+END_TEST
+
+START_TEST(camera_pan_and_zoom) {
+  Camera_t camera;
+  cameraReset(&camera);
+  const float origin[3] = {0.0f, 0.0f, 0.0f};
+  float view[16];
+  float out[3];
+
+  // The target stays under the cursor: 100 of 600 pixels at the distance of
+  // the target span 2 * distance * tan(25 degrees) / 6
+  cameraPan(&camera, 100.0f, -50.0f, 800, 600, 0);
+  cameraViewMatrix(&camera, 0, view);
+  transformPoint(view, origin, out);
+  const float per_pixel =
+      2.0f * sqrtf(24.0f) * tanf(25.0f * M_PI / 180.0f) / 600.0f;
+  ck_assert_float_eq_tol(out[0], 100.0f * per_pixel, 1e-5);
+  ck_assert_float_eq_tol(out[1], 50.0f * per_pixel, 1e-5);
+
+  cameraZoom(&camera, 2.0f);
+  ck_assert_float_eq_tol(camera.distance, sqrtf(24.0f) / 1.21f, 1e-5);
+  cameraZoom(&camera, 100.0f);
+  ck_assert_float_eq(camera.distance, CAMERA_MIN_DISTANCE);
+  cameraZoom(&camera, -100.0f);
+  ck_assert_float_eq(camera.distance, CAMERA_MAX_DISTANCE);
+
+  // Parallel projection keeps the camera where it is and scales the view
+  cameraReset(&camera);
+  cameraZoom(&camera, 1.0f);
+  cameraViewMatrix(&camera, 1, view);
+  ck_assert_float_eq_tol(view[14], -sqrtf(24.0f), 1e-5);
+  float home[16];
+  Camera_t reset;
+  cameraReset(&reset);
+  cameraViewMatrix(&reset, 1, home);
+  ck_assert_float_eq_tol(view[0], home[0] * CAMERA_ZOOM_STEP, 1e-5);
+  ck_assert_float_eq_tol(view[2], home[2], 1e-5);
+  cameraPan(&camera, 400.0f, 0.0f, 800, 600, 1);
+  cameraViewMatrix(&camera, 1, view);
+  transformPoint(view, origin, out);
+  ck_assert_float_eq_tol(out[0], 1.0f, 1e-5);
+}
+END_TEST
+
+Suite *camera_suite(void) {
+  Suite *s = suite_create("CAMERA");
+  TCase *tc = tcase_create("camera");
+
+  tcase_add_test(tc, camera_reset_matches_look_at);
+  tcase_add_test(tc, camera_orbit_follows_cursor);
+  tcase_add_test(tc, camera_pan_and_zoom);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,112 @@
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "../compact.h"
+
+START_TEST(compact_small_mesh) {
+  const float vertices[] = {0.0f, 0.0f, 0.0f, 1.0f,  0.5f, 0.25f,
+                            0.3f, 0.7f, 1.0f, 0.01f, 1.0f, 0.0f};
+  const unsigned int indices[] = {0, 1, 1, 2, 2, 3, 3, 0};
+  CompactMesh_t mesh;
+
+  ck_assert_int_eq(compactMeshBuild(vertices, 4, indices, 8, &mesh), 0);
+
+  ck_assert_int_eq(mesh.n_chunks, 1);
+  ck_assert_int_eq(mesh.n_indices16, 8);
+  ck_assert_int_eq(mesh.n_indices32, 0);
+  for (int k = 0; k < 8; ++k) {
+    ck_assert_uint_eq(mesh.chunks[0].base + mesh.indices16[k], indices[k]);
+  }
+  // Half a quantization step per axis at most
+  ck_assert(mesh.max_error <= sqrt(3.0) * 0.5 / 65535.0 + 1e-7);
+  ck_assert(mesh.rms_error <= mesh.max_error);
+  for (int i = 0; i < 4; ++i) {
+    float decoded[3];
+    compactMeshDecode(&mesh, i, decoded);
+    for (int axis = 0; axis < 3; ++axis) {
+      ck_assert_float_eq_tol(decoded[axis], vertices[i * 3 + axis], 1e-4);
+    }
+  }
+  // Half of the 4 * 12 + 8 * 4 bytes of float geometry
+  ck_assert_int_eq(compactMeshBytes(&mesh), 4 * 6 + 8 * 2);
+  compactMeshFree(&mesh);
+  ck_assert(mesh.positions == NULL);
+}
+END_TEST
+
+START_TEST(compact_chunks_large_mesh) {
+  // A polyline through 200000 vertices plus one segment across all of them
+  const int n_vertices = 200000;
+  const int n_indices = (n_vertices - 1) * 2 + 2;
+  float *vertices = malloc(n_vertices * 3 * sizeof(float));
+  unsigned int *indices = malloc(n_indices * sizeof(unsigned int));
+  for (int i = 0; i < n_vertices; ++i) {
+    vertices[i * 3] = (float)i / n_vertices;
+    vertices[i * 3 + 1] = 0.5f;
+    vertices[i * 3 + 2] = 0.0f;
+  }
+  for (int i = 0; i + 1 < n_vertices; ++i) {
+    indices[i * 2] = i;
+    indices[i * 2 + 1] = i + 1;
+  }
+  indices[n_indices - 2] = 0;
+  indices[n_indices - 1] = n_vertices - 1;
+  CompactMesh_t mesh;
+
+  compactMeshBuild(vertices, n_vertices, indices, n_indices, &mesh);
+
+  ck_assert_int_eq(mesh.n_chunks, 4);
+  ck_assert_int_eq(mesh.n_indices16, n_indices - 2);
+  ck_assert_int_eq(mesh.n_indices32, 2);
+  ck_assert_uint_eq(mesh.indices32[1], n_vertices - 1);
+  int k = 0;
+  for (int c = 0; c < mesh.n_chunks; ++c) {
+    const CompactChunk_t *chunk = &mesh.chunks[c];
+    ck_assert_int_eq(chunk->first, k);
+    for (uint32_t i = 0; i < chunk->count; ++i, ++k) {
+      ck_assert_uint_eq(chunk->base + mesh.indices16[chunk->first + i],
+                        indices[k]);
+    }
+  }
+  compactMeshFree(&mesh);
+  free(vertices);
+  free(indices);
+}
+END_TEST
+
+START_TEST(compact_scattered_indices) {
+  // Segments jumping back and forth cannot be grouped into chunks
+  const int n_vertices = 300000;
+  const int n_indices = 20000;
+  float *vertices = calloc(n_vertices * 3, sizeof(float));
+  unsigned int *indices = malloc(n_indices * sizeof(unsigned int));
+  for (int k = 0; k < n_indices; k += 2) {
+    indices[k] = (k / 2 % 2) * 200000 + k;
+    indices[k + 1] = indices[k] + 1;
+  }
+  CompactMesh_t mesh;
+
+  compactMeshBuild(vertices, n_vertices, indices, n_indices, &mesh);
+
+  ck_assert_int_eq(mesh.n_chunks, 0);
+  ck_assert_int_eq(mesh.n_indices32, n_indices);
+  ck_assert_uint_eq(mesh.indices32[2], indices[2]);
+  compactMeshFree(&mesh);
+  free(vertices);
+  free(indices);
+}
+END_TEST
+
+Suite *compact_suite(void) {
+  Suite *s = suite_create("COMPACT");
+  TCase *tc = tcase_create("compact");
+
+  tcase_add_test(tc, compact_small_mesh);
+  tcase_add_test(tc, compact_chunks_large_mesh);
+  tcase_add_test(tc, compact_scattered_indices);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
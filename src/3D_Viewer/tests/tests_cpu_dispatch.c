@@ -0,0 +1,145 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cpu_dispatch.h"
+
+static const long long kCounts[] = {0, 1, 17, 1001};
+
+static float *makeVertices(long long count) {
+  float *vertices = malloc((size_t)(count * 3 + 1) * sizeof(float));
+  for (long long i = 0; i < count * 3; ++i) {
+    vertices[i] = (float)((i * 7919) % 2003) / 97.0f - 10.0f;
+  }
+  return vertices;
+}
+
+static void copyVertices(float *to, const float *from, long long count) {
+  memcpy(to, from, (size_t)(count * 3) * sizeof(float));
+}
+
+START_TEST(cpu_dispatch_levels_match_scalar) {
+  const float matrix[16] = {0.8f, 0.3f,  -0.5f, 0.0f,  -0.2f, 1.1f,
+                            0.4f, 0.0f,  0.6f,  -0.7f, 0.9f,  0.0f,
+                            1.5f, -2.0f, 0.25f, 1.0f};
+  const float offset[3] = {0.5f, -1.25f, 3.0f};
+  const CpuLevel_t detected = cpuDetectLevel();
+  for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); ++c) {
+    const long long count = kCounts[c];
+    float *source = makeVertices(count);
+    float *expected = makeVertices(count);
+    float *actual = makeVertices(count);
+    float expected_min[3], expected_max[3];
+    cpuSetLevel(CPU_LEVEL_SCALAR);
+    const CpuKernels_t *scalar = cpuKernels();
+    scalar->bounds(source, count, expected_min, expected_max);
+    scalar->scale(expected, count, 1.75f);
+    scalar->move(expected, count, offset);
+    scalar->transform(expected, count, matrix);
+
+    for (int level = CPU_LEVEL_SCALAR; level <= (int)detected; ++level) {
+      cpuSetLevel(level);
+      const CpuKernels_t *kernels = cpuKernels();
+      ck_assert_int_eq(kernels->level, level);
+      float min[3], max[3];
+      kernels->bounds(source, count, min, max);
+      ck_assert_int_eq(memcmp(min, expected_min, sizeof(min)), 0);
+      ck_assert_int_eq(memcmp(max, expected_max, sizeof(max)), 0);
+      copyVertices(actual, source, count);
+      kernels->scale(actual, count, 1.75f);
+      kernels->move(actual, count, offset);
+      kernels->transform(actual, count, matrix);
+      ck_assert_int_eq(
+          memcmp(actual, expected, (size_t)(count * 3) * sizeof(float)), 0);
+    }
+    free(source);
+    free(expected);
+    free(actual);
+  }
+  cpuSetLevel(-1);
+}
+END_TEST
+
+START_TEST(cpu_dispatch_index_max_levels) {
+  enum { kIndices = 1003 };
+  unsigned int *indices = malloc(kIndices * sizeof(unsigned int));
+  for (int i = 0; i < kIndices; ++i) indices[i] = (unsigned int)(i * 31 % 577);
+  // Above INT_MAX, so a signed compare would lose it
+  indices[700] = 0xfffffff0u;
+  const CpuLevel_t detected = cpuDetectLevel();
+  for (int level = CPU_LEVEL_SCALAR; level <= (int)detected; ++level) {
+    cpuSetLevel(level);
+    const CpuKernels_t *kernels = cpuKernels();
+    ck_assert_uint_eq(kernels->index_max(indices, 0), 0);
+    ck_assert_uint_eq(kernels->index_max(indices, 17), 496);
+    ck_assert_uint_eq(kernels->index_max(indices, 700), 576);
+    ck_assert_uint_eq(kernels->index_max(indices, kIndices), 0xfffffff0u);
+    // In the tail past the last full vector
+    ck_assert_uint_eq(kernels->index_max(indices + 701, 302), 576);
+  }
+  cpuSetLevel(-1);
+  free(indices);
+}
+END_TEST
+
+START_TEST(cpu_dispatch_bounds_skip_nan) {
+  float *vertices = makeVertices(40);
+  vertices[0] = NAN;
+  vertices[61] = NAN;
+  float expected_min[3], expected_max[3];
+  cpuSetLevel(CPU_LEVEL_SCALAR);
+  cpuKernels()->bounds(vertices, 40, expected_min, expected_max);
+  ck_assert(!isnan(expected_min[0]) && !isnan(expected_max[1]));
+  for (int level = CPU_LEVEL_SCALAR; level <= (int)cpuDetectLevel(); ++level) {
+    float min[3], max[3];
+    cpuSetLevel(level);
+    cpuKernels()->bounds(vertices, 40, min, max);
+    ck_assert_int_eq(memcmp(min, expected_min, sizeof(min)), 0);
+    ck_assert_int_eq(memcmp(max, expected_max, sizeof(max)), 0);
+  }
+  cpuKernels()->bounds(vertices, 0, expected_min, expected_max);
+  ck_assert(expected_min[2] == FLT_MAX && expected_max[2] == -FLT_MAX);
+  free(vertices);
+  cpuSetLevel(-1);
+}
+END_TEST
+
+START_TEST(cpu_dispatch_environment_override) {
+  setenv("S21_VIEWER_CPU", "scalar", 1);
+  cpuSetLevel(-1);
+  ck_assert_int_eq(cpuLevel(), CPU_LEVEL_SCALAR);
+  ck_assert_str_eq(cpuLevelName(cpuLevel()), "scalar");
+
+  // Levels the processor lacks and unknown names fall back to detection
+  setenv("S21_VIEWER_CPU", "avx512", 1);
+  cpuSetLevel(-1);
+  ck_assert_int_eq(cpuLevel(), cpuDetectLevel());
+  setenv("S21_VIEWER_CPU", "neon", 1);
+  cpuSetLevel(-1);
+  ck_assert_int_eq(cpuLevel(), cpuDetectLevel());
+  cpuSetLevel(CPU_LEVEL_COUNT);
+  ck_assert_int_eq(cpuLevel(), cpuDetectLevel());
+
+  unsetenv("S21_VIEWER_CPU");
+  cpuSetLevel(-1);
+  ck_assert_int_eq(cpuLevel(), cpuDetectLevel());
+}
+END_TEST
+
+Suite *cpu_dispatch_suite(void) {
+  Suite *s = suite_create("CPU_DISPATCH");
+  TCase *tc = tcase_create("cpu_dispatch");
+
+  tcase_add_test(tc, cpu_dispatch_levels_match_scalar);
+  tcase_add_test(tc, cpu_dispatch_index_max_levels);
+  tcase_add_test(tc, cpu_dispatch_bounds_skip_nan);
+  tcase_add_test(tc, cpu_dispatch_environment_override);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
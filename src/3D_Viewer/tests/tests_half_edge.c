@@ -0,0 +1,153 @@
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../half_edge.h"
+#include "../parallel.h"
+
+// Writes a face the way the loaders do, as three segments.
+static void addFace(unsigned int *indices, long long *n, unsigned int a,
+                    unsigned int b, unsigned int c) {
+  const unsigned int segments[6] = {a, b, b, c, c, a};
+  memcpy(&indices[*n], segments, sizeof(segments));
+  *n += 6;
+}
+
+// A side x side grid of vertices, two triangles per cell, all facing up.
+static unsigned int *makeGrid(unsigned int side, long long *n_indices) {
+  const long long cells = (long long)(side - 1) * (side - 1);
+  unsigned int *indices = malloc((size_t)cells * 12 * sizeof(unsigned int));
+  *n_indices = 0;
+  for (unsigned int row = 0; row + 1 < side; ++row) {
+    for (unsigned int column = 0; column + 1 < side; ++column) {
+      const unsigned int corner = row * side + column;
+      addFace(indices, n_indices, corner, corner + 1, corner + side + 1);
+      addFace(indices, n_indices, corner, corner + side + 1, corner + side);
+    }
+  }
+  return indices;
+}
+
+START_TEST(half_edge_pairs_closed_mesh) {
+  unsigned int indices[24];
+  long long n_indices = 0;
+  addFace(indices, &n_indices, 0, 2, 1);
+  addFace(indices, &n_indices, 0, 1, 3);
+  addFace(indices, &n_indices, 1, 2, 3);
+  addFace(indices, &n_indices, 2, 0, 3);
+  HalfEdgeMesh_t mesh;
+  HalfEdgeStats_t stats;
+  ck_assert_int_eq(halfEdgeBuild(indices, n_indices, 4, &mesh, &stats), 0);
+  ck_assert_int_eq(mesh.n_faces, 4);
+  ck_assert_int_eq(mesh.n_edges, 6);
+  ck_assert_int_eq(mesh.n_boundary, 0);
+  ck_assert_int_eq(mesh.n_non_manifold, 0);
+  ck_assert_int_eq(stats.lines, 0);
+  ck_assert_int_eq(stats.bytes, halfEdgeBytes(&mesh));
+  ck_assert_int_ge(stats.peak_bytes, stats.bytes);
+  for (long long h = 0; h < 12; ++h) {
+    const unsigned int twin = mesh.twin[h];
+    ck_assert_uint_lt(twin, 12);
+    ck_assert_uint_eq(mesh.twin[twin], h);
+    // The twin runs the same edge the other way
+    ck_assert_uint_eq(mesh.origin[twin], mesh.origin[halfEdgeNext(h)]);
+    ck_assert_uint_eq(mesh.origin[halfEdgeNext(twin)], mesh.origin[h]);
+  }
+  for (int v = 0; v < 4; ++v) ck_assert_uint_eq(mesh.valence[v], 3);
+  ck_assert_int_eq(halfEdgeBoundaryEdges(&mesh, NULL, 0), 0);
+  halfEdgeFree(&mesh);
+  ck_assert_ptr_null(mesh.origin);
+}
+END_TEST
+
+START_TEST(half_edge_reports_open_edges) {
+  unsigned int indices[32];
+  long long n_indices = 0;
+  // A quad split along 0-2, a third face on that diagonal, a line and a
+  // collapsed face
+  addFace(indices, &n_indices, 0, 1, 2);
+  addFace(indices, &n_indices, 0, 2, 3);
+  indices[n_indices++] = 3;
+  indices[n_indices++] = 4;
+  addFace(indices, &n_indices, 2, 0, 4);
+  addFace(indices, &n_indices, 4, 4, 1);
+  HalfEdgeMesh_t mesh;
+  HalfEdgeStats_t stats;
+  ck_assert_int_eq(halfEdgeBuild(indices, n_indices, 5, &mesh, &stats), 0);
+  ck_assert_int_eq(mesh.n_faces, 3);
+  ck_assert_int_eq(stats.lines, 1);
+  ck_assert_int_eq(stats.skipped, 1);
+  ck_assert_int_eq(mesh.n_edges, 7);
+  ck_assert_int_eq(mesh.n_boundary, 6);
+  ck_assert_int_eq(mesh.n_non_manifold, 1);
+  ck_assert_uint_eq(mesh.non_manifold[0], 0);
+  ck_assert_uint_eq(mesh.non_manifold[1], 2);
+  ck_assert_uint_eq(mesh.twin[2], HALF_EDGE_NON_MANIFOLD);
+  ck_assert_uint_eq(mesh.valence[0], 4);
+  ck_assert_uint_eq(mesh.valence[1], 2);
+  ck_assert_uint_eq(mesh.valence[4], 2);
+
+  unsigned int pairs[4];
+  ck_assert_int_eq(halfEdgeBoundaryEdges(&mesh, pairs, 2), 6);
+  ck_assert_uint_eq(pairs[0], 0);
+  ck_assert_uint_eq(pairs[1], 1);
+  ck_assert_uint_eq(pairs[2], 1);
+  ck_assert_uint_eq(pairs[3], 2);
+  halfEdgeFree(&mesh);
+
+  ck_assert_int_eq(halfEdgeBuild(indices, n_indices, 1LL << 33, &mesh, NULL),
+                   -1);
+  ck_assert_int_eq(halfEdgeBuild(NULL, 0, 0, &mesh, NULL), 0);
+  ck_assert_int_eq(mesh.n_faces, 0);
+  halfEdgeFree(&mesh);
+}
+END_TEST
+
+START_TEST(half_edge_grid_independent_of_threads) {
+  const unsigned int side = 300;
+  long long n_indices = 0;
+  unsigned int *indices = makeGrid(side, &n_indices);
+  const long long n_vertices = (long long)side * side;
+  HalfEdgeMesh_t serial;
+  HalfEdgeMesh_t threaded;
+  parallelSetThreadCount(1);
+  ck_assert_int_eq(
+      halfEdgeBuild(indices, n_indices, n_vertices, &serial, NULL), 0);
+  parallelSetThreadCount(3);
+  ck_assert_int_eq(
+      halfEdgeBuild(indices, n_indices, n_vertices, &threaded, NULL), 0);
+  parallelSetThreadCount(0);
+
+  const long long cells = (long long)(side - 1) * (side - 1);
+  ck_assert_int_eq(serial.n_faces, 2 * cells);
+  ck_assert_int_eq(serial.n_edges, 2LL * side * (side - 1) + cells);
+  ck_assert_int_eq(serial.n_boundary, 4 * (side - 1));
+  ck_assert_int_eq(threaded.n_edges, serial.n_edges);
+  ck_assert_int_eq(threaded.n_boundary, serial.n_boundary);
+  ck_assert_int_eq(memcmp(serial.twin, threaded.twin,
+                          (size_t)serial.n_faces * 3 * sizeof(unsigned int)),
+                   0);
+  ck_assert_int_eq(memcmp(serial.valence, threaded.valence,
+                          (size_t)n_vertices * sizeof(unsigned int)),
+                   0);
+  // Inner vertices of this triangulation have six neighbours
+  ck_assert_uint_eq(serial.valence[side + 1], 6);
+  ck_assert_uint_eq(serial.valence[0], 3);
+  halfEdgeFree(&serial);
+  halfEdgeFree(&threaded);
+  free(indices);
+}
+END_TEST
+
+Suite *half_edge_suite(void) {
+  Suite *s = suite_create("HALF_EDGE");
+  TCase *tc = tcase_create("half_edge");
+
+  tcase_add_test(tc, half_edge_pairs_closed_mesh);
+  tcase_add_test(tc, half_edge_reports_open_edges);
+  tcase_add_test(tc, half_edge_grid_independent_of_threads);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -2,11 +2,36 @@
 
 #include <check.h>
 
+#include "../cpu_dispatch.h"
+
 int main() {
+  cpuSetLevel(-1);
   Suite *s1 = move_suite();
   Suite *s2 = scale_suite();
   Suite *s3 = rotation_suite();
   Suite *s4 = parse_suite();
+  Suite *s5 = stage_timer_suite();
+  Suite *s6 = trace_suite();
+  Suite *s7 = memory_stats_suite();
+  Suite *s8 = weld_suite();
+  Suite *s9 = reorder_suite();
+  Suite *s10 = compact_suite();
+  Suite *s11 = arena_suite();
+  Suite *s12 = out_of_core_suite();
+  Suite *s13 = model_cache_suite();
+  Suite *s14 = obj_reload_suite();
+  Suite *s15 = mesh_loader_suite();
+  Suite *s16 = obj_export_suite();
+  Suite *s17 = camera_suite();
+  Suite *s18 = quality_suite();
+  Suite *s19 = point_cloud_suite();
+  Suite *s20 = obj_stream_suite();
+  Suite *s21 = obj_index_suite();
+  Suite *s22 = cpu_dispatch_suite();
+  Suite *s23 = half_edge_suite();
+  Suite *s24 = bvh_suite();
+  Suite *s25 = parallel_suite();
+  Suite *s26 = obj_generator_suite();
 
   SRunner *runner1 = srunner_create(s1);
   srunner_run_all(runner1, CK_ENV);
@@ -28,5 +53,115 @@ int main() {
   srunner_ntests_failed(runner4);
   srunner_free(runner4);
 
+  SRunner *runner5 = srunner_create(s5);
+  srunner_run_all(runner5, CK_ENV);
+  srunner_ntests_failed(runner5);
+  srunner_free(runner5);
+
+  SRunner *runner6 = srunner_create(s6);
+  srunner_run_all(runner6, CK_ENV);
+  srunner_ntests_failed(runner6);
+  srunner_free(runner6);
+
+  SRunner *runner7 = srunner_create(s7);
+  srunner_run_all(runner7, CK_ENV);
+  srunner_ntests_failed(runner7);
+  srunner_free(runner7);
+
+  SRunner *runner8 = srunner_create(s8);
+  srunner_run_all(runner8, CK_ENV);
+  srunner_ntests_failed(runner8);
+  srunner_free(runner8);
+
+  SRunner *runner9 = srunner_create(s9);
+  srunner_run_all(runner9, CK_ENV);
+  srunner_ntests_failed(runner9);
+  srunner_free(runner9);
+
+  SRunner *runner10 = srunner_create(s10);
+  srunner_run_all(runner10, CK_ENV);
+  srunner_ntests_failed(runner10);
+  srunner_free(runner10);
+
+  SRunner *runner11 = srunner_create(s11);
+  srunner_run_all(runner11, CK_ENV);
+  srunner_ntests_failed(runner11);
+  srunner_free(runner11);
+
+  SRunner *runner12 = srunner_create(s12);
+  srunner_run_all(runner12, CK_ENV);
+  srunner_ntests_failed(runner12);
+  srunner_free(runner12);
+
+  SRunner *runner13 = srunner_create(s13);
+  srunner_run_all(runner13, CK_ENV);
+  srunner_ntests_failed(runner13);
+  srunner_free(runner13);
+
+  SRunner *runner14 = srunner_create(s14);
+  srunner_run_all(runner14, CK_ENV);
+  srunner_ntests_failed(runner14);
+  srunner_free(runner14);
+
+  SRunner *runner15 = srunner_create(s15);
+  srunner_run_all(runner15, CK_ENV);
+  srunner_ntests_failed(runner15);
+  srunner_free(runner15);
+
+  SRunner *runner16 = srunner_create(s16);
+  srunner_run_all(runner16, CK_ENV);
+  srunner_ntests_failed(runner16);
+  srunner_free(runner16);
+
+  SRunner *runner17 = srunner_create(s17);
+  srunner_run_all(runner17, CK_ENV);
+  srunner_ntests_failed(runner17);
+  srunner_free(runner17);
+
+  SRunner *runner18 = srunner_create(s18);
+  srunner_run_all(runner18, CK_ENV);
+  srunner_ntests_failed(runner18);
+  srunner_free(runner18);
+
+  SRunner *runner19 = srunner_create(s19);
+  srunner_run_all(runner19, CK_ENV);
+  srunner_ntests_failed(runner19);
+  srunner_free(runner19);
+
+  SRunner *runner20 = srunner_create(s20);
+  srunner_run_all(runner20, CK_ENV);
+  srunner_ntests_failed(runner20);
+  srunner_free(runner20);
+
+  SRunner *runner21 = srunner_create(s21);
+  srunner_run_all(runner21, CK_ENV);
+  srunner_ntests_failed(runner21);
+  srunner_free(runner21);
+
+  SRunner *runner22 = srunner_create(s22);
+  srunner_run_all(runner22, CK_ENV);
+  srunner_ntests_failed(runner22);
+  srunner_free(runner22);
+
+  SRunner *runner23 = srunner_create(s23);
+  srunner_run_all(runner23, CK_ENV);
+  srunner_ntests_failed(runner23);
+  srunner_free(runner23);
+
+  SRunner *runner24 = srunner_create(s24);
+  srunner_run_all(runner24, CK_ENV);
+  srunner_ntests_failed(runner24);
+  srunner_free(runner24);
+
+  SRunner *runner25 = srunner_create(s25);
+  srunner_run_all(runner25, CK_ENV);
+  srunner_ntests_failed(runner25);
+  srunner_free(runner25);
+
+  SRunner *runner26 = srunner_create(s26);
+  srunner_run_all(runner26, CK_ENV);
+  srunner_ntests_failed(runner26);
+  srunner_free(runner26);
+
   return 0;
 }
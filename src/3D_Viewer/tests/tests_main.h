@@ -12,5 +12,27 @@ Suite *scale_suite(void);
 Suite *rotation_suite(void);
 
 Suite *parse_suite(void);
+Suite *stage_timer_suite(void);
+Suite *trace_suite(void);
+Suite *memory_stats_suite(void);
+Suite *weld_suite(void);
+Suite *reorder_suite(void);
+Suite *compact_suite(void);
+Suite *arena_suite(void);
+Suite *out_of_core_suite(void);
+Suite *model_cache_suite(void);
+Suite *obj_reload_suite(void);
+Suite *mesh_loader_suite(void);
+Suite *obj_export_suite(void);
+Suite *camera_suite(void);
+Suite *quality_suite(void);
+Suite *point_cloud_suite(void);
+Suite *obj_stream_suite(void);
+Suite *obj_index_suite(void);
+Suite *cpu_dispatch_suite(void);
+Suite *half_edge_suite(void);
+Suite *bvh_suite(void);
+Suite *parallel_suite(void);
+Suite *obj_generator_suite(void);
 
 #endif  // SRC_TESTS_CHECK_MATRIX_H_
@@ -0,0 +1,83 @@
+#include <check.h>
+#include <stdlib.h>
+
+#include "../backend.h"
+#include "../memory_stats.h"
+
+START_TEST(memory_stats_add_release) {
+  MemCategoryStats_t before;
+  MemCategoryStats_t after;
+  memAccountGet(MEM_CACHES, &before);
+
+  memAccountAdd(MEM_CACHES, 1000);
+  memAccountAdd(MEM_CACHES, 500);
+  memAccountRelease(MEM_CACHES, 1000);
+  memAccountGet(MEM_CACHES, &after);
+
+  ck_assert_int_eq(after.live_bytes - before.live_bytes, 500);
+  ck_assert_int_eq(after.allocations - before.allocations, 2);
+  ck_assert(after.peak_bytes >= before.live_bytes + 1500);
+  ck_assert_str_eq(after.name, "caches");
+
+  memAccountRelease(MEM_CACHES, 500);
+}
+END_TEST
+
+START_TEST(memory_stats_reset_peaks) {
+  memAccountAdd(MEM_CACHES, 4096);
+  memAccountRelease(MEM_CACHES, 4096);
+  memAccountResetPeaks();
+
+  MemCategoryStats_t stats;
+  memAccountGet(MEM_CACHES, &stats);
+  ck_assert_int_eq(stats.peak_bytes, stats.live_bytes);
+  ck_assert_int_eq(memAccountTotalPeak(), memAccountTotalLive());
+}
+END_TEST
+
+START_TEST(memory_stats_parse_and_free) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  const long long live_before = memAccountTotalLive();
+  memAccountResetPeaks();
+
+  parseObjFile("tests/test_f.obj", &vertices, &n_vertices, &indices,
+               &n_indices);
+
+  MemCategoryStats_t vertex_stats;
+  MemCategoryStats_t temp_stats;
+  memAccountGet(MEM_VERTICES, &vertex_stats);
+  memAccountGet(MEM_LOADER_TEMP, &temp_stats);
+  const long long model_bytes = (long long)n_vertices * 3 * sizeof(float) +
+                                (long long)n_indices * sizeof(unsigned int);
+  ck_assert_int_eq(memAccountTotalLive() - live_before, model_bytes);
+  ck_assert(vertex_stats.live_bytes >= n_vertices * 3 * (long)sizeof(float));
+  ck_assert_int_eq(temp_stats.live_bytes, 0);
+  ck_assert(temp_stats.peak_bytes > 0);
+
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+}
+END_TEST
+
+START_TEST(memory_stats_process_rss) {
+  ck_assert(memProcessRss() >= 0);
+  ck_assert(memProcessPeakRss() > 0);
+}
+END_TEST
+
+Suite *memory_stats_suite(void) {
+  Suite *s = suite_create("MEMORY_STATS");
+  TCase *tc = tcase_create("memory_stats");
+
+  tcase_add_test(tc, memory_stats_add_release);
+  tcase_add_test(tc, memory_stats_reset_peaks);
+  tcase_add_test(tc, memory_stats_parse_and_free);
+  tcase_add_test(tc, memory_stats_process_rss);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
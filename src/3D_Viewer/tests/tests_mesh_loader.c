@@ -0,0 +1,210 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../mesh_loader.h"
+
+#define LOADER_OBJ "tests/loader_model.obj"
+#define LOADER_PLY "tests/loader_model.ply"
+#define LOADER_STL "tests/loader_model.stl"
+#define LOADER_PLY_AS_OBJ "tests/loader_model_ply.obj"
+
+// A square pyramid with a negative base corner: 5 vertices, 4 side
+// triangles and 2 base triangles. The vertices are numbered in the order
+// the triangles first use them, like the merged corners of the STL.
+static const float kPositions[5][3] = {
+    {-1, -1, 0}, {3, 0, 0}, {1, 1, 4}, {3, 2, 0}, {0, 2, 0}};
+static const int kTriangles[6][3] = {{0, 1, 2}, {1, 3, 2}, {3, 4, 2},
+                                     {4, 0, 2}, {0, 3, 1}, {0, 4, 3}};
+
+static void writeObj(void) {
+  FILE *file = fopen(LOADER_OBJ, "w");
+  for (int v = 0; v < 5; ++v) {
+    fprintf(file, "v %g %g %g\n", kPositions[v][0], kPositions[v][1],
+            kPositions[v][2]);
+  }
+  for (int t = 0; t < 6; ++t) {
+    fprintf(file, "f %d %d %d\n", kTriangles[t][0] + 1, kTriangles[t][1] + 1,
+            kTriangles[t][2] + 1);
+  }
+  fclose(file);
+}
+
+// Vertices with an extra color property before z and faces with a flag
+// after the list, so both need the record walk
+static void writePly(const char *path) {
+  FILE *file = fopen(path, "wb");
+  fprintf(file,
+          "ply\nformat binary_little_endian 1.0\ncomment test\n"
+          "element vertex 5\nproperty float x\nproperty float y\n"
+          "property uchar red\nproperty double z\n"
+          "element face 6\nproperty list uchar int vertex_indices\n"
+          "property uchar flags\nend_header\n");
+  for (int v = 0; v < 5; ++v) {
+    const unsigned char red = 200;
+    const double z = kPositions[v][2];
+    fwrite(kPositions[v], sizeof(float), 2, file);
+    fwrite(&red, 1, 1, file);
+    fwrite(&z, sizeof(z), 1, file);
+  }
+  for (int t = 0; t < 6; ++t) {
+    const unsigned char count = 3;
+    const unsigned char flags = 0;
+    fwrite(&count, 1, 1, file);
+    fwrite(kTriangles[t], sizeof(int), 3, file);
+    fwrite(&flags, 1, 1, file);
+  }
+  fclose(file);
+}
+
+static void writeStl(int declared_triangles) {
+  FILE *file = fopen(LOADER_STL, "wb");
+  char header[80] = "solid but binary";
+  const uint32_t count = (uint32_t)declared_triangles;
+  fwrite(header, 1, sizeof(header), file);
+  fwrite(&count, sizeof(count), 1, file);
+  for (int t = 0; t < 6; ++t) {
+    const float normal[3] = {0, 0, 1};
+    const uint16_t attributes = 0;
+    fwrite(normal, sizeof(float), 3, file);
+    for (int c = 0; c < 3; ++c) {
+      fwrite(kPositions[kTriangles[t][c]], sizeof(float), 3, file);
+    }
+    fwrite(&attributes, sizeof(attributes), 1, file);
+  }
+  fclose(file);
+}
+
+static void assertSameModel(const char *path) {
+  float *expected = NULL;
+  unsigned int *expected_indices = NULL;
+  long long n_expected = 0;
+  long long n_expected_indices = 0;
+  parseObjFile(LOADER_OBJ, &expected, &n_expected, &expected_indices,
+               &n_expected_indices);
+
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ck_assert_int_eq(meshLoad(path, &vertices, &n_vertices, &indices,
+                            &n_indices),
+                   0);
+  ck_assert_int_eq(n_vertices, n_expected);
+  ck_assert_int_eq(n_indices, n_expected_indices);
+  ck_assert_int_eq(
+      memcmp(vertices, expected, n_vertices * 3 * sizeof(float)), 0);
+  ck_assert_int_eq(
+      memcmp(indices, expected_indices, n_indices * sizeof(unsigned int)), 0);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  freeModelC(expected, n_expected, expected_indices, n_expected_indices);
+}
+
+START_TEST(mesh_loader_ply_matches_obj) {
+  writeObj();
+  writePly(LOADER_PLY);
+  ck_assert_str_eq(meshLoaderFind(LOADER_PLY)->name, "Binary PLY");
+  assertSameModel(LOADER_PLY);
+  assertSameModel(LOADER_OBJ);
+
+  // The magic wins over the extension
+  writePly(LOADER_PLY_AS_OBJ);
+  ck_assert_str_eq(meshLoaderFind(LOADER_PLY_AS_OBJ)->name, "Binary PLY");
+  assertSameModel(LOADER_PLY_AS_OBJ);
+
+  // ASCII PLY is not read, and leaves the arrays alone
+  FILE *file = fopen(LOADER_PLY, "w");
+  fprintf(file,
+          "ply\nformat ascii 1.0\nelement vertex 1\nproperty float x\n"
+          "property float y\nproperty float z\nend_header\n0 0 0\n");
+  fclose(file);
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ck_assert_int_eq(meshLoad(LOADER_PLY, &vertices, &n_vertices, &indices,
+                            &n_indices),
+                   -1);
+  ck_assert_ptr_eq(vertices, NULL);
+  ck_assert_int_eq(n_vertices, 0);
+
+  remove(LOADER_OBJ);
+  remove(LOADER_PLY);
+  remove(LOADER_PLY_AS_OBJ);
+}
+END_TEST
+
+START_TEST(mesh_loader_stl_merges_corners) {
+  writeObj();
+  writeStl(6);
+  ck_assert_str_eq(meshLoaderFind(LOADER_STL)->name, "Binary STL");
+  // 18 corners, 5 positions, in order of appearance like the OBJ
+  assertSameModel(LOADER_STL);
+
+  // More triangles declared than stored
+  writeStl(7);
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ck_assert_int_eq(meshLoad(LOADER_STL, &vertices, &n_vertices, &indices,
+                            &n_indices),
+                   -1);
+  ck_assert_int_eq(n_vertices, 0);
+
+  remove(LOADER_OBJ);
+  remove(LOADER_STL);
+}
+END_TEST
+
+static int loadNothing(const char *path, float **vertices,
+                       long long *n_vertices, unsigned int **indices,
+                       long long *n_indices) {
+  (void)path;
+  (void)vertices;
+  (void)indices;
+  *n_vertices = 0;
+  *n_indices = 0;
+  return 0;
+}
+
+START_TEST(mesh_loader_registry) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ck_assert_ptr_eq(meshLoaderFind("tests/model.xyz"), NULL);
+  ck_assert_ptr_eq(meshLoaderFind("tests.d/model"), NULL);
+  ck_assert_int_eq(meshLoad("tests/model.xyz", &vertices, &n_vertices,
+                            &indices, &n_indices),
+                   -1);
+  ck_assert_str_eq(meshLoaderFind("tests/MODEL.OBJ")->name, "Wavefront OBJ");
+
+  const int count = meshLoaderCount();
+  const MeshLoader_t xyz = {"Points", "xyz pts", NULL, 0, loadNothing};
+  ck_assert_int_eq(meshLoaderRegister(&xyz), 0);
+  ck_assert_int_eq(meshLoaderCount(), count + 1);
+  ck_assert(meshLoaderFind("tests/model.pts")->load == loadNothing);
+  ck_assert(meshLoaderAt(count)->load == loadNothing);
+  ck_assert_ptr_eq(meshLoaderAt(count + 1), NULL);
+
+  const MeshLoader_t invalid = {"Invalid", "bad", NULL, 0, NULL};
+  ck_assert_int_eq(meshLoaderRegister(&invalid), -1);
+}
+END_TEST
+
+Suite *mesh_loader_suite(void) {
+  Suite *s = suite_create("MESH_LOADER");
+  TCase *tc = tcase_create("mesh_loader");
+
+  tcase_add_test(tc, mesh_loader_ply_matches_obj);
+  tcase_add_test(tc, mesh_loader_stl_merges_corners);
+  tcase_add_test(tc, mesh_loader_registry);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,179 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../memory_stats.h"
+#include "../model_cache.h"
+
+#define CACHE_PATH "tests/cache_model.obj"
+
+static void writeModel(const char *path, int n_vertices) {
+  FILE *file = fopen(path, "w");
+  for (int i = 0; i < n_vertices; ++i) {
+    fprintf(file, "v %d %d 0\n", i, i % 3);
+  }
+  for (int i = 1; i < n_vertices; ++i) fprintf(file, "l %d %d\n", i, i + 1);
+  fclose(file);
+}
+
+START_TEST(model_cache_hit_returns_a_copy) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  parseObjFile("tests/test_f.obj", &vertices, &n_vertices, &indices,
+               &n_indices);
+
+  ModelCache_t *cache = modelCacheCreate(4, 1 << 20);
+  float *copy = NULL;
+  unsigned int *copy_indices = NULL;
+  long long n_copy = 0;
+  long long n_copy_indices = 0;
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 0, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   -1);
+  ck_assert_int_eq(modelCachePut(cache, "tests/test_f.obj", 0, vertices,
+                                 n_vertices, indices, n_indices),
+                   0);
+  // Another load option is another model
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 1, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   -1);
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 0, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   0);
+  ck_assert_int_eq(n_copy, n_vertices);
+  ck_assert_int_eq(n_copy_indices, n_indices);
+  ck_assert_ptr_ne(copy, vertices);
+  ck_assert_int_eq(memcmp(copy, vertices, n_vertices * 3 * sizeof(float)), 0);
+  ck_assert_int_eq(
+      memcmp(copy_indices, indices, n_indices * sizeof(unsigned int)), 0);
+
+  // Transforms of the copy do not reach the cached model
+  moveModelC(copy, n_copy, 1.0f, 0.0f, 0.0f);
+  freeModelC(copy, n_copy, copy_indices, n_copy_indices);
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 0, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   0);
+  ck_assert_int_eq(memcmp(copy, vertices, n_vertices * 3 * sizeof(float)), 0);
+  freeModelC(copy, n_copy, copy_indices, n_copy_indices);
+
+  ModelCacheStats_t stats;
+  modelCacheGetStats(cache, &stats);
+  ck_assert_int_eq(stats.hits, 2);
+  ck_assert_int_eq(stats.misses, 2);
+  ck_assert_int_eq(stats.insertions, 1);
+  ck_assert_int_eq(stats.entries, 1);
+  ck_assert_int_eq(stats.bytes, n_vertices * 3 * sizeof(float) +
+                                    n_indices * sizeof(unsigned int));
+
+  MemCategoryStats_t caches;
+  memAccountGet(MEM_CACHES, &caches);
+  const long long live = caches.live_bytes;
+  modelCacheDestroy(cache);
+  memAccountGet(MEM_CACHES, &caches);
+  ck_assert_int_lt(caches.live_bytes, live);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+}
+END_TEST
+
+START_TEST(model_cache_lru_eviction) {
+  float vertices[33] = {0};
+  unsigned int indices[2] = {0, 1};
+  const long long bytes = 10 * 3 * sizeof(float) + sizeof(indices);
+  ModelCache_t *cache = modelCacheCreate(2, 1 << 20);
+  float *copy = NULL;
+  unsigned int *copy_indices = NULL;
+  long long n_copy = 0;
+  long long n_copy_indices = 0;
+
+  // The same file under three option sets makes three entries
+  modelCachePut(cache, "tests/test_f.obj", 0, vertices, 10, indices, 2);
+  modelCachePut(cache, "tests/test_f.obj", 1, vertices, 10, indices, 2);
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 0, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   0);
+  freeModelC(copy, n_copy, copy_indices, n_copy_indices);
+  // Evicts option 1, used less recently than option 0
+  modelCachePut(cache, "tests/test_f.obj", 2, vertices, 10, indices, 2);
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 1, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   -1);
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 0, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   0);
+  freeModelC(copy, n_copy, copy_indices, n_copy_indices);
+
+  ModelCacheStats_t stats;
+  modelCacheGetStats(cache, &stats);
+  ck_assert_int_eq(stats.evictions, 1);
+  ck_assert_int_eq(stats.entries, 2);
+
+  // A byte budget for one model keeps the most recent one only
+  modelCacheSetLimits(cache, 2, bytes);
+  modelCacheGetStats(cache, &stats);
+  ck_assert_int_eq(stats.evictions, 2);
+  ck_assert_int_eq(stats.entries, 1);
+  ck_assert_int_eq(modelCacheGet(cache, "tests/test_f.obj", 0, &copy, &n_copy,
+                                 &copy_indices, &n_copy_indices),
+                   0);
+  freeModelC(copy, n_copy, copy_indices, n_copy_indices);
+
+  // Larger than the budget or empty: not kept, nothing evicted
+  ck_assert_int_eq(
+      modelCachePut(cache, "tests/test_f.obj", 3, vertices, 11, indices, 2),
+      -1);
+  ck_assert_int_eq(
+      modelCachePut(cache, "tests/test_f.obj", 4, vertices, 0, indices, 0),
+      -1);
+  modelCacheGetStats(cache, &stats);
+  ck_assert_int_eq(stats.entries, 1);
+  ck_assert_int_eq(stats.evictions, 2);
+  modelCacheDestroy(cache);
+}
+END_TEST
+
+START_TEST(model_cache_changed_file_misses) {
+  writeModel(CACHE_PATH, 4);
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  parseObjFile(CACHE_PATH, &vertices, &n_vertices, &indices, &n_indices);
+  const long long budget = (long long)MODEL_CACHE_DEFAULT_BUDGET_MB << 20;
+  ModelCache_t *cache = modelCacheCreate(MODEL_CACHE_DEFAULT_ENTRIES, budget);
+  ck_assert_int_eq(modelCachePut(cache, CACHE_PATH, 0, vertices, n_vertices,
+                                 indices, n_indices),
+                   0);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+
+  // Another size is another file, whatever the modification time
+  writeModel(CACHE_PATH, 5);
+  ck_assert_int_eq(modelCacheGet(cache, CACHE_PATH, 0, &vertices, &n_vertices,
+                                 &indices, &n_indices),
+                   -1);
+  ModelCacheStats_t stats;
+  modelCacheGetStats(cache, &stats);
+  ck_assert_int_eq(stats.entries, 0);
+
+  remove(CACHE_PATH);
+  ck_assert_int_eq(modelCachePut(cache, CACHE_PATH, 0, vertices, 1, indices, 0),
+                   -1);
+  modelCacheDestroy(cache);
+}
+END_TEST
+
+Suite *model_cache_suite(void) {
+  Suite *s = suite_create("MODEL_CACHE");
+  TCase *tc = tcase_create("model_cache");
+
+  tcase_add_test(tc, model_cache_hit_returns_a_copy);
+  tcase_add_test(tc, model_cache_lru_eviction);
+  tcase_add_test(tc, model_cache_changed_file_misses);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,143 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../obj_export.h"
+
+#define EXPORT_PATH "tests/export_model.obj"
+#define EXPORT_SOURCE "tests/export_source.obj"
+
+START_TEST(obj_export_shortest_floats) {
+  char text[OBJ_EXPORT_FLOAT_CHARS];
+  const struct {
+    float value;
+    const char *text;
+  } cases[] = {{0.1f, "0.1"},         {-0.25f, "-0.25"},
+               {2.0f / 3.0f, "0.6666667"}, {100.0f, "100"},
+               {1.5e-6f, "1.5e-6"},   {123456792.0f, "123456790"},
+               {0.0f, "0"}};
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    ck_assert_int_eq(objFormatFloat(cases[i].value, text),
+                     (int)strlen(cases[i].text));
+    ck_assert_str_eq(text, cases[i].text);
+  }
+
+  // Every written value reads back as the same float
+  unsigned int state = 21;
+  for (int i = 0; i < 100000; ++i) {
+    state = state * 1664525u + 1013904223u;
+    const float value =
+        ((float)(state >> 8) / (float)(1 << 24) - 0.5f) * (float)(i % 1000);
+    const int length = objFormatFloat(value, text);
+    ck_assert_int_lt(length, OBJ_EXPORT_FLOAT_CHARS);
+    ck_assert(strtof(text, NULL) == value);
+  }
+  ck_assert(strtof((objFormatFloat(3.4e38f, text), text), NULL) == 3.4e38f);
+  ck_assert(strtof((objFormatFloat(1e-40f, text), text), NULL) == 1e-40f);
+}
+END_TEST
+
+static void parse(const char *path, float **vertices, long long *n_vertices,
+                  unsigned int **indices, long long *n_indices) {
+  *vertices = NULL;
+  *indices = NULL;
+  *n_vertices = 0;
+  *n_indices = 0;
+  parseObjFile(path, vertices, n_vertices, indices, n_indices);
+}
+
+START_TEST(obj_export_round_trip) {
+  const char *models[] = {"tests/test_f.obj", "tests/test_l.obj"};
+  for (int m = 0; m < 2; ++m) {
+    float *vertices;
+    unsigned int *indices;
+    long long n_vertices;
+    long long n_indices;
+    parse(models[m], &vertices, &n_vertices, &indices, &n_indices);
+
+    ObjExportOptions_t options;
+    objExportDefaults(&options);
+    ObjExportStats_t stats;
+    ck_assert_int_eq(objExport(EXPORT_PATH, vertices, n_vertices, indices,
+                               n_indices, &options, &stats),
+                     0);
+    ck_assert_int_eq(stats.vertices, n_vertices);
+    ck_assert_int_eq(stats.faces * 3 + stats.lines, n_indices / 2);
+    ck_assert_int_eq(stats.faces, m == 0 ? 12 : 0);
+    ck_assert_int_gt(stats.bytes, 0);
+
+    float *exported;
+    unsigned int *exported_indices;
+    long long n_exported;
+    long long n_exported_indices;
+    parse(EXPORT_PATH, &exported, &n_exported, &exported_indices,
+          &n_exported_indices);
+    ck_assert_int_eq(n_exported, n_vertices);
+    ck_assert_int_eq(n_exported_indices, n_indices);
+    ck_assert_int_eq(
+        memcmp(exported, vertices, n_vertices * 3 * sizeof(float)), 0);
+    ck_assert_int_eq(memcmp(exported_indices, indices,
+                            n_indices * sizeof(unsigned int)),
+                     0);
+    freeModelC(exported, n_exported, exported_indices, n_exported_indices);
+    freeModelC(vertices, n_vertices, indices, n_indices);
+  }
+  remove(EXPORT_PATH);
+}
+END_TEST
+
+START_TEST(obj_export_restores_file_coordinates) {
+  FILE *file = fopen(EXPORT_SOURCE, "w");
+  fprintf(file, "v -2 10 0.5\nv 6 12 0.5\nv 2 14 4.5\nf 1 2 3\nl 3 1\n");
+  fclose(file);
+  float *vertices;
+  unsigned int *indices;
+  long long n_vertices;
+  long long n_indices;
+  parse(EXPORT_SOURCE, &vertices, &n_vertices, &indices, &n_indices);
+
+  ObjExportOptions_t options;
+  objExportDefaults(&options);
+  getNormalization(options.origin, &options.scale);
+  ck_assert_float_eq(options.scale, 8.0f);
+  ck_assert_float_eq(options.origin[0], -2.0f);
+  ck_assert_float_eq(options.origin[1], 10.0f);
+  ObjExportStats_t stats;
+  ck_assert_int_eq(objExport(EXPORT_PATH, vertices, n_vertices, indices,
+                             n_indices, &options, &stats),
+                   0);
+  ck_assert_int_eq(stats.faces, 1);
+  ck_assert_int_eq(stats.lines, 1);
+
+  file = fopen(EXPORT_PATH, "r");
+  char line[128];
+  char *read = fgets(line, sizeof(line), file);
+  read = fgets(line, sizeof(line), file);
+  ck_assert_ptr_ne(read, NULL);
+  ck_assert_str_eq(line, "v -2 10 0.5\n");
+  fclose(file);
+
+  // Unwritable: nothing is left behind
+  ck_assert_int_eq(objExport("tests/missing/export.obj", vertices, n_vertices,
+                             indices, n_indices, &options, &stats),
+                   -1);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  remove(EXPORT_PATH);
+  remove(EXPORT_SOURCE);
+}
+END_TEST
+
+Suite *obj_export_suite(void) {
+  Suite *s = suite_create("OBJ_EXPORT");
+  TCase *tc = tcase_create("obj_export");
+
+  tcase_add_test(tc, obj_export_shortest_floats);
+  tcase_add_test(tc, obj_export_round_trip);
+  tcase_add_test(tc, obj_export_restores_file_coordinates);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,166 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../tools/obj_generator.h"
+
+#define GENERATED_PATH "tests/generated.obj"
+
+static void parse(const char *path, float **vertices, long long *n_vertices,
+                  unsigned int **indices, long long *n_indices) {
+  *vertices = NULL;
+  *indices = NULL;
+  *n_vertices = 0;
+  *n_indices = 0;
+  parseObjFile(path, vertices, n_vertices, indices, n_indices);
+}
+
+static char *readAll(const char *path, long *size) {
+  FILE *file = fopen(path, "rb");
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  rewind(file);
+  char *text = malloc(*size + 1);
+  *size = (long)fread(text, 1, *size, file);
+  fclose(file);
+  return text;
+}
+
+START_TEST(obj_generator_topologies) {
+  // 100 vertices are a 10 x 10 square: 9 x 9 grid cells, 9 x 10 on the
+  // sphere that closes the seam, 200 soup triangles and a 99 segment line
+  const struct {
+    ObjTopology_t topology;
+    long n_faces;
+    int indices_per_face;
+  } cases[] = {{OBJ_TOPOLOGY_GRID, 162, 6},
+               {OBJ_TOPOLOGY_SPHERE, 180, 6},
+               {OBJ_TOPOLOGY_SOUP, 200, 6},
+               {OBJ_TOPOLOGY_LINES, 99, 2}};
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+    for (int style = OBJ_INDEX_V; style <= OBJ_INDEX_V_VT_VN; ++style) {
+      ObjGeneratorOptions_t options;
+      objGeneratorDefaults(&options);
+      options.topology = cases[c].topology;
+      options.n_vertices = 100;
+      options.index_style = style;
+      ObjGeneratorStats_t stats;
+      ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+      ck_assert_int_eq(stats.n_vertices, 100);
+      ck_assert_int_eq(stats.n_faces, cases[c].n_faces);
+
+      float *vertices;
+      unsigned int *indices;
+      long long n_vertices;
+      long long n_indices;
+      parse(GENERATED_PATH, &vertices, &n_vertices, &indices, &n_indices);
+      ck_assert_int_eq(n_vertices, stats.n_vertices);
+      ck_assert_int_eq(n_indices, stats.n_faces * cases[c].indices_per_face);
+      for (long long i = 0; i < n_indices; ++i) {
+        ck_assert_uint_lt(indices[i], (unsigned int)n_vertices);
+      }
+      freeModelC(vertices, n_vertices, indices, n_indices);
+    }
+  }
+  remove(GENERATED_PATH);
+}
+END_TEST
+
+START_TEST(obj_generator_face_limits) {
+  ObjGeneratorOptions_t options;
+  objGeneratorDefaults(&options);
+  options.n_vertices = 100;
+  options.n_faces = 5;
+  ObjGeneratorStats_t stats;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+  ck_assert_int_eq(stats.n_faces, 5);
+
+  float *vertices;
+  unsigned int *indices;
+  long long n_vertices;
+  long long n_indices;
+  parse(GENERATED_PATH, &vertices, &n_vertices, &indices, &n_indices);
+  ck_assert_int_eq(n_vertices, 100);
+  ck_assert_int_eq(n_indices, 5 * 6);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+
+  // A grid never has more faces than its surface; extra line segments are
+  // random chords
+  options.n_faces = 1000;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+  ck_assert_int_eq(stats.n_faces, 162);
+  options.topology = OBJ_TOPOLOGY_LINES;
+  options.n_faces = 150;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+  parse(GENERATED_PATH, &vertices, &n_vertices, &indices, &n_indices);
+  ck_assert_int_eq(stats.n_faces, 150);
+  ck_assert_int_eq(n_indices, 150 * 2);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  remove(GENERATED_PATH);
+}
+END_TEST
+
+START_TEST(obj_generator_same_seed_same_bytes) {
+  ObjGeneratorOptions_t options;
+  objGeneratorDefaults(&options);
+  options.topology = OBJ_TOPOLOGY_SOUP;
+  options.n_vertices = 500;
+  options.float_format = OBJ_FLOAT_GENERAL;
+  ObjGeneratorStats_t stats;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+  long first_size;
+  char *first = readAll(GENERATED_PATH, &first_size);
+  ck_assert_int_eq(first_size, stats.n_bytes);
+
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+  long second_size;
+  char *second = readAll(GENERATED_PATH, &second_size);
+  ck_assert_int_eq(second_size, first_size);
+  ck_assert_int_eq(memcmp(first, second, first_size), 0);
+  free(second);
+
+  options.seed += 1;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, &stats), 0);
+  second = readAll(GENERATED_PATH, &second_size);
+  ck_assert(second_size != first_size ||
+            memcmp(first, second, first_size) != 0);
+  free(second);
+  free(first);
+  remove(GENERATED_PATH);
+}
+END_TEST
+
+START_TEST(obj_generator_rejects_bad_options) {
+  ObjGeneratorOptions_t options;
+  objGeneratorDefaults(&options);
+  options.n_vertices = -1;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, NULL), -1);
+  objGeneratorDefaults(&options);
+  options.precision = 18;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, NULL), -1);
+  objGeneratorDefaults(&options);
+  options.topology = (ObjTopology_t)4;
+  ck_assert_int_eq(objGenerateFile(GENERATED_PATH, &options, NULL), -1);
+  ck_assert_int_eq(objGenerate(NULL, &options, NULL), -1);
+  ck_assert_int_eq(objGenerateFile("tests/missing/generated.obj", &options,
+                                   NULL),
+                   -1);
+  remove(GENERATED_PATH);
+}
+END_TEST
+
+Suite *obj_generator_suite(void) {
+  Suite *s = suite_create("OBJ_GENERATOR");
+  TCase *tc = tcase_create("obj_generator");
+
+  tcase_add_test(tc, obj_generator_topologies);
+  tcase_add_test(tc, obj_generator_face_limits);
+  tcase_add_test(tc, obj_generator_same_seed_same_bytes);
+  tcase_add_test(tc, obj_generator_rejects_bad_options);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
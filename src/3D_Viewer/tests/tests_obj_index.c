@@ -0,0 +1,142 @@
+#include <check.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../backend.h"
+#include "../obj_index.h"
+#include "../obj_stream.h"
+
+#define INDEX_OBJ "tests/index_model.obj"
+
+START_TEST(obj_index_parses_references) {
+  unsigned int corners[3];
+  ck_assert_int_eq(objParseIndices("f 1 -1/2/3 3//4\n", 5, corners, 3), 3);
+  ck_assert_uint_eq(corners[0], 0);
+  ck_assert_uint_eq(corners[1], 4);
+  ck_assert_uint_eq(corners[2], 2);
+
+  // 0 and references before the first vertex name no vertex
+  ck_assert_int_eq(objParseIndices("l 0 -4", 3, corners, 2), 2);
+  ck_assert_uint_eq(corners[0], OBJ_INDEX_INVALID);
+  ck_assert_uint_eq(corners[1], OBJ_INDEX_INVALID);
+
+  ck_assert_int_eq(objParseIndices("f 4294967296 2", 3, corners, 3), 2);
+  ck_assert_uint_eq(corners[0], OBJ_INDEX_INVALID);
+  ck_assert_uint_eq(corners[1], 1);
+  ck_assert_uint_eq(corners[2], OBJ_INDEX_INVALID);
+  ck_assert_int_eq(objParseIndices("f\tx 1 2", 3, corners, 3), 0);
+}
+END_TEST
+
+START_TEST(obj_index_finds_first_bad) {
+  const long long n = 3 * OBJ_INDEX_BLOCK + 5;
+  unsigned int *indices = malloc(n * sizeof(unsigned int));
+  for (long long i = 0; i < n; ++i) indices[i] = (unsigned int)(i % 100);
+
+  ck_assert_int_eq(objFindBadIndex(indices, n, 100), -1);
+  ck_assert_int_eq(objFindBadIndex(indices, n, 99), 99);
+  indices[n - 1] = 100;
+  ck_assert_int_eq(objFindBadIndex(indices, n, 100), n - 1);
+  indices[OBJ_INDEX_BLOCK + 7] = OBJ_INDEX_INVALID;
+  ck_assert_int_eq(objFindBadIndex(indices, n, 100), OBJ_INDEX_BLOCK + 7);
+  // Unresolved references stay bad however many vertices there are
+  ck_assert_int_eq(objFindBadIndex(indices, n, 1LL << 33),
+                   OBJ_INDEX_BLOCK + 7);
+  ck_assert_int_eq(objFindBadIndex(indices, n, 0), 0);
+  ck_assert_int_eq(objFindBadIndex(NULL, 0, 0), -1);
+  free(indices);
+}
+END_TEST
+
+static void writeModel(const char *faces) {
+  FILE *file = fopen(INDEX_OBJ, "w");
+  fprintf(file, "v 0 0 0\nv 1 0 0\nv 1 1 0\n# three\nv 0 1 0\n%s", faces);
+  fclose(file);
+}
+
+static int streamModel(float **vertices, long long *n_vertices,
+                       unsigned int **indices, long long *n_indices) {
+  const int fd = open(INDEX_OBJ, O_RDONLY);
+  const int status =
+      parseObjStream(fd, vertices, n_vertices, indices, n_indices, NULL);
+  close(fd);
+  return status;
+}
+
+START_TEST(parse_obj_reports_bad_lines) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+
+  // Relative references count back from the last vertex read
+  writeModel("f -4 -3 -2\nl 4 -1\n");
+  ck_assert_int_eq(parseObjFile(INDEX_OBJ, &vertices, &n_vertices, &indices,
+                                &n_indices),
+                   0);
+  const unsigned int expected[] = {0, 1, 1, 2, 2, 0, 3, 3};
+  ck_assert_int_eq(n_indices, 8);
+  ck_assert_int_eq(memcmp(indices, expected, sizeof(expected)), 0);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+
+  LoadError_t error;
+  writeModel("f 1 2 3\nf 1 2 5\n");
+  n_vertices = 0;
+  n_indices = 0;
+  ck_assert_int_eq(parseObjFile(INDEX_OBJ, &vertices, &n_vertices, &indices,
+                                &n_indices),
+                   -1);
+  ck_assert(vertices == NULL && indices == NULL);
+  ck_assert_int_eq(n_vertices, 0);
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_INDEX);
+  ck_assert_int_eq(error.line, 7);
+  ck_assert_int_eq(error.offset, 48);
+  ck_assert_ptr_nonnull(strstr(error.message, "vertex 5"));
+  // A stream names the same line
+  ck_assert_int_eq(streamModel(&vertices, &n_vertices, &indices, &n_indices),
+                   -1);
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_INDEX);
+  ck_assert_int_eq(error.line, 7);
+  ck_assert_int_eq(error.offset, 48);
+
+  writeModel("f 1 2 3\nf 1 2\n");
+  n_vertices = 0;
+  n_indices = 0;
+  ck_assert_int_eq(parseObjFile(INDEX_OBJ, &vertices, &n_vertices, &indices,
+                                &n_indices),
+                   -1);
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_SYNTAX);
+  ck_assert_int_eq(error.line, 7);
+  ck_assert_int_eq(streamModel(&vertices, &n_vertices, &indices, &n_indices),
+                   -1);
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_SYNTAX);
+
+  n_vertices = 0;
+  ck_assert_int_eq(parseObjFile("tests/missing.obj", &vertices, &n_vertices,
+                                &indices, &n_indices),
+                   -1);
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_OPEN);
+  remove(INDEX_OBJ);
+}
+END_TEST
+
+Suite *obj_index_suite(void) {
+  Suite *s = suite_create("OBJ_INDEX");
+  TCase *tc = tcase_create("obj_index");
+
+  tcase_add_test(tc, obj_index_parses_references);
+  tcase_add_test(tc, obj_index_finds_first_bad);
+  tcase_add_test(tc, parse_obj_reports_bad_lines);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,162 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../obj_reload.h"
+
+#define RELOAD_PATH "tests/reload_grid.obj"
+#define RELOAD_SIDE 120
+
+// A RELOAD_SIDE x RELOAD_SIDE grid of line segments, about 400 KB. moved is
+// a vertex lifted by lift, inserted extra vertices after the first row.
+static void writeGrid(int moved, float lift, int inserted) {
+  FILE *file = fopen(RELOAD_PATH, "w");
+  const int n = RELOAD_SIDE * RELOAD_SIDE;
+  for (int v = 0; v < n; ++v) {
+    const float z = v == moved ? lift : 0.5f * (float)((v * 7) % 11) / 11.0f;
+    fprintf(file, "v %.4f %.4f %.4f\n", (float)(v % RELOAD_SIDE),
+            (float)(v / RELOAD_SIDE), z);
+    if (v == RELOAD_SIDE - 1) {
+      for (int i = 0; i < inserted; ++i) {
+        fprintf(file, "v %d %d 40\n", i, -i);
+      }
+    }
+  }
+  for (int v = 0; v < n; ++v) {
+    if (v % RELOAD_SIDE + 1 < RELOAD_SIDE) {
+      fprintf(file, "l %d %d\n", v + 1, v + 2);
+    }
+    if (v + RELOAD_SIDE < n) {
+      fprintf(file, "l %d %d\n", v + 1, v + 1 + RELOAD_SIDE);
+    }
+  }
+  fclose(file);
+}
+
+static void assertMatchesParser(const float *vertices, int n_vertices,
+                                const unsigned int *indices, int n_indices,
+                                float scale) {
+  float *expected = NULL;
+  unsigned int *expected_indices = NULL;
+  long long n_expected = 0;
+  long long n_expected_indices = 0;
+  parseObjFile(RELOAD_PATH, &expected, &n_expected, &expected_indices,
+               &n_expected_indices);
+  if (scale != 1.0f) scaleModelC(expected, n_expected, scale);
+  ck_assert_int_eq(n_vertices, n_expected);
+  ck_assert_int_eq(n_indices, n_expected_indices);
+  ck_assert_int_eq(
+      memcmp(vertices, expected, (size_t)n_vertices * 3 * sizeof(float)), 0);
+  ck_assert_int_eq(memcmp(indices, expected_indices,
+                          (size_t)n_indices * sizeof(unsigned int)),
+                   0);
+  freeModelC(expected, n_expected, expected_indices, n_expected_indices);
+}
+
+START_TEST(obj_reload_patches_changed_chunks) {
+  writeGrid(-1, 0.0f, 0);
+  ObjReload_t *reload = objReloadCreate();
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ObjReloadStats_t stats;
+  ck_assert_int_eq(objReload(reload, RELOAD_PATH, NULL, &vertices, &n_vertices,
+                             &indices, &n_indices, &stats),
+                   0);
+  ck_assert_int_gt(stats.chunks, 4);
+  ck_assert_int_eq(stats.dirty_chunks, stats.chunks);
+  ck_assert_int_eq(stats.relayout, 1);
+  assertMatchesParser(vertices, n_vertices, indices, n_indices, 1.0f);
+
+  // Unchanged file: nothing to do
+  const float *first_vertices = vertices;
+  ck_assert_int_eq(objReload(reload, RELOAD_PATH, NULL, &vertices, &n_vertices,
+                             &indices, &n_indices, &stats),
+                   0);
+  ck_assert_int_eq(stats.dirty_chunks, 0);
+  ck_assert_int_eq(stats.first_dirty_vertex, -1);
+  ck_assert_int_eq(stats.relayout, 0);
+
+  // One vertex moves inside the bounding box: only its chunk (and the next
+  // one, if the line was a chunk boundary) is parsed and written, in place
+  const int moved = RELOAD_SIDE * RELOAD_SIDE / 2;
+  writeGrid(moved, 0.25f, 0);
+  ck_assert_int_eq(objReload(reload, RELOAD_PATH, NULL, &vertices, &n_vertices,
+                             &indices, &n_indices, &stats),
+                   0);
+  ck_assert_int_le(stats.dirty_chunks, 2);
+  ck_assert_int_eq(stats.relayout, 0);
+  ck_assert_int_eq(stats.renormalized, 0);
+  ck_assert_ptr_eq(vertices, first_vertices);
+  ck_assert_int_le(stats.first_dirty_vertex, moved);
+  ck_assert_int_gt(stats.first_dirty_vertex + stats.dirty_vertices, moved);
+  ck_assert_int_lt(stats.dirty_vertices, n_vertices / 4);
+  ck_assert_int_eq(stats.dirty_indices, 0);
+  assertMatchesParser(vertices, n_vertices, indices, n_indices, 1.0f);
+
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  objReloadDestroy(reload);
+  remove(RELOAD_PATH);
+}
+END_TEST
+
+START_TEST(obj_reload_inserted_lines_and_bounds) {
+  writeGrid(-1, 0.0f, 0);
+  ObjReload_t *reload = objReloadCreate();
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ObjReloadStats_t stats;
+  objReload(reload, RELOAD_PATH, NULL, &vertices, &n_vertices, &indices,
+            &n_indices, &stats);
+  const int chunks = stats.chunks;
+
+  // New vertices near the start shift everything after them and grow the
+  // bounding box; the chunks after the insertion are still reused
+  writeGrid(-1, 0.0f, 3);
+  ck_assert_int_eq(objReload(reload, RELOAD_PATH, NULL, &vertices, &n_vertices,
+                             &indices, &n_indices, &stats),
+                   0);
+  ck_assert_int_eq(stats.relayout, 1);
+  ck_assert_int_eq(stats.renormalized, 1);
+  ck_assert_int_le(stats.dirty_chunks, 2);
+  ck_assert_int_ge(stats.chunks, chunks - 1);
+  assertMatchesParser(vertices, n_vertices, indices, n_indices, 1.0f);
+
+  // The transforms since the load are applied to what is written
+  const float scale[16] = {2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 1};
+  writeGrid(-1, 0.0f, 0);
+  ck_assert_int_eq(objReload(reload, RELOAD_PATH, scale, &vertices,
+                             &n_vertices, &indices, &n_indices, &stats),
+                   0);
+  assertMatchesParser(vertices, n_vertices, indices, n_indices, 2.0f);
+
+  // A missing file leaves the model as it is
+  remove(RELOAD_PATH);
+  float *kept = vertices;
+  ck_assert_int_eq(objReload(reload, RELOAD_PATH, NULL, &vertices, &n_vertices,
+                             &indices, &n_indices, &stats),
+                   -1);
+  ck_assert_ptr_eq(vertices, kept);
+  ck_assert_int_eq(n_vertices, RELOAD_SIDE * RELOAD_SIDE);
+
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  objReloadDestroy(reload);
+}
+END_TEST
+
+Suite *obj_reload_suite(void) {
+  Suite *s = suite_create("OBJ_RELOAD");
+  TCase *tc = tcase_create("obj_reload");
+
+  tcase_add_test(tc, obj_reload_patches_changed_chunks);
+  tcase_add_test(tc, obj_reload_inserted_lines_and_bounds);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
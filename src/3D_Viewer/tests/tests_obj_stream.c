@@ -0,0 +1,177 @@
+#include <check.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../backend.h"
+#include "../obj_stream.h"
+
+#define STREAM_LINES "tests/stream_lines.txt"
+#define STREAM_OBJ "tests/stream_model.obj"
+#define STREAM_LINE_COUNT 20000
+// Longer than a block, so it spans three of them
+#define STREAM_LONG_LINE (OBJ_STREAM_BLOCK_BYTES + OBJ_STREAM_BLOCK_BYTES / 2)
+
+static size_t lineLength(int i) {
+  return i == STREAM_LINE_COUNT / 2 ? STREAM_LONG_LINE : (size_t)(i * 7 % 301);
+}
+
+static char lineByte(int i, size_t k) { return (char)('a' + (i + k) % 26); }
+
+// Lines of many lengths, the last one without a newline.
+static long long writeLines(void) {
+  FILE *file = fopen(STREAM_LINES, "w");
+  long long bytes = 0;
+  for (int i = 0; i < STREAM_LINE_COUNT; ++i) {
+    for (size_t k = 0; k < lineLength(i); ++k) fputc(lineByte(i, k), file);
+    bytes += (long long)lineLength(i);
+    if (i + 1 < STREAM_LINE_COUNT) {
+      fputc('\n', file);
+      ++bytes;
+    }
+  }
+  fclose(file);
+  return bytes;
+}
+
+START_TEST(obj_stream_lines_across_blocks) {
+  const long long bytes = writeLines();
+  const int fd = open(STREAM_LINES, O_RDONLY);
+  ck_assert_int_ge(fd, 0);
+  ObjStream_t *stream = objStreamOpen(fd);
+  ck_assert_ptr_nonnull(stream);
+
+  char *line = NULL;
+  int count = 0;
+  ssize_t length;
+  while ((length = objStreamGetLine(stream, &line)) != -1) {
+    ck_assert_int_lt(count, STREAM_LINE_COUNT);
+    ck_assert_int_eq(length, lineLength(count));
+    ck_assert_int_eq(strlen(line), lineLength(count));
+    for (size_t k = 0; k < (size_t)length; k += 97) {
+      ck_assert_int_eq(line[k], lineByte(count, k));
+    }
+    ++count;
+  }
+  ck_assert_int_eq(count, STREAM_LINE_COUNT);
+  ck_assert_int_eq(objStreamGetLine(stream, &line), -1);
+  ck_assert_int_eq(objStreamError(stream), 0);
+  ObjStreamStats_t stats;
+  objStreamGetStats(stream, &stats);
+  ck_assert_int_eq(stats.bytes, bytes);
+  ck_assert_int_eq(stats.blocks, (bytes + OBJ_STREAM_BLOCK_BYTES - 1) /
+                                     OBJ_STREAM_BLOCK_BYTES);
+  objStreamClose(stream);
+  close(fd);
+
+  // A stream closed before its end stops its reader
+  const int again = open(STREAM_LINES, O_RDONLY);
+  stream = objStreamOpen(again);
+  ck_assert_int_eq(objStreamGetLine(stream, &line), 0);
+  objStreamClose(stream);
+  close(again);
+  remove(STREAM_LINES);
+}
+END_TEST
+
+typedef struct PipeWriter_t {
+  int fd;
+  const char *path;
+} PipeWriter_t;
+
+static void *writePipe(void *argument) {
+  PipeWriter_t *writer = argument;
+  FILE *file = fopen(writer->path, "rb");
+  char buffer[4096];
+  size_t got;
+  while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    if (write(writer->fd, buffer, got) != (ssize_t)got) break;
+  }
+  fclose(file);
+  close(writer->fd);
+  return NULL;
+}
+
+START_TEST(parse_obj_stream_matches_file) {
+  FILE *file = fopen(STREAM_OBJ, "w");
+  for (int i = 0; i < 3000; ++i) {
+    fprintf(file, "v %d.25 %d -%d.5\n", i % 17, i % 29, i % 13);
+  }
+  fprintf(file, "vn 0 0 1\n# a comment\n");
+  for (int i = 1; i + 2 <= 3000; i += 3) {
+    if (i % 2) {
+      fprintf(file, "f %d %d %d\n", i, i + 1, i + 2);
+    } else {
+      fprintf(file, "f %d/1/1 %d/1/1 %d/1/1\n", i, i + 1, i + 2);
+    }
+    fprintf(file, "l %d %d\n", i, i + 2);
+  }
+  fprintf(file, "v 40 40 40");
+  fclose(file);
+
+  float *expected_vertices = NULL;
+  unsigned int *expected_indices = NULL;
+  long long expected_n_vertices = 0;
+  long long expected_n_indices = 0;
+  parseObjFile(STREAM_OBJ, &expected_vertices, &expected_n_vertices,
+               &expected_indices, &expected_n_indices);
+  float expected_origin[3];
+  float expected_scale;
+  getNormalization(expected_origin, &expected_scale);
+
+  int ends[2];
+  ck_assert_int_eq(pipe(ends), 0);
+  PipeWriter_t writer = {ends[1], STREAM_OBJ};
+  pthread_t thread;
+  pthread_create(&thread, NULL, writePipe, &writer);
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ObjStreamStats_t stats;
+  ck_assert_int_eq(parseObjStream(ends[0], &vertices, &n_vertices, &indices,
+                                  &n_indices, &stats),
+                   0);
+  pthread_join(thread, NULL);
+  close(ends[0]);
+
+  ck_assert_int_eq(n_vertices, expected_n_vertices);
+  ck_assert_int_eq(n_indices, expected_n_indices);
+  ck_assert_int_eq(n_vertices, 3001);
+  ck_assert_int_eq(memcmp(vertices, expected_vertices,
+                          (size_t)n_vertices * 3 * sizeof(float)),
+                   0);
+  ck_assert_int_eq(memcmp(indices, expected_indices,
+                          (size_t)n_indices * sizeof(unsigned int)),
+                   0);
+  float origin[3];
+  float scale;
+  getNormalization(origin, &scale);
+  ck_assert_int_eq(memcmp(origin, expected_origin, sizeof(origin)), 0);
+  ck_assert_float_eq(scale, expected_scale);
+  ck_assert_int_gt(stats.bytes, 0);
+
+  ck_assert_int_eq(objStreamIsPipe("-"), 1);
+  ck_assert_int_eq(objStreamIsPipe(STREAM_OBJ), 0);
+  ck_assert_int_eq(objStreamIsPipe("tests"), 0);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  freeModelC(expected_vertices, expected_n_vertices, expected_indices,
+             expected_n_indices);
+  remove(STREAM_OBJ);
+}
+END_TEST
+
+Suite *obj_stream_suite(void) {
+  Suite *s = suite_create("OBJ_STREAM");
+  TCase *tc = tcase_create("obj_stream");
+
+  tcase_add_test(tc, obj_stream_lines_across_blocks);
+  tcase_add_test(tc, parse_obj_stream_matches_file);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
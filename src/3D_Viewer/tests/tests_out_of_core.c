@@ -0,0 +1,224 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../backend.h"
+#include "../memory_stats.h"
+#include "../out_of_core.h"
+
+#define GRID 20
+#define OBJ_PATH "tests/ooc_grid.obj"
+#define STORE_PATH "tests/ooc_grid.obj" OOC_STORE_SUFFIX
+
+static const float kIdentity[16] = {1, 0, 0, 0, 0, 1, 0, 0,
+                                    0, 0, 1, 0, 0, 0, 0, 1};
+
+// GRID x GRID grid in the xy plane: edges along rows, faces along columns,
+// and with bad_edge one edge to a vertex that does not exist. Half of the
+// faces use v//vn corners, the others count back from the last vertex.
+static void writeGrid(int bad_edge) {
+  FILE *file = fopen(OBJ_PATH, "w");
+  for (int y = 0; y < GRID; ++y) {
+    for (int x = 0; x < GRID; ++x) {
+      fprintf(file, "v %d %d %d\n", x, y, (x * y) % 3);
+    }
+  }
+  for (int y = 0; y < GRID; ++y) {
+    for (int x = 0; x + 1 < GRID; ++x) {
+      fprintf(file, "l %d %d\n", y * GRID + x + 1, y * GRID + x + 2);
+    }
+  }
+  for (int y = 0; y + 1 < GRID; ++y) {
+    for (int x = 0; x + 1 < GRID; x += 2) {
+      const int corners[3] = {y * GRID + x + 1, (y + 1) * GRID + x + 1,
+                              (y + 1) * GRID + x + 2};
+      if (x % 4 == 0) {
+        fprintf(file, "f %d//1 %d//1 %d//1\n", corners[0], corners[1],
+                corners[2]);
+      } else {
+        const int n = GRID * GRID + 1;
+        fprintf(file, "f %d %d %d\n", corners[0] - n, corners[1] - n,
+                corners[2] - n);
+      }
+    }
+  }
+  if (bad_edge) fprintf(file, "l 1 %d\n", GRID * GRID + 5);
+  fclose(file);
+}
+
+typedef struct Segment_t {
+  float p[6];
+} Segment_t;
+
+static int compareSegments(const void *a, const void *b) {
+  return memcmp(a, b, sizeof(Segment_t));
+}
+
+static void addSegment(Segment_t *segment, const float *first,
+                       const float *second) {
+  const int swap = memcmp(first, second, 3 * sizeof(float)) > 0;
+  memcpy(segment->p, swap ? second : first, 3 * sizeof(float));
+  memcpy(segment->p + 3, swap ? first : second, 3 * sizeof(float));
+}
+
+static void buildGrid(long target, OocBuildStats_t *stats) {
+  writeGrid(0);
+  OocBuildOptions_t options;
+  oocBuildDefaults(&options);
+  options.target_chunk_vertices = target;
+  options.overview_grid = 4;
+  ck_assert_int_eq(oocBuild(OBJ_PATH, STORE_PATH, &options, stats), 0);
+}
+
+START_TEST(ooc_build_matches_parser) {
+  const long long live_before = memAccountTotalLive();
+  OocBuildStats_t stats;
+  buildGrid(16, &stats);
+  ck_assert_int_eq(stats.vertices, GRID * GRID);
+  ck_assert_int_eq(stats.edges, GRID * (GRID - 1) + (GRID - 1) * 10 * 3);
+  ck_assert_int_gt(stats.chunks, 1);
+  ck_assert_int_gt(stats.cross_edges, 0);
+  ck_assert_int_gt(stats.overview_edges, 0);
+
+  OocStore_t *store = oocOpen(STORE_PATH, 1LL << 30);
+  ck_assert_ptr_nonnull(store);
+  ck_assert_int_eq(oocChunkCount(store), stats.chunks);
+  OocFrame_t frame;
+  do {
+    oocUpdate(store, kIdentity, 100000, &frame);
+  } while (frame.pending > 0);
+  ck_assert_int_eq(frame.visible, stats.chunks);
+  ck_assert_int_eq(frame.drawn, stats.chunks);
+  ck_assert_int_eq(frame.coarse, 0);
+
+  // Every edge of the model appears in exactly one chunk
+  const long n_segments = stats.edges;
+  Segment_t *stored = calloc(n_segments, sizeof(Segment_t));
+  long n_stored = 0;
+  const int *draw = NULL;
+  const int n_draw = oocDrawList(store, &draw);
+  for (int i = 0; i < n_draw; ++i) {
+    OocMeshView_t chunk;
+    ck_assert_int_eq(oocChunk(store, draw[i], &chunk), 0);
+    for (long e = 0; e < chunk.n_indices; e += 2) {
+      ck_assert_uint_le(chunk.indices[e], (unsigned)chunk.n_vertices - 1);
+      ck_assert_uint_le(chunk.indices[e + 1], (unsigned)chunk.n_vertices - 1);
+      ck_assert_int_lt(n_stored, n_segments);
+      addSegment(&stored[n_stored++], &chunk.positions[chunk.indices[e] * 3],
+                 &chunk.positions[chunk.indices[e + 1] * 3]);
+    }
+  }
+  ck_assert_int_eq(n_stored, n_segments);
+
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  ck_assert_int_eq(
+      parseObjFile(OBJ_PATH, &vertices, &n_vertices, &indices, &n_indices),
+      0);
+  Segment_t *parsed = calloc(n_segments, sizeof(Segment_t));
+  long n_parsed = 0;
+  for (int e = 0; e < n_indices; e += 2) {
+    addSegment(&parsed[n_parsed++], &vertices[indices[e] * 3],
+               &vertices[indices[e + 1] * 3]);
+  }
+  ck_assert_int_eq(n_parsed, n_segments);
+  qsort(stored, n_segments, sizeof(Segment_t), compareSegments);
+  qsort(parsed, n_segments, sizeof(Segment_t), compareSegments);
+  for (long i = 0; i < n_segments; ++i) {
+    for (int k = 0; k < 6; ++k) {
+      ck_assert_float_eq_tol(stored[i].p[k], parsed[i].p[k], 1e-6);
+    }
+  }
+
+  free(stored);
+  free(parsed);
+  freeModelC(vertices, n_vertices, indices, n_indices);
+  oocClose(store);
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+  remove(STORE_PATH);
+  remove(OBJ_PATH);
+}
+END_TEST
+
+START_TEST(ooc_budget_and_eviction) {
+  OocBuildStats_t stats;
+  buildGrid(8, &stats);
+  OocStore_t *store = oocOpen(STORE_PATH, 1LL << 30);
+  ck_assert_ptr_nonnull(store);
+  OocFrame_t frame;
+  oocUpdate(store, kIdentity, 100000, &frame);
+  // Room for the tables and three chunks of at most one page each
+  const long long fixed = frame.resident_bytes - frame.drawn * 4096LL;
+  const long long budget = fixed + 3 * 4096LL;
+  oocSetBudget(store, budget);
+
+  for (int step = 0; step < 4; ++step) {
+    // Zoom into a different corner of the model each step
+    float mvp[16];
+    memcpy(mvp, kIdentity, sizeof(mvp));
+    mvp[0] = mvp[5] = 8.0f;
+    mvp[12] = -8.0f * (step & 1 ? 0.9f : 0.1f);
+    mvp[13] = -8.0f * (step & 2 ? 0.9f : 0.1f);
+    oocUpdate(store, mvp, 1000, &frame);
+    ck_assert_int_gt(frame.visible, 0);
+    ck_assert_int_lt(frame.visible, stats.chunks);
+    ck_assert(frame.resident_bytes <= budget);
+    ck_assert_int_le(frame.drawn, 3);
+    if (step > 0) ck_assert_int_gt(frame.evicted, 0);
+  }
+
+  // Zoomed out everything is visible, what does not fit is left coarse
+  oocUpdate(store, kIdentity, 1000, &frame);
+  ck_assert_int_eq(frame.visible, stats.chunks);
+  ck_assert_int_eq(frame.drawn + frame.pending + frame.coarse, frame.visible);
+  ck_assert_int_gt(frame.coarse, 0);
+  ck_assert(frame.resident_bytes <= budget);
+
+  OocMeshView_t overview;
+  oocOverview(store, &overview);
+  ck_assert_int_gt(overview.n_vertices, 0);
+  ck_assert_int_le(overview.n_vertices, 4 * 4 * 4);
+  oocClose(store);
+  remove(STORE_PATH);
+  remove(OBJ_PATH);
+}
+END_TEST
+
+START_TEST(ooc_missing_files_and_bad_indices) {
+  ck_assert_int_eq(oocBuild("tests/no_such_model.obj",
+                            "tests/no_such_model.obj" OOC_STORE_SUFFIX, NULL,
+                            NULL),
+                   -1);
+  ck_assert_ptr_null(oocOpen("tests/no_such_model.obj" OOC_STORE_SUFFIX, 0));
+  ck_assert_ptr_null(oocOpen("tests/test_f.obj", 1LL << 30));
+
+  // A bad reference fails the build like it fails parseObjFile
+  writeGrid(1);
+  ck_assert_int_eq(oocBuild(OBJ_PATH, STORE_PATH, NULL, NULL), -1);
+  LoadError_t error;
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_INDEX);
+  ck_assert_int_eq(error.line, GRID * GRID + GRID * (GRID - 1) +
+                                   (GRID - 1) * (GRID / 2) + 1);
+  ck_assert_ptr_nonnull(strstr(error.message, "out of range"));
+  ck_assert_int_eq(access(STORE_PATH, F_OK), -1);
+  remove(OBJ_PATH);
+}
+END_TEST
+
+Suite *out_of_core_suite(void) {
+  Suite *s = suite_create("OUT_OF_CORE");
+  TCase *tc = tcase_create("out_of_core");
+
+  tcase_add_test(tc, ooc_build_matches_parser);
+  tcase_add_test(tc, ooc_budget_and_eviction);
+  tcase_add_test(tc, ooc_missing_files_and_bad_indices);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
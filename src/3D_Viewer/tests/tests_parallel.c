@@ -0,0 +1,156 @@
+#include <check.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parallel.h"
+
+#define COUNT 100003
+
+typedef struct Visits_t {
+  unsigned char *visits;
+  ParallelPriority_t priority;
+  int wrong_priority;
+} Visits_t;
+
+static void innerRange(void *context, long begin, long end) {
+  Visits_t *visits = context;
+  for (long i = begin; i < end; ++i) visits->visits[i]++;
+}
+
+// Outer items of 100 inner ones each, visited by nested loops
+static void outerRange(void *context, long begin, long end) {
+  Visits_t *visits = context;
+  if (parallelPriority() != visits->priority) visits->wrong_priority = 1;
+  for (long i = begin; i < end; ++i) {
+    Visits_t inner = {visits->visits + i * 100, visits->priority, 0};
+    parallelFor(100, 10, innerRange, &inner);
+  }
+}
+
+static void sumRange(void *context, long begin, long end, void *partial) {
+  const float *values = context;
+  float *sum = partial;
+  for (long i = begin; i < end; ++i) *sum += values[i];
+}
+
+static void addSums(void *context, void *result, const void *partial) {
+  (void)context;
+  *(float *)result += *(const float *)partial;
+}
+
+typedef struct Cancelling_t {
+  ParallelToken_t *token;
+  atomic_long done;
+} Cancelling_t;
+
+// The first range cancels the loop, the others wait for it
+static void cancelRange(void *context, long begin, long end) {
+  Cancelling_t *cancelling = context;
+  if (begin == 0) parallelTokenCancel(cancelling->token);
+  while (!parallelTokenCancelled(cancelling->token)) {
+  }
+  atomic_fetch_add(&cancelling->done, end - begin);
+}
+
+START_TEST(parallel_for_visits_every_item_once) {
+  unsigned char *visits = calloc(COUNT, 1);
+  for (int threads = 1; threads <= 4; threads += 3) {
+    parallelSetThreadCount(threads);
+    memset(visits, 0, COUNT);
+    Visits_t loop = {visits, PARALLEL_INTERACTIVE, 0};
+    parallelFor(COUNT, 7, innerRange, &loop);
+    for (long i = 0; i < COUNT; ++i) ck_assert_int_eq(visits[i], 1);
+    // Nested loops run at the priority of the thread that started them
+    memset(visits, 0, COUNT);
+    parallelSetPriority(PARALLEL_BACKGROUND);
+    loop.priority = PARALLEL_BACKGROUND;
+    parallelFor(COUNT / 100, 1, outerRange, &loop);
+    parallelSetPriority(PARALLEL_INTERACTIVE);
+    ck_assert_int_eq(parallelPriority(), PARALLEL_INTERACTIVE);
+    ck_assert_int_eq(loop.wrong_priority, 0);
+    for (long i = 0; i < COUNT / 100 * 100; ++i) {
+      ck_assert_int_eq(visits[i], 1);
+    }
+  }
+  parallelFor(0, 1, innerRange, NULL);
+  parallelSetThreadCount(0);
+  free(visits);
+}
+END_TEST
+
+START_TEST(parallel_reduce_is_independent_of_threads) {
+  float *values = malloc(COUNT * sizeof(float));
+  for (long i = 0; i < COUNT; ++i) values[i] = 1.0f / (float)(i % 97 + 1);
+  float sums[3];
+  const int threads[3] = {1, 2, 4};
+  for (int t = 0; t < 3; ++t) {
+    parallelSetThreadCount(threads[t]);
+    sums[t] = 0.0f;
+    ck_assert_int_eq(parallelReduce(COUNT, 64, sumRange, addSums, values,
+                                    &sums[t], sizeof(float)),
+                     0);
+  }
+  ck_assert(memcmp(&sums[0], &sums[1], sizeof(float)) == 0);
+  ck_assert(memcmp(&sums[0], &sums[2], sizeof(float)) == 0);
+  ck_assert_float_eq_tol(sums[0], COUNT / 97.0f * 5.1973f, 50.0f);
+  // The identity is kept for an empty range
+  float empty = 3.0f;
+  parallelReduce(0, 1, sumRange, addSums, values, &empty, sizeof(float));
+  ck_assert_float_eq(empty, 3.0f);
+  parallelSetThreadCount(0);
+  free(values);
+}
+END_TEST
+
+START_TEST(parallel_tokens_cancel_and_stats_count) {
+  parallelSetThreadCount(4);
+  unsigned char *visits = calloc(COUNT, 1);
+  Visits_t loop = {visits, PARALLEL_INTERACTIVE, 0};
+  parallelFor(COUNT, 1000, innerRange, &loop);
+  parallelResetStats();
+  ParallelStats_t stats;
+  parallelGetStats(&stats);
+  ck_assert_int_eq(stats.threads, 4);
+  ck_assert_int_eq(stats.loops, 0);
+
+  Cancelling_t cancelling = {parallelTokenCreate(), 0};
+  ck_assert_int_eq(parallelForCancellable(COUNT, 1000, cancelRange,
+                                          &cancelling, cancelling.token),
+                   -1);
+  ck_assert_int_gt(atomic_load(&cancelling.done), 0);
+  ck_assert_int_lt(atomic_load(&cancelling.done), COUNT);
+  // A cancelled token skips even a loop run inline
+  ck_assert_int_eq(parallelForCancellable(10, 1000, innerRange, &loop,
+                                          cancelling.token),
+                   -1);
+  ck_assert_int_eq(visits[0], 1);
+  parallelTokenDestroy(cancelling.token);
+  ck_assert_int_eq(parallelForCancellable(COUNT, 1000, innerRange, &loop,
+                                          NULL),
+                   0);
+
+  parallelGetStats(&stats);
+  ck_assert_int_eq(stats.loops, 2);
+  ck_assert_int_ge(stats.tasks, 2);
+  ck_assert_int_gt(stats.cancelled, 0);
+  ck_assert_int_ge(stats.steals, 0);
+  ck_assert(stats.elapsed_ns > 0.0);
+  ck_assert(stats.utilization >= 0.0);
+  parallelSetThreadCount(0);
+  free(visits);
+}
+END_TEST
+
+Suite *parallel_suite(void) {
+  Suite *s = suite_create("Parallel");
+  TCase *tc = tcase_create("parallel");
+
+  tcase_add_test(tc, parallel_for_visits_every_item_once);
+  tcase_add_test(tc, parallel_reduce_is_independent_of_threads);
+  tcase_add_test(tc, parallel_tokens_cancel_and_stats_count);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -2,7 +2,9 @@
 #include <check.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../backend.h"
 
@@ -11,9 +13,9 @@ bool float_arrays_equal(const float *a, const float *b, int len, float epsilon);
 START_TEST(parse_f) {
   const char *testFilename = "tests/test_f.obj";
   float *testVertices = NULL;
-  int n_vertices = 0;
+  long long n_vertices = 0;
   unsigned int *testIndices = NULL;
-  int n_indices = 0;
+  long long n_indices = 0;
 
   parseObjFile(testFilename, &testVertices, &n_vertices, &testIndices,
                &n_indices);
@@ -45,9 +47,9 @@ END_TEST
 START_TEST(parse_l) {
   const char *testFilename = "tests/test_l.obj";
   float *testVertices = NULL;
-  int n_vertices = 0;
+  long long n_vertices = 0;
   unsigned int *testIndices = NULL;
-  int n_indices = 0;
+  long long n_indices = 0;
 
   parseObjFile(testFilename, &testVertices, &n_vertices, &testIndices,
                &n_indices);
@@ -77,9 +79,9 @@ END_TEST
 START_TEST(parse_f_dashes) {
   const char *testFilename = "tests/test_f_dashes.obj";
   float *testVertices = NULL;
-  int n_vertices = 0;
+  long long n_vertices = 0;
   unsigned int *testIndices = NULL;
-  int n_indices = 0;
+  long long n_indices = 0;
 
   parseObjFile(testFilename, &testVertices, &n_vertices, &testIndices,
                &n_indices);
@@ -108,6 +110,30 @@ START_TEST(parse_f_dashes) {
 }
 END_TEST
 
+START_TEST(parse_indices_past_int_max) {
+  const char *testFilename = "tests/test_large_indices.obj";
+  FILE *file = fopen(testFilename, "w");
+  fprintf(file, "v 0 0 0\nv 1 1 1\nl 1 2\nl 1 3000000000\n");
+  fclose(file);
+  float *testVertices = NULL;
+  long long n_vertices = 0;
+  unsigned int *testIndices = NULL;
+  long long n_indices = 0;
+
+  ck_assert_int_eq(parseObjFile(testFilename, &testVertices, &n_vertices,
+                                &testIndices, &n_indices),
+                   -1);
+
+  // Index values above INT_MAX keep their 32-bit unsigned value
+  LoadError_t error;
+  getLoadError(&error);
+  ck_assert_int_eq(error.code, LOAD_ERROR_INDEX);
+  ck_assert_int_eq(error.line, 4);
+  ck_assert_ptr_nonnull(strstr(error.message, "vertex 3000000000 "));
+  remove(testFilename);
+}
+END_TEST
+
 Suite *parse_suite(void) {
   Suite *s = suite_create("PARSE");
   TCase *tc = tcase_create("parse");
@@ -115,6 +141,7 @@ Suite *parse_suite(void) {
   tcase_add_test(tc, parse_f);
   tcase_add_test(tc, parse_l);
   tcase_add_test(tc, parse_f_dashes);
+  tcase_add_test(tc, parse_indices_past_int_max);
 
   suite_add_tcase(s, tc);
 
@@ -0,0 +1,137 @@
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../point_cloud.h"
+
+#define CLOUD_POINTS 20000
+
+// Points in the cube from -0.5 to 0.5, coordinates on a grid of 1/1024
+static float *createPoints(int n) {
+  float *vertices = malloc((size_t)n * 3 * sizeof(float));
+  unsigned int state = 43;
+  for (int i = 0; i < n * 3; ++i) {
+    state = state * 1664525u + 1013904223u;
+    vertices[i] = (float)(state >> 22) / 1024.0f - 0.5f;
+  }
+  return vertices;
+}
+
+static int comparePoints(const void *a, const void *b) {
+  return memcmp(a, b, 3 * sizeof(float));
+}
+
+static void checkCloud(const PointCloud_t *cloud, const float *vertices,
+                       int n) {
+  ck_assert_int_eq(cloud->n_points, n);
+  float *expected = malloc((size_t)n * 3 * sizeof(float));
+  float *actual = malloc((size_t)n * 3 * sizeof(float));
+  memcpy(expected, vertices, (size_t)n * 3 * sizeof(float));
+  memcpy(actual, cloud->positions, (size_t)n * 3 * sizeof(float));
+  qsort(expected, n, 3 * sizeof(float), comparePoints);
+  qsort(actual, n, 3 * sizeof(float), comparePoints);
+  ck_assert_int_eq(memcmp(expected, actual, (size_t)n * 3 * sizeof(float)),
+                   0);
+  free(expected);
+  free(actual);
+
+  // Node ranges tile the positions, each point inside its node's box
+  int *owner = calloc(n, sizeof(int));
+  for (int index = 0; index < cloud->n_nodes; ++index) {
+    const PointCloudNode_t *node = &cloud->nodes[index];
+    if (node->n_children > 0) {
+      ck_assert_int_eq(node->count, POINT_CLOUD_NODE_POINTS);
+    }
+    for (int i = node->first; i < node->first + node->count; ++i) {
+      ck_assert_int_eq(owner[i]++, 0);
+      for (int axis = 0; axis < 3; ++axis) {
+        ck_assert(cloud->positions[i * 3 + axis] >= node->min[axis]);
+        ck_assert(cloud->positions[i * 3 + axis] <= node->max[axis]);
+      }
+    }
+    for (int c = 0; c < node->n_children; ++c) {
+      const PointCloudNode_t *child = &cloud->nodes[node->first_child + c];
+      ck_assert_int_gt(child->first, node->first);
+      for (int axis = 0; axis < 3; ++axis) {
+        ck_assert(child->min[axis] >= node->min[axis]);
+        ck_assert(child->max[axis] <= node->max[axis]);
+      }
+    }
+  }
+  for (int i = 0; i < n; ++i) ck_assert_int_eq(owner[i], 1);
+  free(owner);
+}
+
+START_TEST(point_cloud_build_keeps_every_point) {
+  float *vertices = createPoints(CLOUD_POINTS);
+  PointCloud_t cloud;
+  ck_assert_int_eq(pointCloudBuild(vertices, CLOUD_POINTS, &cloud), 0);
+  ck_assert_int_gt(cloud.n_nodes, 1);
+  ck_assert_int_gt(cloud.depth, 0);
+  checkCloud(&cloud, vertices, CLOUD_POINTS);
+  pointCloudFree(&cloud);
+  ck_assert_ptr_null(cloud.positions);
+
+  // Points that never split end in a leaf at the deepest level
+  for (int i = 0; i < CLOUD_POINTS * 3; ++i) vertices[i] = 1.0f;
+  ck_assert_int_eq(pointCloudBuild(vertices, CLOUD_POINTS, &cloud), 0);
+  ck_assert_int_le(cloud.depth, POINT_CLOUD_MAX_DEPTH);
+  checkCloud(&cloud, vertices, CLOUD_POINTS);
+  pointCloudFree(&cloud);
+
+  ck_assert_int_eq(pointCloudBuild(vertices, 0, &cloud), 0);
+  ck_assert_int_eq(cloud.n_nodes, 0);
+  free(vertices);
+}
+END_TEST
+
+START_TEST(point_cloud_select_respects_budget) {
+  float *vertices = createPoints(CLOUD_POINTS);
+  PointCloud_t cloud;
+  ck_assert_int_eq(pointCloudBuild(vertices, CLOUD_POINTS, &cloud), 0);
+  float mvp[16] = {0};
+  for (int i = 0; i < 4; ++i) mvp[i * 5] = 1.0f;
+  PointCloudFrame_t frame;
+
+  // Close up with no limit everything is drawn
+  pointCloudSelect(&cloud, mvp, 100000, CLOUD_POINTS, &frame);
+  ck_assert_int_eq(frame.drawn_points, CLOUD_POINTS);
+  ck_assert_int_eq(frame.drawn_nodes, cloud.n_nodes);
+  ck_assert_int_eq(frame.budget_reached, 0);
+  ck_assert_int_eq(cloud.draw[0], 0);
+
+  // The budget stops refinement, the root is drawn in any case
+  pointCloudSelect(&cloud, mvp, 100000, 5000, &frame);
+  ck_assert_int_le(frame.drawn_points, 5000);
+  ck_assert_int_eq(frame.budget_reached, 1);
+  pointCloudSelect(&cloud, mvp, 100000, 0, &frame);
+  ck_assert_int_eq(frame.drawn_nodes, 1);
+  ck_assert_int_eq(frame.drawn_points, POINT_CLOUD_NODE_POINTS);
+
+  // Far away the root's points are already closer than a pixel
+  pointCloudSelect(&cloud, mvp, 10, CLOUD_POINTS, &frame);
+  ck_assert_int_eq(frame.drawn_nodes, 1);
+  ck_assert_int_eq(frame.budget_reached, 0);
+
+  // Out of view nothing is drawn
+  mvp[12] = 10.0f;
+  pointCloudSelect(&cloud, mvp, 100000, CLOUD_POINTS, &frame);
+  ck_assert_int_eq(frame.drawn_nodes, 0);
+  ck_assert_int_eq(cloud.n_draw, 0);
+
+  pointCloudFree(&cloud);
+  free(vertices);
+}
+END_TEST
+
+Suite *point_cloud_suite(void) {
+  Suite *s = suite_create("POINT_CLOUD");
+  TCase *tc = tcase_create("point_cloud");
+
+  tcase_add_test(tc, point_cloud_build_keeps_every_point);
+  tcase_add_test(tc, point_cloud_select_respects_budget);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
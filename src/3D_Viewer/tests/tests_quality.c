@@ -0,0 +1,71 @@
+#include <check.h>
+#include <string.h>
+
+#include "../quality.h"
+
+static QualityLevel_t recordFrames(QualityGovernor_t *governor, int frames,
+                                   double frame_ns) {
+  QualityLevel_t level = governor->level;
+  for (int i = 0; i < frames; ++i) {
+    level = qualityRecordFrame(governor, frame_ns);
+  }
+  return level;
+}
+
+START_TEST(quality_governor_steps) {
+  QualityGovernor_t governor;
+  qualityInit(&governor, 16e6);
+  ck_assert_int_eq(governor.level, QUALITY_FULL);
+
+  // Frames within the target keep the level
+  ck_assert_int_eq(recordFrames(&governor, 20, 12e6), QUALITY_FULL);
+  // A window over the target lowers it one step at a time
+  ck_assert_int_eq(recordFrames(&governor, QUALITY_WINDOW - 1, 20e6),
+                   QUALITY_FULL);
+  ck_assert_int_eq(recordFrames(&governor, 1, 20e6), QUALITY_POINT_GLYPHS);
+  ck_assert_int_eq(recordFrames(&governor, QUALITY_WINDOW, 20e6),
+                   QUALITY_NO_GLYPHS);
+  // Between the raise ratio and the target nothing changes
+  ck_assert_int_eq(recordFrames(&governor, 20, 10e6), QUALITY_NO_GLYPHS);
+  // Fast frames raise it again
+  ck_assert_int_eq(recordFrames(&governor, QUALITY_WINDOW, 2e6),
+                   QUALITY_POINT_GLYPHS);
+
+  // An overloaded frame lowers it at once, down to the last level
+  ck_assert_int_eq(qualityRecordFrame(&governor, 100e6), QUALITY_NO_GLYPHS);
+  ck_assert_int_eq(recordFrames(&governor, 10, 100e6),
+                   QUALITY_REDUCED_RESOLUTION);
+
+  qualityRestore(&governor);
+  ck_assert_int_eq(governor.level, QUALITY_FULL);
+  ck_assert_int_eq(governor.n_frames, 0);
+  ck_assert_str_eq(qualityLevelName(QUALITY_COARSE_EDGES), "coarse edges");
+  ck_assert_str_eq(qualityLevelName(QUALITY_LEVEL_COUNT), "unknown");
+}
+END_TEST
+
+START_TEST(quality_edge_subset) {
+  unsigned int indices[18];
+  for (int i = 0; i < 18; ++i) indices[i] = (unsigned int)i;
+  unsigned int subset[18];
+  // Edges 0, 4 and 8 of 9
+  ck_assert_int_eq(
+      qualityEdgeSubset(indices, 18, QUALITY_EDGE_STRIDE, subset), 6);
+  const unsigned int expected[6] = {0, 1, 8, 9, 16, 17};
+  ck_assert_int_eq(memcmp(subset, expected, sizeof(expected)), 0);
+  ck_assert_int_eq(qualityEdgeSubset(indices, 18, 1, subset), 18);
+  ck_assert_int_eq(qualityEdgeSubset(indices, 0, 4, subset), 0);
+}
+END_TEST
+
+Suite *quality_suite(void) {
+  Suite *s = suite_create("QUALITY");
+  TCase *tc = tcase_create("quality");
+
+  tcase_add_test(tc, quality_governor_steps);
+  tcase_add_test(tc, quality_edge_subset);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,139 @@
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../memory_stats.h"
+#include "../reorder.h"
+
+static float *copyVertices(const float *source, int n_vertices) {
+  float *vertices =
+      memAccountMalloc(MEM_VERTICES, n_vertices * 3 * sizeof(float));
+  memcpy(vertices, source, n_vertices * 3 * sizeof(float));
+  return vertices;
+}
+
+START_TEST(reorder_keeps_segments) {
+  // Corners of a unit square listed out of spatial order
+  const float source[] = {1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+                          1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+  const unsigned int original[] = {0, 2, 2, 1, 1, 3, 3, 0};
+  unsigned int indices[8];
+  memcpy(indices, original, sizeof(indices));
+  float *vertices = copyVertices(source, 4);
+  ReorderStats_t stats;
+
+  ck_assert_int_eq(reorderModel(&vertices, 4, indices, 8, &stats), 0);
+
+  // The origin has the smallest Morton code
+  ck_assert_float_eq_tol(vertices[0], 0.0f, 1e-6);
+  ck_assert_float_eq_tol(vertices[1], 0.0f, 1e-6);
+  // Every segment still joins the same two points
+  for (int s = 0; s < 4; ++s) {
+    const float *a = &vertices[indices[s * 2] * 3];
+    const float *b = &vertices[indices[s * 2 + 1] * 3];
+    int found = 0;
+    for (int k = 0; k < 4; ++k) {
+      const float *p = &source[original[k * 2] * 3];
+      const float *q = &source[original[k * 2 + 1] * 3];
+      found |= memcmp(a, p, 12) == 0 && memcmp(b, q, 12) == 0;
+    }
+    ck_assert(found);
+  }
+  // Segments are sorted by their smaller vertex index
+  for (int s = 1; s < 4; ++s) {
+    const unsigned int previous = indices[s * 2 - 2] < indices[s * 2 - 1]
+                                      ? indices[s * 2 - 2]
+                                      : indices[s * 2 - 1];
+    const unsigned int current = indices[s * 2] < indices[s * 2 + 1]
+                                     ? indices[s * 2]
+                                     : indices[s * 2 + 1];
+    ck_assert_uint_le(previous, current);
+  }
+  freeModelC(vertices, 4, NULL, 0);
+}
+END_TEST
+
+START_TEST(reorder_improves_locality) {
+  // A 64 x 64 grid with vertices in a scrambled order
+  const int side = 64;
+  const int n_vertices = side * side;
+  float *source = malloc(n_vertices * 3 * sizeof(float));
+  int *slot = malloc(n_vertices * sizeof(int));
+  for (int i = 0; i < n_vertices; ++i) {
+    slot[i] = (int)((i * 1031L) % n_vertices);
+  }
+  for (int i = 0; i < n_vertices; ++i) {
+    source[slot[i] * 3] = (float)(i % side) / side;
+    source[slot[i] * 3 + 1] = (float)(i / side) / side;
+    source[slot[i] * 3 + 2] = 0.0f;
+  }
+  const int n_indices = (side - 1) * side * 2;
+  unsigned int *indices = malloc(n_indices * sizeof(unsigned int));
+  int k = 0;
+  for (int row = 0; row < side; ++row) {
+    for (int column = 0; column + 1 < side; ++column) {
+      indices[k++] = slot[row * side + column];
+      indices[k++] = slot[row * side + column + 1];
+    }
+  }
+  float *vertices = copyVertices(source, n_vertices);
+  const long long live_before = memAccountTotalLive();
+  ReorderStats_t stats;
+
+  reorderModel(&vertices, n_vertices, indices, n_indices, &stats);
+
+  ck_assert(stats.edge_span_after * 10.0 < stats.edge_span_before);
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+  freeModelC(vertices, n_vertices, NULL, 0);
+  free(source);
+  free(slot);
+  free(indices);
+}
+END_TEST
+
+START_TEST(reorder_keeps_triangles) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  parseObjFile("tests/test_f.obj", &vertices, &n_vertices, &indices,
+               &n_indices);
+  ck_assert_int_eq(n_indices, 72);
+
+  ck_assert_int_eq(
+      reorderModel(&vertices, n_vertices, indices, n_indices, NULL), 0);
+
+  // Each face is still written as the segments a-b, b-c, c-a
+  for (long long k = 0; k < n_indices; k += 6) {
+    ck_assert_uint_eq(indices[k + 1], indices[k + 2]);
+    ck_assert_uint_eq(indices[k + 3], indices[k + 4]);
+    ck_assert_uint_eq(indices[k + 5], indices[k]);
+  }
+  freeModelC(vertices, n_vertices, indices, n_indices);
+}
+END_TEST
+
+START_TEST(reorder_empty_model) {
+  float *vertices = NULL;
+  ReorderStats_t stats;
+
+  ck_assert_int_eq(reorderModel(&vertices, 0, NULL, 0, &stats), 0);
+  ck_assert(vertices == NULL);
+  ck_assert_double_eq_tol(stats.edge_span_after, 0.0, 1e-9);
+}
+END_TEST
+
+Suite *reorder_suite(void) {
+  Suite *s = suite_create("REORDER");
+  TCase *tc = tcase_create("reorder");
+
+  tcase_add_test(tc, reorder_keeps_segments);
+  tcase_add_test(tc, reorder_improves_locality);
+  tcase_add_test(tc, reorder_keeps_triangles);
+  tcase_add_test(tc, reorder_empty_model);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -1,4 +1,5 @@
 #include <check.h>
+#include <math.h>
 
 #include "../backend.h"
 
@@ -299,6 +300,33 @@ START_TEST(rotate_z2) {
 }
 END_TEST
 
+START_TEST(transform_matches_separate_passes) {
+  float vertices[] = {0.0f, 0.0f, 0.0f, 1.0f, -0.5f,  0.25f,
+                      0.3f, 0.7f, 1.0f, -1.0f, 0.125f, 0.5f};
+  float expected[12];
+  const int n_vertices = 4;
+  const float angle = M_PI / 6;
+  for (int i = 0; i < n_vertices * 3; i += 3) {
+    rotateX(angle, vertices[i + 0], vertices[i + 1], vertices[i + 2],
+            &expected[i + 0], &expected[i + 1], &expected[i + 2]);
+  }
+  scaleModelC(expected, n_vertices, 2.0f);
+  moveModelC(expected, n_vertices, 1.0f, 2.0f, 3.0f);
+
+  // The rotation, then the scale, then the move, column-major
+  const float c = cosf(angle);
+  const float s = sinf(angle);
+  const float matrix[16] = {2.0f, 0.0f,      0.0f,     0.0f,
+                            0.0f, 2.0f * c,  2.0f * s, 0.0f,
+                            0.0f, -2.0f * s, 2.0f * c, 0.0f,
+                            1.0f, 2.0f,      3.0f,     1.0f};
+  transformModelC(vertices, n_vertices, matrix);
+
+  for (int i = 0; i < n_vertices * 3; ++i)
+    ck_assert_float_eq_tol(vertices[i], expected[i], 1e-5);
+}
+END_TEST
+
 Suite *rotation_suite(void) {
   Suite *s = suite_create("ROTATE");
   TCase *tc = tcase_create("rotate");
@@ -312,6 +340,7 @@ Suite *rotation_suite(void) {
   tcase_add_test(tc, rotate_z0);
   tcase_add_test(tc, rotate_z1);
   tcase_add_test(tc, rotate_z2);
+  tcase_add_test(tc, transform_matches_separate_passes);
 
   suite_add_tcase(s, tc);
 
@@ -0,0 +1,72 @@
+#include <check.h>
+#include <stdlib.h>
+
+#include "../backend.h"
+#include "../stage_timer.h"
+
+START_TEST(stage_timer_scale_and_move) {
+  float vertices[] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  stageTimerReset();
+
+  scaleModelC(vertices, 2, 2.0f);
+  scaleModelC(vertices, 2, 0.5f);
+  moveModelC(vertices, 2, 1.0f, 0.0f, 0.0f);
+
+  const StageTiming_t *scale = stageTimerGet(STAGE_SCALE);
+  const StageTiming_t *move = stageTimerGet(STAGE_MOVE);
+  ck_assert_int_eq(scale->calls, 2);
+  ck_assert_int_eq(scale->items, 4);
+  ck_assert_int_eq(move->calls, 1);
+  ck_assert_int_eq(move->items, 2);
+  ck_assert(scale->total_ns >= scale->last_ns);
+  ck_assert(scale->max_ns >= scale->last_ns);
+  ck_assert_str_eq(move->name, "move");
+}
+END_TEST
+
+START_TEST(stage_timer_parse) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  stageTimerReset();
+
+  parseObjFile("tests/test_f.obj", &vertices, &n_vertices, &indices,
+               &n_indices);
+
+  const StageTiming_t *total = stageTimerGet(STAGE_PARSE_TOTAL);
+  const StageTiming_t *count = stageTimerGet(STAGE_PARSE_COUNT);
+  const StageTiming_t *fill = stageTimerGet(STAGE_PARSE_FILL);
+  ck_assert_int_eq(total->calls, 1);
+  ck_assert_int_eq(total->items, n_vertices);
+  ck_assert_int_eq(count->calls, 1);
+  ck_assert_int_eq(fill->calls, 1);
+  ck_assert(total->last_ns >= count->last_ns + fill->last_ns);
+
+  free(vertices);
+  free(indices);
+}
+END_TEST
+
+START_TEST(stage_timer_reset) {
+  float vertices[] = {1.0f, 2.0f, 3.0f};
+  scaleModelC(vertices, 1, 2.0f);
+  stageTimerReset();
+
+  ck_assert_int_eq(stageTimerGet(STAGE_SCALE)->calls, 0);
+  ck_assert(stageTimerGet(STAGE_COUNT) == NULL);
+}
+END_TEST
+
+Suite *stage_timer_suite(void) {
+  Suite *s = suite_create("STAGE_TIMER");
+  TCase *tc = tcase_create("stage_timer");
+
+  tcase_add_test(tc, stage_timer_scale_and_move);
+  tcase_add_test(tc, stage_timer_parse);
+  tcase_add_test(tc, stage_timer_reset);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
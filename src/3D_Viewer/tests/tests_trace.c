@@ -0,0 +1,126 @@
+#include <check.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../trace.h"
+
+START_TEST(trace_disabled_records_nothing) {
+  traceEnable(1);
+  traceEnable(0);
+  float vertices[] = {1.0f, 2.0f, 3.0f};
+
+  scaleModelC(vertices, 1, 2.0f);
+  TRACE_BEGIN(span);
+  TRACE_END(span, "unused");
+
+  ck_assert_int_eq(traceEventCount(), 0);
+}
+END_TEST
+
+START_TEST(trace_records_spans) {
+  float vertices[] = {1.0f, 2.0f, 3.0f};
+  traceEnable(1);
+
+  scaleModelC(vertices, 1, 2.0f);
+  moveModelC(vertices, 1, 1.0f, 1.0f, 1.0f);
+  TRACE_BEGIN(span);
+  TRACE_END(span, "custom");
+  traceEnable(0);
+
+  ck_assert_int_eq(traceEventCount(), 3);
+}
+END_TEST
+
+START_TEST(trace_dump_chrome_format) {
+  float *vertices = NULL;
+  unsigned int *indices = NULL;
+  long long n_vertices = 0;
+  long long n_indices = 0;
+  traceEnable(1);
+  traceSetThreadName("tests");
+  parseObjFile("tests/test_f.obj", &vertices, &n_vertices, &indices,
+               &n_indices);
+  traceEnable(0);
+
+  const char *path = "tests_trace_dump.json";
+  ck_assert_int_eq(traceDump(path), 0);
+  FILE *file = fopen(path, "r");
+  ck_assert_ptr_nonnull(file);
+  char text[8192] = {0};
+  size_t length = fread(text, 1, sizeof(text) - 1, file);
+  fclose(file);
+  remove(path);
+
+  ck_assert(length > 0);
+  ck_assert(strstr(text, "\"traceEvents\"") != NULL);
+  ck_assert(strstr(text, "\"name\": \"parseObjFile\"") != NULL);
+  ck_assert(strstr(text, "\"name\": \"parse.count\"") != NULL);
+  ck_assert(strstr(text, "\"name\": \"parse.index\"") != NULL);
+  ck_assert(strstr(text, "\"name\": \"parse.normalize\"") != NULL);
+  ck_assert(strstr(text, "\"name\": \"tests\"") != NULL);
+  ck_assert(strstr(text, "\"ph\": \"X\"") != NULL);
+
+  free(vertices);
+  free(indices);
+}
+END_TEST
+
+// Names itself and, while tracing, records one span before it exits
+static void *namedThread(void *name) {
+  traceSetThreadName(name);
+  TRACE_BEGIN(span);
+  TRACE_END(span, "thread.span");
+  return NULL;
+}
+
+static void runNamedThread(const char *name) {
+  pthread_t thread;
+  ck_assert_int_eq(pthread_create(&thread, NULL, namedThread, (void *)name),
+                   0);
+  pthread_join(thread, NULL);
+}
+
+START_TEST(trace_exited_threads_and_escaped_names) {
+  traceEnable(0);
+  // Naming a thread while tracing is off leaves nothing in the dump
+  runNamedThread("untraced");
+  traceEnable(1);
+  runNamedThread("reader \"one\"\n");
+  traceEnable(0);
+  ck_assert_int_eq(traceEventCount(), 1);
+
+  const char *path = "tests_trace_threads.json";
+  ck_assert_int_eq(traceDump(path), 0);
+  FILE *file = fopen(path, "r");
+  ck_assert_ptr_nonnull(file);
+  char text[8192] = {0};
+  fread(text, 1, sizeof(text) - 1, file);
+  fclose(file);
+  remove(path);
+
+  ck_assert(strstr(text, "untraced") == NULL);
+  ck_assert(strstr(text, "\"name\": \"reader \\\"one\\\"\\u000a\"") != NULL);
+  ck_assert(strstr(text, "\"name\": \"thread.span\"") != NULL);
+  // A new session drops the events of the exited thread
+  traceEnable(1);
+  traceEnable(0);
+  ck_assert_int_eq(traceEventCount(), 0);
+}
+END_TEST
+
+Suite *trace_suite(void) {
+  Suite *s = suite_create("TRACE");
+  TCase *tc = tcase_create("trace");
+
+  tcase_add_test(tc, trace_disabled_records_nothing);
+  tcase_add_test(tc, trace_records_spans);
+  tcase_add_test(tc, trace_dump_chrome_format);
+  tcase_add_test(tc, trace_exited_threads_and_escaped_names);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,156 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../backend.h"
+#include "../memory_stats.h"
+#include "../parallel.h"
+#include "../weld.h"
+
+static float *copyVertices(const float *source, int n_vertices) {
+  float *vertices =
+      memAccountMalloc(MEM_VERTICES, n_vertices * 3 * sizeof(float));
+  memcpy(vertices, source, n_vertices * 3 * sizeof(float));
+  return vertices;
+}
+
+START_TEST(weld_exact_duplicates) {
+  const float source[] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                          0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+  unsigned int indices[] = {0, 1, 2, 3, 3, 0};
+  long long n_vertices = 4;
+  float *vertices = copyVertices(source, n_vertices);
+  WeldStats_t stats;
+
+  ck_assert_int_eq(weldVertices(&vertices, &n_vertices, indices, 6,
+                                WELD_DEFAULT_EPSILON, &stats),
+                   0);
+
+  ck_assert_int_eq(n_vertices, 2);
+  ck_assert_int_eq(stats.vertices_in, 4);
+  ck_assert_int_eq(stats.vertices_out, 2);
+  ck_assert_double_eq_tol(stats.merge_ratio, 0.5, 1e-9);
+  const unsigned int expected[] = {0, 1, 0, 1, 1, 0};
+  for (int i = 0; i < 6; ++i) ck_assert_uint_eq(indices[i], expected[i]);
+  ck_assert_float_eq_tol(vertices[3], 1.0f, 1e-6);
+  freeModelC(vertices, n_vertices, NULL, 0);
+}
+END_TEST
+
+START_TEST(weld_within_epsilon) {
+  // The second vertex is closer than epsilon, the third is not
+  const float source[] = {0.5f, 0.5f, 0.5f, 0.5005f, 0.5f, 0.5f,
+                          0.502f, 0.5f, 0.5f};
+  unsigned int indices[] = {0, 1, 1, 2};
+  long long n_vertices = 3;
+  float *vertices = copyVertices(source, n_vertices);
+
+  weldVertices(&vertices, &n_vertices, indices, 4, 1e-3f, NULL);
+
+  ck_assert_int_eq(n_vertices, 2);
+  ck_assert_uint_eq(indices[0], 0);
+  ck_assert_uint_eq(indices[1], 0);
+  ck_assert_uint_eq(indices[3], 1);
+  ck_assert_float_eq_tol(vertices[3], 0.502f, 1e-6);
+  freeModelC(vertices, n_vertices, NULL, 0);
+}
+END_TEST
+
+START_TEST(weld_thread_count_independent) {
+  const int n_source = 100000;
+  float *source = malloc(n_source * 3 * sizeof(float));
+  unsigned int *indices_single = malloc(n_source * sizeof(unsigned int));
+  unsigned int *indices_parallel = malloc(n_source * sizeof(unsigned int));
+  for (int i = 0; i < n_source; ++i) {
+    // Every position appears twice, the copy slightly displaced
+    const int position = i / 2;
+    const float offset = (i % 2) * 1e-7f;
+    source[i * 3] = (position % 100) / 100.0f + offset;
+    source[i * 3 + 1] = (position / 100 % 100) / 100.0f;
+    source[i * 3 + 2] = (position / 10000) / 100.0f;
+    indices_single[i] = indices_parallel[i] = (i * 7919) % n_source;
+  }
+  long long n_single = n_source;
+  long long n_parallel = n_source;
+  float *single = copyVertices(source, n_source);
+  float *parallel = copyVertices(source, n_source);
+
+  parallelSetThreadCount(1);
+  weldVertices(&single, &n_single, indices_single, n_source,
+               WELD_DEFAULT_EPSILON, NULL);
+  parallelSetThreadCount(4);
+  weldVertices(&parallel, &n_parallel, indices_parallel, n_source,
+               WELD_DEFAULT_EPSILON, NULL);
+  parallelSetThreadCount(0);
+
+  ck_assert_int_eq(n_single, n_source / 2);
+  ck_assert_int_eq(n_parallel, n_single);
+  ck_assert_int_eq(memcmp(single, parallel, n_single * 3 * sizeof(float)), 0);
+  ck_assert_int_eq(memcmp(indices_single, indices_parallel,
+                          n_source * sizeof(unsigned int)),
+                   0);
+  freeModelC(single, n_single, NULL, 0);
+  freeModelC(parallel, n_parallel, NULL, 0);
+  free(source);
+  free(indices_single);
+  free(indices_parallel);
+}
+END_TEST
+
+START_TEST(weld_keeps_accounting) {
+  const float source[] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+                          0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+  long long n_vertices = 4;
+  const long long live_before = memAccountTotalLive();
+  float *vertices = copyVertices(source, n_vertices);
+
+  weldVertices(&vertices, &n_vertices, NULL, 0, WELD_DEFAULT_EPSILON, NULL);
+  freeModelC(vertices, n_vertices, NULL, 0);
+
+  ck_assert_int_eq(memAccountTotalLive(), live_before);
+}
+END_TEST
+
+START_TEST(weld_empty_model) {
+  float *vertices = NULL;
+  long long n_vertices = 0;
+  WeldStats_t stats;
+
+  ck_assert_int_eq(weldVertices(&vertices, &n_vertices, NULL, 0,
+                                WELD_DEFAULT_EPSILON, &stats),
+                   0);
+  ck_assert_int_eq(stats.vertices_out, 0);
+  ck_assert(vertices == NULL);
+}
+END_TEST
+
+START_TEST(weld_rejects_counts_past_32_bits) {
+  float vertex[3] = {1.0f, 2.0f, 3.0f};
+  float *vertices = vertex;
+  // Only the count is checked, the array is never read
+  long long n_vertices = (long long)UINT32_MAX + 1;
+
+  ck_assert_int_eq(weldVertices(&vertices, &n_vertices, NULL, 0,
+                                WELD_DEFAULT_EPSILON, NULL),
+                   -1);
+  ck_assert(vertices == vertex);
+  ck_assert(n_vertices == (long long)UINT32_MAX + 1);
+}
+END_TEST
+
+Suite *weld_suite(void) {
+  Suite *s = suite_create("WELD");
+  TCase *tc = tcase_create("weld");
+
+  tcase_add_test(tc, weld_exact_duplicates);
+  tcase_add_test(tc, weld_within_epsilon);
+  tcase_add_test(tc, weld_thread_count_independent);
+  tcase_add_test(tc, weld_keeps_accounting);
+  tcase_add_test(tc, weld_empty_model);
+  tcase_add_test(tc, weld_rejects_counts_past_32_bits);
+
+  suite_add_tcase(s, tc);
+
+  return s;
+}
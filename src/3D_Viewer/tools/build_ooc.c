@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cpu_dispatch.h"
+#include "../out_of_core.h"
+
+static void printUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s MODEL.obj|- [-o STORE] [--chunk-vertices N]\n"
+          "          [--overview-grid N] [--overview-edges N]\n"
+          "The store defaults to MODEL.obj" OOC_STORE_SUFFIX
+          ", where the viewer looks for it.\n"
+          "With - the model is read from the standard input and -o is "
+          "needed.\n",
+          program);
+}
+
+static int parseArguments(int argc, char *argv[], OocBuildOptions_t *options,
+                          const char **store_path) {
+  for (int i = 2; i < argc; ++i) {
+    if (i + 1 >= argc) return -1;
+    const char *key = argv[i];
+    const char *value = argv[++i];
+    if (strcmp(key, "-o") == 0) {
+      *store_path = value;
+    } else if (strcmp(key, "--chunk-vertices") == 0) {
+      options->target_chunk_vertices = atol(value);
+    } else if (strcmp(key, "--overview-grid") == 0) {
+      options->overview_grid = atoi(value);
+    } else if (strcmp(key, "--overview-edges") == 0) {
+      options->max_overview_edges = atoi(value);
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  OocBuildOptions_t options;
+  oocBuildDefaults(&options);
+  cpuSetLevel(-1);
+  const char *store_path = NULL;
+  if (argc < 2 || parseArguments(argc, argv, &options, &store_path) != 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  char default_path[4096];
+  if (store_path == NULL && strcmp(argv[1], "-") == 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (store_path == NULL) {
+    snprintf(default_path, sizeof(default_path), "%s" OOC_STORE_SUFFIX,
+             argv[1]);
+    store_path = default_path;
+  }
+
+  OocBuildStats_t stats;
+  if (oocBuild(argv[1], store_path, &options, &stats) != 0) {
+    fprintf(stderr, "Failed to build %s from %s\n", store_path, argv[1]);
+    return 1;
+  }
+  fprintf(stderr,
+          "%lld vertices, %lld edges (%lld across chunks)\n"
+          "%d chunks, %d nodes, overview %d vertices %d edges\n"
+          "%lld bytes in %.2f s\n",
+          stats.vertices, stats.edges, stats.cross_edges, stats.chunks,
+          stats.nodes, stats.overview_vertices, stats.overview_edges,
+          stats.file_bytes, stats.elapsed_ns / 1e9);
+  return 0;
+}
@@ -0,0 +1,91 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "obj_generator.h"
+
+static void printUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s --vertices N [--faces N]\n"
+          "          [--topology grid|sphere|soup|lines]\n"
+          "          [--index-style v|vtn] [--format fixed|general]\n"
+          "          [--precision N] [--seed N] [-o FILE.obj | -o -]\n",
+          program);
+}
+
+static int parseEnum(const char *value, const char *const *names, int count) {
+  for (int i = 0; i < count; ++i)
+    if (strcmp(value, names[i]) == 0) return i;
+  return -1;
+}
+
+static int parseArguments(int argc, char *argv[],
+                          ObjGeneratorOptions_t *options, const char **path) {
+  static const char *kTopologies[] = {"grid", "sphere", "soup", "lines"};
+  static const char *kIndexStyles[] = {"v", "vtn"};
+  static const char *kFormats[] = {"fixed", "general"};
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) return -1;
+    const char *key = argv[i];
+    const char *value = argv[++i];
+    int choice = 0;
+    if (strcmp(key, "--vertices") == 0) {
+      options->n_vertices = atol(value);
+    } else if (strcmp(key, "--faces") == 0) {
+      options->n_faces = atol(value);
+    } else if (strcmp(key, "--topology") == 0 &&
+               (choice = parseEnum(value, kTopologies, 4)) >= 0) {
+      options->topology = (ObjTopology_t)choice;
+    } else if (strcmp(key, "--index-style") == 0 &&
+               (choice = parseEnum(value, kIndexStyles, 2)) >= 0) {
+      options->index_style = (ObjIndexStyle_t)choice;
+    } else if (strcmp(key, "--format") == 0 &&
+               (choice = parseEnum(value, kFormats, 2)) >= 0) {
+      options->float_format = (ObjFloatFormat_t)choice;
+    } else if (strcmp(key, "--precision") == 0) {
+      options->precision = atoi(value);
+    } else if (strcmp(key, "--seed") == 0) {
+      options->seed = strtoull(value, NULL, 10);
+    } else if (strcmp(key, "-o") == 0) {
+      *path = value;
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  ObjGeneratorOptions_t options;
+  objGeneratorDefaults(&options);
+  const char *path = "-";
+  if (argc < 2 || parseArguments(argc, argv, &options, &path) != 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ObjGeneratorStats_t stats;
+  int status = 0;
+  if (strcmp(path, "-") == 0) {
+    status = objGenerate(stdout, &options, &stats);
+    fflush(stdout);
+  } else {
+    status = objGenerateFile(path, &options, &stats);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if (status != 0) {
+    fprintf(stderr, "Failed to generate %s\n", path);
+    return 1;
+  }
+
+  const double seconds =
+      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  fprintf(stderr, "%ld vertices, %ld faces, %ld bytes in %.2f s (%.1f MB/s)\n",
+          stats.n_vertices, stats.n_faces, stats.n_bytes, seconds,
+          stats.n_bytes / seconds / 1e6);
+  return 0;
+}
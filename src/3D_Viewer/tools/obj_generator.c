@@ -0,0 +1,334 @@
+#include "obj_generator.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OBJ_WRITER_CAPACITY (1 << 20)
+#define OBJ_WRITER_SLACK 256
+
+static const double kPi = 3.14159265358979323846;
+
+/*!
+ * \brief ObjWriter_t
+ *
+ * Output is formatted into a 1 MiB buffer and written with one fwrite per
+ * buffer, so memory use is constant whatever the model size.
+ */
+typedef struct ObjWriter_t {
+  FILE *stream;
+  char buffer[OBJ_WRITER_CAPACITY];
+  size_t length;
+  long n_bytes;
+  int failed;
+  const ObjGeneratorOptions_t *options;
+} ObjWriter_t;
+
+static void writerFlush(ObjWriter_t *writer) {
+  if (writer->length == 0) return;
+  if (fwrite(writer->buffer, 1, writer->length, writer->stream) !=
+      writer->length) {
+    writer->failed = 1;
+  }
+  writer->n_bytes += (long)writer->length;
+  writer->length = 0;
+}
+
+static void writerReserve(ObjWriter_t *writer) {
+  if (writer->length + OBJ_WRITER_SLACK > OBJ_WRITER_CAPACITY) {
+    writerFlush(writer);
+  }
+}
+
+static void writerText(ObjWriter_t *writer, const char *text) {
+  const size_t n = strlen(text);
+  memcpy(writer->buffer + writer->length, text, n);
+  writer->length += n;
+}
+
+static void writerUnsigned(ObjWriter_t *writer, unsigned long long value) {
+  char digits[24];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (n > 0) writer->buffer[writer->length++] = digits[--n];
+}
+
+static void writerFloat(ObjWriter_t *writer, double value) {
+  const ObjGeneratorOptions_t *options = writer->options;
+  static const unsigned long long kPowers[] = {
+      1ULL,      10ULL,      100ULL,      1000ULL,      10000ULL,
+      100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL};
+  const int precision = options->precision;
+  const double magnitude = fabs(value);
+
+  if (options->float_format == OBJ_FLOAT_GENERAL || precision > 9 ||
+      magnitude * (double)kPowers[precision > 9 ? 9 : precision] > 9e18) {
+    const char *format = options->float_format == OBJ_FLOAT_GENERAL ? "%.*g"
+                                                                      : "%.*f";
+    const int limit = OBJ_WRITER_SLACK / 4;
+    int n = snprintf(writer->buffer + writer->length, limit, format, precision,
+                     value);
+    writer->length += (size_t)(n < limit ? n : limit - 1);
+    return;
+  }
+
+  const unsigned long long scale = kPowers[precision];
+  const unsigned long long scaled =
+      (unsigned long long)(magnitude * (double)scale + 0.5);
+  if (value < 0.0) writer->buffer[writer->length++] = '-';
+  writerUnsigned(writer, scaled / scale);
+  if (precision > 0) {
+    writer->buffer[writer->length++] = '.';
+    unsigned long long fraction = scaled % scale;
+    for (int i = precision - 1; i >= 0; --i) {
+      writer->buffer[writer->length + i] = (char)('0' + fraction % 10);
+      fraction /= 10;
+    }
+    writer->length += precision;
+  }
+}
+
+static void writerTriple(ObjWriter_t *writer, const char *tag, double x,
+                         double y, double z) {
+  writerReserve(writer);
+  writerText(writer, tag);
+  writerFloat(writer, x);
+  writer->buffer[writer->length++] = ' ';
+  writerFloat(writer, y);
+  writer->buffer[writer->length++] = ' ';
+  writerFloat(writer, z);
+  writer->buffer[writer->length++] = '\n';
+}
+
+static void writerFaceIndex(ObjWriter_t *writer, long index) {
+  writer->buffer[writer->length++] = ' ';
+  writerUnsigned(writer, (unsigned long long)index);
+  if (writer->options->index_style == OBJ_INDEX_V_VT_VN) {
+    writer->buffer[writer->length++] = '/';
+    writerUnsigned(writer, (unsigned long long)index);
+    writer->buffer[writer->length++] = '/';
+    writerUnsigned(writer, (unsigned long long)index);
+  }
+}
+
+// Indices are zero-based here and written one-based.
+static void writerFace(ObjWriter_t *writer, long a, long b, long c) {
+  writerReserve(writer);
+  writer->buffer[writer->length++] = 'f';
+  writerFaceIndex(writer, a + 1);
+  writerFaceIndex(writer, b + 1);
+  writerFaceIndex(writer, c + 1);
+  writer->buffer[writer->length++] = '\n';
+}
+
+static void writerLine(ObjWriter_t *writer, long a, long b) {
+  writerReserve(writer);
+  writer->buffer[writer->length++] = 'l';
+  writer->buffer[writer->length++] = ' ';
+  writerUnsigned(writer, (unsigned long long)(a + 1));
+  writer->buffer[writer->length++] = ' ';
+  writerUnsigned(writer, (unsigned long long)(b + 1));
+  writer->buffer[writer->length++] = '\n';
+}
+
+/*!
+ * \brief nextRandom
+ *
+ * splitmix64: the whole output depends only on the seed, so the same options
+ * always produce a byte-identical file.
+ */
+static unsigned long long nextRandom(unsigned long long *state) {
+  unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static double randomUnit(unsigned long long *state) {
+  return (double)(nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static long gridSide(long n_vertices) {
+  long side = (long)ceil(sqrt((double)n_vertices));
+  return side < 1 ? 1 : side;
+}
+
+static void writeVertices(ObjWriter_t *writer, unsigned long long *random) {
+  const ObjGeneratorOptions_t *options = writer->options;
+  const long n = options->n_vertices;
+  const long side = gridSide(n);
+  const long rows = (n + side - 1) / side;
+  double walk[3] = {0.0, 0.0, 0.0};
+
+  for (long i = 0; i < n; ++i) {
+    const long column = i % side;
+    const long row = i / side;
+    double p[3] = {0.0, 0.0, 0.0};
+    double normal[3] = {0.0, 0.0, 1.0};
+
+    if (options->topology == OBJ_TOPOLOGY_GRID) {
+      p[0] = (double)column;
+      p[1] = (double)row;
+      p[2] = (double)((float)((column * 7 + row * 13) % 17) * 0.1f);
+    } else if (options->topology == OBJ_TOPOLOGY_SPHERE) {
+      const double theta = rows > 1 ? kPi * row / (rows - 1) : 0.0;
+      const double phi = 2.0 * kPi * column / side;
+      p[0] = sin(theta) * cos(phi);
+      p[1] = cos(theta);
+      p[2] = sin(theta) * sin(phi);
+      memcpy(normal, p, sizeof(normal));
+    } else if (options->topology == OBJ_TOPOLOGY_SOUP) {
+      for (int axis = 0; axis < 3; ++axis) p[axis] = randomUnit(random) * 2 - 1;
+    } else {
+      for (int axis = 0; axis < 3; ++axis) {
+        walk[axis] += (randomUnit(random) - 0.5) * 0.1;
+        p[axis] = walk[axis];
+      }
+    }
+
+    writerTriple(writer, "v ", p[0], p[1], p[2]);
+    if (options->index_style == OBJ_INDEX_V_VT_VN &&
+        options->topology != OBJ_TOPOLOGY_LINES) {
+      writerReserve(writer);
+      writerText(writer, "vt ");
+      writerFloat(writer, (double)column / side);
+      writer->buffer[writer->length++] = ' ';
+      writerFloat(writer, rows > 1 ? (double)row / (rows - 1) : 0.0);
+      writer->buffer[writer->length++] = '\n';
+      writerTriple(writer, "vn ", normal[0], normal[1], normal[2]);
+    }
+  }
+}
+
+static long writeSurfaceFaces(ObjWriter_t *writer, long limit) {
+  const ObjGeneratorOptions_t *options = writer->options;
+  const long n = options->n_vertices;
+  const long side = gridSide(n);
+  const int wrap = options->topology == OBJ_TOPOLOGY_SPHERE;
+  long written = 0;
+
+  for (long row = 0; (row + 1) * side < n; ++row) {
+    for (long column = 0; column < side; ++column) {
+      if (!wrap && column + 1 >= side) break;
+      const long next = (column + 1) % side;
+      const long a = row * side + column;
+      const long b = row * side + next;
+      const long c = a + side;
+      const long d = b + side;
+      if (c >= n || d >= n) continue;
+      if (limit >= 0 && written >= limit) return written;
+      writerFace(writer, a, b, d);
+      ++written;
+      if (limit >= 0 && written >= limit) return written;
+      writerFace(writer, a, d, c);
+      ++written;
+    }
+  }
+  return written;
+}
+
+static long writeSoupFaces(ObjWriter_t *writer, unsigned long long *random) {
+  const long n = writer->options->n_vertices;
+  const long count =
+      writer->options->n_faces >= 0 ? writer->options->n_faces : 2 * n;
+  for (long i = 0; i < count && n > 0; ++i) {
+    const long a = (long)(nextRandom(random) % (unsigned long long)n);
+    const long b = (long)(nextRandom(random) % (unsigned long long)n);
+    const long c = (long)(nextRandom(random) % (unsigned long long)n);
+    writerFace(writer, a, b, c);
+  }
+  return n > 0 ? count : 0;
+}
+
+// A polyline through the random walk, then random chords if more segments
+// were requested. Line records always use plain vertex indices.
+static long writeLineSegments(ObjWriter_t *writer, unsigned long long *random) {
+  const long n = writer->options->n_vertices;
+  const long count = writer->options->n_faces >= 0 ? writer->options->n_faces
+                                                   : (n > 0 ? n - 1 : 0);
+  for (long i = 0; i < count && n > 1; ++i) {
+    if (i + 1 < n) {
+      writerLine(writer, i, i + 1);
+    } else {
+      writerLine(writer, (long)(nextRandom(random) % (unsigned long long)n),
+                 (long)(nextRandom(random) % (unsigned long long)n));
+    }
+  }
+  return n > 1 ? count : 0;
+}
+
+void objGeneratorDefaults(ObjGeneratorOptions_t *options) {
+  memset(options, 0, sizeof(*options));
+  options->topology = OBJ_TOPOLOGY_GRID;
+  options->n_vertices = 1000;
+  options->n_faces = -1;
+  options->index_style = OBJ_INDEX_V;
+  options->float_format = OBJ_FLOAT_FIXED;
+  options->precision = 6;
+  options->seed = 21;
+}
+
+/*!
+ * \brief objGenerate
+ *
+ * Streams a synthetic OBJ model to the given stream.
+ *
+ * \param stats Optional, receives the written vertex, face and byte counts.
+ * \return 0 on success, -1 on invalid options or a write error.
+ */
+int objGenerate(FILE *stream, const ObjGeneratorOptions_t *options,
+                ObjGeneratorStats_t *stats) {
+  static const char *kNames[] = {"grid", "sphere", "soup", "lines"};
+  const int n_names = (int)(sizeof(kNames) / sizeof(kNames[0]));
+  if (stream == NULL || options == NULL || options->n_vertices < 0 ||
+      options->precision < 0 || options->precision > 17 ||
+      (int)options->topology < 0 || (int)options->topology >= n_names) {
+    return -1;
+  }
+  ObjWriter_t *writer = calloc(1, sizeof(ObjWriter_t));
+  if (writer == NULL) return -1;
+  writer->stream = stream;
+  writer->options = options;
+  unsigned long long random = options->seed;
+
+  const char *name = kNames[options->topology];
+  writer->length += (size_t)snprintf(
+      writer->buffer, OBJ_WRITER_SLACK,
+      "# s21_3DViewer generator: %s seed %llu\no %s\n", name, options->seed,
+      name);
+
+  writeVertices(writer, &random);
+
+  long n_faces = 0;
+  if (options->topology == OBJ_TOPOLOGY_SOUP) {
+    n_faces = writeSoupFaces(writer, &random);
+  } else if (options->topology == OBJ_TOPOLOGY_LINES) {
+    n_faces = writeLineSegments(writer, &random);
+  } else {
+    n_faces = writeSurfaceFaces(writer, options->n_faces);
+  }
+  writerFlush(writer);
+
+  if (stats != NULL) {
+    stats->n_vertices = options->n_vertices;
+    stats->n_faces = n_faces;
+    stats->n_bytes = writer->n_bytes;
+  }
+  const int status = writer->failed || ferror(stream) ? -1 : 0;
+  free(writer);
+  return status;
+}
+
+int objGenerateFile(const char *path, const ObjGeneratorOptions_t *options,
+                    ObjGeneratorStats_t *stats) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  const int status = objGenerate(file, options, stats);
+  return fclose(file) == 0 ? status : -1;
+}
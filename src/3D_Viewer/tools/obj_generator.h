@@ -0,0 +1,68 @@
+#ifndef SRC_TOOLS_OBJ_GENERATOR_H_
+#define SRC_TOOLS_OBJ_GENERATOR_H_
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief ObjTopology_t
+ *
+ * Shape of the generated model. Grid and sphere share the same square vertex
+ * layout; the sphere wraps it around the longitude seam and keeps duplicated
+ * pole vertices like most CAD exports do.
+ */
+typedef enum ObjTopology_t {
+  OBJ_TOPOLOGY_GRID,
+  OBJ_TOPOLOGY_SPHERE,
+  OBJ_TOPOLOGY_SOUP,
+  OBJ_TOPOLOGY_LINES
+} ObjTopology_t;
+
+typedef enum ObjIndexStyle_t {
+  OBJ_INDEX_V,       // f 1 2 3
+  OBJ_INDEX_V_VT_VN  // f 1/1/1 2/2/2 3/3/3, with vt and vn per vertex
+} ObjIndexStyle_t;
+
+typedef enum ObjFloatFormat_t {
+  OBJ_FLOAT_FIXED,   // fast path, like %.<precision>f
+  OBJ_FLOAT_GENERAL  // %.<precision>g through snprintf
+} ObjFloatFormat_t;
+
+/*!
+ * \brief ObjGeneratorOptions_t
+ *
+ * n_faces < 0 writes the natural face count of the topology: two triangles
+ * per grid cell, 2 * n_vertices triangles for the soup and a polyline of
+ * n_vertices - 1 segments for lines. Grid and sphere never write more faces
+ * than their surface has.
+ */
+typedef struct ObjGeneratorOptions_t {
+  ObjTopology_t topology;
+  long n_vertices;
+  long n_faces;
+  ObjIndexStyle_t index_style;
+  ObjFloatFormat_t float_format;
+  int precision;
+  unsigned long long seed;
+} ObjGeneratorOptions_t;
+
+typedef struct ObjGeneratorStats_t {
+  long n_vertices;
+  long n_faces;
+  long n_bytes;
+} ObjGeneratorStats_t;
+
+void objGeneratorDefaults(ObjGeneratorOptions_t *options);
+int objGenerate(FILE *stream, const ObjGeneratorOptions_t *options,
+                ObjGeneratorStats_t *stats);
+int objGenerateFile(const char *path, const ObjGeneratorOptions_t *options,
+                    ObjGeneratorStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SRC_TOOLS_OBJ_GENERATOR_H_
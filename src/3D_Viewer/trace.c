@@ -0,0 +1,318 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stage_timer.h"
+
+#define TRACE_BUFFER_EVENTS 65536
+#define TRACE_THREAD_NAME_LENGTH 32
+#define TRACE_PATH_LENGTH 1024
+
+typedef struct TraceEvent_t {
+  const char* name;
+  const char* arg_name;
+  double start_ns;
+  double duration_ns;
+  double arg_value;
+} TraceEvent_t;
+
+/*!
+ * \brief TraceBuffer_t
+ *
+ * Events of one thread. Only the owning thread appends, publishing each event
+ * with a release store of count, so recording takes no lock and the dump can
+ * read any buffer while its thread is still running. A full buffer drops new
+ * events and counts them. Events of an older session than trace_session are
+ * stale; the owner clears them before its next append.
+ */
+typedef struct TraceBuffer_t {
+  struct TraceBuffer_t* next;
+  int thread_id;
+  int exited;
+  char thread_name[TRACE_THREAD_NAME_LENGTH];
+  atomic_long session;
+  atomic_long count;
+  atomic_long dropped;
+  TraceEvent_t events[];
+} TraceBuffer_t;
+
+/*!
+ * \brief TraceThread_t
+ *
+ * Per-thread state. Naming a thread only fills this in; the event buffer is
+ * allocated by the first span recorded while tracing is on.
+ */
+typedef struct TraceThread_t {
+  int thread_id;
+  char name[TRACE_THREAD_NAME_LENGTH];
+  TraceBuffer_t* buffer;
+} TraceThread_t;
+
+volatile int trace_enabled = 0;
+
+// The list is only changed and walked under trace_mutex; appends to a buffer
+// never take it.
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static TraceBuffer_t* trace_buffers = NULL;
+static atomic_long trace_session = 1;
+static atomic_int trace_next_thread_id = 1;
+static _Thread_local TraceThread_t trace_thread;
+static double trace_origin_ns = 0.0;
+static char trace_exit_path[TRACE_PATH_LENGTH];
+
+static TraceThread_t* localThread(void) {
+  if (trace_thread.thread_id == 0) {
+    trace_thread.thread_id = atomic_fetch_add(&trace_next_thread_id, 1);
+    snprintf(trace_thread.name, sizeof(trace_thread.name), "thread %d",
+             trace_thread.thread_id);
+  }
+  return &trace_thread;
+}
+
+/*!
+ * \brief releaseBuffer
+ *
+ * Thread-exit destructor of a buffer. An empty or stale buffer is freed; one
+ * holding events of the current session shrinks to them and stays listed
+ * until the next session starts.
+ */
+static void releaseBuffer(void* value) {
+  TraceBuffer_t* buffer = value;
+  trace_thread.buffer = NULL;
+  pthread_mutex_lock(&trace_mutex);
+  TraceBuffer_t** link = &trace_buffers;
+  while (*link != buffer) link = &(*link)->next;
+  const long count = atomic_load(&buffer->count);
+  if (count == 0 || atomic_load(&buffer->session) !=
+                        atomic_load(&trace_session)) {
+    *link = buffer->next;
+    free(buffer);
+  } else {
+    TraceBuffer_t* shrunk = realloc(
+        buffer, offsetof(TraceBuffer_t, events) + count * sizeof(TraceEvent_t));
+    if (shrunk != NULL) buffer = shrunk;
+    buffer->exited = 1;
+    *link = buffer;
+  }
+  pthread_mutex_unlock(&trace_mutex);
+}
+
+static void createKey(void) { pthread_key_create(&trace_key, releaseBuffer); }
+
+static TraceBuffer_t* localBuffer(void) {
+  TraceThread_t* thread = localThread();
+  if (thread->buffer != NULL) return thread->buffer;
+
+  TraceBuffer_t* buffer =
+      calloc(1, offsetof(TraceBuffer_t, events) +
+                    TRACE_BUFFER_EVENTS * sizeof(TraceEvent_t));
+  if (buffer == NULL) return NULL;
+  buffer->thread_id = thread->thread_id;
+  memcpy(buffer->thread_name, thread->name, sizeof(buffer->thread_name));
+  atomic_store(&buffer->session, atomic_load(&trace_session));
+  pthread_once(&trace_key_once, createKey);
+  pthread_setspecific(trace_key, buffer);
+  pthread_mutex_lock(&trace_mutex);
+  buffer->next = trace_buffers;
+  trace_buffers = buffer;
+  pthread_mutex_unlock(&trace_mutex);
+  thread->buffer = buffer;
+  return buffer;
+}
+
+double traceNow(void) { return stageTimerNow(); }
+
+/*!
+ * \brief traceEnable
+ *
+ * Starts or stops recording. Starting again after a stop discards the events
+ * recorded so far, so each recording session dumps on its own. Only the
+ * session number changes here; each thread clears its own buffer, so a
+ * writer in the middle of an append never sees its count reset under it.
+ */
+void traceEnable(int enabled) {
+  if (enabled && !trace_enabled) {
+    pthread_mutex_lock(&trace_mutex);
+    atomic_fetch_add(&trace_session, 1);
+    // Buffers of exited threads only held events of the last session
+    TraceBuffer_t** link = &trace_buffers;
+    while (*link != NULL) {
+      TraceBuffer_t* buffer = *link;
+      if (buffer->exited) {
+        *link = buffer->next;
+        free(buffer);
+      } else {
+        link = &buffer->next;
+      }
+    }
+    trace_origin_ns = traceNow();
+    pthread_mutex_unlock(&trace_mutex);
+  }
+  trace_enabled = enabled ? 1 : 0;
+}
+
+void traceRecordSpanArg(const char* name, double start_ns, const char* arg_name,
+                        double arg_value) {
+  const double end_ns = traceNow();
+  if (!trace_enabled && trace_thread.buffer == NULL) return;
+  TraceBuffer_t* buffer = localBuffer();
+  if (buffer == NULL) return;
+
+  const long session = atomic_load_explicit(&trace_session,
+                                            memory_order_acquire);
+  if (atomic_load_explicit(&buffer->session, memory_order_relaxed) !=
+      session) {
+    atomic_store_explicit(&buffer->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&buffer->dropped, 0, memory_order_relaxed);
+    atomic_store_explicit(&buffer->session, session, memory_order_release);
+  }
+  const long index = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+  if (index >= TRACE_BUFFER_EVENTS) {
+    atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+    return;
+  }
+  TraceEvent_t* event = &buffer->events[index];
+  event->name = name;
+  event->arg_name = arg_name;
+  event->start_ns = start_ns;
+  event->duration_ns = end_ns - start_ns;
+  event->arg_value = arg_value;
+  atomic_store_explicit(&buffer->count, index + 1, memory_order_release);
+}
+
+/*!
+ * \brief traceRecordSpan
+ *
+ * Records a complete span from start_ns until now on the calling thread.
+ */
+void traceRecordSpan(const char* name, double start_ns) {
+  traceRecordSpanArg(name, start_ns, NULL, 0.0);
+}
+
+/*!
+ * \brief traceSetThreadName
+ *
+ * Names the calling thread in the dump. It allocates nothing, so threads
+ * started on every load may call it while tracing is off.
+ */
+void traceSetThreadName(const char* name) {
+  TraceThread_t* thread = localThread();
+  snprintf(thread->name, sizeof(thread->name), "%s", name);
+  if (thread->buffer != NULL) {
+    pthread_mutex_lock(&trace_mutex);
+    memcpy(thread->buffer->thread_name, thread->name,
+           sizeof(thread->buffer->thread_name));
+    pthread_mutex_unlock(&trace_mutex);
+  }
+}
+
+// Events of the current session in buffer, zero for a stale buffer
+static long sessionCount(TraceBuffer_t* buffer, long session) {
+  if (atomic_load_explicit(&buffer->session, memory_order_acquire) != session) {
+    return 0;
+  }
+  return atomic_load_explicit(&buffer->count, memory_order_acquire);
+}
+
+long traceEventCount(void) {
+  long total = 0;
+  pthread_mutex_lock(&trace_mutex);
+  const long session = atomic_load(&trace_session);
+  for (TraceBuffer_t* buffer = trace_buffers; buffer != NULL;
+       buffer = buffer->next) {
+    total += sessionCount(buffer, session);
+  }
+  pthread_mutex_unlock(&trace_mutex);
+  return total;
+}
+
+// Writes text as a JSON string literal
+static void writeJsonString(FILE* file, const char* text) {
+  fputc('"', file);
+  for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(file, "\\%c", *c);
+    } else if (*c < 0x20) {
+      fprintf(file, "\\u%04x", *c);
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+/*!
+ * \brief traceDump
+ *
+ * Writes all recorded spans in the Chrome trace-event format, readable by
+ * chrome://tracing and Perfetto. Recording may continue during the dump.
+ *
+ * \return 0 on success, -1 if the file could not be written.
+ */
+int traceDump(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) return -1;
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  const char* separator = "";
+  pthread_mutex_lock(&trace_mutex);
+  const long session = atomic_load(&trace_session);
+  for (TraceBuffer_t* buffer = trace_buffers; buffer != NULL;
+       buffer = buffer->next) {
+    const long count = sessionCount(buffer, session);
+    fprintf(file,
+            "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %d, \"args\": {\"name\": ",
+            separator, buffer->thread_id);
+    writeJsonString(file, buffer->thread_name);
+    fprintf(file, ", \"dropped\": %ld}}",
+            count > 0 ? atomic_load(&buffer->dropped) : 0L);
+    separator = ",\n";
+    for (long i = 0; i < count; ++i) {
+      const TraceEvent_t* event = &buffer->events[i];
+      fprintf(file, ",\n{\"name\": ");
+      writeJsonString(file, event->name);
+      fprintf(file,
+              ", \"cat\": \"viewer\", \"ph\": \"X\", \"pid\": 1, "
+              "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+              buffer->thread_id, (event->start_ns - trace_origin_ns) / 1e3,
+              event->duration_ns / 1e3);
+      if (event->arg_name != NULL) {
+        fprintf(file, ", \"args\": {");
+        writeJsonString(file, event->arg_name);
+        fprintf(file, ": %.3f}", event->arg_value);
+      }
+      fprintf(file, "}");
+    }
+  }
+  pthread_mutex_unlock(&trace_mutex);
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+static void dumpAtExit(void) {
+  if (traceDump(trace_exit_path) == 0) {
+    fprintf(stderr, "Trace written to %s\n", trace_exit_path);
+  }
+}
+
+/*!
+ * \brief traceInitFromEnvironment
+ *
+ * When S21_VIEWER_TRACE is set, starts recording immediately and writes the
+ * trace to the path it names when the program exits.
+ */
+void traceInitFromEnvironment(void) {
+  const char* path = getenv("S21_VIEWER_TRACE");
+  if (path == NULL || path[0] == '\0') return;
+  snprintf(trace_exit_path, sizeof(trace_exit_path), "%s", path);
+  traceEnable(1);
+  atexit(dumpAtExit);
+}
@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief trace_enabled
+ *
+ * Non-zero while spans are recorded. It is only written by traceEnable, so
+ * the check at the start of a span is a plain load and one branch.
+ */
+extern volatile int trace_enabled;
+
+double traceNow(void);
+void traceEnable(int enabled);
+void traceRecordSpan(const char* name, double start_ns);
+void traceRecordSpanArg(const char* name, double start_ns, const char* arg_name,
+                        double arg_value);
+void traceSetThreadName(const char* name);
+int traceDump(const char* path);
+void traceInitFromEnvironment(void);
+long traceEventCount(void);
+
+/*!
+ * \brief TRACE_BEGIN / TRACE_END
+ *
+ * Scoped span for C code. TRACE_BEGIN stores a negative start when tracing is
+ * off, TRACE_END then records nothing. name must be a string literal or
+ * otherwise outlive the dump.
+ */
+#define TRACE_BEGIN(var) const double var = trace_enabled ? traceNow() : -1.0
+#define TRACE_END(var, name)                    \
+  do {                                          \
+    if (var >= 0.0) traceRecordSpan(name, var); \
+  } while (0)
+
+#ifdef __cplusplus
+}
+
+/*!
+ * \brief TraceScope
+ *
+ * RAII span for C++ code: records the lifetime of the object under name.
+ */
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name)
+      : name_(name), start_(trace_enabled ? traceNow() : -1.0) {}
+  ~TraceScope() {
+    if (start_ >= 0.0) traceRecordSpan(name_, start_);
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+  double start_;
+};
+#endif
+
+#endif  // TRACE_H
@@ -0,0 +1,268 @@
+#include "weld.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "parallel.h"
+#include "stage_timer.h"
+#include "trace.h"
+
+#define WELD_GRAIN 16384
+#define WELD_MIN_EPSILON 1e-9f
+// Cell edge in merge distances. Larger cells mean fewer neighbour lookups.
+#define WELD_CELL_SCALE 8.0f
+
+/*!
+ * \brief WeldContext_t
+ *
+ * State shared by the parallel passes. Vertices are hashed into cells of
+ * WELD_CELL_SCALE merge distances, so a vertex within epsilon of another lies
+ * in the same cell or, on the axes where it is within epsilon of a cell face,
+ * in the neighbour across that face: 1 to 8 cells, usually 1.
+ * Cells are spread over n_buckets buckets; bucket b holds
+ * order[starts[b]] .. order[starts[b + 1] - 1].
+ */
+typedef struct WeldContext_t {
+  const float* vertices;
+  float inverse_cell;
+  float near_face;
+  float epsilon_squared;
+  uint32_t bucket_mask;
+  atomic_uint* cursors;
+  uint32_t* starts;
+  uint32_t* order;
+  uint32_t* representative;
+  const uint32_t* remap;
+  unsigned int* indices;
+  uint32_t n_vertices;
+} WeldContext_t;
+
+static uint32_t hashCell(int64_t x, int64_t y, int64_t z, uint32_t mask) {
+  uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ull;
+  h ^= (uint64_t)y * 0xC2B2AE3D27D4EB4Full;
+  h ^= (uint64_t)z * 0x165667B19E3779F9ull;
+  h ^= h >> 29;
+  h *= 0xBF58476D1CE4E5B9ull;
+  h ^= h >> 32;
+  return (uint32_t)h & mask;
+}
+
+static uint32_t bucketOf(const WeldContext_t* context, long vertex) {
+  const float* v = &context->vertices[vertex * 3];
+  return hashCell((int64_t)floorf(v[0] * context->inverse_cell),
+                  (int64_t)floorf(v[1] * context->inverse_cell),
+                  (int64_t)floorf(v[2] * context->inverse_cell),
+                  context->bucket_mask);
+}
+
+static void countBuckets(void* argument, long begin, long end) {
+  WeldContext_t* context = argument;
+  for (long i = begin; i < end; ++i) {
+    atomic_fetch_add_explicit(&context->cursors[bucketOf(context, i)], 1,
+                              memory_order_relaxed);
+  }
+}
+
+// The order inside a bucket depends on scheduling, the result does not:
+// the query below only looks for the smallest matching index.
+static void scatterBuckets(void* argument, long begin, long end) {
+  WeldContext_t* context = argument;
+  for (long i = begin; i < end; ++i) {
+    const uint32_t slot = atomic_fetch_add_explicit(
+        &context->cursors[bucketOf(context, i)], 1, memory_order_relaxed);
+    context->order[slot] = (uint32_t)i;
+  }
+}
+
+static uint32_t smallestInBucket(const WeldContext_t* context, uint32_t bucket,
+                                 const float* v, uint32_t best) {
+  for (uint32_t k = context->starts[bucket]; k < context->starts[bucket + 1];
+       ++k) {
+    const uint32_t j = context->order[k];
+    if (j >= best) continue;
+    const float* w = &context->vertices[(size_t)j * 3];
+    const float dx = v[0] - w[0];
+    const float dy = v[1] - w[1];
+    const float dz = v[2] - w[2];
+    if (dx * dx + dy * dy + dz * dz <= context->epsilon_squared) best = j;
+  }
+  return best;
+}
+
+static void findRepresentatives(void* argument, long begin, long end) {
+  WeldContext_t* context = argument;
+  for (long i = begin; i < end; ++i) {
+    const float* v = &context->vertices[i * 3];
+    int64_t cell[3];
+    int64_t side[3];
+    int axes = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float scaled = v[axis] * context->inverse_cell;
+      cell[axis] = (int64_t)floorf(scaled);
+      const float offset = scaled - (float)cell[axis];
+      side[axis] = offset < context->near_face         ? -1
+                   : offset > 1.0f - context->near_face ? 1
+                                                        : 0;
+      if (side[axis] != 0) axes |= 1 << axis;
+    }
+    uint32_t best = (uint32_t)i;
+    for (int corner = 0; corner < 8; ++corner) {
+      if ((corner & axes) != corner) continue;
+      const uint32_t bucket = hashCell(cell[0] + ((corner & 1) ? side[0] : 0),
+                                       cell[1] + ((corner & 2) ? side[1] : 0),
+                                       cell[2] + ((corner & 4) ? side[2] : 0),
+                                       context->bucket_mask);
+      best = smallestInBucket(context, bucket, v, best);
+    }
+    context->representative[i] = best;
+  }
+}
+
+static void remapIndices(void* argument, long begin, long end) {
+  WeldContext_t* context = argument;
+  for (long k = begin; k < end; ++k) {
+    // Out of range indices are left for the renderer to reject as before
+    if (context->indices[k] < context->n_vertices) {
+      context->indices[k] = context->remap[context->indices[k]];
+    }
+  }
+}
+
+/*!
+ * \brief compactVertices
+ *
+ * Resolves every vertex to the root of its chain of representatives (each
+ * representative has a smaller index, so one ascending pass is enough) and
+ * moves the roots to the front, keeping their order.
+ *
+ * \return Number of vertices left.
+ */
+static uint32_t compactVertices(float* vertices, uint32_t n_vertices,
+                                uint32_t* representative, uint32_t* remap) {
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < n_vertices; ++i) {
+    const uint32_t root = representative[representative[i]];
+    representative[i] = root;
+    if (root == i) {
+      vertices[(size_t)next * 3] = vertices[(size_t)i * 3];
+      vertices[(size_t)next * 3 + 1] = vertices[(size_t)i * 3 + 1];
+      vertices[(size_t)next * 3 + 2] = vertices[(size_t)i * 3 + 2];
+      remap[i] = next++;
+    } else {
+      remap[i] = remap[root];
+    }
+  }
+  return next;
+}
+
+static void freeContext(WeldContext_t* context, size_t n_buckets) {
+  const size_t n = context->n_vertices;
+  loaderFree(MEM_LOADER_TEMP, context->cursors,
+             n_buckets * sizeof(atomic_uint));
+  loaderFree(MEM_LOADER_TEMP, context->starts,
+             (n_buckets + 1) * sizeof(uint32_t));
+  loaderFree(MEM_LOADER_TEMP, context->order, n * sizeof(uint32_t));
+  loaderFree(MEM_LOADER_TEMP, context->representative,
+             n * sizeof(uint32_t));
+}
+
+/*!
+ * \brief weldVertices
+ *
+ * Merges vertices closer than epsilon to each other and rewrites indices to
+ * point at the kept vertices. A vertex is merged into the smallest-index
+ * vertex within epsilon, so chains of close vertices collapse into one.
+ * Hashing, bucket filling, the neighbour query and the index rewrite run on
+ * parallelThreadCount() threads; the result does not depend on the thread
+ * count. The vertex array is shrunk to the new count.
+ *
+ * \param vertices Array returned by parseObjFile, may be reallocated.
+ * \param epsilon Merge distance in model coordinates.
+ * \param stats Filled with the counts and merge ratio, may be NULL.
+ * \return 0 on success, -1 if temporary memory could not be allocated or
+ * there are more vertices than 32-bit indices reach, in which case the model
+ * is left unchanged.
+ */
+int weldVertices(float** vertices, long long* n_vertices,
+                 unsigned int* indices, long long n_indices, float epsilon,
+                 WeldStats_t* stats) {
+  // Vertex numbers are 32-bit like the indices
+  if (*n_vertices > UINT32_MAX) return -1;
+  const uint32_t n = *n_vertices > 0 ? (uint32_t)*n_vertices : 0;
+  if (stats != NULL) {
+    stats->vertices_in = n;
+    stats->vertices_out = n;
+    stats->merge_ratio = 0.0;
+    stats->elapsed_ns = 0.0;
+  }
+  if (n == 0) return 0;
+  const double start = stageTimerNow();
+  TRACE_BEGIN(span);
+  if (epsilon < WELD_MIN_EPSILON) epsilon = WELD_MIN_EPSILON;
+
+  size_t n_buckets = 1;
+  while (n_buckets < n) n_buckets <<= 1;
+  WeldContext_t context = {0};
+  context.vertices = *vertices;
+  context.inverse_cell = 1.0f / (WELD_CELL_SCALE * epsilon);
+  // Slightly more than epsilon so rounding cannot hide a neighbour
+  context.near_face = 1.01f / WELD_CELL_SCALE;
+  context.epsilon_squared = epsilon * epsilon;
+  context.bucket_mask = (uint32_t)(n_buckets - 1);
+  context.indices = indices;
+  context.n_vertices = n;
+  context.cursors = loaderAlloc(MEM_LOADER_TEMP,
+                                n_buckets * sizeof(atomic_uint));
+  context.starts =
+      loaderAlloc(MEM_LOADER_TEMP, (n_buckets + 1) * sizeof(uint32_t));
+  context.order = loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  context.representative =
+      loaderAlloc(MEM_LOADER_TEMP, n * sizeof(uint32_t));
+  if (context.cursors == NULL || context.starts == NULL ||
+      context.order == NULL || context.representative == NULL) {
+    freeContext(&context, n_buckets);
+    return -1;
+  }
+
+  for (size_t b = 0; b < n_buckets; ++b) atomic_init(&context.cursors[b], 0);
+  parallelFor(n, WELD_GRAIN, countBuckets, &context);
+  uint32_t offset = 0;
+  for (size_t b = 0; b < n_buckets; ++b) {
+    context.starts[b] = offset;
+    offset += atomic_load_explicit(&context.cursors[b], memory_order_relaxed);
+    atomic_store_explicit(&context.cursors[b], context.starts[b],
+                          memory_order_relaxed);
+  }
+  context.starts[n_buckets] = offset;
+  parallelFor(n, WELD_GRAIN, scatterBuckets, &context);
+  parallelFor(n, WELD_GRAIN, findRepresentatives, &context);
+
+  // order is no longer needed, reuse it for the old to new index mapping
+  const uint32_t kept =
+      compactVertices(*vertices, n, context.representative, context.order);
+  context.remap = context.order;
+  parallelFor(n_indices, WELD_GRAIN, remapIndices, &context);
+  freeContext(&context, n_buckets);
+
+  if (kept < n) {
+    *vertices = loaderShrink(MEM_VERTICES, *vertices,
+                             (size_t)n * 3 * sizeof(float),
+                             (size_t)kept * 3 * sizeof(float));
+  }
+  *n_vertices = kept;
+
+  stageTimerRecord(STAGE_WELD, start, n);
+  if (stats != NULL) {
+    stats->vertices_out = kept;
+    stats->merge_ratio = (double)(n - kept) / (double)n;
+    stats->elapsed_ns = stageTimerGet(STAGE_WELD)->last_ns;
+  }
+  if (span >= 0.0) {
+    traceRecordSpanArg("weldVertices", span, "merge_ratio",
+                       (double)(n - kept) / (double)n);
+  }
+  return 0;
+}
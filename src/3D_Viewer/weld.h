@@ -0,0 +1,32 @@
+#ifndef WELD_H
+#define WELD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Merge distance in normalized model coordinates ([0, 1] after parsing).
+#define WELD_DEFAULT_EPSILON 1e-6f
+
+/*!
+ * \brief WeldStats_t
+ *
+ * Result of a welding pass. merge_ratio is the fraction of the input
+ * vertices that were merged into another vertex.
+ */
+typedef struct WeldStats_t {
+  long long vertices_in;
+  long long vertices_out;
+  double merge_ratio;
+  double elapsed_ns;
+} WeldStats_t;
+
+int weldVertices(float** vertices, long long* n_vertices,
+                 unsigned int* indices, long long n_indices, float epsilon,
+                 WeldStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // WELD_H